@@ -1,12 +1,14 @@
 #include <asm/idt.h>
 #include <drivers/keyboard.h>
 #include <drivers/mouse.h>
+#include <drivers/disk.h>
 #include <drivers/syscall.h>
 #include <asm/port.h>
 #include <asm/processor.h>
 #include <asm/task.h>
 #include <asm/timer.h>
 #include <asm/gdt.h>
+#include <asm/mm.h>
 
 struct idt_entry idt[IDT_ENTRIES];
 struct struct_ptr idtp;
@@ -69,6 +71,10 @@ void idt_handler(uint8_t num, uint32_t err_code) {
         keyboard_handler();
     } else if (num == 44) {
         mouse_handler();
+    } else if (num == 46) {
+        disk_irq_handler();
+    } else if (num == 14 && mm_handle_page_fault(read_cr2(), err_code) == 0) {
+        return;
     } else if (handler_address != 0) {
         void (*handler)(uint8_t, uint32_t) = (void (*)(uint8_t, uint32_t)) handler_address;
         handler(num, err_code);
@@ -88,6 +94,7 @@ void idt_handler(uint8_t num, uint32_t err_code) {
         outb(0xA0, 0x20);
         outb(0x20, 0x20);
     }
+    if (num == 33 || num == 44) task_resched_pending();
 }
 
 void idt_init() {
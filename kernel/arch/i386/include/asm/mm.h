@@ -10,13 +10,16 @@
 #define MIN_BLOCK_SIZE 16
 #define ALIGNMENT 8
 
+#define KMALLOC_MIN_CLASS 16u
+#define KMALLOC_MAX_CLASS 2048u
+#define KMALLOC_CLASS_COUNT 8u
+
 #define USER_VADDR_BASE 0x00400000u
 #define USER_VADDR_SIZE 0x00400000u
 #define USER_STACK_TOP  (USER_VADDR_BASE + USER_VADDR_SIZE - 16u)
 
-#define USER_SLOT_BASE_PHYS 0x02000000u
-#define USER_SLOT_SIZE_PHYS 0x00400000u
-#define USER_SLOT_COUNT 12
+#define PAGE_SIZE 4096u
+#define PMM_MIN_PHYS 0x02000000u
 
 struct mm_map_entry {
     uint32_t base_low;
@@ -39,6 +42,15 @@ typedef struct block_header {
     struct block_header* prev;
 } block_header_t;
 
+typedef struct {
+    uint32_t object_size;
+    uint32_t active_objects;
+    uint32_t total_objects;
+    uint32_t pages;
+    uint32_t allocs;
+    uint32_t frees;
+} kmalloc_class_stats_t;
+
 extern struct mm_map global_mmap;
 
 void mm_init(void);
@@ -47,10 +59,20 @@ void paging_init(void);
 uint32_t mm_kernel_cr3(void);
 void mm_switch_cr3(uint32_t cr3_phys);
 
-int mm_user_slot_alloc(uint32_t *slot_idx_out, uint32_t *phys_base_out);
-void mm_user_slot_free(uint32_t slot_idx);
-uint32_t mm_user_cr3_create(uint32_t user_phys_base);
-void mm_user_cr3_destroy(uint32_t cr3_phys);
+void pmm_init(void);
+uint32_t pmm_alloc_frame(void);
+void pmm_free_frame(uint32_t phys);
+uint32_t pmm_total_frames(void);
+uint32_t pmm_free_frames(void);
+uint32_t mm_cow_fault_count(void);
+
+uint32_t mm_user_space_create(void);
+void mm_user_space_destroy(uint32_t cr3_phys);
+uint32_t mm_user_space_clone(uint32_t src_cr3);
+uint32_t mm_user_resident_pages(uint32_t cr3_phys);
+int mm_user_read(uint32_t cr3_phys, uint32_t vaddr, void *buf, uint32_t size);
+uint32_t mm_user_release(uint32_t cr3_phys, uint32_t vaddr, uint32_t size);
+int mm_handle_page_fault(uint32_t fault_addr, uint32_t err_code);
 
 void* kmalloc(size_t size);
 void* kcalloc(size_t num, size_t size);
@@ -64,3 +86,7 @@ void vfree(void* ptr);
 size_t get_total_heap(void);
 size_t get_used_heap(void);
 size_t get_free_heap(void);
+
+uint32_t kmalloc_class_count(void);
+int kmalloc_class_stats(uint32_t idx, kmalloc_class_stats_t* out);
+void kmalloc_slab_pages(uint32_t* total_out, uint32_t* free_out);
@@ -9,4 +9,10 @@ struct struct_ptr {
 
 #define hlt() __asm__ __volatile__("hlt")
 #define sti() __asm__ __volatile__("sti")
-#define cli() __asm__ __volatile__("cli")
\ No newline at end of file
+#define cli() __asm__ __volatile__("cli")
+
+static inline uint32_t read_cr2(void) {
+	uint32_t v;
+	__asm__ __volatile__("mov %%cr2, %0" : "=r"(v));
+	return v;
+}
@@ -2,7 +2,10 @@
 #include <stdint.h>
 
 #define STACK_SIZE 16384
-#define MAX_TASKS 16
+#define MAX_TASKS 256
+#define TASK_NICE_MIN (-20)
+#define TASK_NICE_MAX 19
+#define TASK_PRIO_LEVELS 40
 
 typedef enum {
     TASK_READY,
@@ -11,18 +14,38 @@ typedef enum {
     TASK_TERMINATED
 } task_state_t;
 
+typedef struct wait_queue {
+    struct task *head;
+    struct task *tail;
+} wait_queue_t;
+
 typedef struct task {
     uint32_t esp;
     uint32_t esp0;
     uint32_t pid;
     uint32_t ppid;
     uint32_t cr3;
-    uint32_t user_slot;
-    uint32_t user_phys_base;
+    uint32_t brk_start;
+    uint32_t brk;
+    uint32_t brk_limit;
     task_state_t state;
     uint8_t *stack;
-    struct task *next;
     uint32_t wake_tick;
+    int32_t nice;
+    uint32_t timeslice;
+    uint32_t slice_left;
+    uint32_t nr_switches;
+    uint32_t nr_preempt;
+    uint32_t run_ticks;
+    uint32_t nr_syscalls;
+    uint8_t on_runq;
+    uint8_t on_sleepq;
+    struct task *rq_next;
+    struct task *rq_prev;
+    struct task *sleep_next;
+    struct wait_queue *wq;
+    struct task *wq_next;
+    wait_queue_t child_wq;
     int32_t exit_status;
     uint32_t term_signal;
     char tty_path[64];
@@ -35,6 +58,20 @@ int task_create(void (*entry)(void*), void *arg);
 void task_yield(void);
 void task_exit(void);
 void schedule(void);
+void task_wake(task_t *task);
+void task_set_exit_hook(void (*hook)(task_t *task));
+void wait_queue_init(wait_queue_t *wq);
+void wait_queue_wake_all(wait_queue_t *wq);
+int task_wait(wait_queue_t *wq, uint32_t timeout_ticks);
+void task_poll_wait(uint32_t timeout_ticks);
+void task_poll_notify(void);
+void task_resched_pending(void);
+void task_preempt_disable(void);
+void task_preempt_enable(void);
+void task_sleep_until(uint32_t tick);
+void task_tick(uint32_t now);
+int task_set_nice(uint32_t pid, int32_t nice);
+int task_get_nice(uint32_t pid, int32_t *nice_out);
 int task_state_by_pid(uint32_t pid);
 task_t *task_find_by_pid(uint32_t pid);
 int task_terminate_by_pid(uint32_t pid, int32_t exit_status, uint32_t term_signal);
@@ -42,5 +79,5 @@ int task_waitpid(int32_t pid, int32_t *status_out, uint32_t options);
 
 extern task_t *current_task;
 extern task_t *_idle_task;
-extern task_t tasks[MAX_TASKS];
+extern task_t *tasks;
 extern int task_count;
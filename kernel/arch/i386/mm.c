@@ -13,15 +13,57 @@ static size_t total_heap_size = 0;
 static size_t used_heap_size = 0;
 static uint32_t kernel_page_directory[1024] __attribute__((aligned(4096)));
 static uint8_t paging_enabled = 0;
-static uint8_t user_slot_used[USER_SLOT_COUNT];
+static uint32_t* pmm_bitmap = NULL;
+static uint32_t pmm_frame_count = 0;
+static uint32_t pmm_free_count = 0;
+static uint32_t pmm_hint = 0;
+static uint16_t* pmm_refs = NULL;
+static uint32_t cow_fault_count = 0;
 struct mm_map global_mmap;
 
+typedef struct slab_page {
+    uint8_t cls;
+    uint8_t reserved;
+    uint16_t inuse;
+    void *free;
+    struct slab_page *next;
+    struct slab_page *prev;
+} slab_page_t;
+
+typedef struct {
+    slab_page_t *partial;
+    uint32_t pages;
+    uint32_t active;
+    uint32_t allocs;
+    uint32_t frees;
+} slab_class_t;
+
+static slab_page_t *slab_pages = NULL;
+static uint32_t slab_page_count = 0;
+static uintptr_t slab_page_base = 0;
+static slab_page_t *slab_pool = NULL;
+static uint32_t slab_pool_total = 0;
+static uint32_t slab_pool_free = 0;
+static slab_class_t slab_classes[KMALLOC_CLASS_COUNT];
+
 #define CR0_PG 0x80000000u
+#define CR0_WP 0x00010000u
 #define CR4_PSE 0x00000010u
 #define PDE_PRESENT 0x001u
 #define PDE_RW 0x002u
 #define PDE_USER 0x004u
 #define PDE_PS 0x080u
+#define PTE_PRESENT 0x001u
+#define PTE_RW 0x002u
+#define PTE_USER 0x004u
+#define PTE_COW 0x200u
+#define PF_PRESENT 0x001u
+#define PF_WRITE 0x002u
+
+#define KHEAP_SIZE 0x1000000u
+#define SLAB_PAGE_SIZE PAGE_SIZE
+#define SLAB_CHUNK_PAGES 16u
+#define VALLOC_TAG 0x56A110C5u
 
 static size_t align_size(size_t size) {
     return (size + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1);
@@ -136,6 +178,166 @@ static void merge_free_blocks(block_header_t* block) {
     }
 }
 
+static uint32_t slab_class_size(uint32_t cls) {
+    return KMALLOC_MIN_CLASS << cls;
+}
+
+static int slab_class_for(size_t size) {
+    uint32_t cls = 0;
+    if (size > KMALLOC_MAX_CLASS) return -1;
+    if (size > KMALLOC_MIN_CLASS)
+        cls = 32u - (uint32_t)__builtin_clz((uint32_t)(size - 1)) - 4u;
+    return (int)cls;
+}
+
+static slab_page_t* slab_page_of(const void* ptr) {
+    uintptr_t addr = (uintptr_t)ptr;
+    uint32_t idx;
+    if (!slab_pages || addr < slab_page_base) return NULL;
+    idx = (uint32_t)((addr - slab_page_base) / SLAB_PAGE_SIZE);
+    if (idx >= slab_page_count || slab_pages[idx].cls == 0) return NULL;
+    return &slab_pages[idx];
+}
+
+static void* slab_page_addr(slab_page_t* page) {
+    return (void*)(slab_page_base + (uintptr_t)(page - slab_pages) * SLAB_PAGE_SIZE);
+}
+
+static void slab_partial_push(slab_class_t* sc, slab_page_t* page) {
+    page->prev = NULL;
+    page->next = sc->partial;
+    if (sc->partial) sc->partial->prev = page;
+    sc->partial = page;
+}
+
+static void slab_partial_remove(slab_class_t* sc, slab_page_t* page) {
+    if (page->prev)
+        page->prev->next = page->next;
+    else
+        sc->partial = page->next;
+    if (page->next)
+        page->next->prev = page->prev;
+    page->next = NULL;
+    page->prev = NULL;
+}
+
+static void* heap_alloc(size_t size) {
+    if (size == 0 || !heap_start) return NULL;
+
+    size = align_size(size);
+    block_header_t* block = find_free_block(size);
+    if (!block) return NULL;
+
+    remove_from_list(block);
+    split_block(block, size);
+
+    block->is_free = 0;
+    used_heap_size += block_total_size(block);
+
+    return get_block_payload(block);
+}
+
+static int slab_pool_refill(void) {
+    uint8_t* raw = (uint8_t*)heap_alloc(SLAB_CHUNK_PAGES * SLAB_PAGE_SIZE + SLAB_PAGE_SIZE);
+    uintptr_t addr;
+    uintptr_t end;
+    if (!raw) return -1;
+    addr = ((uintptr_t)raw + SLAB_PAGE_SIZE - 1) & ~(uintptr_t)(SLAB_PAGE_SIZE - 1);
+    end = (uintptr_t)raw + SLAB_CHUNK_PAGES * SLAB_PAGE_SIZE + SLAB_PAGE_SIZE;
+    for (; addr + SLAB_PAGE_SIZE <= end; addr += SLAB_PAGE_SIZE) {
+        slab_page_t* page = &slab_pages[(addr - slab_page_base) / SLAB_PAGE_SIZE];
+        page->cls = 0;
+        page->inuse = 0;
+        page->free = NULL;
+        page->prev = NULL;
+        page->next = slab_pool;
+        slab_pool = page;
+        slab_pool_total++;
+        slab_pool_free++;
+    }
+    return 0;
+}
+
+static slab_page_t* slab_page_get(uint32_t cls) {
+    slab_page_t* page;
+    uint32_t size = slab_class_size(cls);
+    uint8_t* base;
+    void* head = NULL;
+
+    if (!slab_pool && slab_pool_refill() != 0) return NULL;
+    page = slab_pool;
+    slab_pool = page->next;
+    slab_pool_free--;
+
+    base = (uint8_t*)slab_page_addr(page);
+    for (uint32_t off = SLAB_PAGE_SIZE; off >= size; off -= size) {
+        void** obj = (void**)(base + off - size);
+        *obj = head;
+        head = obj;
+    }
+    page->cls = (uint8_t)(cls + 1);
+    page->inuse = 0;
+    page->free = head;
+    page->next = NULL;
+    page->prev = NULL;
+    slab_classes[cls].pages++;
+    return page;
+}
+
+static void slab_page_put(slab_page_t* page) {
+    slab_classes[page->cls - 1].pages--;
+    page->cls = 0;
+    page->free = NULL;
+    page->prev = NULL;
+    page->next = slab_pool;
+    slab_pool = page;
+    slab_pool_free++;
+}
+
+static void* slab_alloc(uint32_t cls) {
+    slab_class_t* sc = &slab_classes[cls];
+    slab_page_t* page = sc->partial;
+    void** obj;
+
+    if (!page) {
+        page = slab_page_get(cls);
+        if (!page) return NULL;
+        slab_partial_push(sc, page);
+    }
+    obj = (void**)page->free;
+    page->free = *obj;
+    page->inuse++;
+    if (!page->free) slab_partial_remove(sc, page);
+    sc->active++;
+    sc->allocs++;
+    return obj;
+}
+
+static void slab_free(slab_page_t* page, void* ptr) {
+    slab_class_t* sc = &slab_classes[page->cls - 1];
+    uint32_t size = slab_class_size(page->cls - 1);
+    uintptr_t off = (uintptr_t)ptr - (uintptr_t)slab_page_addr(page);
+
+    if ((off % size) != 0 || page->inuse == 0) {
+#ifdef ENABLE_VGA
+        vga_print("Invalid kfree() call!\n");
+#endif
+        return;
+    }
+
+    if (!page->free) slab_partial_push(sc, page);
+    *(void**)ptr = page->free;
+    page->free = ptr;
+    page->inuse--;
+    sc->active--;
+    sc->frees++;
+
+    if (page->inuse == 0 && (page->prev || page->next)) {
+        slab_partial_remove(sc, page);
+        slab_page_put(page);
+    }
+}
+
 void mm_init(void) {
     volatile struct mm_map_entry *entry = (volatile struct mm_map_entry *)MM_MAP_ADDRESS;
     global_mmap.count = 0;
@@ -157,7 +359,6 @@ void paging_init(void) {
     for (uint32_t i = 0; i < 1024; i++) {
         kernel_page_directory[i] = (i << 22) | PDE_PRESENT | PDE_RW | PDE_PS;
     }
-    memset(user_slot_used, 0, sizeof(user_slot_used));
 
     __asm__ __volatile__("mov %%cr4, %0" : "=r"(cr4));
     cr4 |= CR4_PSE;
@@ -166,7 +367,7 @@ void paging_init(void) {
     __asm__ __volatile__("mov %0, %%cr3" : : "r"((uint32_t)kernel_page_directory) : "memory");
 
     __asm__ __volatile__("mov %%cr0, %0" : "=r"(cr0));
-    cr0 |= CR0_PG;
+    cr0 |= CR0_PG | CR0_WP;
     __asm__ __volatile__("mov %0, %%cr0" : : "r"(cr0) : "memory");
 
     paging_enabled = 1;
@@ -181,52 +382,300 @@ void mm_switch_cr3(uint32_t cr3_phys) {
     __asm__ __volatile__("mov %0, %%cr3" : : "r"(cr3_phys) : "memory");
 }
 
-int mm_user_slot_alloc(uint32_t *slot_idx_out, uint32_t *phys_base_out) {
-    uint32_t idx;
-    uint32_t phys;
-
-    if (!slot_idx_out || !phys_base_out) return -1;
-
-    for (idx = 0; idx < USER_SLOT_COUNT; idx++) {
-        if (!user_slot_used[idx]) {
-            user_slot_used[idx] = 1;
-            phys = USER_SLOT_BASE_PHYS + idx * USER_SLOT_SIZE_PHYS;
-            memset((void*)(uintptr_t)phys, 0, USER_SLOT_SIZE_PHYS);
-            *slot_idx_out = idx;
-            *phys_base_out = phys;
-            return 0;
+static int pmm_frame_used(uint32_t idx) {
+    return (pmm_bitmap[idx >> 5] >> (idx & 31u)) & 1u;
+}
+
+static void pmm_mark(uint32_t idx, int used) {
+    if (used)
+        pmm_bitmap[idx >> 5] |= (1u << (idx & 31u));
+    else
+        pmm_bitmap[idx >> 5] &= ~(1u << (idx & 31u));
+}
+
+void pmm_init(void) {
+    uint64_t top = PMM_MIN_PHYS;
+    uint32_t words;
+
+    for (uint32_t i = 0; i < global_mmap.count; i++) {
+        struct mm_map_entry *ent = &global_mmap.entries[i];
+        uint64_t base = ((uint64_t)ent->base_high << 32) | ent->base_low;
+        uint64_t length = ((uint64_t)ent->length_high << 32) | ent->length_low;
+        uint64_t end = base + length;
+        if (ent->type != 1) continue;
+        if (end > 0xFFFFF000ull) end = 0xFFFFF000ull;
+        if (end > top) top = end;
+    }
+
+    pmm_frame_count = (uint32_t)((top - PMM_MIN_PHYS) / PAGE_SIZE);
+    pmm_free_count = 0;
+    pmm_hint = 0;
+    if (pmm_frame_count == 0) return;
+
+    words = (pmm_frame_count + 31u) / 32u;
+    pmm_bitmap = (uint32_t*)kmalloc(words * sizeof(uint32_t));
+    pmm_refs = (uint16_t*)kcalloc(pmm_frame_count, sizeof(uint16_t));
+    if (!pmm_bitmap || !pmm_refs) {
+        kfree(pmm_bitmap);
+        kfree(pmm_refs);
+        pmm_bitmap = NULL;
+        pmm_refs = NULL;
+        pmm_frame_count = 0;
+        return;
+    }
+    memset(pmm_bitmap, 0xFF, words * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < global_mmap.count; i++) {
+        struct mm_map_entry *ent = &global_mmap.entries[i];
+        uint64_t base = ((uint64_t)ent->base_high << 32) | ent->base_low;
+        uint64_t length = ((uint64_t)ent->length_high << 32) | ent->length_low;
+        uint64_t end = base + length;
+        if (ent->type != 1) continue;
+        if (base < PMM_MIN_PHYS) base = PMM_MIN_PHYS;
+        if (end > top) end = top;
+        base = (base + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1);
+        for (; base + PAGE_SIZE <= end; base += PAGE_SIZE) {
+            uint32_t idx = (uint32_t)((base - PMM_MIN_PHYS) / PAGE_SIZE);
+            if (!pmm_frame_used(idx)) continue;
+            pmm_mark(idx, 0);
+            pmm_free_count++;
         }
     }
-    return -1;
 }
 
-void mm_user_slot_free(uint32_t slot_idx) {
-    if (slot_idx >= USER_SLOT_COUNT) return;
-    user_slot_used[slot_idx] = 0;
+uint32_t pmm_alloc_frame(void) {
+    uint32_t words = (pmm_frame_count + 31u) / 32u;
+
+    if (pmm_free_count == 0) return 0;
+    for (uint32_t n = 0; n < words; n++) {
+        uint32_t w = pmm_hint + n;
+        uint32_t bits;
+        uint32_t idx;
+        if (w >= words) w -= words;
+        bits = ~pmm_bitmap[w];
+        if (!bits) continue;
+        idx = w * 32u + (uint32_t)__builtin_ctz(bits);
+        if (idx >= pmm_frame_count) continue;
+        pmm_mark(idx, 1);
+        pmm_refs[idx] = 1;
+        pmm_free_count--;
+        pmm_hint = w;
+        return PMM_MIN_PHYS + idx * PAGE_SIZE;
+    }
+    return 0;
+}
+
+void pmm_free_frame(uint32_t phys) {
+    uint32_t idx;
+    if (phys < PMM_MIN_PHYS || (phys & (PAGE_SIZE - 1)) != 0) return;
+    idx = (phys - PMM_MIN_PHYS) / PAGE_SIZE;
+    if (idx >= pmm_frame_count || !pmm_frame_used(idx)) return;
+    if (pmm_refs[idx] > 1) {
+        pmm_refs[idx]--;
+        return;
+    }
+    pmm_refs[idx] = 0;
+    pmm_mark(idx, 0);
+    pmm_free_count++;
+    if ((idx >> 5) < pmm_hint) pmm_hint = idx >> 5;
+}
+
+static uint32_t pmm_frame_refs(uint32_t phys) {
+    uint32_t idx;
+    if (phys < PMM_MIN_PHYS) return 0;
+    idx = (phys - PMM_MIN_PHYS) / PAGE_SIZE;
+    if (idx >= pmm_frame_count) return 0;
+    return pmm_refs[idx];
 }
 
-uint32_t mm_user_cr3_create(uint32_t user_phys_base) {
+static int pmm_frame_ref(uint32_t phys) {
+    uint32_t idx;
+    if (phys < PMM_MIN_PHYS) return -1;
+    idx = (phys - PMM_MIN_PHYS) / PAGE_SIZE;
+    if (idx >= pmm_frame_count || pmm_refs[idx] == 0xFFFFu) return -1;
+    pmm_refs[idx]++;
+    return 0;
+}
+
+uint32_t pmm_total_frames(void) { return pmm_frame_count; }
+uint32_t mm_cow_fault_count(void) { return cow_fault_count; }
+uint32_t pmm_free_frames(void) { return pmm_free_count; }
+
+static uint32_t* user_page_table(uint32_t cr3_phys) {
+    uint32_t pde;
+    if (!cr3_phys || cr3_phys == (uint32_t)kernel_page_directory) return NULL;
+    pde = ((uint32_t*)(uintptr_t)cr3_phys)[USER_VADDR_BASE >> 22];
+    if (!(pde & PDE_PRESENT) || (pde & PDE_PS)) return NULL;
+    return (uint32_t*)(uintptr_t)(pde & 0xFFFFF000u);
+}
+
+static uint32_t current_cr3(void) {
+    uint32_t cr3;
+    __asm__ __volatile__("mov %%cr3, %0" : "=r"(cr3));
+    return cr3;
+}
+
+static inline void invlpg(uint32_t vaddr) {
+    __asm__ __volatile__("invlpg (%0)" : : "r"(vaddr) : "memory");
+}
+
+uint32_t mm_user_space_create(void) {
     uint32_t *pd;
-    uint32_t user_pde;
+    uint32_t pt;
 
-    if ((user_phys_base & (USER_SLOT_SIZE_PHYS - 1u)) != 0) return 0;
-    pd = (uint32_t*)valloc_aligned(4096, 4096);
+    pd = (uint32_t*)valloc_aligned(PAGE_SIZE, PAGE_SIZE);
     if (!pd) return 0;
+    pt = pmm_alloc_frame();
+    if (!pt) {
+        vfree(pd);
+        return 0;
+    }
+    memset((void*)(uintptr_t)pt, 0, PAGE_SIZE);
 
-    memcpy(pd, kernel_page_directory, 4096);
-    user_pde = (user_phys_base & 0xFFC00000u) | PDE_PRESENT | PDE_RW | PDE_USER | PDE_PS;
-    pd[USER_VADDR_BASE >> 22] = user_pde;
+    memcpy(pd, kernel_page_directory, PAGE_SIZE);
+    pd[USER_VADDR_BASE >> 22] = pt | PDE_PRESENT | PDE_RW | PDE_USER;
     return (uint32_t)pd;
 }
 
-void mm_user_cr3_destroy(uint32_t cr3_phys) {
+void mm_user_space_destroy(uint32_t cr3_phys) {
+    uint32_t *pt = user_page_table(cr3_phys);
     if (!cr3_phys || cr3_phys == (uint32_t)kernel_page_directory) return;
+    if (pt) {
+        for (uint32_t i = 0; i < USER_VADDR_SIZE / PAGE_SIZE; i++) {
+            if (pt[i] & PTE_PRESENT) pmm_free_frame(pt[i] & 0xFFFFF000u);
+        }
+        pmm_free_frame((uint32_t)pt);
+    }
     vfree((void*)(uintptr_t)cr3_phys);
 }
 
+uint32_t mm_user_space_clone(uint32_t src_cr3) {
+    uint32_t *src = user_page_table(src_cr3);
+    uint32_t *dst;
+    uint32_t cr3;
+
+    if (!src) return 0;
+    cr3 = mm_user_space_create();
+    if (!cr3) return 0;
+    dst = user_page_table(cr3);
+
+    for (uint32_t i = 0; i < USER_VADDR_SIZE / PAGE_SIZE; i++) {
+        uint32_t frame;
+        if (!(src[i] & PTE_PRESENT)) continue;
+        frame = src[i] & 0xFFFFF000u;
+        if (pmm_frame_ref(frame) != 0) {
+            uint32_t copy = pmm_alloc_frame();
+            if (!copy) {
+                mm_user_space_destroy(cr3);
+                return 0;
+            }
+            memcpy((void*)(uintptr_t)copy, (const void*)(uintptr_t)frame, PAGE_SIZE);
+            dst[i] = copy | (src[i] & 0xFFFu);
+            continue;
+        }
+        if (src[i] & (PTE_RW | PTE_COW))
+            src[i] = (src[i] & ~PTE_RW) | PTE_COW;
+        dst[i] = src[i];
+    }
+    if (current_cr3() == src_cr3) mm_switch_cr3(src_cr3);
+    return cr3;
+}
+
+uint32_t mm_user_resident_pages(uint32_t cr3_phys) {
+    uint32_t *pt = user_page_table(cr3_phys);
+    uint32_t n = 0;
+    if (!pt) return 0;
+    for (uint32_t i = 0; i < USER_VADDR_SIZE / PAGE_SIZE; i++) {
+        if (pt[i] & PTE_PRESENT) n++;
+    }
+    return n;
+}
+
+uint32_t mm_user_release(uint32_t cr3_phys, uint32_t vaddr, uint32_t size) {
+    uint32_t *pt = user_page_table(cr3_phys);
+    uint32_t start;
+    uint32_t end;
+    uint32_t n = 0;
+    int live;
+
+    if (!pt || size == 0) return 0;
+    if (vaddr < USER_VADDR_BASE || vaddr - USER_VADDR_BASE >= USER_VADDR_SIZE) return 0;
+    if (size > USER_VADDR_BASE + USER_VADDR_SIZE - vaddr) size = USER_VADDR_BASE + USER_VADDR_SIZE - vaddr;
+    start = (vaddr + PAGE_SIZE - 1u) & ~(PAGE_SIZE - 1u);
+    end = (vaddr + size) & ~(PAGE_SIZE - 1u);
+    live = current_cr3() == cr3_phys;
+
+    for (uint32_t va = start; va < end; va += PAGE_SIZE) {
+        uint32_t idx = (va - USER_VADDR_BASE) / PAGE_SIZE;
+        if (!(pt[idx] & PTE_PRESENT)) continue;
+        pmm_free_frame(pt[idx] & 0xFFFFF000u);
+        pt[idx] = 0;
+        if (live) invlpg(va);
+        n++;
+    }
+    return n;
+}
+
+int mm_user_read(uint32_t cr3_phys, uint32_t vaddr, void *buf, uint32_t size) {
+    uint32_t *pt = user_page_table(cr3_phys);
+    uint8_t *out = (uint8_t*)buf;
+    uint32_t done = 0;
+
+    if (!pt || !buf) return -1;
+    if (vaddr < USER_VADDR_BASE || vaddr - USER_VADDR_BASE >= USER_VADDR_SIZE) return 0;
+    if (size > USER_VADDR_BASE + USER_VADDR_SIZE - vaddr) size = USER_VADDR_BASE + USER_VADDR_SIZE - vaddr;
+
+    while (done < size) {
+        uint32_t va = vaddr + done;
+        uint32_t off = va & (PAGE_SIZE - 1);
+        uint32_t chunk = PAGE_SIZE - off;
+        uint32_t pte = pt[(va - USER_VADDR_BASE) / PAGE_SIZE];
+        if (chunk > size - done) chunk = size - done;
+        if (pte & PTE_PRESENT)
+            memcpy(out + done, (const void*)(uintptr_t)((pte & 0xFFFFF000u) + off), chunk);
+        else
+            memset(out + done, 0, chunk);
+        done += chunk;
+    }
+    return (int)done;
+}
+
+int mm_handle_page_fault(uint32_t fault_addr, uint32_t err_code) {
+    uint32_t *pt = user_page_table(current_cr3());
+    uint32_t idx;
+    uint32_t frame;
+
+    if (!pt) return -1;
+    if (fault_addr < USER_VADDR_BASE || fault_addr - USER_VADDR_BASE >= USER_VADDR_SIZE) return -1;
+
+    idx = (fault_addr - USER_VADDR_BASE) / PAGE_SIZE;
+    if (err_code & PF_PRESENT) {
+        uint32_t old = pt[idx] & 0xFFFFF000u;
+        if (!(err_code & PF_WRITE) || !(pt[idx] & PTE_COW)) return -1;
+        cow_fault_count++;
+        if (pmm_frame_refs(old) > 1) {
+            frame = pmm_alloc_frame();
+            if (!frame) return -1;
+            memcpy((void*)(uintptr_t)frame, (const void*)(uintptr_t)old, PAGE_SIZE);
+            pmm_free_frame(old);
+            pt[idx] = frame | (pt[idx] & 0xFFFu);
+        }
+        pt[idx] = (pt[idx] & ~PTE_COW) | PTE_RW;
+        invlpg(fault_addr & ~(PAGE_SIZE - 1));
+        return 0;
+    }
+    if (pt[idx] & PTE_PRESENT) return 0;
+    frame = pmm_alloc_frame();
+    if (!frame) return -1;
+    memset((void*)(uintptr_t)frame, 0, PAGE_SIZE);
+    pt[idx] = frame | PTE_PRESENT | PTE_RW | PTE_USER;
+    invlpg(fault_addr & ~(PAGE_SIZE - 1));
+    return 0;
+}
+
 void kmalloc_init(void) {
     uint64_t heap_base = 0x900000;
-    uint64_t heap_size = 0x1000000;
+    uint64_t heap_size = KHEAP_SIZE;
     int heap_region_found = 0;
 
     for (uint32_t i = 0; i < global_mmap.count; i++) {
@@ -266,22 +715,30 @@ void kmalloc_init(void) {
     free_list = first;
     total_heap_size = block_total_size(first);
     used_heap_size = 0;
+
+    memset(slab_classes, 0, sizeof(slab_classes));
+    slab_pool = NULL;
+    slab_pool_total = 0;
+    slab_pool_free = 0;
+    slab_page_base = (uintptr_t)heap_start & ~(uintptr_t)(SLAB_PAGE_SIZE - 1);
+    slab_page_count = (uint32_t)(((uintptr_t)heap_end - slab_page_base + SLAB_PAGE_SIZE - 1) / SLAB_PAGE_SIZE);
+    slab_pages = (slab_page_t*)heap_alloc(slab_page_count * sizeof(slab_page_t));
+    if (slab_pages)
+        memset(slab_pages, 0, slab_page_count * sizeof(slab_page_t));
+    else
+        slab_page_count = 0;
 }
 
 void* kmalloc(size_t size) {
+    int cls;
     if (size == 0 || !heap_start) return NULL;
 
-    size = align_size(size);
-    block_header_t* block = find_free_block(size);
-    if (!block) return NULL;
-
-    remove_from_list(block);
-    split_block(block, size);
-
-    block->is_free = 0;
-    used_heap_size += block_total_size(block);
-
-    return get_block_payload(block);
+    cls = slab_class_for(size);
+    if (cls >= 0 && slab_pages) {
+        void* p = slab_alloc((uint32_t)cls);
+        if (p) return p;
+    }
+    return heap_alloc(size);
 }
 
 void* kcalloc(size_t num, size_t size) {
@@ -300,6 +757,17 @@ void* krealloc(void* ptr, size_t size) {
         return NULL;
     }
 
+    slab_page_t* page = slab_page_of(ptr);
+    if (page) {
+        uint32_t old_size = slab_class_size(page->cls - 1);
+        if (size <= old_size) return ptr;
+        void* newp = kmalloc(size);
+        if (!newp) return NULL;
+        memcpy(newp, ptr, old_size);
+        kfree(ptr);
+        return newp;
+    }
+
     block_header_t* block = get_block_from_payload(ptr);
     if (!block || block->magic != HEAP_MAGIC) {
 #ifdef ENABLE_VGA
@@ -329,6 +797,12 @@ void* krealloc(void* ptr, size_t size) {
 void kfree(void* ptr) {
     if (!ptr || !heap_start) return;
 
+    slab_page_t* page = slab_page_of(ptr);
+    if (page) {
+        slab_free(page, ptr);
+        return;
+    }
+
     block_header_t* block = get_block_from_payload(ptr);
     if (!block || block->magic != HEAP_MAGIC) {
 #ifdef ENABLE_VGA
@@ -358,20 +832,51 @@ void* valloc(size_t size) {
 void* valloc_aligned(size_t size, size_t alignment) {
     if (alignment < ALIGNMENT) alignment = ALIGNMENT;
     
-    size_t total = size + alignment + sizeof(void*);
+    size_t total = size + alignment + 2 * sizeof(void*);
     void* raw = kmalloc(total);
     if (!raw) return NULL;
 
-    uintptr_t addr = (uintptr_t)raw + sizeof(void*);
+    uintptr_t addr = (uintptr_t)raw + 2 * sizeof(void*);
     uintptr_t aligned = (addr + alignment - 1) & ~(alignment - 1);
+    ((uint32_t*)aligned)[-2] = VALLOC_TAG;
     ((void**)aligned)[-1] = raw;
     return (void*)aligned;
 }
 
 void vfree(void* ptr) {
     if (!ptr) return;
+
+    slab_page_t* page = slab_page_of(ptr);
+    if (page && (((uintptr_t)ptr - (uintptr_t)slab_page_addr(page)) % slab_class_size(page->cls - 1)) == 0) {
+        kfree(ptr);
+        return;
+    }
+
     void* raw = ((void**)ptr)[-1];
-    kfree(raw);
+    if (((uint32_t*)ptr)[-2] == VALLOC_TAG && raw < ptr && raw >= heap_start) {
+        ((uint32_t*)ptr)[-2] = 0;
+        kfree(raw);
+        return;
+    }
+    kfree(ptr);
+}
+
+uint32_t kmalloc_class_count(void) { return KMALLOC_CLASS_COUNT; }
+
+int kmalloc_class_stats(uint32_t idx, kmalloc_class_stats_t* out) {
+    if (idx >= KMALLOC_CLASS_COUNT || !out) return -1;
+    out->object_size = slab_class_size(idx);
+    out->active_objects = slab_classes[idx].active;
+    out->total_objects = slab_classes[idx].pages * (SLAB_PAGE_SIZE / out->object_size);
+    out->pages = slab_classes[idx].pages;
+    out->allocs = slab_classes[idx].allocs;
+    out->frees = slab_classes[idx].frees;
+    return 0;
+}
+
+void kmalloc_slab_pages(uint32_t* total_out, uint32_t* free_out) {
+    if (total_out) *total_out = slab_pool_total;
+    if (free_out) *free_out = slab_pool_free;
 }
 
 size_t get_total_heap(void) { return total_heap_size; }
@@ -14,12 +14,18 @@ static void idle_task(void *arg) {
 }
 
 uint32_t next_pid = 1;
-task_t tasks[MAX_TASKS];
+task_t *tasks = NULL;
 int task_count = 0;
 task_t *current_task = NULL;
 task_t *_idle_task = NULL;
-static task_t *ready_head = NULL;
-static task_t *ready_tail = NULL;
+static task_t *run_head[TASK_PRIO_LEVELS];
+static task_t *run_tail[TASK_PRIO_LEVELS];
+static uint32_t run_bitmap[(TASK_PRIO_LEVELS + 31) / 32];
+static task_t *sleep_head = NULL;
+static uint8_t need_resched = 0;
+static uint32_t preempt_count = 0;
+static wait_queue_t poll_wq;
+static void (*task_exit_hook)(task_t *task) = NULL;
 
 extern void context_switch(uint32_t *old_esp, uint32_t new_esp, uint32_t new_cr3);
 
@@ -41,24 +47,138 @@ static inline void irq_restore(uint32_t flags) {
     else cli();
 }
 
+static uint32_t task_prio(const task_t *task) {
+    return (uint32_t)(task->nice - TASK_NICE_MIN);
+}
+
+static uint32_t task_timeslice(int32_t nice) {
+    return 1u + (uint32_t)(TASK_NICE_MAX - nice) / 4u;
+}
+
+static void runq_push(task_t *task) {
+    uint32_t prio;
+    if (task == _idle_task || task->on_runq) return;
+    prio = task_prio(task);
+    task->rq_next = NULL;
+    task->rq_prev = run_tail[prio];
+    if (run_tail[prio]) run_tail[prio]->rq_next = task;
+    else run_head[prio] = task;
+    run_tail[prio] = task;
+    run_bitmap[prio >> 5] |= (1u << (prio & 31u));
+    task->on_runq = 1;
+}
+
+static void runq_remove(task_t *task) {
+    uint32_t prio;
+    if (!task->on_runq) return;
+    prio = task_prio(task);
+    if (task->rq_prev) task->rq_prev->rq_next = task->rq_next;
+    else run_head[prio] = task->rq_next;
+    if (task->rq_next) task->rq_next->rq_prev = task->rq_prev;
+    else run_tail[prio] = task->rq_prev;
+    if (!run_head[prio]) run_bitmap[prio >> 5] &= ~(1u << (prio & 31u));
+    task->rq_next = NULL;
+    task->rq_prev = NULL;
+    task->on_runq = 0;
+}
+
+static int runq_best_prio(void) {
+    for (uint32_t w = 0; w < (TASK_PRIO_LEVELS + 31) / 32; w++) {
+        if (run_bitmap[w]) return (int)(w * 32u + (uint32_t)__builtin_ctz(run_bitmap[w]));
+    }
+    return -1;
+}
+
+static task_t *runq_pop(void) {
+    int prio = runq_best_prio();
+    task_t *task;
+    if (prio < 0) return NULL;
+    task = run_head[prio];
+    runq_remove(task);
+    return task;
+}
+
+static void sleepq_insert(task_t *task) {
+    task_t **link = &sleep_head;
+    while (*link && (int32_t)((*link)->wake_tick - task->wake_tick) <= 0) link = &(*link)->sleep_next;
+    task->sleep_next = *link;
+    *link = task;
+    task->on_sleepq = 1;
+}
+
+static void sleepq_remove(task_t *task) {
+    task_t **link = &sleep_head;
+    if (!task->on_sleepq) return;
+    while (*link && *link != task) link = &(*link)->sleep_next;
+    if (*link) *link = task->sleep_next;
+    task->sleep_next = NULL;
+    task->on_sleepq = 0;
+}
+
+static void waitq_remove(task_t *task) {
+    task_t **link;
+    wait_queue_t *wq = task->wq;
+    task_t *prev = NULL;
+    if (!wq) return;
+    link = &wq->head;
+    while (*link && *link != task) {
+        prev = *link;
+        link = &(*link)->wq_next;
+    }
+    if (*link) {
+        *link = task->wq_next;
+        if (wq->tail == task) wq->tail = prev;
+    }
+    task->wq = NULL;
+    task->wq_next = NULL;
+}
+
+static void task_notify_parent(task_t *task) {
+    task_t *parent;
+    if (!task || task->ppid == 0) return;
+    parent = task_find_by_pid(task->ppid);
+    if (parent) wait_queue_wake_all(&parent->child_wq);
+}
+
+static void task_sched_reset(task_t *task, int32_t nice) {
+    task->nice = nice;
+    task->timeslice = task_timeslice(nice);
+    task->slice_left = task->timeslice;
+    task->nr_switches = 0;
+    task->nr_preempt = 0;
+    task->run_ticks = 0;
+    task->nr_syscalls = 0;
+    task->brk_start = 0;
+    task->brk = 0;
+    task->brk_limit = 0;
+    task->on_runq = 0;
+    task->on_sleepq = 0;
+    task->rq_next = NULL;
+    task->rq_prev = NULL;
+    task->sleep_next = NULL;
+    task->wq = NULL;
+    task->wq_next = NULL;
+    wait_queue_init(&task->child_wq);
+}
+
 static void task_release_resources(task_t *task) {
     if (!task) return;
     if (task->cr3 && task->cr3 != mm_kernel_cr3()) {
-        mm_user_cr3_destroy(task->cr3);
-    }
-    if (task->user_slot != (uint32_t)-1) {
-        mm_user_slot_free(task->user_slot);
+        mm_user_space_destroy(task->cr3);
     }
     if (task->stack) {
         kfree(task->stack);
     }
     task->stack = NULL;
     task->cr3 = mm_kernel_cr3();
-    task->user_slot = (uint32_t)-1;
-    task->user_phys_base = 0;
 }
 
 void task_init(void (*main_task)(void)) {
+    tasks = (task_t*)kcalloc(MAX_TASKS, sizeof(task_t));
+    if (!tasks) {
+        while (1) hlt();
+    }
+
     uint8_t *idle_stack = (uint8_t*)kmalloc(STACK_SIZE);
     uint32_t *idle_top = (uint32_t*)(idle_stack + STACK_SIZE);
     *--idle_top = 0;
@@ -72,8 +192,6 @@ void task_init(void (*main_task)(void)) {
     idle->ppid = 0;
     idle->state = TASK_READY;
     idle->cr3 = mm_kernel_cr3();
-    idle->user_slot = (uint32_t)-1;
-    idle->user_phys_base = 0;
     idle->stack = idle_stack;
     idle->esp = (uint32_t)idle_top;
     idle->esp0 = (uint32_t)(idle_stack + STACK_SIZE);
@@ -83,7 +201,7 @@ void task_init(void (*main_task)(void)) {
     idle->tty_path[0] = '\0';
     idle->prog_path[0] = '\0';
     idle->cmdline[0] = '\0';
-    idle->next = idle;
+    task_sched_reset(idle, TASK_NICE_MAX);
 
     _idle_task = idle;
 
@@ -92,8 +210,6 @@ void task_init(void (*main_task)(void)) {
     init_task->ppid = 0;
     init_task->state = TASK_RUNNING;
     init_task->cr3 = mm_kernel_cr3();
-    init_task->user_slot = (uint32_t)-1;
-    init_task->user_phys_base = 0;
     init_task->stack = NULL;
     init_task->esp = get_esp();
     init_task->esp0 = get_esp();
@@ -103,13 +219,9 @@ void task_init(void (*main_task)(void)) {
     init_task->tty_path[0] = '\0';
     init_task->prog_path[0] = '\0';
     init_task->cmdline[0] = '\0';
-
-    init_task->next = idle;
-    idle->next = init_task;
+    task_sched_reset(init_task, 0);
 
     current_task = init_task;
-    ready_head = idle;
-    ready_tail = init_task;
 
     (void)main_task;
 }
@@ -148,23 +260,12 @@ int task_create(void (*entry)(void*), void *arg) {
             return -1;
         }
         task = &tasks[task_count++];
-        if (ready_head == NULL) {
-            ready_head = task;
-            ready_tail = task;
-            task->next = task;
-        } else {
-            task->next = ready_head;
-            ready_tail->next = task;
-            ready_tail = task;
-        }
     }
 
     task->pid = next_pid++;
     task->ppid = current_task ? current_task->pid : 0;
     task->state = TASK_READY;
     task->cr3 = mm_kernel_cr3();
-    task->user_slot = (uint32_t)-1;
-    task->user_phys_base = 0;
     task->stack = stack;
     task->esp = (uint32_t)top;
     task->esp0 = (uint32_t)(stack + STACK_SIZE);
@@ -174,6 +275,8 @@ int task_create(void (*entry)(void*), void *arg) {
     task->tty_path[0] = '\0';
     task->prog_path[0] = '\0';
     task->cmdline[0] = '\0';
+    task_sched_reset(task, (current_task && current_task != _idle_task) ? current_task->nice : 0);
+    runq_push(task);
 
     irq_restore(irq_flags);
     return task->pid;
@@ -188,50 +291,179 @@ void task_yield(void) {
     else cli();
 }
 
+void task_set_exit_hook(void (*hook)(task_t *task)) {
+    task_exit_hook = hook;
+}
+
 void task_exit(void) {
+    cli();
+    if (task_exit_hook) task_exit_hook(current_task);
     current_task->state = TASK_TERMINATED;
+    task_notify_parent(current_task);
     
     schedule();
     while (1);
 }
 
 void schedule(void) {
-    task_t *next = current_task;
-    task_t *first_idle = NULL;
-    int found = 0;
-    
-    do {
-        next = next->next;
-        if (next->state == TASK_READY) {
-            if (next == _idle_task) {
-                if (!first_idle) first_idle = next;
-                continue;
-            }
-            found = 1;
-            break;
-        }
-    } while (next != current_task);
+    task_t *prev = current_task;
+    task_t *next;
+
+    need_resched = 0;
+    if (prev->state == TASK_RUNNING) {
+        prev->state = TASK_READY;
+        runq_push(prev);
+    }
+
+    next = runq_pop();
+    if (!next) next = _idle_task;
+    if (next->slice_left == 0) next->slice_left = next->timeslice;
+    next->state = TASK_RUNNING;
+    if (next == prev) return;
+
+    current_task = next;
+    next->nr_switches++;
+    tss.esp0 = next->esp0;
+    context_switch(&prev->esp, next->esp, (next->cr3 ? next->cr3 : mm_kernel_cr3()));
+}
+
+void task_wake(task_t *task) {
+    if (!task || task->state != TASK_BLOCKED) return;
+    sleepq_remove(task);
+    waitq_remove(task);
+    task->state = TASK_READY;
+    runq_push(task);
+    if (current_task && (current_task == _idle_task || task_prio(task) < task_prio(current_task))) {
+        need_resched = 1;
+    }
+}
 
-    if (!found && first_idle) {
-        next = first_idle;
-        found = 1;
+void wait_queue_init(wait_queue_t *wq) {
+    if (!wq) return;
+    wq->head = NULL;
+    wq->tail = NULL;
+}
+
+void wait_queue_wake_all(wait_queue_t *wq) {
+    uint32_t irq_flags;
+    if (!wq) return;
+    irq_flags = irq_save();
+    while (wq->head) {
+        task_t *task = wq->head;
+        if (task->state == TASK_BLOCKED) task_wake(task);
+        else waitq_remove(task);
+    }
+    irq_restore(irq_flags);
+}
+
+int task_wait(wait_queue_t *wq, uint32_t timeout_ticks) {
+    task_t *task = current_task;
+    uint32_t irq_flags;
+    if (!wq || !task || task == _idle_task) return -1;
+
+    irq_flags = irq_save();
+    task->wq = wq;
+    task->wq_next = NULL;
+    if (wq->tail) wq->tail->wq_next = task;
+    else wq->head = task;
+    wq->tail = task;
+    task->state = TASK_BLOCKED;
+    if (timeout_ticks) {
+        task->wake_tick = timer_get_ticks() + timeout_ticks;
+        sleepq_insert(task);
     }
+    schedule();
+    irq_restore(irq_flags);
+    return 0;
+}
+
+void task_poll_wait(uint32_t timeout_ticks) {
+    (void)task_wait(&poll_wq, timeout_ticks);
+}
+
+void task_poll_notify(void) {
+    wait_queue_wake_all(&poll_wq);
+}
+
+void task_resched_pending(void) {
+    if (need_resched && current_task && preempt_count == 0) schedule();
+}
+
+void task_preempt_disable(void) {
+    preempt_count++;
+}
+
+void task_preempt_enable(void) {
+    if (preempt_count > 0) preempt_count--;
+}
+
+void task_sleep_until(uint32_t tick) {
+    if (!current_task || current_task == _idle_task) return;
+    current_task->state = TASK_BLOCKED;
+    current_task->wake_tick = tick;
+    sleepq_insert(current_task);
+    schedule();
+}
 
-    if (found) {
-        task_t *prev = current_task;
-        current_task = next;
-        current_task->state = TASK_RUNNING;
-        tss.esp0 = current_task->esp0;
-        if (prev->state == TASK_RUNNING) {
-            prev->state = TASK_READY;
+void task_tick(uint32_t now) {
+    task_t *cur = current_task;
+    while (sleep_head && (int32_t)(now - sleep_head->wake_tick) >= 0) {
+        task_wake(sleep_head);
+    }
+    if (!cur) return;
+    cur->run_ticks++;
+    if (preempt_count > 0) {
+        if (cur == _idle_task) {
+            if (runq_best_prio() >= 0) need_resched = 1;
+        } else {
+            if (cur->slice_left > 0) cur->slice_left--;
+            if (cur->slice_left == 0) need_resched = 1;
         }
-        context_switch(&prev->esp, next->esp, (current_task->cr3 ? current_task->cr3 : mm_kernel_cr3()));
-    } else {
-        sti();
-        hlt();
-        cli();
+        return;
+    }
+    if (cur == _idle_task) {
+        if (runq_best_prio() >= 0) schedule();
+        return;
+    }
+    if (cur->slice_left > 0) cur->slice_left--;
+    if (cur->slice_left == 0) {
+        cur->nr_preempt++;
         schedule();
+        return;
+    }
+    if (need_resched) schedule();
+}
+
+int task_set_nice(uint32_t pid, int32_t nice) {
+    task_t *task = task_find_by_pid(pid);
+    uint32_t irq_flags;
+    if (!task || task == _idle_task || task->state == TASK_TERMINATED) return -1;
+    if (nice < TASK_NICE_MIN) nice = TASK_NICE_MIN;
+    if (nice > TASK_NICE_MAX) nice = TASK_NICE_MAX;
+
+    irq_flags = irq_save();
+    if (task->on_runq) {
+        runq_remove(task);
+        task->nice = nice;
+        runq_push(task);
+    } else {
+        task->nice = nice;
+    }
+    task->timeslice = task_timeslice(nice);
+    if (task->slice_left > task->timeslice) task->slice_left = task->timeslice;
+    {
+        int best = runq_best_prio();
+        if (best >= 0 && current_task && (uint32_t)best < task_prio(current_task)) need_resched = 1;
     }
+    irq_restore(irq_flags);
+    return 0;
+}
+
+int task_get_nice(uint32_t pid, int32_t *nice_out) {
+    task_t *task = task_find_by_pid(pid);
+    if (!task || !nice_out) return -1;
+    *nice_out = task->nice;
+    return 0;
 }
 
 int task_state_by_pid(uint32_t pid) {
@@ -260,7 +492,12 @@ int task_terminate_by_pid(uint32_t pid, int32_t exit_status, uint32_t term_signa
     }
     task->exit_status = exit_status;
     task->term_signal = term_signal;
+    runq_remove(task);
+    sleepq_remove(task);
+    waitq_remove(task);
+    if (task_exit_hook) task_exit_hook(task);
     task->state = TASK_TERMINATED;
+    task_notify_parent(task);
     return 0;
 }
 
@@ -296,6 +533,6 @@ int task_waitpid(int32_t pid, int32_t *status_out, uint32_t options) {
         }
         if (!has_child) return -1;
         if (options & 1u) return 0;
-        task_yield();
+        if (task_wait(&current_task->child_wq, 0) != 0) task_yield();
     }
 }
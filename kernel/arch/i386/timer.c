@@ -11,13 +11,8 @@ static volatile uint32_t ticks = 0;
 
 void timer_handler(void) {
     ticks++;
-
-    for (int i = 0; i < task_count; i++) {
-        task_t *task = &tasks[i];
-        if (task->state == TASK_BLOCKED && task->wake_tick <= ticks) task->state = TASK_READY;
-    }
-
-    if (current_task != NULL) schedule();
+    vesa_flush();
+    task_tick(ticks);
 }
 
 void timer_init(void) {
@@ -39,8 +34,6 @@ void sleep(uint32_t ms) {
 
     uint32_t deadline = ticks + ticks_to_wait;
     cli();
-    current_task->state = TASK_BLOCKED;
-    current_task->wake_tick = deadline;
-    schedule();
+    task_sleep_until(deadline);
     sti();
 }
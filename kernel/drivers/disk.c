@@ -2,6 +2,9 @@
 #include <asm/port.h>
 #include <asm/mm.h>
 #include <asm/processor.h>
+#include <asm/task.h>
+#include <asm/timer.h>
+#include <drivers/pci.h>
 #include <devctl.h>
 #include <stdint.h>
 #include <string.h>
@@ -19,15 +22,55 @@
 #define ATA_REG_COMMAND    7
 
 #define ATA_SR_BSY 0x80
+#define ATA_SR_DF  0x20
 #define ATA_SR_DRQ 0x08
 #define ATA_SR_ERR 0x01
 
-#define ATA_CMD_READ_SECTORS  0x20
-#define ATA_CMD_WRITE_SECTORS 0x30
-#define ATA_CMD_CACHE_FLUSH   0xE7
-#define ATA_CMD_IDENTIFY      0xEC
+#define ATA_CMD_READ_SECTORS      0x20
+#define ATA_CMD_READ_SECTORS_EXT  0x24
+#define ATA_CMD_READ_DMA_EXT      0x25
+#define ATA_CMD_WRITE_SECTORS     0x30
+#define ATA_CMD_WRITE_SECTORS_EXT 0x34
+#define ATA_CMD_WRITE_DMA_EXT     0x35
+#define ATA_CMD_READ_DMA          0xC8
+#define ATA_CMD_WRITE_DMA         0xCA
+#define ATA_CMD_CACHE_FLUSH       0xE7
+#define ATA_CMD_CACHE_FLUSH_EXT   0xEA
+#define ATA_CMD_IDENTIFY          0xEC
+
+#define ATA_LBA28_END 0x10000000u
+
+#define BM_REG_CMD    0
+#define BM_REG_STATUS 2
+#define BM_REG_PRDT   4
+
+#define BM_CMD_START 0x01
+#define BM_CMD_READ  0x08
+#define BM_SR_ERR    0x02
+#define BM_SR_IRQ    0x04
+
+#define PCI_CMD_OFFSET     0x04
+#define PCI_CMD_IO         0x0001
+#define PCI_CMD_BUS_MASTER 0x0004
+
+#define ATA_DMA_PAGE_SIZE 4096u
+#define ATA_DMA_PAGES ((DISK_MAX_SECTORS * 512u) / ATA_DMA_PAGE_SIZE)
+#define ATA_IRQ_TIMEOUT_TICKS 500u
+
+typedef struct {
+    uint32_t addr;
+    uint16_t bytes;
+    uint16_t flags;
+} __attribute__((packed)) ata_prd_t;
 
 static uint32_t g_total_sectors = 0;
+static uint8_t g_lba48 = 0;
+static uint8_t g_dma_capable = 0;
+static uint8_t g_write_cached = 0;
+static uint16_t g_bm_base = 0;
+static ata_prd_t *g_prdt = NULL;
+static uint32_t g_dma_pages[ATA_DMA_PAGES];
+static volatile uint8_t g_irq_seen = 0;
 
 typedef struct {
     uint32_t base_lba;
@@ -66,6 +109,14 @@ static int ata_wait_drq(void) {
     return -1;
 }
 
+static inline void ata_read_words(uint16_t *dst, uint32_t n) {
+    __asm__ __volatile__("cld; rep insw" : "+D"(dst), "+c"(n) : "d"((uint16_t)(ATA_IO_BASE + ATA_REG_DATA)) : "memory");
+}
+
+static inline void ata_write_words(const uint16_t *src, uint32_t n) {
+    __asm__ __volatile__("cld; rep outsw" : "+S"(src), "+c"(n) : "d"((uint16_t)(ATA_IO_BASE + ATA_REG_DATA)) : "memory");
+}
+
 static int ata_identify(void) {
     uint16_t id[256];
 
@@ -81,43 +132,193 @@ static int ata_identify(void) {
     if (ata_status() == 0) return -1;
     if (ata_wait_drq() != 0) return -1;
 
-    for (uint32_t i = 0; i < 256; i++) id[i] = inw(ATA_IO_BASE + ATA_REG_DATA);
+    ata_read_words(id, 256);
 
     g_total_sectors = ((uint32_t)id[61] << 16) | (uint32_t)id[60];
+    if (id[83] & (1u << 10)) {
+        uint32_t lo = ((uint32_t)id[101] << 16) | (uint32_t)id[100];
+        uint32_t hi = ((uint32_t)id[103] << 16) | (uint32_t)id[102];
+        g_lba48 = 1;
+        if (hi != 0) g_total_sectors = 0xFFFFFFFFu;
+        else if (lo > g_total_sectors) g_total_sectors = lo;
+    }
+    g_dma_capable = (id[49] & (1u << 8)) ? 1 : 0;
     if (g_total_sectors == 0) g_total_sectors = 2880;
     return 0;
 }
 
-static int ata_rw28(uint32_t lba, uint32_t count, void *buffer, int write_mode) {
-    uint16_t *w = (uint16_t*)buffer;
-    if (!buffer || count == 0 || count > 255 || lba > 0x0FFFFFFF) return -1;
+static uint8_t ata_issue(uint32_t lba, uint32_t count, uint8_t cmd28, uint8_t cmd48) {
+    if (g_lba48 && lba + count > ATA_LBA28_END) {
+        outb(ATA_IO_BASE + ATA_REG_DRIVE, 0x40);
+        outb(ATA_IO_BASE + ATA_REG_SECCNT, (uint8_t)((count >> 8) & 0xFF));
+        outb(ATA_IO_BASE + ATA_REG_LBA0, (uint8_t)((lba >> 24) & 0xFF));
+        outb(ATA_IO_BASE + ATA_REG_LBA1, 0);
+        outb(ATA_IO_BASE + ATA_REG_LBA2, 0);
+        outb(ATA_IO_BASE + ATA_REG_SECCNT, (uint8_t)(count & 0xFF));
+        outb(ATA_IO_BASE + ATA_REG_LBA0, (uint8_t)(lba & 0xFF));
+        outb(ATA_IO_BASE + ATA_REG_LBA1, (uint8_t)((lba >> 8) & 0xFF));
+        outb(ATA_IO_BASE + ATA_REG_LBA2, (uint8_t)((lba >> 16) & 0xFF));
+        outb(ATA_IO_BASE + ATA_REG_COMMAND, cmd48);
+        return cmd48;
+    }
+    outb(ATA_IO_BASE + ATA_REG_DRIVE, (uint8_t)(0xE0 | ((lba >> 24) & 0x0F)));
+    outb(ATA_IO_BASE + ATA_REG_SECCNT, (uint8_t)(count & 0xFF));
+    outb(ATA_IO_BASE + ATA_REG_LBA0, (uint8_t)(lba & 0xFF));
+    outb(ATA_IO_BASE + ATA_REG_LBA1, (uint8_t)((lba >> 8) & 0xFF));
+    outb(ATA_IO_BASE + ATA_REG_LBA2, (uint8_t)((lba >> 16) & 0xFF));
+    outb(ATA_IO_BASE + ATA_REG_COMMAND, cmd28);
+    return cmd28;
+}
 
-    for (uint32_t s = 0; s < count; s++) {
-        uint32_t cur = lba + s;
-        if (ata_wait_not_busy() != 0) return -1;
+static int ata_lba_ok(uint32_t lba, uint32_t count) {
+    if (count == 0 || count > DISK_MAX_SECTORS) return 0;
+    if (lba + count < lba) return 0;
+    if (!g_lba48 && lba + count > ATA_LBA28_END) return 0;
+    return 1;
+}
 
-        outb(ATA_IO_BASE + ATA_REG_DRIVE, (uint8_t)(0xE0 | ((cur >> 24) & 0x0F)));
-        outb(ATA_IO_BASE + ATA_REG_SECCNT, 1);
-        outb(ATA_IO_BASE + ATA_REG_LBA0, (uint8_t)(cur & 0xFF));
-        outb(ATA_IO_BASE + ATA_REG_LBA1, (uint8_t)((cur >> 8) & 0xFF));
-        outb(ATA_IO_BASE + ATA_REG_LBA2, (uint8_t)((cur >> 16) & 0xFF));
-        outb(ATA_IO_BASE + ATA_REG_COMMAND, write_mode ? ATA_CMD_WRITE_SECTORS : ATA_CMD_READ_SECTORS);
+static int ata_pio_rw(uint32_t lba, uint32_t count, void *buffer, int write_mode) {
+    uint16_t *w = (uint16_t*)buffer;
 
-        if (ata_wait_drq() != 0) return -1;
+    if (ata_wait_not_busy() != 0) return -1;
+    if (write_mode) ata_issue(lba, count, ATA_CMD_WRITE_SECTORS, ATA_CMD_WRITE_SECTORS_EXT);
+    else ata_issue(lba, count, ATA_CMD_READ_SECTORS, ATA_CMD_READ_SECTORS_EXT);
 
+    for (uint32_t s = 0; s < count; s++) {
+        if (ata_wait_drq() != 0) return -1;
         if (!write_mode) {
-            for (uint32_t i = 0; i < 256; i++) w[s * 256 + i] = inw(ATA_IO_BASE + ATA_REG_DATA);
+            ata_read_words(w + s * 256u, 256);
         } else {
-            for (uint32_t i = 0; i < 256; i++) outw(ATA_IO_BASE + ATA_REG_DATA, w[s * 256 + i]);
+            ata_write_words(w + s * 256u, 256);
             ata_400ns_delay();
         }
     }
 
     if (write_mode) {
         if (ata_wait_not_busy() != 0) return -1;
-        outb(ATA_IO_BASE + ATA_REG_COMMAND, ATA_CMD_CACHE_FLUSH);
-        if (ata_wait_not_busy() != 0) return -1;
+        if (ata_status() & (ATA_SR_ERR | ATA_SR_DF)) return -1;
+        g_write_cached = 1;
+    }
+    return 0;
+}
+
+static int ata_dma_done(void) {
+    if (g_irq_seen) return 1;
+    return (inb(g_bm_base + BM_REG_STATUS) & BM_SR_IRQ) ? 1 : 0;
+}
+
+static int ata_wait_irq(void) {
+    uint32_t flags;
+    uint32_t start = timer_get_ticks();
+    int done;
+
+    __asm__ __volatile__("pushf; pop %0" : "=r"(flags) :: "memory");
+    cli();
+    task_preempt_disable();
+    while (!(done = ata_dma_done()) && timer_get_ticks() - start < ATA_IRQ_TIMEOUT_TICKS) {
+        __asm__ __volatile__("sti; hlt; cli" ::: "memory");
+    }
+    task_preempt_enable();
+    if (flags & (1u << 9)) sti();
+    return done ? 0 : -1;
+}
+
+static int ata_dma_rw(uint32_t lba, uint32_t count, void *buffer, int write_mode) {
+    uint8_t *p = (uint8_t*)buffer;
+    uint32_t bytes = count * 512u;
+    uint32_t pages = (bytes + ATA_DMA_PAGE_SIZE - 1u) / ATA_DMA_PAGE_SIZE;
+    uint8_t dir = write_mode ? 0 : BM_CMD_READ;
+    uint8_t bm_st;
+    uint8_t st;
+    int rc;
+
+    for (uint32_t i = 0; i < pages; i++) {
+        uint32_t chunk = bytes - i * ATA_DMA_PAGE_SIZE;
+        if (chunk > ATA_DMA_PAGE_SIZE) chunk = ATA_DMA_PAGE_SIZE;
+        g_prdt[i].addr = g_dma_pages[i];
+        g_prdt[i].bytes = (uint16_t)chunk;
+        g_prdt[i].flags = (i + 1u == pages) ? 0x8000u : 0;
+        if (write_mode) memcpy((void*)(uintptr_t)g_dma_pages[i], p + i * ATA_DMA_PAGE_SIZE, chunk);
     }
+
+    if (ata_wait_not_busy() != 0) return -1;
+    outb(g_bm_base + BM_REG_CMD, 0);
+    outb(g_bm_base + BM_REG_STATUS, BM_SR_IRQ | BM_SR_ERR);
+    outdw(g_bm_base + BM_REG_PRDT, (uint32_t)(uintptr_t)g_prdt);
+    outb(g_bm_base + BM_REG_CMD, dir);
+
+    g_irq_seen = 0;
+    if (write_mode) ata_issue(lba, count, ATA_CMD_WRITE_DMA, ATA_CMD_WRITE_DMA_EXT);
+    else ata_issue(lba, count, ATA_CMD_READ_DMA, ATA_CMD_READ_DMA_EXT);
+    outb(g_bm_base + BM_REG_CMD, (uint8_t)(dir | BM_CMD_START));
+
+    rc = ata_wait_irq();
+    outb(g_bm_base + BM_REG_CMD, dir);
+    bm_st = inb(g_bm_base + BM_REG_STATUS);
+    st = ata_status();
+    outb(g_bm_base + BM_REG_STATUS, BM_SR_IRQ | BM_SR_ERR);
+    if (rc != 0 || (bm_st & BM_SR_ERR) || (st & (ATA_SR_ERR | ATA_SR_DF | ATA_SR_BSY))) return -1;
+
+    if (write_mode) {
+        g_write_cached = 1;
+    } else {
+        for (uint32_t i = 0; i < pages; i++) {
+            uint32_t chunk = bytes - i * ATA_DMA_PAGE_SIZE;
+            if (chunk > ATA_DMA_PAGE_SIZE) chunk = ATA_DMA_PAGE_SIZE;
+            memcpy(p + i * ATA_DMA_PAGE_SIZE, (const void*)(uintptr_t)g_dma_pages[i], chunk);
+        }
+    }
+    return 0;
+}
+
+static int ata_rw(uint32_t lba, uint32_t count, void *buffer, int write_mode) {
+    if (!buffer || !ata_lba_ok(lba, count)) return -1;
+    if (g_bm_base && ata_dma_rw(lba, count, buffer, write_mode) == 0) return 0;
+    return ata_pio_rw(lba, count, buffer, write_mode);
+}
+
+static void ata_dma_init(void) {
+    const pci_device_t *d = pci_find_class(0x01, 0x01, 0xFF, 0);
+    uint16_t cmd;
+
+    if (!g_dma_capable || !d || !(d->bar[4] & 1u)) return;
+    g_prdt = (ata_prd_t*)valloc_aligned(sizeof(ata_prd_t) * ATA_DMA_PAGES, 256);
+    if (!g_prdt) return;
+    for (uint32_t i = 0; i < ATA_DMA_PAGES; i++) {
+        g_dma_pages[i] = pmm_alloc_frame();
+        if (!g_dma_pages[i]) {
+            while (i-- > 0) pmm_free_frame(g_dma_pages[i]);
+            vfree(g_prdt);
+            g_prdt = NULL;
+            return;
+        }
+    }
+
+    cmd = pci_cfg_read16(d->bus, d->slot, d->func, PCI_CMD_OFFSET);
+    cmd |= PCI_CMD_IO | PCI_CMD_BUS_MASTER;
+    pci_cfg_write16(d->bus, d->slot, d->func, PCI_CMD_OFFSET, cmd);
+    g_bm_base = (uint16_t)(d->bar[4] & 0xFFFCu);
+
+    outb(ATA_CTRL_BASE, 0);
+    outb(0xA1, inb(0xA1) & 0xBF);
+}
+
+void disk_irq_handler(void) {
+    uint8_t bm_st = g_bm_base ? inb(g_bm_base + BM_REG_STATUS) : 0;
+    (void)ata_status();
+    if (!g_bm_base || (bm_st & BM_SR_IRQ)) g_irq_seen = 1;
+}
+
+int disk_flush(void) {
+    if (g_total_sectors == 0) return -1;
+    if (!g_write_cached) return 0;
+    if (ata_wait_not_busy() != 0) return -1;
+    outb(ATA_IO_BASE + ATA_REG_DRIVE, 0xE0);
+    outb(ATA_IO_BASE + ATA_REG_COMMAND, g_lba48 ? ATA_CMD_CACHE_FLUSH_EXT : ATA_CMD_CACHE_FLUSH);
+    ata_400ns_delay();
+    if (ata_wait_not_busy() != 0) return -1;
+    if (ata_status() & (ATA_SR_ERR | ATA_SR_DF)) return -1;
+    g_write_cached = 0;
     return 0;
 }
 
@@ -136,7 +337,7 @@ static void disk_parts_init(void) {
     g_disk_parts[0].total_sectors = g_total_sectors;
     g_disk_parts[0].flags = 1;
 
-    if (ata_rw28(0, 1, mbr, 0) != 0) return;
+    if (ata_rw(0, 1, mbr, 0) != 0) return;
     if (mbr[510] != 0x55 || mbr[511] != 0xAA) return;
 
     for (uint32_t i = 0; i < 4; i++) {
@@ -158,20 +359,20 @@ static void disk_parts_init(void) {
 
 int disk_read_kernel(uint32_t lba, uint32_t count, void *buffer) {
     uint32_t end_lba;
-    if (!buffer || count == 0 || count > 255 || g_total_sectors == 0) return -1;
+    if (!buffer || count == 0 || count > DISK_MAX_SECTORS || g_total_sectors == 0) return -1;
     if (lba >= g_total_sectors) return -1;
     end_lba = lba + count;
     if (end_lba < lba || end_lba > g_total_sectors) return -1;
-    return ata_rw28(lba, count, buffer, 0);
+    return ata_rw(lba, count, buffer, 0);
 }
 
 int disk_write_kernel(uint32_t lba, uint32_t count, const void *buffer) {
     uint32_t end_lba;
-    if (!buffer || count == 0 || count > 255 || g_total_sectors == 0) return -1;
+    if (!buffer || count == 0 || count > DISK_MAX_SECTORS || g_total_sectors == 0) return -1;
     if (lba >= g_total_sectors) return -1;
     end_lba = lba + count;
     if (end_lba < lba || end_lba > g_total_sectors) return -1;
-    return ata_rw28(lba, count, (void*)buffer, 1);
+    return ata_rw(lba, count, (void*)buffer, 1);
 }
 
 int disk_get_partition_info(uint32_t index, uint32_t *start_lba, uint32_t *total_sectors) {
@@ -198,21 +399,23 @@ static int disk_ioctl(void *ctx, uint32_t request, void *arg) {
         uint32_t bytes;
         uint32_t end_lba;
         if (!rw || rw->count == 0 || rw->buffer == 0 || part->total_sectors == 0) return -1;
-        if (rw->count > 255) return -1;
+        if (rw->count > DISK_MAX_SECTORS) return -1;
         if (rw->lba >= part->total_sectors) return -1;
         end_lba = rw->lba + rw->count;
         if (end_lba < rw->lba || end_lba > part->total_sectors) return -1;
         bytes = rw->count * 512u;
         if (bytes / 512u != rw->count) return -1;
         if (rw->buffer + bytes < rw->buffer) return -1;
-        return ata_rw28(part->base_lba + rw->lba, rw->count, (void*)(uintptr_t)rw->buffer, request == DEV_IOCTL_DISK_WRITE);
+        return ata_rw(part->base_lba + rw->lba, rw->count, (void*)(uintptr_t)rw->buffer, request == DEV_IOCTL_DISK_WRITE);
     }
+    if (request == DEV_IOCTL_DISK_FLUSH) return disk_flush();
     return -1;
 }
 
 void disk_init(devfs_t *devfs) {
     if (!devfs) return;
     if (ata_identify() != 0) return;
+    ata_dma_init();
     disk_parts_init();
     devfs_create_dir(devfs, "/disk");
     devfs_create_device_ops(devfs, "/disk/0", 0, 0, 0, disk_ioctl, &g_disk_parts[0]);
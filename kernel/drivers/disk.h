@@ -2,7 +2,11 @@
 
 #include <drivers/filesystem/devfs.h>
 
+#define DISK_MAX_SECTORS 256u
+
 void disk_init(devfs_t *devfs);
+void disk_irq_handler(void);
+int disk_flush(void);
 int disk_read_kernel(uint32_t lba, uint32_t count, void *buffer);
 int disk_write_kernel(uint32_t lba, uint32_t count, const void *buffer);
 int disk_get_partition_info(uint32_t index, uint32_t *start_lba, uint32_t *total_sectors);
@@ -14,6 +14,8 @@
 #define USER_ELF_MAX_VADDR (USER_VADDR_BASE + USER_VADDR_SIZE)
 
 static int g_elf_last_error = 0;
+static uint32_t g_elf_last_start = 0;
+static uint32_t g_elf_last_end = 0;
 
 typedef struct {
     uint8_t e_ident[16];
@@ -52,6 +54,8 @@ static int range_ok(uint32_t vaddr, uint32_t size) {
 
 int elf_load_from_vfs_ex(vfs_t *fs, const char *path, uint32_t *entry_out, char *interp_out, uint32_t interp_cap) {
     g_elf_last_error = 0;
+    g_elf_last_start = 0;
+    g_elf_last_end = 0;
     if (!fs || !path || !entry_out) {
         g_elf_last_error = 1;
         return -1;
@@ -146,6 +150,8 @@ int elf_load_from_vfs_ex(vfs_t *fs, const char *path, uint32_t *entry_out, char
         if (ph[i].p_memsz > ph[i].p_filesz) {
             memset((void*)(uintptr_t)(ph[i].p_vaddr + ph[i].p_filesz), 0, ph[i].p_memsz - ph[i].p_filesz);
         }
+        if (!g_elf_last_end || ph[i].p_vaddr < g_elf_last_start) g_elf_last_start = ph[i].p_vaddr;
+        if (ph[i].p_vaddr + ph[i].p_memsz > g_elf_last_end) g_elf_last_end = ph[i].p_vaddr + ph[i].p_memsz;
     }
 
     if (!range_ok(eh->e_entry, 1)) {
@@ -166,3 +172,8 @@ int elf_load_from_vfs(vfs_t *fs, const char *path, uint32_t *entry_out) {
 int elf_get_last_error(void) {
     return g_elf_last_error;
 }
+
+void elf_get_last_image(uint32_t *start_out, uint32_t *end_out) {
+    if (start_out) *start_out = g_elf_last_start;
+    if (end_out) *end_out = g_elf_last_end;
+}
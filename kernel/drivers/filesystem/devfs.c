@@ -49,6 +49,18 @@ static ssize_t devfs_append_op(void *fs_ctx, const char *path, const void *buf,
     return memfs_append(d->fs, path, buf, size);
 }
 
+static ssize_t devfs_pread_op(void *fs_ctx, const char *path, void *buf, size_t size, uint32_t offset) {
+    devfs_t *d = (devfs_t*)fs_ctx;
+    if (!d || !d->fs) return -1;
+    return memfs_pread(d->fs, path, buf, size, offset);
+}
+
+static ssize_t devfs_pwrite_op(void *fs_ctx, const char *path, const void *buf, size_t size, uint32_t offset) {
+    devfs_t *d = (devfs_t*)fs_ctx;
+    if (!d || !d->fs) return -1;
+    return memfs_pwrite(d->fs, path, buf, size, offset);
+}
+
 static int devfs_ioctl_op(void *fs_ctx, const char *path, uint32_t request, void *arg) {
     devfs_t *d = (devfs_t*)fs_ctx;
     if (!d || !d->fs) return -1;
@@ -108,11 +120,45 @@ static int devfs_get_info_op(void *fs_ctx, const char *path, vfs_info_t *out) {
     memfs_inode in;
     if (!d || !d->fs || !out) return -1;
     if (memfs_get_info(d->fs, path, &in) != 0) return -1;
-    out->type = (vfs_node_type_t)in.type;
-    out->mode = in.mode;
-    out->uid = in.uid;
-    out->gid = in.gid;
-    out->size = in.file.size;
+    memfs_node_info(&in, out);
+    return 0;
+}
+
+static void *devfs_node_open_op(void *fs_ctx, const char *path) {
+    devfs_t *d = (devfs_t*)fs_ctx;
+    if (!d || !d->fs) return NULL;
+    return memfs_node_open(d->fs, path);
+}
+
+static void devfs_node_ref_op(void *fs_ctx, void *node) {
+    (void)fs_ctx;
+    memfs_node_ref((memfs_inode*)node);
+}
+
+static void devfs_node_release_op(void *fs_ctx, void *node) {
+    (void)fs_ctx;
+    memfs_node_release((memfs_inode*)node);
+}
+
+static ssize_t devfs_node_pread_op(void *fs_ctx, void *node, void *buf, size_t size, uint32_t offset) {
+    (void)fs_ctx;
+    return memfs_node_pread((memfs_inode*)node, buf, size, offset);
+}
+
+static ssize_t devfs_node_pwrite_op(void *fs_ctx, void *node, const void *buf, size_t size, uint32_t offset) {
+    (void)fs_ctx;
+    return memfs_node_pwrite((memfs_inode*)node, buf, size, offset);
+}
+
+static int devfs_node_ioctl_op(void *fs_ctx, void *node, uint32_t request, void *arg) {
+    (void)fs_ctx;
+    return memfs_node_ioctl((memfs_inode*)node, request, arg);
+}
+
+static int devfs_node_get_info_op(void *fs_ctx, void *node, vfs_info_t *out) {
+    (void)fs_ctx;
+    if (!node || !out) return -1;
+    memfs_node_info((memfs_inode*)node, out);
     return 0;
 }
 
@@ -131,5 +177,14 @@ const vfs_ops_t g_devfs_vfs_ops = {
     devfs_mkfifo_op,
     devfs_mksock_op,
     devfs_list_op,
-    devfs_get_info_op
+    devfs_get_info_op,
+    devfs_pread_op,
+    devfs_pwrite_op,
+    devfs_node_open_op,
+    devfs_node_ref_op,
+    devfs_node_release_op,
+    devfs_node_pread_op,
+    devfs_node_pwrite_op,
+    devfs_node_ioctl_op,
+    devfs_node_get_info_op
 };
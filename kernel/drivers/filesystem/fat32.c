@@ -13,6 +13,15 @@
 
 #define FAT32_EOC 0x0FFFFFFFu
 
+#define FAT32_CACHE_SECTORS 64u
+#define FAT32_NO_SECTOR 0xFFFFFFFFu
+#define FAT32_FREE_UNKNOWN 0xFFFFFFFFu
+#define FAT32_ZERO_SECTORS 8u
+
+#define FSINFO_LEAD_SIG 0x41615252u
+#define FSINFO_STRUCT_SIG 0x61417272u
+#define FSINFO_TRAIL_SIG 0xAA550000u
+
 enum {
     FAT32_DISK_ATA = 0
 };
@@ -57,6 +66,50 @@ typedef struct {
     uint32_t entry_offset;
 } fat32_found_t;
 
+typedef struct fat32_open_node {
+    fat32_found_t found;
+    uint32_t refs;
+    uint8_t unlinked;
+    struct fat32_open_node *next;
+} fat32_open_node_t;
+
+typedef struct {
+    uint32_t sector;
+    uint32_t stamp;
+    uint8_t dirty;
+    uint8_t data[512];
+} fat32_fat_slot_t;
+
+typedef struct fat32_fat_cache {
+    fat32_fat_slot_t slots[FAT32_CACHE_SECTORS];
+    uint32_t clock;
+    uint32_t last;
+    uint32_t *used_map;
+    uint32_t max_cluster;
+    uint32_t free_count;
+    uint32_t next_free;
+    uint32_t fsinfo_sector;
+    uint8_t fsinfo_dirty;
+    uint8_t fsinfo[512];
+    uint8_t zero[FAT32_ZERO_SECTORS * 512u];
+} fat32_fat_cache_t;
+
+static fat32_open_node_t *fat32_open_find(fat32_fs_t *fs, const fat32_found_t *n) {
+    fat32_open_node_t *it;
+    for (it = fs->open_nodes; it; it = it->next) {
+        if (it->unlinked) continue;
+        if (it->found.entry_rel_sector == n->entry_rel_sector && it->found.entry_offset == n->entry_offset) return it;
+    }
+    return NULL;
+}
+
+static void fat32_open_sync(fat32_fs_t *fs, const fat32_found_t *n) {
+    fat32_open_node_t *o = fat32_open_find(fs, n);
+    if (!o) return;
+    o->found.node.first_cluster = n->node.first_cluster;
+    o->found.node.size = n->node.size;
+}
+
 static int fat32_read_sectors(const fat32_fs_t *fs, uint32_t rel_lba, uint32_t count, void *buf) {
     uint32_t end;
     if (!fs || !buf || count == 0) return -1;
@@ -160,86 +213,262 @@ static void lfn_extract_piece(const fat32_lfn_t *lfn, char *piece, uint32_t cap)
     piece[p] = '\0';
 }
 
+static uint32_t rd_le32(const uint8_t *p) {
+    return ((uint32_t)p[0]) |
+           ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+static void wr_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+    p[2] = (uint8_t)((v >> 16) & 0xFF);
+    p[3] = (uint8_t)((v >> 24) & 0xFF);
+}
+
+static int fat32_cluster_used(const fat32_fat_cache_t *fc, uint32_t cluster) {
+    return (fc->used_map[cluster >> 5] >> (cluster & 31u)) & 1u;
+}
+
+static void fat32_mark_cluster(const fat32_fs_t *fs, uint32_t cluster, int used) {
+    fat32_fat_cache_t *fc = fs->fat_cache;
+    uint32_t bit;
+    if (!fc || !fc->used_map || cluster > fc->max_cluster) return;
+    bit = 1u << (cluster & 31u);
+    if (used && !(fc->used_map[cluster >> 5] & bit)) {
+        fc->used_map[cluster >> 5] |= bit;
+        if (fc->free_count != FAT32_FREE_UNKNOWN && fc->free_count > 0) fc->free_count--;
+        fc->fsinfo_dirty = 1;
+    } else if (!used && (fc->used_map[cluster >> 5] & bit)) {
+        fc->used_map[cluster >> 5] &= ~bit;
+        if (fc->free_count != FAT32_FREE_UNKNOWN) fc->free_count++;
+        fc->fsinfo_dirty = 1;
+    }
+}
+
+static int fat32_slot_writeback(const fat32_fs_t *fs, fat32_fat_slot_t *slot) {
+    uint32_t fat_i;
+    if (!slot->dirty) return 0;
+    for (fat_i = 0; fat_i < fs->num_fats; fat_i++) {
+        uint32_t rel_sec = fs->fat_start_lba + fat_i * fs->fat_size_sectors + slot->sector;
+        if (fat32_write_sectors(fs, rel_sec, 1, slot->data) != 0) return -1;
+    }
+    slot->dirty = 0;
+    return 0;
+}
+
+static fat32_fat_slot_t *fat32_fat_sector(const fat32_fs_t *fs, uint32_t sector) {
+    fat32_fat_cache_t *fc = fs->fat_cache;
+    fat32_fat_slot_t *victim;
+    uint32_t i;
+    if (!fc || sector >= fs->fat_size_sectors) return NULL;
+    if (fc->slots[fc->last].sector == sector) {
+        fc->slots[fc->last].stamp = ++fc->clock;
+        return &fc->slots[fc->last];
+    }
+    victim = &fc->slots[0];
+    for (i = 0; i < FAT32_CACHE_SECTORS; i++) {
+        fat32_fat_slot_t *slot = &fc->slots[i];
+        if (slot->sector == sector) {
+            slot->stamp = ++fc->clock;
+            fc->last = i;
+            return slot;
+        }
+        if (slot->sector == FAT32_NO_SECTOR) {
+            if (victim->sector != FAT32_NO_SECTOR) victim = slot;
+        } else if (victim->sector != FAT32_NO_SECTOR && slot->stamp < victim->stamp) {
+            victim = slot;
+        }
+    }
+    if (victim->sector != FAT32_NO_SECTOR && fat32_slot_writeback(fs, victim) != 0) return NULL;
+    victim->sector = FAT32_NO_SECTOR;
+    if (fat32_read_sectors(fs, fs->fat_start_lba + sector, 1, victim->data) != 0) return NULL;
+    victim->sector = sector;
+    victim->stamp = ++fc->clock;
+    victim->dirty = 0;
+    fc->last = (uint32_t)(victim - fc->slots);
+    return victim;
+}
+
 static int fat32_fat_get(const fat32_fs_t *fs, uint32_t cluster, uint32_t *out_val) {
-    uint8_t sec[512];
+    fat32_fat_slot_t *slot;
     uint32_t fat_off;
-    uint32_t rel_sec;
-    uint32_t off;
-    uint32_t v;
     if (!fs || !out_val || cluster < 2) return -1;
     fat_off = cluster * 4u;
-    rel_sec = fs->fat_start_lba + (fat_off / 512u);
-    off = fat_off % 512u;
-    if (fat32_read_sectors(fs, rel_sec, 1, sec) != 0) return -1;
-    v = (uint32_t)sec[off] |
-        ((uint32_t)sec[off + 1] << 8) |
-        ((uint32_t)sec[off + 2] << 16) |
-        ((uint32_t)sec[off + 3] << 24);
-    *out_val = v & 0x0FFFFFFFu;
+    slot = fat32_fat_sector(fs, fat_off / 512u);
+    if (!slot) return -1;
+    *out_val = rd_le32(slot->data + (fat_off % 512u)) & 0x0FFFFFFFu;
     return 0;
 }
 
 static int fat32_fat_set(const fat32_fs_t *fs, uint32_t cluster, uint32_t value) {
-    uint8_t sec[512];
+    fat32_fat_slot_t *slot;
     uint32_t fat_off;
-    uint32_t rel_sec_in_fat;
     uint32_t off;
-    uint32_t newv;
-    uint32_t fat_i;
+    uint32_t cur;
     if (!fs || cluster < 2) return -1;
-
     fat_off = cluster * 4u;
-    rel_sec_in_fat = fat_off / 512u;
     off = fat_off % 512u;
-    newv = value & 0x0FFFFFFFu;
+    slot = fat32_fat_sector(fs, fat_off / 512u);
+    if (!slot) return -1;
+    cur = rd_le32(slot->data + off);
+    cur = (cur & 0xF0000000u) | (value & 0x0FFFFFFFu);
+    wr_le32(slot->data + off, cur);
+    slot->dirty = 1;
+    fat32_mark_cluster(fs, cluster, (value & 0x0FFFFFFFu) != 0);
+    return 0;
+}
 
-    for (fat_i = 0; fat_i < fs->num_fats; fat_i++) {
-        uint32_t rel_sec = fs->fat_start_lba + fat_i * fs->fat_size_sectors + rel_sec_in_fat;
-        uint32_t cur;
-        if (fat32_read_sectors(fs, rel_sec, 1, sec) != 0) return -1;
-        cur = (uint32_t)sec[off] |
-              ((uint32_t)sec[off + 1] << 8) |
-              ((uint32_t)sec[off + 2] << 16) |
-              ((uint32_t)sec[off + 3] << 24);
-        cur = (cur & 0xF0000000u) | newv;
-        sec[off] = (uint8_t)(cur & 0xFF);
-        sec[off + 1] = (uint8_t)((cur >> 8) & 0xFF);
-        sec[off + 2] = (uint8_t)((cur >> 16) & 0xFF);
-        sec[off + 3] = (uint8_t)((cur >> 24) & 0xFF);
-        if (fat32_write_sectors(fs, rel_sec, 1, sec) != 0) return -1;
+int fat32_sync(fat32_fs_t *fs) {
+    fat32_fat_cache_t *fc;
+    int rc = 0;
+    uint32_t i;
+    if (!fs || !fs->fat_cache) return 0;
+    fc = fs->fat_cache;
+    for (i = 0; i < FAT32_CACHE_SECTORS; i++) {
+        if (fc->slots[i].sector != FAT32_NO_SECTOR && fat32_slot_writeback(fs, &fc->slots[i]) != 0) rc = -1;
+    }
+    if (fc->fsinfo_dirty && fc->fsinfo_sector) {
+        wr_le32(fc->fsinfo + 488, fc->free_count);
+        wr_le32(fc->fsinfo + 492, fc->next_free);
+        if (fat32_write_sectors(fs, fc->fsinfo_sector, 1, fc->fsinfo) != 0) rc = -1;
+        else fc->fsinfo_dirty = 0;
+    }
+    return rc;
+}
+
+void fat32_release(fat32_fs_t *fs) {
+    if (!fs || !fs->fat_cache) return;
+    (void)fat32_sync(fs);
+    (void)disk_flush();
+    if (fs->fat_cache->used_map) kfree(fs->fat_cache->used_map);
+    kfree(fs->fat_cache);
+    fs->fat_cache = NULL;
+}
+
+static int fat32_cache_init(fat32_fs_t *fs, uint32_t fsinfo_sector) {
+    fat32_fat_cache_t *fc;
+    uint32_t max_c;
+    uint32_t words;
+    uint32_t sec;
+    uint32_t i;
+
+    fc = (fat32_fat_cache_t*)kcalloc(1, sizeof(*fc));
+    if (!fc) return -1;
+    for (i = 0; i < FAT32_CACHE_SECTORS; i++) fc->slots[i].sector = FAT32_NO_SECTOR;
+    fs->fat_cache = fc;
+
+    max_c = fat32_max_cluster(fs);
+    if (max_c >= fs->fat_size_sectors * 128u) max_c = fs->fat_size_sectors * 128u - 1u;
+    fc->max_cluster = max_c;
+    fc->next_free = 2;
+    fc->free_count = FAT32_FREE_UNKNOWN;
+
+    words = (max_c >> 5) + 1u;
+    fc->used_map = (uint32_t*)kcalloc(words, sizeof(uint32_t));
+    if (fc->used_map) {
+        uint32_t last_sec = (max_c * 4u) / 512u;
+        uint32_t free_count = 0;
+        fc->used_map[0] = 0x3u;
+        for (sec = 0; sec <= last_sec; sec += FAT32_ZERO_SECTORS) {
+            uint32_t run = last_sec + 1u - sec;
+            uint32_t e;
+            if (run > FAT32_ZERO_SECTORS) run = FAT32_ZERO_SECTORS;
+            if (fat32_read_sectors(fs, fs->fat_start_lba + sec, run, fc->zero) != 0) {
+                kfree(fc->used_map);
+                fc->used_map = NULL;
+                break;
+            }
+            for (e = 0; e < run * 128u; e++) {
+                uint32_t c = sec * 128u + e;
+                if (c < 2) continue;
+                if (c > max_c) break;
+                if (rd_le32(fc->zero + e * 4u) & 0x0FFFFFFFu) fc->used_map[c >> 5] |= 1u << (c & 31u);
+                else free_count++;
+            }
+        }
+        if (fc->used_map) {
+            for (i = (max_c + 1u) & 31u; i != 0 && i < 32u; i++) fc->used_map[words - 1u] |= 1u << i;
+            fc->free_count = free_count;
+        }
+        memset(fc->zero, 0, sizeof(fc->zero));
+    }
+
+    if (fsinfo_sector != 0 && fsinfo_sector < fs->reserved_sectors &&
+        fat32_read_sectors(fs, fsinfo_sector, 1, fc->fsinfo) == 0 &&
+        rd_le32(fc->fsinfo) == FSINFO_LEAD_SIG &&
+        rd_le32(fc->fsinfo + 484) == FSINFO_STRUCT_SIG &&
+        rd_le32(fc->fsinfo + 508) == FSINFO_TRAIL_SIG) {
+        uint32_t hint = rd_le32(fc->fsinfo + 492);
+        fc->fsinfo_sector = fsinfo_sector;
+        if (hint >= 2 && hint <= max_c) fc->next_free = hint;
+        if (!fc->used_map) {
+            uint32_t count = rd_le32(fc->fsinfo + 488);
+            if (count <= max_c) fc->free_count = count;
+        }
+        if (rd_le32(fc->fsinfo + 488) != fc->free_count) fc->fsinfo_dirty = 1;
     }
     return 0;
 }
 
 static int fat32_zero_cluster(const fat32_fs_t *fs, uint32_t cluster) {
-    uint8_t z[512];
     uint32_t rel;
     uint32_t s;
-    if (!fs || cluster < 2) return -1;
-    memset(z, 0, sizeof(z));
+    if (!fs || !fs->fat_cache || cluster < 2) return -1;
     rel = fat32_cluster_to_rel_lba(fs, cluster);
-    for (s = 0; s < fs->sectors_per_cluster; s++) {
-        if (fat32_write_sectors(fs, rel + s, 1, z) != 0) return -1;
+    for (s = 0; s < fs->sectors_per_cluster; s += FAT32_ZERO_SECTORS) {
+        uint32_t run = fs->sectors_per_cluster - s;
+        if (run > FAT32_ZERO_SECTORS) run = FAT32_ZERO_SECTORS;
+        if (fat32_write_sectors(fs, rel + s, run, fs->fat_cache->zero) != 0) return -1;
     }
     return 0;
 }
 
-static int fat32_alloc_cluster(const fat32_fs_t *fs, uint32_t *out_cluster) {
-    uint32_t c;
-    uint32_t max_c;
+static uint32_t fat32_find_free(const fat32_fs_t *fs, uint32_t start) {
+    fat32_fat_cache_t *fc = fs->fat_cache;
+    uint32_t max_c = fc->max_cluster;
+    uint32_t c = start;
+    uint32_t scanned = 0;
     uint32_t v;
-    if (!fs || !out_cluster) return -1;
-    max_c = fat32_max_cluster(fs);
-    for (c = 2; c <= max_c; c++) {
-        if (fat32_fat_get(fs, c, &v) != 0) return -1;
-        if (v == 0) {
-            if (fat32_fat_set(fs, c, FAT32_EOC) != 0) return -1;
-            if (fat32_zero_cluster(fs, c) != 0) return -1;
-            *out_cluster = c;
-            return 0;
+
+    if (c < 2 || c > max_c) c = 2;
+    while (scanned < max_c - 1u) {
+        if (fc->used_map) {
+            if ((c & 31u) == 0 && fc->used_map[c >> 5] == 0xFFFFFFFFu) {
+                scanned += 32u;
+                c += 32u;
+            } else if (!fat32_cluster_used(fc, c)) {
+                return c;
+            } else {
+                scanned++;
+                c++;
+            }
+        } else {
+            if (fat32_fat_get(fs, c, &v) != 0) return 0;
+            if (v == 0) return c;
+            scanned++;
+            c++;
         }
+        if (c > max_c) c = 2;
     }
-    return -1;
+    return 0;
+}
+
+static int fat32_alloc_cluster(const fat32_fs_t *fs, uint32_t *out_cluster) {
+    fat32_fat_cache_t *fc;
+    uint32_t c;
+    if (!fs || !out_cluster || !fs->fat_cache) return -1;
+    fc = fs->fat_cache;
+    if (fc->free_count == 0) return -1;
+    c = fat32_find_free(fs, fc->next_free);
+    if (c < 2) return -1;
+    if (fat32_fat_set(fs, c, FAT32_EOC) != 0) return -1;
+    if (fat32_zero_cluster(fs, c) != 0) return -1;
+    fc->next_free = (c + 1u > fc->max_cluster) ? 2u : c + 1u;
+    fc->fsinfo_dirty = 1;
+    *out_cluster = c;
+    return 0;
 }
 
 static int fat32_free_chain(const fat32_fs_t *fs, uint32_t first_cluster) {
@@ -261,27 +490,6 @@ static int fat32_free_chain(const fat32_fs_t *fs, uint32_t first_cluster) {
     return 0;
 }
 
-static int fat32_chain_last(const fat32_fs_t *fs, uint32_t first_cluster, uint32_t *out_last, uint32_t *out_len) {
-    uint32_t c;
-    uint32_t len = 0;
-    uint32_t guard = 0;
-    uint32_t max_c;
-    if (!fs || !out_last || !out_len || first_cluster < 2) return -1;
-    c = first_cluster;
-    max_c = fat32_max_cluster(fs) + 8;
-    while (1) {
-        uint32_t next;
-        len++;
-        if (fat32_fat_get(fs, c, &next) != 0) return -1;
-        if (fat32_is_eoc(next) || next < 2) break;
-        c = next;
-        if (++guard > max_c) return -1;
-    }
-    *out_last = c;
-    *out_len = len;
-    return 0;
-}
-
 static int fat32_dir_find(const fat32_fs_t *fs, uint32_t dir_cluster, const char *name, fat32_found_t *out) {
     uint8_t sec[512];
     uint32_t c = dir_cluster;
@@ -624,13 +832,6 @@ static int disk_get_total(uint8_t kind, uint8_t index, uint32_t *total, uint32_t
     return -1;
 }
 
-static uint32_t rd_le32(const uint8_t *p) {
-    return ((uint32_t)p[0]) |
-           ((uint32_t)p[1] << 8) |
-           ((uint32_t)p[2] << 16) |
-           ((uint32_t)p[3] << 24);
-}
-
 static int disk_partition_bounds(
     uint8_t kind, uint8_t index, uint32_t partition_index,
     uint32_t *start_out, uint32_t *count_out
@@ -698,6 +899,8 @@ int fat32_init_named(fat32_fs_t *fs, const char *disk_name, uint32_t partition_i
     fs->data_start_lba = fs->reserved_sectors + (uint32_t)fs->num_fats * fs->fat_size_sectors;
     if (fs->data_start_lba >= fs->part_total_sectors) return -1;
     if (fs->root_cluster < 2) return -1;
+    if (fat32_cache_init(fs, (uint32_t)(bs[48] | (bs[49] << 8))) != 0) return -1;
+    (void)fat32_sync(fs);
     return 0;
 }
 
@@ -747,224 +950,292 @@ static int fat32_close_op(void *fs_ctx, int fd) {
     return 0;
 }
 
-static ssize_t fat32_read_op(void *fs_ctx, const char *path, void *buf, size_t size) {
-    fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
-    fat32_found_t n;
+static ssize_t fat32_read_at(const fat32_fs_t *fs, const fat32_node_t *node, void *buf, size_t size, uint32_t offset) {
+    uint32_t cluster_sz;
+    uint32_t want;
+    uint32_t skip;
+    uint32_t pos;
     uint32_t c;
     uint32_t copied = 0;
+    uint8_t *out = (uint8_t*)buf;
     uint8_t sec[512];
 
-    if (!fs || !buf) return -1;
-    if (fat32_resolve(fs, path, &n) != 0) return -1;
-    if (n.node.attr & FAT32_ATTR_DIR) return -1;
+    if (node->attr & FAT32_ATTR_DIR) return -1;
+    if (offset >= node->size || size == 0) return 0;
 
-    c = n.node.first_cluster;
-    if (c < 2 && n.node.size == 0) return 0;
+    want = node->size - offset;
+    if ((uint32_t)size < want) want = (uint32_t)size;
+    cluster_sz = fat32_cluster_size(fs);
 
-    while (c >= 2 && !fat32_is_eoc(c) && copied < size && copied < n.node.size) {
+    c = node->first_cluster;
+    for (skip = offset / cluster_sz; skip > 0; skip--) {
+        if (c < 2 || fat32_is_eoc(c)) return 0;
+        if (fat32_fat_get(fs, c, &c) != 0) return -1;
+    }
+    pos = offset % cluster_sz;
+
+    while (copied < want && c >= 2 && !fat32_is_eoc(c)) {
         uint32_t rel = fat32_cluster_to_rel_lba(fs, c);
-        uint32_t s;
-        for (s = 0; s < fs->sectors_per_cluster; s++) {
-            uint32_t left_file;
-            uint32_t left_buf;
-            uint32_t take;
-            if (copied >= size || copied >= n.node.size) break;
-            if (fat32_read_sectors(fs, rel + s, 1, sec) != 0) return -1;
-            left_file = n.node.size - copied;
-            left_buf = (uint32_t)size - copied;
-            take = (left_file < left_buf) ? left_file : left_buf;
-            if (take > 512) take = 512;
-            memcpy((uint8_t*)buf + copied, sec, take);
-            copied += take;
+        uint32_t s = pos / 512u;
+        uint32_t sec_off = pos % 512u;
+        if (pos == 0 && want - copied >= cluster_sz) {
+            uint32_t max_run = (want - copied) / cluster_sz;
+            uint32_t cap = DISK_MAX_SECTORS / fs->sectors_per_cluster;
+            uint32_t run = 1;
+            uint32_t next;
+            if (cap == 0) cap = 1;
+            if (max_run > cap) max_run = cap;
+            if (fat32_fat_get(fs, c, &next) != 0) return copied ? (ssize_t)copied : -1;
+            while (run < max_run && next == c + run) {
+                if (fat32_fat_get(fs, next, &next) != 0) return copied ? (ssize_t)copied : -1;
+                run++;
+            }
+            if (fat32_read_sectors(fs, rel, run * fs->sectors_per_cluster, out + copied) != 0) return copied ? (ssize_t)copied : -1;
+            copied += run * cluster_sz;
+            c = next;
+            continue;
         }
-        if (fat32_fat_get(fs, c, &c) != 0) return -1;
+        while (s < fs->sectors_per_cluster && copied < want) {
+            uint32_t left = want - copied;
+            if (sec_off == 0 && left >= 512u) {
+                uint32_t run = left / 512u;
+                if (run > fs->sectors_per_cluster - s) run = fs->sectors_per_cluster - s;
+                if (fat32_read_sectors(fs, rel + s, run, out + copied) != 0) return copied ? (ssize_t)copied : -1;
+                copied += run * 512u;
+                s += run;
+            } else {
+                uint32_t take = 512u - sec_off;
+                if (take > left) take = left;
+                if (fat32_read_sectors(fs, rel + s, 1, sec) != 0) return copied ? (ssize_t)copied : -1;
+                memcpy(out + copied, sec + sec_off, take);
+                copied += take;
+                sec_off = 0;
+                s++;
+            }
+        }
+        pos = 0;
+        if (copied < want && fat32_fat_get(fs, c, &c) != 0) return copied ? (ssize_t)copied : -1;
     }
 
     return (ssize_t)copied;
 }
 
-static ssize_t fat32_write_op(void *fs_ctx, const char *path, const void *buf, size_t size) {
-    fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
-    fat32_found_t n;
-    uint32_t old_first;
-    uint32_t new_first = 0;
-    uint32_t prev = 0;
-    uint32_t need_clusters;
+static int fat32_next_or_extend(const fat32_fs_t *fs, uint32_t c, uint32_t *out_next) {
+    uint32_t next;
+    if (fat32_fat_get(fs, c, &next) != 0) return -1;
+    if (fat32_is_eoc(next) || next < 2) {
+        if (fat32_alloc_cluster(fs, &next) != 0) return -1;
+        if (fat32_fat_set(fs, c, next) != 0) {
+            fat32_free_chain(fs, next);
+            return -1;
+        }
+    }
+    *out_next = next;
+    return 0;
+}
+
+/* A write past EOF must not expose stale bytes between the old size and the
+   write offset. Clusters allocated for the gap are zeroed on allocation, so
+   only the tail of the cluster that held the old EOF needs clearing. */
+static int fat32_zero_tail(const fat32_fs_t *fs, uint32_t first, uint32_t old_size, uint32_t offset) {
+    uint32_t cluster_sz = fat32_cluster_size(fs);
+    uint32_t c = first;
+    uint32_t from = old_size % cluster_sz;
+    uint32_t to;
+    uint32_t rel;
+    uint32_t s;
+    uint8_t sec[512];
+
+    if (!fs->fat_cache || first < 2 || offset <= old_size || (from == 0 && old_size > 0)) return 0;
+    to = cluster_sz;
+    if (offset - old_size < cluster_sz - from) to = from + (offset - old_size);
+
+    for (uint32_t skip = old_size / cluster_sz; skip > 0; skip--) {
+        if (fat32_fat_get(fs, c, &c) != 0) return -1;
+        if (fat32_is_eoc(c) || c < 2) return 0;
+    }
+    rel = fat32_cluster_to_rel_lba(fs, c);
+
+    s = from / 512u;
+    if (from % 512u) {
+        uint32_t sec_end = (to < (s + 1u) * 512u) ? to : (s + 1u) * 512u;
+        if (fat32_read_sectors(fs, rel + s, 1, sec) != 0) return -1;
+        memset(sec + from % 512u, 0, sec_end - from);
+        if (fat32_write_sectors(fs, rel + s, 1, sec) != 0) return -1;
+        s++;
+    }
+    while (s < to / 512u) {
+        uint32_t run = to / 512u - s;
+        if (run > FAT32_ZERO_SECTORS) run = FAT32_ZERO_SECTORS;
+        if (fat32_write_sectors(fs, rel + s, run, fs->fat_cache->zero) != 0) return -1;
+        s += run;
+    }
+    if (to % 512u && s * 512u < to) {
+        if (fat32_read_sectors(fs, rel + s, 1, sec) != 0) return -1;
+        memset(sec, 0, to % 512u);
+        if (fat32_write_sectors(fs, rel + s, 1, sec) != 0) return -1;
+    }
+    return 0;
+}
+
+static ssize_t fat32_write_at(const fat32_fs_t *fs, fat32_found_t *n, int update_dirent, const void *buf, size_t size, uint32_t offset) {
     uint32_t cluster_sz;
-    uint32_t left;
+    uint32_t first;
+    uint32_t skip;
+    uint32_t pos;
+    uint32_t c;
+    uint32_t written = 0;
+    uint32_t new_size;
+    int failed = 0;
     const uint8_t *in = (const uint8_t*)buf;
     uint8_t sec[512];
-    uint32_t c;
 
-    if (!fs || (!buf && size > 0)) return -1;
-    if (fat32_resolve(fs, path, &n) != 0) return -1;
-    if (n.node.attr & FAT32_ATTR_DIR) return -1;
+    if (n->node.attr & FAT32_ATTR_DIR) return -1;
+    if (size == 0) return 0;
+    if (offset + (uint32_t)size < offset) return -1;
 
-    old_first = n.node.first_cluster;
     cluster_sz = fat32_cluster_size(fs);
-    need_clusters = (size == 0) ? 0 : (uint32_t)((size + cluster_sz - 1) / cluster_sz);
+    first = n->node.first_cluster;
+    if (first < 2 && fat32_alloc_cluster(fs, &first) != 0) return -1;
+    if (fat32_zero_tail(fs, n->node.first_cluster, n->node.size, offset) != 0) return -1;
 
-    for (c = 0; c < need_clusters; c++) {
-        uint32_t nc;
-        if (fat32_alloc_cluster(fs, &nc) != 0) {
-            if (new_first >= 2) fat32_free_chain(fs, new_first);
-            return -1;
-        }
-        if (prev >= 2 && fat32_fat_set(fs, prev, nc) != 0) {
-            fat32_free_chain(fs, new_first);
-            return -1;
-        }
-        if (new_first < 2) new_first = nc;
-        prev = nc;
+    c = first;
+    for (skip = offset / cluster_sz; skip > 0 && !failed; skip--) {
+        if (fat32_next_or_extend(fs, c, &c) != 0) failed = 1;
     }
+    pos = offset % cluster_sz;
 
-    left = (uint32_t)size;
-    c = new_first;
-    while (left > 0 && c >= 2 && !fat32_is_eoc(c)) {
+    while (!failed && written < (uint32_t)size) {
         uint32_t rel = fat32_cluster_to_rel_lba(fs, c);
-        uint32_t s;
-        for (s = 0; s < fs->sectors_per_cluster; s++) {
-            uint32_t take;
-            if (left == 0) {
-                memset(sec, 0, sizeof(sec));
+        uint32_t s = pos / 512u;
+        uint32_t sec_off = pos % 512u;
+        while (s < fs->sectors_per_cluster && written < (uint32_t)size) {
+            uint32_t left = (uint32_t)size - written;
+            if (sec_off == 0 && left >= 512u) {
+                uint32_t run = left / 512u;
+                if (run > fs->sectors_per_cluster - s) run = fs->sectors_per_cluster - s;
+                if (fat32_write_sectors(fs, rel + s, run, in + written) != 0) {
+                    failed = 1;
+                    break;
+                }
+                written += run * 512u;
+                s += run;
+            } else {
+                uint32_t take = 512u - sec_off;
+                if (take > left) take = left;
+                if (fat32_read_sectors(fs, rel + s, 1, sec) != 0) {
+                    failed = 1;
+                    break;
+                }
+                memcpy(sec + sec_off, in + written, take);
                 if (fat32_write_sectors(fs, rel + s, 1, sec) != 0) {
-                    if (new_first >= 2) fat32_free_chain(fs, new_first);
-                    return -1;
+                    failed = 1;
+                    break;
                 }
-                continue;
-            }
-            take = (left >= 512u) ? 512u : left;
-            memset(sec, 0, sizeof(sec));
-            memcpy(sec, in, take);
-            if (fat32_write_sectors(fs, rel + s, 1, sec) != 0) {
-                if (new_first >= 2) fat32_free_chain(fs, new_first);
-                return -1;
+                written += take;
+                sec_off = 0;
+                s++;
             }
-            in += take;
-            left -= take;
         }
-        if (left == 0) break;
-        if (fat32_fat_get(fs, c, &c) != 0) {
-            if (new_first >= 2) fat32_free_chain(fs, new_first);
-            return -1;
+        pos = 0;
+        if (!failed && written < (uint32_t)size && fat32_next_or_extend(fs, c, &c) != 0) failed = 1;
+    }
+
+    new_size = n->node.size;
+    if (written > 0 && offset + written > new_size) new_size = offset + written;
+    if (new_size != n->node.size || first != n->node.first_cluster) {
+        n->node.size = new_size;
+        n->node.first_cluster = first;
+        if (update_dirent) {
+            fat32_dirent_t e;
+            if (fat32_read_dirent_at(fs, n->entry_rel_sector, n->entry_offset, &e) != 0) return -1;
+            e.first_cluster_hi = (uint16_t)((first >> 16) & 0xFFFFu);
+            e.first_cluster_lo = (uint16_t)(first & 0xFFFFu);
+            e.file_size = new_size;
+            if (fat32_write_dirent_at(fs, n->entry_rel_sector, n->entry_offset, &e) != 0) return -1;
         }
     }
+    return written ? (ssize_t)written : -1;
+}
+
+static ssize_t fat32_read_op(void *fs_ctx, const char *path, void *buf, size_t size) {
+    fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
+    fat32_found_t n;
+
+    if (!fs || !buf) return -1;
+    if (fat32_resolve(fs, path, &n) != 0) return -1;
+    return fat32_read_at(fs, &n.node, buf, size, 0);
+}
+
+static ssize_t fat32_write_file(void *fs_ctx, const char *path, const void *buf, size_t size) {
+    fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
+    fat32_found_t n;
+    fat32_found_t w;
+    uint32_t old_first;
+
+    if (!fs || (!buf && size > 0)) return -1;
+    if (fat32_resolve(fs, path, &n) != 0) return -1;
+    if (n.node.attr & FAT32_ATTR_DIR) return -1;
+
+    old_first = n.node.first_cluster;
+    w = n;
+    w.node.first_cluster = 0;
+    w.node.size = 0;
+    if (size > 0 && fat32_write_at(fs, &w, 0, buf, size, 0) != (ssize_t)size) {
+        if (w.node.first_cluster >= 2) fat32_free_chain(fs, w.node.first_cluster);
+        return -1;
+    }
 
     {
         fat32_dirent_t e;
         if (fat32_read_dirent_at(fs, n.entry_rel_sector, n.entry_offset, &e) != 0) return -1;
-        e.first_cluster_hi = (uint16_t)((new_first >> 16) & 0xFFFFu);
-        e.first_cluster_lo = (uint16_t)(new_first & 0xFFFFu);
+        e.first_cluster_hi = (uint16_t)((w.node.first_cluster >> 16) & 0xFFFFu);
+        e.first_cluster_lo = (uint16_t)(w.node.first_cluster & 0xFFFFu);
         e.file_size = (uint32_t)size;
         if (fat32_write_dirent_at(fs, n.entry_rel_sector, n.entry_offset, &e) != 0) return -1;
     }
-    
-    
+    n.node.first_cluster = w.node.first_cluster;
+    n.node.size = (uint32_t)size;
+    fat32_open_sync(fs, &n);
+
     if (old_first >= 2) (void)fat32_free_chain(fs, old_first);
 
     return (ssize_t)size;
 }
 
-static ssize_t fat32_append_op(void *fs_ctx, const char *path, const void *buf, size_t size) {
+static ssize_t fat32_append_file(void *fs_ctx, const char *path, const void *buf, size_t size) {
     fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
     fat32_found_t n;
-    uint32_t cluster_sz;
-    uint32_t old_size;
-    uint32_t written = 0;
-    const uint8_t *in = (const uint8_t*)buf;
+    ssize_t r;
 
     if (!fs || (!buf && size > 0)) return -1;
     if (size == 0) return 0;
     if (fat32_resolve(fs, path, &n) != 0) return -1;
     if (n.node.attr & FAT32_ATTR_DIR) return -1;
 
-    old_size = n.node.size;
-    cluster_sz = fat32_cluster_size(fs);
-
-    if (n.node.first_cluster < 2 || old_size == 0) return fat32_write_op(fs_ctx, path, buf, size);
-
-    {
-        uint32_t last;
-        uint32_t chain_len;
-        uint32_t used_in_last;
-
-        if (fat32_chain_last(fs, n.node.first_cluster, &last, &chain_len) != 0) return -1;
-        (void)chain_len;
-
-        used_in_last = old_size % cluster_sz;
-        if (used_in_last != 0) {
-            uint32_t rel = fat32_cluster_to_rel_lba(fs, last);
-            uint32_t sec_idx = used_in_last / 512u;
-            uint32_t sec_off = used_in_last % 512u;
-            uint8_t sec[512];
-            uint32_t take;
-
-            if (fat32_read_sectors(fs, rel + sec_idx, 1, sec) != 0) return -1;
-            take = (uint32_t)size;
-            if (take > 512u - sec_off) take = 512u - sec_off;
-            memcpy(sec + sec_off, in, take);
-            if (fat32_write_sectors(fs, rel + sec_idx, 1, sec) != 0) return -1;
-            in += take;
-            size -= take;
-            written += take;
-
-            while (size > 0 && ++sec_idx < fs->sectors_per_cluster) {
-                take = (uint32_t)size;
-                if (take > 512u) take = 512u;
-                memset(sec, 0, sizeof(sec));
-                memcpy(sec, in, take);
-                if (fat32_write_sectors(fs, rel + sec_idx, 1, sec) != 0) return -1;
-                in += take;
-                size -= take;
-                written += take;
-            }
-        }
-
-        while (size > 0) {
-            uint32_t nc;
-            uint32_t rel;
-            uint32_t s;
-            uint8_t sec[512];
-
-            if (fat32_alloc_cluster(fs, &nc) != 0) break;
-            if (fat32_fat_set(fs, last, nc) != 0) {
-                fat32_free_chain(fs, nc);
-                break;
-            }
-            if (fat32_fat_set(fs, nc, FAT32_EOC) != 0) {
-                fat32_free_chain(fs, nc);
-                break;
-            }
-            last = nc;
-
-            rel = fat32_cluster_to_rel_lba(fs, nc);
-            for (s = 0; s < fs->sectors_per_cluster; s++) {
-                uint32_t take;
-                if (size == 0) {
-                    memset(sec, 0, sizeof(sec));
-                    if (fat32_write_sectors(fs, rel + s, 1, sec) != 0) break;
-                    continue;
-                }
-                take = (uint32_t)size;
-                if (take > 512u) take = 512u;
-                memset(sec, 0, sizeof(sec));
-                memcpy(sec, in, take);
-                if (fat32_write_sectors(fs, rel + s, 1, sec) != 0) break;
-                in += take;
-                size -= take;
-                written += take;
-            }
-        }
+    r = fat32_write_at(fs, &n, 1, buf, size, n.node.size);
+    fat32_open_sync(fs, &n);
+    return r;
+}
 
-        if (written > 0) {
-            fat32_dirent_t e;
-            if (fat32_read_dirent_at(fs, n.entry_rel_sector, n.entry_offset, &e) != 0) return -1;
-            e.file_size = old_size + written;
-            if (fat32_write_dirent_at(fs, n.entry_rel_sector, n.entry_offset, &e) != 0) return -1;
-        }
-    }
+static ssize_t fat32_pread_op(void *fs_ctx, const char *path, void *buf, size_t size, uint32_t offset) {
+    fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
+    fat32_found_t n;
+    if (!fs || !buf) return -1;
+    if (fat32_resolve(fs, path, &n) != 0) return -1;
+    return fat32_read_at(fs, &n.node, buf, size, offset);
+}
 
-    return (ssize_t)written;
+static ssize_t fat32_pwrite_file(void *fs_ctx, const char *path, const void *buf, size_t size, uint32_t offset) {
+    fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
+    fat32_found_t n;
+    ssize_t r;
+    if (!fs || !buf) return -1;
+    if (size == 0) return 0;
+    if (fat32_resolve(fs, path, &n) != 0) return -1;
+    r = fat32_write_at(fs, &n, 1, buf, size, offset);
+    fat32_open_sync(fs, &n);
+    return r;
 }
 
 static int fat32_ioctl_op(void *fs_ctx, const char *path, uint32_t request, void *arg) {
@@ -975,7 +1246,7 @@ static int fat32_ioctl_op(void *fs_ctx, const char *path, uint32_t request, void
     return -1;
 }
 
-static int fat32_mkdir_op(void *fs_ctx, const char *path) {
+static int fat32_mkdir(void *fs_ctx, const char *path) {
     fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
     uint32_t parent_cluster;
     char name[256];
@@ -1012,7 +1283,7 @@ static int fat32_mkdir_op(void *fs_ctx, const char *path) {
     return 0;
 }
 
-static int fat32_create_file_op(void *fs_ctx, const char *path) {
+static int fat32_create_file(void *fs_ctx, const char *path) {
     fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
     uint32_t parent_cluster;
     char name[256];
@@ -1040,20 +1311,27 @@ static int fat32_link_op(void *fs_ctx, const char *oldpath, const char *newpath)
     return -1;
 }
 
-static int fat32_unlink_op(void *fs_ctx, const char *path) {
+static int fat32_unlink(void *fs_ctx, const char *path) {
     fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
     fat32_found_t n;
     if (!fs || !path) return -1;
     if (fat32_resolve(fs, path, &n) != 0) return -1;
     if (n.node.attr & FAT32_ATTR_DIR) return -1;
     if (fat32_mark_deleted_at(fs, n.entry_rel_sector, n.entry_offset) != 0) return -1;
+    {
+        fat32_open_node_t *o = fat32_open_find(fs, &n);
+        if (o) {
+            o->unlinked = 1;
+            return 0;
+        }
+    }
     if (n.node.first_cluster >= 2) {
         if (fat32_free_chain(fs, n.node.first_cluster) != 0) return -1;
     }
     return 0;
 }
 
-static int fat32_rmdir_op(void *fs_ctx, const char *path) {
+static int fat32_rmdir(void *fs_ctx, const char *path) {
     fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
     fat32_found_t n;
     uint32_t dir_cluster;
@@ -1173,21 +1451,144 @@ static ssize_t fat32_list_op(void *fs_ctx, const char *path, char *out, size_t o
     return (ssize_t)pos;
 }
 
+static void fat32_fill_info(const fat32_node_t *node, vfs_info_t *out) {
+    out->type = (node->attr & FAT32_ATTR_DIR) ? VFS_NODE_DIR : VFS_NODE_FILE;
+    out->mode = 0;
+    out->uid = 0;
+    out->gid = 0;
+    out->size = node->size;
+}
+
 static int fat32_get_info_op(void *fs_ctx, const char *path, vfs_info_t *out) {
     fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
     fat32_found_t n;
 
     if (!fs || !out) return -1;
     if (fat32_resolve(fs, path, &n) != 0) return -1;
+    fat32_fill_info(&n.node, out);
+    return 0;
+}
 
-    out->type = (n.node.attr & FAT32_ATTR_DIR) ? VFS_NODE_DIR : VFS_NODE_FILE;
-    out->mode = 0;
-    out->uid = 0;
-    out->gid = 0;
-    out->size = n.node.size;
+static void *fat32_node_open_op(void *fs_ctx, const char *path) {
+    fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
+    fat32_found_t n;
+    fat32_open_node_t *o;
+
+    if (!fs) return NULL;
+    if (fat32_resolve(fs, path, &n) != 0) return NULL;
+    o = fat32_open_find(fs, &n);
+    if (o) {
+        o->refs++;
+        return o;
+    }
+    o = (fat32_open_node_t*)kmalloc(sizeof(*o));
+    if (!o) return NULL;
+    memset(o, 0, sizeof(*o));
+    o->found = n;
+    o->refs = 1;
+    o->next = fs->open_nodes;
+    fs->open_nodes = o;
+    return o;
+}
+
+static void fat32_node_ref_op(void *fs_ctx, void *node) {
+    (void)fs_ctx;
+    if (node) ((fat32_open_node_t*)node)->refs++;
+}
+
+static void fat32_node_release_op(void *fs_ctx, void *node) {
+    fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
+    fat32_open_node_t *o = (fat32_open_node_t*)node;
+    fat32_open_node_t **link;
+
+    if (!fs || !o || o->refs == 0) return;
+    if (--o->refs > 0) return;
+    for (link = &fs->open_nodes; *link; link = &(*link)->next) {
+        if (*link == o) {
+            *link = o->next;
+            break;
+        }
+    }
+    if (o->unlinked && o->found.node.first_cluster >= 2) {
+        (void)fat32_free_chain(fs, o->found.node.first_cluster);
+        (void)fat32_sync(fs);
+    }
+    kfree(o);
+}
+
+static ssize_t fat32_node_pread_op(void *fs_ctx, void *node, void *buf, size_t size, uint32_t offset) {
+    fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
+    if (!fs || !node || !buf) return -1;
+    return fat32_read_at(fs, &((fat32_open_node_t*)node)->found.node, buf, size, offset);
+}
+
+static ssize_t fat32_node_pwrite_op(void *fs_ctx, void *node, const void *buf, size_t size, uint32_t offset) {
+    fat32_fs_t *fs = (fat32_fs_t*)fs_ctx;
+    fat32_open_node_t *o = (fat32_open_node_t*)node;
+    ssize_t r;
+    if (!fs || !o || !buf) return -1;
+    r = fat32_write_at(fs, &o->found, !o->unlinked, buf, size, offset);
+    (void)fat32_sync(fs);
+    return r;
+}
+
+static int fat32_node_ioctl_op(void *fs_ctx, void *node, uint32_t request, void *arg) {
+    (void)fs_ctx;
+    (void)node;
+    (void)request;
+    (void)arg;
+    return -1;
+}
+
+static int fat32_node_get_info_op(void *fs_ctx, void *node, vfs_info_t *out) {
+    (void)fs_ctx;
+    if (!node || !out) return -1;
+    fat32_fill_info(&((fat32_open_node_t*)node)->found.node, out);
     return 0;
 }
 
+static ssize_t fat32_write_op(void *fs_ctx, const char *path, const void *buf, size_t size) {
+    ssize_t r = fat32_write_file(fs_ctx, path, buf, size);
+    (void)fat32_sync((fat32_fs_t*)fs_ctx);
+    return r;
+}
+
+static ssize_t fat32_append_op(void *fs_ctx, const char *path, const void *buf, size_t size) {
+    ssize_t r = fat32_append_file(fs_ctx, path, buf, size);
+    (void)fat32_sync((fat32_fs_t*)fs_ctx);
+    return r;
+}
+
+static ssize_t fat32_pwrite_op(void *fs_ctx, const char *path, const void *buf, size_t size, uint32_t offset) {
+    ssize_t r = fat32_pwrite_file(fs_ctx, path, buf, size, offset);
+    (void)fat32_sync((fat32_fs_t*)fs_ctx);
+    return r;
+}
+
+static int fat32_mkdir_op(void *fs_ctx, const char *path) {
+    int r = fat32_mkdir(fs_ctx, path);
+    (void)fat32_sync((fat32_fs_t*)fs_ctx);
+    return r;
+}
+
+static int fat32_create_file_op(void *fs_ctx, const char *path) {
+    int r = fat32_create_file(fs_ctx, path);
+    (void)fat32_sync((fat32_fs_t*)fs_ctx);
+    return r;
+}
+
+static int fat32_unlink_op(void *fs_ctx, const char *path) {
+    int r = fat32_unlink(fs_ctx, path);
+    (void)fat32_sync((fat32_fs_t*)fs_ctx);
+    return r;
+}
+
+static int fat32_rmdir_op(void *fs_ctx, const char *path) {
+    int r = fat32_rmdir(fs_ctx, path);
+    (void)fat32_sync((fat32_fs_t*)fs_ctx);
+    return r;
+}
+
 const vfs_ops_t g_fat32_vfs_ops = {
     fat32_open_op,
     fat32_close_op,
@@ -1203,5 +1604,14 @@ const vfs_ops_t g_fat32_vfs_ops = {
     fat32_mkfifo_op,
     fat32_mksock_op,
     fat32_list_op,
-    fat32_get_info_op
+    fat32_get_info_op,
+    fat32_pread_op,
+    fat32_pwrite_op,
+    fat32_node_open_op,
+    fat32_node_ref_op,
+    fat32_node_release_op,
+    fat32_node_pread_op,
+    fat32_node_pwrite_op,
+    fat32_node_ioctl_op,
+    fat32_node_get_info_op
 };
@@ -3,6 +3,9 @@
 #include <drivers/filesystem/vfs.h>
 #include <stdint.h>
 
+struct fat32_open_node;
+struct fat32_fat_cache;
+
 typedef struct {
     uint8_t disk_kind;
     uint8_t disk_index;
@@ -20,10 +23,15 @@ typedef struct {
 
     uint32_t fat_start_lba;
     uint32_t data_start_lba;
+
+    struct fat32_open_node *open_nodes;
+    struct fat32_fat_cache *fat_cache;
 } fat32_fs_t;
 
 int fat32_init(fat32_fs_t *fs, uint32_t partition_index);
 int fat32_init_named(fat32_fs_t *fs, const char *disk_name, uint32_t partition_index);
 int fat32_init_devpath(fat32_fs_t *fs, const char *dev_path);
+int fat32_sync(fat32_fs_t *fs);
+void fat32_release(fat32_fs_t *fs);
 
 extern const vfs_ops_t g_fat32_vfs_ops;
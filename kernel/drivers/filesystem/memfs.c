@@ -1,7 +1,11 @@
 #include <drivers/filesystem/memfs.h>
 #include <asm/mm.h>
+#include <drivers/pipe.h>
+#include <kerrno.h>
 #include <string.h>
 
+#define MEMFS_FILE_MIN_CAP 64u
+
 static char* dup_name(const char *s) {
     char *n = valloc(256);
     if (!n) return NULL;
@@ -214,43 +218,55 @@ static char type_suffix(memfs_node_type t) {
     }
 }
 
+static void stream_sync(memfs *owner_fs, memfs_inode *node) {
+    size_t avail = pipe_available(node->file.pipe);
+    if (avail > node->file.size) used_add(owner_fs, avail - node->file.size);
+    else used_sub(owner_fs, node->file.size - avail);
+    node->file.size = avail;
+    node->file.capacity = node->file.pipe->capacity;
+}
+
 static ssize_t stream_write(memfs *owner_fs, memfs_inode *node, const void *buf, size_t size) {
-    uint8_t *newbuf;
-    if (!node || !buf) return -1;
+    ssize_t n;
+    if (!node || !buf || !node->file.pipe) return -1;
     if (size == 0) return 0;
-    newbuf = valloc(node->file.size + size);
-    if (!newbuf) return -1;
-    if (node->file.data && node->file.size) {
-        memcpy(newbuf, node->file.data, node->file.size);
-        vfree(node->file.data);
-    }
-    memcpy(newbuf + node->file.size, buf, size);
-    node->file.data = newbuf;
-    node->file.size += size;
-    used_add(owner_fs, size);
-    return (ssize_t)size;
+    n = pipe_write(node->file.pipe, buf, size, node->open_count < 2u);
+    stream_sync(owner_fs, node);
+    return (n < 0) ? -1 : n;
 }
 
 static ssize_t stream_read(memfs *owner_fs, memfs_inode *node, void *buf, size_t size) {
-    size_t to_copy;
-    size_t remain;
-    uint8_t *newbuf = NULL;
-    if (!node || !buf) return -1;
+    ssize_t n;
+    if (!node || !buf || !node->file.pipe) return -1;
     if (size == 0) return 0;
-    if (!node->file.data || node->file.size == 0) return 0;
-    to_copy = (size < node->file.size) ? size : node->file.size;
-    memcpy(buf, node->file.data, to_copy);
-    remain = node->file.size - to_copy;
-    if (remain > 0) {
-        newbuf = valloc(remain);
-        if (!newbuf) return -1;
-        memcpy(newbuf, node->file.data + to_copy, remain);
-    }
-    vfree(node->file.data);
+    n = pipe_read(node->file.pipe, buf, size, 1);
+    stream_sync(owner_fs, node);
+    if (n == -K_EAGAIN) return 0;
+    return (n < 0) ? -1 : n;
+}
+
+static int file_reserve(memfs_inode *node, size_t need) {
+    uint8_t *newbuf;
+    size_t cap;
+    if (!node) return -1;
+    if (node->file.data && need <= node->file.capacity) return 0;
+    cap = node->file.capacity ? node->file.capacity : MEMFS_FILE_MIN_CAP;
+    while (cap < need) {
+        if (cap > ((size_t)-1) / 2u) {
+            cap = need;
+            break;
+        }
+        cap <<= 1;
+    }
+    newbuf = valloc(cap);
+    if (!newbuf) return -1;
+    if (node->file.data) {
+        if (node->file.size) memcpy(newbuf, node->file.data, node->file.size);
+        vfree(node->file.data);
+    }
     node->file.data = newbuf;
-    node->file.size = remain;
-    used_sub(owner_fs, to_copy);
-    return (ssize_t)to_copy;
+    node->file.capacity = cap;
+    return 0;
 }
 
 memfs* memfs_create(size_t size) {
@@ -350,6 +366,12 @@ memfs_inode* memfs_create_fifo(memfs *fs, const char *path) {
     node->name = dup_name(name);
     node->file.size = 0;
     node->file.data = NULL;
+    node->file.pipe = pipe_create(PIPE_NAMED);
+    if (!node->file.pipe) {
+        vfree(node->name);
+        vfree(node);
+        return NULL;
+    }
     dir_add(parent, node);
     owner_fs->inode_count++;
     return node;
@@ -377,6 +399,12 @@ memfs_inode* memfs_create_socket(memfs *fs, const char *path) {
     node->name = dup_name(name);
     node->file.size = 0;
     node->file.data = NULL;
+    node->file.pipe = pipe_create(PIPE_NAMED);
+    if (!node->file.pipe) {
+        vfree(node->name);
+        vfree(node);
+        return NULL;
+    }
     dir_add(parent, node);
     owner_fs->inode_count++;
     return node;
@@ -443,6 +471,25 @@ memfs_inode* memfs_create_device_ops(
     return dev;
 }
 
+static void inode_free(memfs *owner_fs, memfs_inode *node) {
+    if (is_stream_node(node->type) && node->file.pipe) {
+        pipe_destroy(node->file.pipe);
+        used_sub(owner_fs, node->file.size);
+        node->file.pipe = NULL;
+        node->file.size = 0;
+    }
+    if (is_storage_node(node->type) && node->file.data) {
+        vfree(node->file.data);
+        used_sub(owner_fs, node->file.size);
+        node->file.data = NULL;
+        node->file.size = 0;
+        node->file.capacity = 0;
+    }
+    if (node->name) vfree(node->name);
+    if (owner_fs->inode_count > 0) owner_fs->inode_count--;
+    vfree(node);
+}
+
 int memfs_delete_file(memfs *fs, const char *path) {
     memfs *owner_fs = fs;
     memfs_inode *parent = NULL;
@@ -471,17 +518,7 @@ int memfs_delete_file(memfs *fs, const char *path) {
     if (d->name) vfree(d->name);
     vfree(d);
 
-    if (node->link_count == 0) {
-        if (node->file.data) {
-            vfree(node->file.data);
-            used_sub(owner_fs, node->file.size);
-            node->file.data = NULL;
-            node->file.size = 0;
-        }
-        if (node->name) vfree(node->name);
-        if (owner_fs->inode_count > 0) owner_fs->inode_count--;
-        vfree(node);
-    }
+    if (node->link_count == 0 && node->open_count == 0) inode_free(owner_fs, node);
     return 0;
 }
 
@@ -512,11 +549,7 @@ int memfs_delete_dir(memfs *fs, const char *path) {
     if (node->link_count > 0) node->link_count--;
     if (d->name) vfree(d->name);
     vfree(d);
-    if (node->link_count == 0) {
-        if (node->name) vfree(node->name);
-        if (owner_fs->inode_count > 0) owner_fs->inode_count--;
-        vfree(node);
-    }
+    if (node->link_count == 0 && node->open_count == 0) inode_free(owner_fs, node);
     return 0;
 }
 
@@ -552,11 +585,13 @@ ssize_t memfs_write(memfs *fs, const char *path, const void *buf, size_t size) {
         used_sub(owner_fs, node->file.size);
         node->file.data = NULL;
         node->file.size = 0;
+        node->file.capacity = 0;
     }
     node->file.data = valloc(size);
     if (!node->file.data) return -1;
     memcpy(node->file.data, buf, size);
     node->file.size = size;
+    node->file.capacity = size;
     used_add(owner_fs, size);
     return (ssize_t)size;
 }
@@ -584,13 +619,122 @@ ssize_t memfs_read(memfs *fs, const char *path, void *buf, size_t size) {
     }
 }
 
-int memfs_ioctl(memfs *fs, const char *path, uint32_t request, void *arg) {
-    memfs_inode *node = lookup_path(fs, path);
+static ssize_t inode_pread(memfs *owner_fs, memfs_inode *node, void *buf, size_t size, uint32_t offset) {
+    if (!node || !buf) return -1;
+    if (node->type == MEMFS_TYPE_DEVICE) {
+        if (!(node->device.flags & MEMFS_DEV_READ)) return -1;
+        if (node->device.read) return node->device.read(node->device.ctx, buf, size);
+        if (!node->device.buffer) return -1;
+        if (offset >= node->device.size) return 0;
+        {
+            size_t left = node->device.size - offset;
+            size_t to_copy = (size < left) ? size : left;
+            memcpy(buf, node->device.buffer + offset, to_copy);
+            return (ssize_t)to_copy;
+        }
+    }
+    if (!is_storage_node(node->type)) return -1;
+    if (is_stream_node(node->type)) return stream_read(owner_fs, node, buf, size);
+    if (offset >= node->file.size) return 0;
+    {
+        size_t left = node->file.size - offset;
+        size_t to_copy = (size < left) ? size : left;
+        memcpy(buf, node->file.data + offset, to_copy);
+        return (ssize_t)to_copy;
+    }
+}
+
+static ssize_t inode_pwrite(memfs *owner_fs, memfs_inode *node, const void *buf, size_t size, uint32_t offset) {
+    size_t end;
+    if (!node || !buf) return -1;
+    if (node->type == MEMFS_TYPE_DEVICE) {
+        if (!(node->device.flags & MEMFS_DEV_WRITE)) return -1;
+        if (node->device.write) return node->device.write(node->device.ctx, buf, size);
+        if (!node->device.buffer) return -1;
+        if (offset >= node->device.size) return 0;
+        {
+            size_t left = node->device.size - offset;
+            size_t to_copy = (size < left) ? size : left;
+            memcpy(node->device.buffer + offset, buf, to_copy);
+            return (ssize_t)to_copy;
+        }
+    }
+    if (!is_storage_node(node->type)) return -1;
+    if (is_stream_node(node->type)) return stream_write(owner_fs, node, buf, size);
+    if (size == 0) return 0;
+    end = (size_t)offset + size;
+    if (end < size) return -1;
+    if (file_reserve(node, end) != 0) return -1;
+    if (offset > node->file.size) memset(node->file.data + node->file.size, 0, offset - node->file.size);
+    memcpy(node->file.data + offset, buf, size);
+    if (end > node->file.size) {
+        used_add(owner_fs, end - node->file.size);
+        node->file.size = end;
+    }
+    return (ssize_t)size;
+}
+
+ssize_t memfs_pread(memfs *fs, const char *path, void *buf, size_t size, uint32_t offset) {
+    memfs *owner_fs = fs;
+    memfs_inode *node = lookup_path_ex(fs, path, &owner_fs);
+    return inode_pread(owner_fs, node, buf, size, offset);
+}
+
+ssize_t memfs_pwrite(memfs *fs, const char *path, const void *buf, size_t size, uint32_t offset) {
+    memfs *owner_fs = fs;
+    memfs_inode *node = lookup_path_ex(fs, path, &owner_fs);
+    return inode_pwrite(owner_fs, node, buf, size, offset);
+}
+
+int memfs_node_ioctl(memfs_inode *node, uint32_t request, void *arg) {
     if (!node || node->type != MEMFS_TYPE_DEVICE) return -1;
     if (!node->device.ioctl) return -1;
     return node->device.ioctl(node->device.ctx, request, arg);
 }
 
+int memfs_ioctl(memfs *fs, const char *path, uint32_t request, void *arg) {
+    return memfs_node_ioctl(lookup_path(fs, path), request, arg);
+}
+
+memfs_inode* memfs_node_open(memfs *fs, const char *path) {
+    memfs *owner_fs = fs;
+    memfs_inode *node = lookup_path_ex(fs, path, &owner_fs);
+    if (!node) return NULL;
+    node->open_count++;
+    node->open_owner = owner_fs;
+    return node;
+}
+
+void memfs_node_ref(memfs_inode *node) {
+    if (node) node->open_count++;
+}
+
+void memfs_node_release(memfs_inode *node) {
+    if (!node || node->open_count == 0) return;
+    node->open_count--;
+    if (node->open_count == 0 && node->link_count == 0 && node != node->open_owner->root) {
+        inode_free(node->open_owner, node);
+    }
+}
+
+ssize_t memfs_node_pread(memfs_inode *node, void *buf, size_t size, uint32_t offset) {
+    if (!node) return -1;
+    return inode_pread(node->open_owner, node, buf, size, offset);
+}
+
+ssize_t memfs_node_pwrite(memfs_inode *node, const void *buf, size_t size, uint32_t offset) {
+    if (!node) return -1;
+    return inode_pwrite(node->open_owner, node, buf, size, offset);
+}
+
+void memfs_node_info(const memfs_inode *node, vfs_info_t *out) {
+    out->type = (vfs_node_type_t)node->type;
+    out->mode = node->mode;
+    out->uid = node->uid;
+    out->gid = node->gid;
+    out->size = node->file.size;
+}
+
 int memfs_get_info(memfs *fs, const char *path, memfs_inode *out) {
     memfs_inode *node = lookup_path(fs, path);
     if (!node) return -1;
@@ -638,19 +782,13 @@ int memfs_link(memfs *fs, const char *oldpath, const char *newpath) {
 ssize_t memfs_append(memfs *fs, const char *path, const void *buf, size_t size) {
     memfs *owner_fs = fs;
     memfs_inode *node = lookup_path_ex(fs, path, &owner_fs);
-    uint8_t *newbuf;
     if (!node || !is_storage_node(node->type)) return -1;
     if (is_stream_node(node->type)) return stream_write(owner_fs, node, buf, size);
-    newbuf = valloc(node->file.size + size);
-    if (!newbuf) return -1;
-    if (node->file.data) {
-        memcpy(newbuf, node->file.data, node->file.size);
-        vfree(node->file.data);
-    }
-    memcpy(newbuf + node->file.size, buf, size);
+    if (size == 0) return 0;
+    if (file_reserve(node, node->file.size + size) != 0) return -1;
+    memcpy(node->file.data + node->file.size, buf, size);
     used_add(owner_fs, size);
     node->file.size += size;
-    node->file.data = newbuf;
     return (ssize_t)size;
 }
 
@@ -785,6 +923,14 @@ static ssize_t memfs_append_op(void *fs_ctx, const char *path, const void *buf,
     return memfs_append((memfs*)fs_ctx, path, buf, size);
 }
 
+static ssize_t memfs_pread_op(void *fs_ctx, const char *path, void *buf, size_t size, uint32_t offset) {
+    return memfs_pread((memfs*)fs_ctx, path, buf, size, offset);
+}
+
+static ssize_t memfs_pwrite_op(void *fs_ctx, const char *path, const void *buf, size_t size, uint32_t offset) {
+    return memfs_pwrite((memfs*)fs_ctx, path, buf, size, offset);
+}
+
 static int memfs_ioctl_op(void *fs_ctx, const char *path, uint32_t request, void *arg) {
     return memfs_ioctl((memfs*)fs_ctx, path, request, arg);
 }
@@ -825,11 +971,43 @@ static int memfs_get_info_op(void *fs_ctx, const char *path, vfs_info_t *out) {
     memfs_inode in;
     if (!out) return -1;
     if (memfs_get_info((memfs*)fs_ctx, path, &in) != 0) return -1;
-    out->type = (vfs_node_type_t)in.type;
-    out->mode = in.mode;
-    out->uid = in.uid;
-    out->gid = in.gid;
-    out->size = in.file.size;
+    memfs_node_info(&in, out);
+    return 0;
+}
+
+static void *memfs_node_open_op(void *fs_ctx, const char *path) {
+    return memfs_node_open((memfs*)fs_ctx, path);
+}
+
+static void memfs_node_ref_op(void *fs_ctx, void *node) {
+    (void)fs_ctx;
+    memfs_node_ref((memfs_inode*)node);
+}
+
+static void memfs_node_release_op(void *fs_ctx, void *node) {
+    (void)fs_ctx;
+    memfs_node_release((memfs_inode*)node);
+}
+
+static ssize_t memfs_node_pread_op(void *fs_ctx, void *node, void *buf, size_t size, uint32_t offset) {
+    (void)fs_ctx;
+    return memfs_node_pread((memfs_inode*)node, buf, size, offset);
+}
+
+static ssize_t memfs_node_pwrite_op(void *fs_ctx, void *node, const void *buf, size_t size, uint32_t offset) {
+    (void)fs_ctx;
+    return memfs_node_pwrite((memfs_inode*)node, buf, size, offset);
+}
+
+static int memfs_node_ioctl_op(void *fs_ctx, void *node, uint32_t request, void *arg) {
+    (void)fs_ctx;
+    return memfs_node_ioctl((memfs_inode*)node, request, arg);
+}
+
+static int memfs_node_get_info_op(void *fs_ctx, void *node, vfs_info_t *out) {
+    (void)fs_ctx;
+    if (!node || !out) return -1;
+    memfs_node_info((memfs_inode*)node, out);
     return 0;
 }
 
@@ -848,5 +1026,14 @@ const vfs_ops_t g_memfs_vfs_ops = {
     memfs_mkfifo_op,
     memfs_mksock_op,
     memfs_list_op,
-    memfs_get_info_op
+    memfs_get_info_op,
+    memfs_pread_op,
+    memfs_pwrite_op,
+    memfs_node_open_op,
+    memfs_node_ref_op,
+    memfs_node_release_op,
+    memfs_node_pread_op,
+    memfs_node_pwrite_op,
+    memfs_node_ioctl_op,
+    memfs_node_get_info_op
 };
@@ -7,6 +7,7 @@
 typedef struct _memfs_inode memfs_inode;
 typedef struct _memfs_dentry memfs_dentry;
 typedef struct _memfs memfs;
+struct pipe;
 
 typedef ssize_t (*memfs_dev_read_t)(void *ctx, void *buf, size_t size);
 typedef ssize_t (*memfs_dev_write_t)(void *ctx, const void *buf, size_t size);
@@ -43,11 +44,15 @@ typedef struct _memfs_inode {
     uint16_t gid;
 
     uint32_t link_count;
+    uint32_t open_count;
+    memfs *open_owner;
 
     union {
         struct {
             size_t size;
             uint8_t *data;
+            size_t capacity;
+            struct pipe *pipe;
         } file;
 
         struct {
@@ -102,8 +107,18 @@ int memfs_close(int fd);
 
 ssize_t memfs_write(memfs *fs, const char *path, const void *buf, size_t size);
 ssize_t memfs_read(memfs *fs, const char *path, void *buf, size_t size);
+ssize_t memfs_pread(memfs *fs, const char *path, void *buf, size_t size, uint32_t offset);
+ssize_t memfs_pwrite(memfs *fs, const char *path, const void *buf, size_t size, uint32_t offset);
 int memfs_ioctl(memfs *fs, const char *path, uint32_t request, void *arg);
 
+memfs_inode* memfs_node_open(memfs *fs, const char *path);
+void memfs_node_ref(memfs_inode *node);
+void memfs_node_release(memfs_inode *node);
+ssize_t memfs_node_pread(memfs_inode *node, void *buf, size_t size, uint32_t offset);
+ssize_t memfs_node_pwrite(memfs_inode *node, const void *buf, size_t size, uint32_t offset);
+int memfs_node_ioctl(memfs_inode *node, uint32_t request, void *arg);
+void memfs_node_info(const memfs_inode *node, vfs_info_t *out);
+
 int memfs_get_info(memfs *fs, const char *path, memfs_inode *out);
 memfs_inode* memfs_search(memfs *fs, const char *name);
 int memfs_link(memfs *fs, const char *oldpath, const char *newpath);
@@ -22,6 +22,7 @@ typedef enum {
     PROC_SYS_MEMINFO = 1,
     PROC_SYS_STAT = 2,
     PROC_SYS_VERSION = 3,
+    PROC_SYS_SLABINFO = 4,
 } proc_sys_file_t;
 
 typedef enum {
@@ -40,7 +41,12 @@ typedef struct {
     uint32_t file_id;
 } proc_path_t;
 
-static char g_proc_sys_text[256];
+typedef struct {
+    proc_path_t pp;
+    uint32_t refs;
+} proc_handle_t;
+
+static char g_proc_sys_text[768];
 static char g_proc_pid_text[768];
 
 #define PROC_SYS_TEXT_CAP ((size_t)sizeof(g_proc_sys_text))
@@ -141,6 +147,11 @@ static int proc_parse_path(const char *path, proc_path_t *out) {
         out->file_id = PROC_SYS_VERSION;
         return 0;
     }
+    if (strcmp(path, "/slabinfo") == 0) {
+        out->kind = PROC_NODE_SYS_FILE;
+        out->file_id = PROC_SYS_SLABINFO;
+        return 0;
+    }
 
     p = path + 1;
     if (strncmp(p, "self", 4) == 0 && (p[4] == '\0' || p[4] == '/')) {
@@ -210,7 +221,7 @@ static ssize_t proc_root_list(char *out, size_t out_size) {
     size_t len = 0;
     if (!out || out_size == 0) return -1;
     out[0] = '\0';
-    if (proc_append_text(out, out_size, &len, "uptime\nmeminfo\nstat\nversion\nself/\n") != 0) return -1;
+    if (proc_append_text(out, out_size, &len, "uptime\nmeminfo\nstat\nversion\nslabinfo\nself/\n") != 0) return -1;
     for (int i = 0; i < task_count; i++) {
         if (tasks[i].pid == 0) continue;
         if (proc_append_u32(out, out_size, &len, tasks[i].pid) != 0) return -1;
@@ -244,7 +255,15 @@ static ssize_t proc_pid_fd_list(uint32_t pid, char *out, size_t out_size) {
     return (ssize_t)len;
 }
 
-static ssize_t proc_read_system_file(uint32_t id, void *buf, size_t size) {
+static ssize_t proc_copy_window(const char *text, size_t len, uint32_t offset, void *buf, size_t size) {
+    if (offset >= len) return 0;
+    len -= offset;
+    if (len > size) len = size;
+    memcpy(buf, text + offset, len);
+    return (ssize_t)len;
+}
+
+static ssize_t proc_read_system_file(uint32_t id, void *buf, size_t size, uint32_t offset) {
     char *text = g_proc_sys_text;
     size_t len = 0;
     if (!buf) return -1;
@@ -261,6 +280,10 @@ static ssize_t proc_read_system_file(uint32_t id, void *buf, size_t size) {
             if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, (uint32_t)get_used_heap()) != 0) return -1;
             if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, "\nHeapFree: ") != 0) return -1;
             if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, (uint32_t)get_free_heap()) != 0) return -1;
+            if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, "\nPagesTotal: ") != 0) return -1;
+            if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, pmm_total_frames()) != 0) return -1;
+            if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, "\nPagesFree: ") != 0) return -1;
+            if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, pmm_free_frames()) != 0) return -1;
             if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, "\n") != 0) return -1;
             break;
         case PROC_SYS_STAT: {
@@ -283,21 +306,47 @@ static ssize_t proc_read_system_file(uint32_t id, void *buf, size_t size) {
             if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, blocked) != 0) return -1;
             if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, "\nterminated ") != 0) return -1;
             if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, terminated) != 0) return -1;
+            if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, "\ncow_faults ") != 0) return -1;
+            if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, mm_cow_fault_count()) != 0) return -1;
             if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, "\n") != 0) return -1;
             break;
         }
         case PROC_SYS_VERSION:
             if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, HOUSEOS_RELEASE_STR "\n") != 0) return -1;
             break;
+        case PROC_SYS_SLABINFO: {
+            kmalloc_class_stats_t st;
+            uint32_t pages_total = 0, pages_free = 0;
+            kmalloc_slab_pages(&pages_total, &pages_free);
+            if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, "pages ") != 0) return -1;
+            if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, pages_total) != 0) return -1;
+            if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, " free ") != 0) return -1;
+            if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, pages_free) != 0) return -1;
+            if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, "\nsize active total pages allocs frees\n") != 0) return -1;
+            for (uint32_t i = 0; i < kmalloc_class_count(); i++) {
+                if (kmalloc_class_stats(i, &st) != 0) break;
+                if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, st.object_size) != 0) return -1;
+                if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, " ") != 0) return -1;
+                if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, st.active_objects) != 0) return -1;
+                if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, " ") != 0) return -1;
+                if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, st.total_objects) != 0) return -1;
+                if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, " ") != 0) return -1;
+                if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, st.pages) != 0) return -1;
+                if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, " ") != 0) return -1;
+                if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, st.allocs) != 0) return -1;
+                if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, " ") != 0) return -1;
+                if (proc_append_u32(text, PROC_SYS_TEXT_CAP, &len, st.frees) != 0) return -1;
+                if (proc_append_text(text, PROC_SYS_TEXT_CAP, &len, "\n") != 0) return -1;
+            }
+            break;
+        }
         default:
             return -1;
     }
-    if (len > size) len = size;
-    memcpy(buf, text, len);
-    return (ssize_t)len;
+    return proc_copy_window(text, len, offset, buf, size);
 }
 
-static ssize_t proc_read_pid_text(task_t *task, uint32_t file_id, void *buf, size_t size) {
+static ssize_t proc_read_pid_text(task_t *task, uint32_t file_id, void *buf, size_t size, uint32_t offset) {
     char *text = g_proc_pid_text;
     char fd_path[256];
     size_t len = 0;
@@ -324,9 +373,14 @@ static ssize_t proc_read_pid_text(task_t *task, uint32_t file_id, void *buf, siz
             proc_append_i32(text, PROC_PID_TEXT_CAP, &len, task->exit_status);
             proc_append_text(text, PROC_PID_TEXT_CAP, &len, "\nTermSignal:\t");
             proc_append_u32(text, PROC_PID_TEXT_CAP, &len, task->term_signal);
-            proc_append_text(text, PROC_PID_TEXT_CAP, &len, "\nUserSlot:\t");
-            if (task->user_slot == (uint32_t)-1) proc_append_text(text, PROC_PID_TEXT_CAP, &len, "-1");
-            else proc_append_u32(text, PROC_PID_TEXT_CAP, &len, task->user_slot);
+            proc_append_text(text, PROC_PID_TEXT_CAP, &len, "\nNice:\t");
+            proc_append_i32(text, PROC_PID_TEXT_CAP, &len, task->nice);
+            proc_append_text(text, PROC_PID_TEXT_CAP, &len, "\nRssPages:\t");
+            proc_append_u32(text, PROC_PID_TEXT_CAP, &len, mm_user_resident_pages(task->cr3));
+            proc_append_text(text, PROC_PID_TEXT_CAP, &len, "\nHeapBytes:\t");
+            proc_append_u32(text, PROC_PID_TEXT_CAP, &len, task->brk - task->brk_start);
+            proc_append_text(text, PROC_PID_TEXT_CAP, &len, "\nSyscalls:\t");
+            proc_append_u32(text, PROC_PID_TEXT_CAP, &len, task->nr_syscalls);
             proc_append_text(text, PROC_PID_TEXT_CAP, &len, "\n");
             break;
         case PROC_PID_STAT:
@@ -338,8 +392,19 @@ static ssize_t proc_read_pid_text(task_t *task, uint32_t file_id, void *buf, siz
             proc_append_text(text, PROC_PID_TEXT_CAP, &len, " ");
             proc_append_u32(text, PROC_PID_TEXT_CAP, &len, task->term_signal);
             proc_append_text(text, PROC_PID_TEXT_CAP, &len, " ");
-            if (task->user_slot == (uint32_t)-1) proc_append_text(text, PROC_PID_TEXT_CAP, &len, "0");
-            else proc_append_u32(text, PROC_PID_TEXT_CAP, &len, task->user_phys_base);
+            proc_append_u32(text, PROC_PID_TEXT_CAP, &len, mm_user_resident_pages(task->cr3));
+            proc_append_text(text, PROC_PID_TEXT_CAP, &len, " ");
+            proc_append_i32(text, PROC_PID_TEXT_CAP, &len, task->nice);
+            proc_append_text(text, PROC_PID_TEXT_CAP, &len, " ");
+            proc_append_u32(text, PROC_PID_TEXT_CAP, &len, task->timeslice);
+            proc_append_text(text, PROC_PID_TEXT_CAP, &len, " ");
+            proc_append_u32(text, PROC_PID_TEXT_CAP, &len, task->nr_switches);
+            proc_append_text(text, PROC_PID_TEXT_CAP, &len, " ");
+            proc_append_u32(text, PROC_PID_TEXT_CAP, &len, task->nr_preempt);
+            proc_append_text(text, PROC_PID_TEXT_CAP, &len, " ");
+            proc_append_u32(text, PROC_PID_TEXT_CAP, &len, task->run_ticks);
+            proc_append_text(text, PROC_PID_TEXT_CAP, &len, " ");
+            proc_append_u32(text, PROC_PID_TEXT_CAP, &len, task->nr_syscalls);
             proc_append_text(text, PROC_PID_TEXT_CAP, &len, "\n");
             break;
         case PROC_PID_TTY:
@@ -354,22 +419,19 @@ static ssize_t proc_read_pid_text(task_t *task, uint32_t file_id, void *buf, siz
             return -1;
     }
     if (file_id == PROC_PID_MEM) return -1;
-    if (len > size) len = size;
-    memcpy(buf, text, len);
     (void)fd_path;
-    return (ssize_t)len;
+    return proc_copy_window(text, len, offset, buf, size);
 }
 
-static ssize_t proc_read_pid_mem(task_t *task, void *buf, size_t size) {
-    size_t to_copy;
+static ssize_t proc_read_pid_mem(task_t *task, void *buf, size_t size, uint32_t offset) {
+    int n;
     if (!task || !buf) return -1;
-    if (task->user_slot == (uint32_t)-1 || task->user_phys_base == 0) return 0;
-    to_copy = (size < USER_SLOT_SIZE_PHYS) ? size : USER_SLOT_SIZE_PHYS;
-    memcpy(buf, (const void*)(uintptr_t)task->user_phys_base, to_copy);
-    return (ssize_t)to_copy;
+    if (offset >= USER_VADDR_SIZE) return 0;
+    n = mm_user_read(task->cr3, USER_VADDR_BASE + offset, buf, (uint32_t)size);
+    return (n > 0) ? (ssize_t)n : 0;
 }
 
-static ssize_t proc_read_pid_fd(uint32_t pid, uint32_t fd, void *buf, size_t size) {
+static ssize_t proc_read_pid_fd(uint32_t pid, uint32_t fd, void *buf, size_t size, uint32_t offset) {
     char path[256];
     size_t len;
     if (!buf) return -1;
@@ -379,9 +441,7 @@ static ssize_t proc_read_pid_fd(uint32_t pid, uint32_t fd, void *buf, size_t siz
         path[len++] = '\n';
         path[len] = '\0';
     }
-    if (len > size) len = size;
-    memcpy(buf, path, len);
-    return (ssize_t)len;
+    return proc_copy_window(path, len, offset, buf, size);
 }
 
 static int proc_open_op(void *fs_ctx, const char *path) {
@@ -396,23 +456,31 @@ static int proc_close_op(void *fs_ctx, int fd) {
     return 0;
 }
 
-static ssize_t proc_read_op(void *fs_ctx, const char *path, void *buf, size_t size) {
-    proc_path_t pp;
+static ssize_t proc_read_node(const proc_path_t *pp, void *buf, size_t size, uint32_t offset) {
     task_t *task;
-    (void)fs_ctx;
-    if (proc_parse_path(path, &pp) != 0) return -1;
-    if (pp.kind == PROC_NODE_SYS_FILE) return proc_read_system_file(pp.file_id, buf, size);
-    if (pp.pid == 0) return -1;
-    task = task_find_by_pid(pp.pid);
+    if (pp->kind == PROC_NODE_SYS_FILE) return proc_read_system_file(pp->file_id, buf, size, offset);
+    if (pp->pid == 0) return -1;
+    task = task_find_by_pid(pp->pid);
     if (!task) return -1;
-    if (pp.kind == PROC_NODE_PID_FILE) {
-        if (pp.file_id == PROC_PID_MEM) return proc_read_pid_mem(task, buf, size);
-        return proc_read_pid_text(task, pp.file_id, buf, size);
+    if (pp->kind == PROC_NODE_PID_FILE) {
+        if (pp->file_id == PROC_PID_MEM) return proc_read_pid_mem(task, buf, size, offset);
+        return proc_read_pid_text(task, pp->file_id, buf, size, offset);
     }
-    if (pp.kind == PROC_NODE_PID_FD_FILE) return proc_read_pid_fd(pp.pid, pp.fd, buf, size);
+    if (pp->kind == PROC_NODE_PID_FD_FILE) return proc_read_pid_fd(pp->pid, pp->fd, buf, size, offset);
     return -1;
 }
 
+static ssize_t proc_pread_op(void *fs_ctx, const char *path, void *buf, size_t size, uint32_t offset) {
+    proc_path_t pp;
+    (void)fs_ctx;
+    if (proc_parse_path(path, &pp) != 0) return -1;
+    return proc_read_node(&pp, buf, size, offset);
+}
+
+static ssize_t proc_read_op(void *fs_ctx, const char *path, void *buf, size_t size) {
+    return proc_pread_op(fs_ctx, path, buf, size, 0);
+}
+
 static ssize_t proc_write_op(void *fs_ctx, const char *path, const void *buf, size_t size) {
     (void)fs_ctx;
     (void)path;
@@ -429,6 +497,15 @@ static ssize_t proc_append_op(void *fs_ctx, const char *path, const void *buf, s
     return -1;
 }
 
+static ssize_t proc_pwrite_op(void *fs_ctx, const char *path, const void *buf, size_t size, uint32_t offset) {
+    (void)fs_ctx;
+    (void)path;
+    (void)buf;
+    (void)size;
+    (void)offset;
+    return -1;
+}
+
 static int proc_ioctl_op(void *fs_ctx, const char *path, uint32_t request, void *arg) {
     (void)fs_ctx;
     (void)path;
@@ -495,40 +572,37 @@ static ssize_t proc_list_op(void *fs_ctx, const char *path, char *out, size_t ou
     return -1;
 }
 
-static int proc_get_info_op(void *fs_ctx, const char *path, vfs_info_t *out) {
-    proc_path_t pp;
+static int proc_info_node(const proc_path_t *pp, vfs_info_t *out) {
     task_t *task;
     char tmp[2048];
     ssize_t n;
-    (void)fs_ctx;
-    if (!out || proc_parse_path(path, &pp) != 0) return -1;
     memset(out, 0, sizeof(*out));
     out->mode = 0444u;
-    if (pp.kind == PROC_NODE_ROOT_DIR || pp.kind == PROC_NODE_PID_DIR || pp.kind == PROC_NODE_PID_FD_DIR) {
+    if (pp->kind == PROC_NODE_ROOT_DIR || pp->kind == PROC_NODE_PID_DIR || pp->kind == PROC_NODE_PID_FD_DIR) {
         out->type = VFS_NODE_DIR;
         out->mode = 0555u;
         return 0;
     }
-    if (pp.kind == PROC_NODE_SYS_FILE) {
+    if (pp->kind == PROC_NODE_SYS_FILE) {
         out->type = VFS_NODE_FILE;
-        n = proc_read_system_file(pp.file_id, tmp, sizeof(tmp));
+        n = proc_read_system_file(pp->file_id, tmp, sizeof(tmp), 0);
         out->size = (n > 0) ? (uint32_t)n : 0u;
         return 0;
     }
-    task = task_find_by_pid(pp.pid);
+    task = task_find_by_pid(pp->pid);
     if (!task) return -1;
-    if (pp.kind == PROC_NODE_PID_FILE) {
+    if (pp->kind == PROC_NODE_PID_FILE) {
         out->type = VFS_NODE_FILE;
-        if (pp.file_id == PROC_PID_MEM) out->size = USER_SLOT_SIZE_PHYS;
+        if (pp->file_id == PROC_PID_MEM) out->size = USER_VADDR_SIZE;
         else {
-            n = proc_read_pid_text(task, pp.file_id, tmp, sizeof(tmp));
+            n = proc_read_pid_text(task, pp->file_id, tmp, sizeof(tmp), 0);
             out->size = (n > 0) ? (uint32_t)n : 0u;
         }
         return 0;
     }
-    if (pp.kind == PROC_NODE_PID_FD_FILE) {
+    if (pp->kind == PROC_NODE_PID_FD_FILE) {
         out->type = VFS_NODE_FILE;
-        n = proc_read_pid_fd(pp.pid, pp.fd, tmp, sizeof(tmp));
+        n = proc_read_pid_fd(pp->pid, pp->fd, tmp, sizeof(tmp), 0);
         if (n < 0) return -1;
         out->size = (uint32_t)n;
         return 0;
@@ -536,6 +610,66 @@ static int proc_get_info_op(void *fs_ctx, const char *path, vfs_info_t *out) {
     return -1;
 }
 
+static int proc_get_info_op(void *fs_ctx, const char *path, vfs_info_t *out) {
+    proc_path_t pp;
+    (void)fs_ctx;
+    if (!out || proc_parse_path(path, &pp) != 0) return -1;
+    return proc_info_node(&pp, out);
+}
+
+static void *proc_node_open_op(void *fs_ctx, const char *path) {
+    proc_handle_t *h;
+    proc_path_t pp;
+    (void)fs_ctx;
+    if (proc_parse_path(path, &pp) != 0) return NULL;
+    h = (proc_handle_t*)kmalloc(sizeof(*h));
+    if (!h) return NULL;
+    h->pp = pp;
+    h->refs = 1;
+    return h;
+}
+
+static void proc_node_ref_op(void *fs_ctx, void *node) {
+    (void)fs_ctx;
+    if (node) ((proc_handle_t*)node)->refs++;
+}
+
+static void proc_node_release_op(void *fs_ctx, void *node) {
+    proc_handle_t *h = (proc_handle_t*)node;
+    (void)fs_ctx;
+    if (!h || h->refs == 0) return;
+    if (--h->refs == 0) kfree(h);
+}
+
+static ssize_t proc_node_pread_op(void *fs_ctx, void *node, void *buf, size_t size, uint32_t offset) {
+    (void)fs_ctx;
+    if (!node) return -1;
+    return proc_read_node(&((proc_handle_t*)node)->pp, buf, size, offset);
+}
+
+static ssize_t proc_node_pwrite_op(void *fs_ctx, void *node, const void *buf, size_t size, uint32_t offset) {
+    (void)fs_ctx;
+    (void)node;
+    (void)buf;
+    (void)size;
+    (void)offset;
+    return -1;
+}
+
+static int proc_node_ioctl_op(void *fs_ctx, void *node, uint32_t request, void *arg) {
+    (void)fs_ctx;
+    (void)node;
+    (void)request;
+    (void)arg;
+    return -1;
+}
+
+static int proc_node_get_info_op(void *fs_ctx, void *node, vfs_info_t *out) {
+    (void)fs_ctx;
+    if (!node || !out) return -1;
+    return proc_info_node(&((proc_handle_t*)node)->pp, out);
+}
+
 const vfs_ops_t g_procfs_vfs_ops = {
     proc_open_op,
     proc_close_op,
@@ -551,5 +685,14 @@ const vfs_ops_t g_procfs_vfs_ops = {
     proc_mkfifo_op,
     proc_mksock_op,
     proc_list_op,
-    proc_get_info_op
+    proc_get_info_op,
+    proc_pread_op,
+    proc_pwrite_op,
+    proc_node_open_op,
+    proc_node_ref_op,
+    proc_node_release_op,
+    proc_node_pread_op,
+    proc_node_pwrite_op,
+    proc_node_ioctl_op,
+    proc_node_get_info_op
 };
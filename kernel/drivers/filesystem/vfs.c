@@ -1,4 +1,5 @@
 #include <drivers/filesystem/vfs.h>
+#include <asm/mm.h>
 #include <string.h>
 
 static int is_valid_abs_path(const char *path) {
@@ -287,6 +288,74 @@ ssize_t vfs_append(vfs_t *vfs, const char *path, const void *buf, size_t size) {
     return r.ops->append(r.fs_ctx, r.local_path, buf, size);
 }
 
+static ssize_t vfs_pread_fallback(const vfs_resolved_t *r, void *buf, size_t size, uint32_t offset) {
+    vfs_info_t info;
+    uint8_t *tmp;
+    ssize_t n;
+    uint32_t to_copy;
+    if (!r->ops->read || !r->ops->get_info) return -1;
+    if (r->ops->get_info(r->fs_ctx, r->local_path, &info) != 0) return -1;
+    if (offset >= info.size) return 0;
+    tmp = (uint8_t*)kmalloc(info.size);
+    if (!tmp) return -1;
+    n = r->ops->read(r->fs_ctx, r->local_path, tmp, info.size);
+    if (n < 0) {
+        kfree(tmp);
+        return -1;
+    }
+    if ((uint32_t)n <= offset) {
+        kfree(tmp);
+        return 0;
+    }
+    to_copy = (uint32_t)n - offset;
+    if (to_copy > size) to_copy = (uint32_t)size;
+    memcpy(buf, tmp + offset, to_copy);
+    kfree(tmp);
+    return (ssize_t)to_copy;
+}
+
+static ssize_t vfs_pwrite_fallback(const vfs_resolved_t *r, const void *buf, size_t size, uint32_t offset) {
+    vfs_info_t info;
+    uint8_t *tmp;
+    uint32_t dst_size;
+    if (!r->ops->write || !r->ops->get_info) return -1;
+    if (r->ops->get_info(r->fs_ctx, r->local_path, &info) != 0) return -1;
+    dst_size = (offset + (uint32_t)size > info.size) ? (offset + (uint32_t)size) : info.size;
+    tmp = (uint8_t*)kmalloc(dst_size ? dst_size : 1);
+    if (!tmp) return -1;
+    memset(tmp, 0, dst_size);
+    if (info.size > 0 && (!r->ops->read || r->ops->read(r->fs_ctx, r->local_path, tmp, info.size) < 0)) {
+        kfree(tmp);
+        return -1;
+    }
+    memcpy(tmp + offset, buf, size);
+    if (r->ops->write(r->fs_ctx, r->local_path, tmp, dst_size) < 0) {
+        kfree(tmp);
+        return -1;
+    }
+    kfree(tmp);
+    return (ssize_t)size;
+}
+
+ssize_t vfs_pread(vfs_t *vfs, const char *path, void *buf, size_t size, uint32_t offset) {
+    vfs_resolved_t r;
+    if (!buf && size > 0) return -1;
+    if (vfs_resolve(vfs, path, &r) != 0 || !r.ops) return -1;
+    if (size == 0) return 0;
+    if (r.ops->pread) return r.ops->pread(r.fs_ctx, r.local_path, buf, size, offset);
+    return vfs_pread_fallback(&r, buf, size, offset);
+}
+
+ssize_t vfs_pwrite(vfs_t *vfs, const char *path, const void *buf, size_t size, uint32_t offset) {
+    vfs_resolved_t r;
+    if (!buf && size > 0) return -1;
+    if (vfs_resolve(vfs, path, &r) != 0 || !r.ops) return -1;
+    if (size == 0) return 0;
+    if (offset + (uint32_t)size < offset) return -1;
+    if (r.ops->pwrite) return r.ops->pwrite(r.fs_ctx, r.local_path, buf, size, offset);
+    return vfs_pwrite_fallback(&r, buf, size, offset);
+}
+
 int vfs_ioctl(vfs_t *vfs, const char *path, uint32_t request, void *arg) {
     vfs_resolved_t r;
     if (vfs_resolve(vfs, path, &r) != 0 || !r.ops || !r.ops->ioctl) return -1;
@@ -460,3 +529,51 @@ int vfs_get_info(vfs_t *vfs, const char *path, vfs_info_t *out) {
     if (vfs_resolve(vfs, path, &r) != 0 || !r.ops || !r.ops->get_info) return -1;
     return r.ops->get_info(r.fs_ctx, r.local_path, out);
 }
+
+int vfs_handle_open(vfs_t *vfs, const char *path, vfs_handle_t *out) {
+    vfs_resolved_t r;
+    if (!out) return -1;
+    memset(out, 0, sizeof(*out));
+    if (vfs_resolve(vfs, path, &r) != 0 || !r.ops || !r.ops->node_open) return -1;
+    out->node = r.ops->node_open(r.fs_ctx, r.local_path);
+    if (!out->node) return -1;
+    out->fs_ctx = r.fs_ctx;
+    out->ops = r.ops;
+    return 0;
+}
+
+void vfs_handle_ref(vfs_handle_t *h) {
+    if (!h || !h->node || !h->ops->node_ref) return;
+    h->ops->node_ref(h->fs_ctx, h->node);
+}
+
+void vfs_handle_release(vfs_handle_t *h) {
+    if (!h) return;
+    if (h->node && h->ops->node_release) h->ops->node_release(h->fs_ctx, h->node);
+    memset(h, 0, sizeof(*h));
+}
+
+ssize_t vfs_handle_pread(vfs_handle_t *h, void *buf, size_t size, uint32_t offset) {
+    if (!h || !h->node || !h->ops->node_pread) return -1;
+    if (!buf && size > 0) return -1;
+    if (size == 0) return 0;
+    return h->ops->node_pread(h->fs_ctx, h->node, buf, size, offset);
+}
+
+ssize_t vfs_handle_pwrite(vfs_handle_t *h, const void *buf, size_t size, uint32_t offset) {
+    if (!h || !h->node || !h->ops->node_pwrite) return -1;
+    if (!buf && size > 0) return -1;
+    if (size == 0) return 0;
+    if (offset + (uint32_t)size < offset) return -1;
+    return h->ops->node_pwrite(h->fs_ctx, h->node, buf, size, offset);
+}
+
+int vfs_handle_ioctl(vfs_handle_t *h, uint32_t request, void *arg) {
+    if (!h || !h->node || !h->ops->node_ioctl) return -1;
+    return h->ops->node_ioctl(h->fs_ctx, h->node, request, arg);
+}
+
+int vfs_handle_get_info(vfs_handle_t *h, vfs_info_t *out) {
+    if (!h || !h->node || !h->ops->node_get_info) return -1;
+    return h->ops->node_get_info(h->fs_ctx, h->node, out);
+}
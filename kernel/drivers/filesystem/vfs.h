@@ -38,6 +38,15 @@ typedef struct _vfs_ops {
     int (*mksock)(void *fs_ctx, const char *path);
     ssize_t (*list)(void *fs_ctx, const char *path, char *out, size_t out_size);
     int (*get_info)(void *fs_ctx, const char *path, vfs_info_t *out);
+    ssize_t (*pread)(void *fs_ctx, const char *path, void *buf, size_t size, uint32_t offset);
+    ssize_t (*pwrite)(void *fs_ctx, const char *path, const void *buf, size_t size, uint32_t offset);
+    void *(*node_open)(void *fs_ctx, const char *path);
+    void (*node_ref)(void *fs_ctx, void *node);
+    void (*node_release)(void *fs_ctx, void *node);
+    ssize_t (*node_pread)(void *fs_ctx, void *node, void *buf, size_t size, uint32_t offset);
+    ssize_t (*node_pwrite)(void *fs_ctx, void *node, const void *buf, size_t size, uint32_t offset);
+    int (*node_ioctl)(void *fs_ctx, void *node, uint32_t request, void *arg);
+    int (*node_get_info)(void *fs_ctx, void *node, vfs_info_t *out);
 } vfs_ops_t;
 
 #define VFS_FS_NAME_MAX 16
@@ -72,6 +81,12 @@ typedef struct {
     char local_path[256];
 } vfs_resolved_t;
 
+typedef struct {
+    void *fs_ctx;
+    const vfs_ops_t *ops;
+    void *node;
+} vfs_handle_t;
+
 int vfs_init(vfs_t *vfs);
 int vfs_register_fs(vfs_t *vfs, const char *fs_name, const vfs_ops_t *ops);
 int vfs_set_root(vfs_t *vfs, const char *fs_name, void *fs_ctx);
@@ -87,6 +102,8 @@ int vfs_close(vfs_t *vfs, int fd);
 ssize_t vfs_read(vfs_t *vfs, const char *path, void *buf, size_t size);
 ssize_t vfs_write(vfs_t *vfs, const char *path, const void *buf, size_t size);
 ssize_t vfs_append(vfs_t *vfs, const char *path, const void *buf, size_t size);
+ssize_t vfs_pread(vfs_t *vfs, const char *path, void *buf, size_t size, uint32_t offset);
+ssize_t vfs_pwrite(vfs_t *vfs, const char *path, const void *buf, size_t size, uint32_t offset);
 int vfs_ioctl(vfs_t *vfs, const char *path, uint32_t request, void *arg);
 int vfs_mkdir(vfs_t *vfs, const char *path);
 int vfs_create_file(vfs_t *vfs, const char *path);
@@ -98,3 +115,11 @@ int vfs_mksock(vfs_t *vfs, const char *path);
 ssize_t vfs_list(vfs_t *vfs, const char *path, char *out, size_t out_size);
 ssize_t vfs_list_mounts(vfs_t *vfs, char *out, size_t out_size);
 int vfs_get_info(vfs_t *vfs, const char *path, vfs_info_t *out);
+
+int vfs_handle_open(vfs_t *vfs, const char *path, vfs_handle_t *out);
+void vfs_handle_ref(vfs_handle_t *h);
+void vfs_handle_release(vfs_handle_t *h);
+ssize_t vfs_handle_pread(vfs_handle_t *h, void *buf, size_t size, uint32_t offset);
+ssize_t vfs_handle_pwrite(vfs_handle_t *h, const void *buf, size_t size, uint32_t offset);
+int vfs_handle_ioctl(vfs_handle_t *h, uint32_t request, void *arg);
+int vfs_handle_get_info(vfs_handle_t *h, vfs_info_t *out);
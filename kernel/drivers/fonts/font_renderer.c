@@ -2,6 +2,20 @@
 #include <string.h>
 #include <asm/mm.h>
 
+#define FONT_ATLAS_SLOTS 2u
+#define FONT_ATLAS_GLYPHS 256u
+#define FONT_RUN_BATCH 64u
+
+typedef struct {
+    psf_font_t* font;
+    uint32_t stamp;
+    uint32_t glyph_bytes;
+    uint8_t* pixels;
+} font_atlas_t;
+
+static font_atlas_t g_atlas[FONT_ATLAS_SLOTS];
+static uint32_t g_atlas_clock = 0;
+
 const uint8_t* font_get_glyph(psf_font_t* font, char c) {
     if (!font || !font->data) return NULL;
     
@@ -83,4 +97,77 @@ void font_draw_string(psf_font_t* font, uint32_t x, uint32_t y, const char* str,
                 break;
         }
     }
-}
\ No newline at end of file
+}
+
+static void font_atlas_fill(font_atlas_t* a) {
+    psf_font_t* font = a->font;
+    uint32_t bytes_per_line = (font->width + 7u) / 8u;
+    uint32_t glyphs = (font->num_glyphs < FONT_ATLAS_GLYPHS) ? font->num_glyphs : FONT_ATLAS_GLYPHS;
+    uint8_t* dst = a->pixels;
+
+    for (uint32_t gi = 0; gi < FONT_ATLAS_GLYPHS; gi++) {
+        const uint8_t* glyph = font->data + ((gi < glyphs) ? gi : 0u) * font->glyph_size;
+        for (uint32_t row = 0; row < font->height; row++) {
+            const uint8_t* bits = glyph + row * bytes_per_line;
+            for (uint32_t col = 0; col < font->width; col++) {
+                *dst++ = (bits[col / 8u] & (0x80u >> (col % 8u))) ? 0xFFu : 0x00u;
+            }
+        }
+    }
+}
+
+/* Atlases hold one coverage byte per pixel and are keyed on the font only; colours are applied by the blit. */
+static font_atlas_t* font_atlas_get(psf_font_t* font) {
+    font_atlas_t* victim = &g_atlas[0];
+    uint32_t glyph_bytes;
+
+    if (!font || !font->data || font->num_glyphs == 0) return NULL;
+    for (uint32_t i = 0; i < FONT_ATLAS_SLOTS; i++) {
+        font_atlas_t* a = &g_atlas[i];
+        if (a->pixels && a->font == font) {
+            a->stamp = ++g_atlas_clock;
+            return a;
+        }
+        if (!a->pixels) victim = a;
+        else if (victim->pixels && a->stamp < victim->stamp) victim = a;
+    }
+
+    glyph_bytes = font->width * font->height;
+    if (victim->pixels && victim->glyph_bytes != glyph_bytes) {
+        kfree(victim->pixels);
+        victim->pixels = NULL;
+    }
+    if (!victim->pixels) {
+        victim->pixels = (uint8_t*)kmalloc(glyph_bytes * FONT_ATLAS_GLYPHS);
+        if (!victim->pixels) return NULL;
+    }
+    victim->font = font;
+    victim->glyph_bytes = glyph_bytes;
+    victim->stamp = ++g_atlas_clock;
+    font_atlas_fill(victim);
+    return victim;
+}
+
+void font_draw_run(psf_font_t* font, uint32_t x, uint32_t y, const char* s, uint32_t len, uint32_t fg, uint32_t bg) {
+    const uint8_t* batch[FONT_RUN_BATCH];
+    font_atlas_t* a;
+
+    if (!font || !s || !vesa_is_initialized()) return;
+    a = font_atlas_get(font);
+    if (!a) {
+        for (uint32_t i = 0; i < len; i++) {
+            vesa_fill_rect(x + i * font->width, y, font->width, font->height, bg);
+            if (s[i] != ' ') font_draw_char(font, x + i * font->width, y, s[i], fg);
+        }
+        return;
+    }
+
+    while (len > 0) {
+        uint32_t n = (len < FONT_RUN_BATCH) ? len : FONT_RUN_BATCH;
+        for (uint32_t i = 0; i < n; i++) batch[i] = a->pixels + (uint32_t)(uint8_t)s[i] * a->glyph_bytes;
+        vesa_blit_glyphs(x, y, font->width, font->height, batch, n, fg, bg);
+        x += n * font->width;
+        s += n;
+        len -= n;
+    }
+}
@@ -6,4 +6,5 @@
 
 const uint8_t* font_get_glyph(psf_font_t* font, char c);
 void font_draw_char(psf_font_t* font, uint32_t x, uint32_t y, char c, uint32_t color);
-void font_draw_string(psf_font_t* font, uint32_t x, uint32_t y, const char* str, uint32_t color);
\ No newline at end of file
+void font_draw_string(psf_font_t* font, uint32_t x, uint32_t y, const char* str, uint32_t color);
+void font_draw_run(psf_font_t* font, uint32_t x, uint32_t y, const char* s, uint32_t len, uint32_t fg, uint32_t bg);
\ No newline at end of file
@@ -33,9 +33,11 @@ typedef struct {
 } rgba_color_t;
 
 image_t* image_load_from_memfs(memfs* fs, const char* path);
+image_t* image_load_from_buffer(const uint8_t* data, size_t size);
 void image_free(image_t* img);
 void image_draw(image_t* img, uint32_t x, uint32_t y);
 void image_draw_scaled(image_t* img, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+void image_draw_scaled_bilinear(image_t* img, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
 void image_draw_part(image_t* img, uint32_t src_x, uint32_t src_y, uint32_t src_w, uint32_t src_h, uint32_t dst_x, uint32_t dst_y);
 void image_draw_transparent(image_t* img, uint32_t x, uint32_t y, uint32_t transparent_color);
 void image_draw_alpha(image_t* img, uint32_t x, uint32_t y);
@@ -57,13 +57,18 @@ image_t* image_load_from_memfs(memfs* fs, const char* path) {
     
     if (info.type != MEMFS_TYPE_FILE) return NULL;
     
-    uint8_t* file_data = (uint8_t*)valloc(info.file.size);
-    if (!file_data) return NULL;
-    
-    ssize_t bytes_read = memfs_read(fs, path, file_data, info.file.size);
-    if (bytes_read != info.file.size) {
-        vfree(file_data);
-        return NULL;
+    const uint8_t* file_data = info.file.data;
+    uint8_t* copy = NULL;
+    if (!file_data) {
+        copy = (uint8_t*)valloc(info.file.size);
+        if (!copy) return NULL;
+        
+        ssize_t bytes_read = memfs_read(fs, path, copy, info.file.size);
+        if (bytes_read != info.file.size) {
+            vfree(copy);
+            return NULL;
+        }
+        file_data = copy;
     }
     
     image_t* img = NULL;
@@ -74,7 +79,7 @@ image_t* image_load_from_memfs(memfs* fs, const char* path) {
         img = image_load_from_buffer(file_data, info.file.size);
     }
     
-    vfree(file_data);
+    if (copy) vfree(copy);
     
     return img;
 }
@@ -1,203 +1,239 @@
-
 #include <drivers/images/image.h>
 #include <string.h>
 
-static inline uint8_t fast_divide_255(uint32_t value) {
-    return (value + 1 + (value >> 8)) >> 8;
+#define IMAGE_SPAN 256u
+
+static inline uint32_t image_fetch(const image_t* img, const uint8_t* row, uint32_t sx) {
+    const uint8_t* p = row + sx * (img->bpp / 8);
+    if (img->bpp == 32) {
+        return ((uint32_t)p[3] << 24) | ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    }
+    return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
 }
 
-static inline uint8_t alpha_blend(uint8_t src, uint8_t dst, uint8_t alpha) {
-    uint32_t src_weight = alpha;
-    uint32_t dst_weight = 255 - alpha;
-    uint32_t result = (src * src_weight + dst * dst_weight);
-    return fast_divide_255(result);
+static void image_load_span(const image_t* img, uint32_t sx, uint32_t sy, uint32_t* out, uint32_t n) {
+    const uint8_t* p = img->data + sy * img->pitch + sx * (img->bpp / 8);
+    if (img->bpp == 32) {
+        for (uint32_t i = 0; i < n; i++, p += 4) {
+            out[i] = ((uint32_t)p[3] << 24) | ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+        }
+    } else {
+        for (uint32_t i = 0; i < n; i++, p += 3) {
+            out[i] = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+        }
+    }
 }
 
-void image_draw(image_t* img, uint32_t x, uint32_t y) {
-    if (!img || !img->data || !vesa_is_initialized()) return;
-    
+/* Red and blue share one multiply in separate 16-bit lanes; the sums stay
+   below 0xFF01, so the divide-by-255 rounding can run on both lanes at once. */
+static inline uint32_t image_blend_px(uint32_t s, uint32_t d) {
+    uint32_t a = s >> 24;
+    uint32_t ia = 255u - a;
+    uint32_t rb = (s & 0x00FF00FFu) * a + (d & 0x00FF00FFu) * ia;
+    uint32_t g = ((s >> 8) & 0xFFu) * a + ((d >> 8) & 0xFFu) * ia;
+    rb = ((rb + 0x00010001u + ((rb >> 8) & 0x00FF00FFu)) >> 8) & 0x00FF00FFu;
+    g = (g + 1u + (g >> 8)) & 0x0000FF00u;
+    return rb | g;
+}
+
+static inline uint32_t image_lerp_px(uint32_t a, uint32_t b, uint32_t w) {
+    uint32_t iw = 256u - w;
+    uint32_t rb = (((a & 0x00FF00FFu) * iw + (b & 0x00FF00FFu) * w) >> 8) & 0x00FF00FFu;
+    uint32_t ag = (((a >> 8) & 0x00FF00FFu) * iw + ((b >> 8) & 0x00FF00FFu) * w) & 0xFF00FF00u;
+    return rb | ag;
+}
+
+static void image_blend_span(uint32_t* dst, const uint32_t* src, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t s = src[i];
+        uint32_t a = s >> 24;
+        if (a == 0u) continue;
+        dst[i] = (a == 255u) ? (s & 0x00FFFFFFu) : image_blend_px(s, dst[i]);
+    }
+}
+
+static void image_emit_span(uint32_t x, uint32_t y, uint32_t* span, uint32_t n, bool blend) {
+    uint32_t dst[IMAGE_SPAN];
+    uint32_t opaque = 1;
+    uint32_t visible = 0;
+    if (!blend) {
+        vesa_write_row(x, y, span, n);
+        return;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t a = span[i] >> 24;
+        if (a != 255u) opaque = 0;
+        if (a != 0u) visible = 1;
+    }
+    if (!visible) return;
+    if (opaque) {
+        for (uint32_t i = 0; i < n; i++) span[i] &= 0x00FFFFFFu;
+        vesa_write_row(x, y, span, n);
+        return;
+    }
+    n = vesa_read_row(x, y, dst, n);
+    image_blend_span(dst, span, n);
+    vesa_write_row(x, y, dst, n);
+}
+
+static bool image_clip(uint32_t x, uint32_t y, uint32_t* w, uint32_t* h) {
     uint32_t screen_width = vesa_get_width();
     uint32_t screen_height = vesa_get_height();
-    
-    uint32_t draw_width = img->width;
-    uint32_t draw_height = img->height;
-    
-    if (x + draw_width > screen_width) draw_width = screen_width - x;
-    if (y + draw_height > screen_height) draw_height = screen_height - y;
-    
-    for (uint32_t src_y = 0; src_y < draw_height; src_y++) {
-        uint8_t* src_row = img->data + src_y * img->pitch;
-        
-        for (uint32_t src_x = 0; src_x < draw_width; src_x++) {
-            uint8_t* src_pixel = src_row + src_x * (img->bpp / 8);
-            
-            uint32_t color;
-            if (img->bpp == 24) {
-                color = vesa_rgb(src_pixel[0], src_pixel[1], src_pixel[2]);
-            } else if (img->bpp == 32) {
-                color = vesa_argb(src_pixel[3], src_pixel[0], src_pixel[1], src_pixel[2]);
-            } else {
-                continue;
-            }
-            
-            vesa_put_pixel(x + src_x, y + src_y, color);
+    if (x >= screen_width || y >= screen_height || *w == 0 || *h == 0) return false;
+    if (*w > screen_width - x) *w = screen_width - x;
+    if (*h > screen_height - y) *h = screen_height - y;
+    return true;
+}
+
+static void image_blit(image_t* img, uint32_t src_x, uint32_t src_y, uint32_t w, uint32_t h,
+                       uint32_t dst_x, uint32_t dst_y, bool blend) {
+    uint32_t span[IMAGE_SPAN];
+    for (uint32_t row = 0; row < h; row++) {
+        for (uint32_t col = 0; col < w; col += IMAGE_SPAN) {
+            uint32_t n = w - col;
+            if (n > IMAGE_SPAN) n = IMAGE_SPAN;
+            image_load_span(img, src_x + col, src_y + row, span, n);
+            image_emit_span(dst_x + col, dst_y + row, span, n, blend);
         }
     }
 }
 
+static bool image_drawable(const image_t* img) {
+    if (!img || !img->data || !vesa_is_initialized()) return false;
+    return img->bpp == 24 || img->bpp == 32;
+}
+
+void image_draw(image_t* img, uint32_t x, uint32_t y) {
+    uint32_t draw_width;
+    uint32_t draw_height;
+    if (!image_drawable(img)) return;
+    draw_width = img->width;
+    draw_height = img->height;
+    if (!image_clip(x, y, &draw_width, &draw_height)) return;
+    image_blit(img, 0, 0, draw_width, draw_height, x, y, false);
+}
+
 void image_draw_transparent(image_t* img, uint32_t x, uint32_t y, uint32_t transparent_color) {
-    if (!img || !img->data || !vesa_is_initialized()) return;
-    
-    uint32_t screen_width = vesa_get_width();
-    uint32_t screen_height = vesa_get_height();
-    
-    uint32_t draw_width = img->width;
-    uint32_t draw_height = img->height;
-    
-    if (x + draw_width > screen_width) draw_width = screen_width - x;
-    if (y + draw_height > screen_height) draw_height = screen_height - y;
-    
-    for (uint32_t src_y = 0; src_y < draw_height; src_y++) {
-        uint8_t* src_row = img->data + src_y * img->pitch;
-        
-        for (uint32_t src_x = 0; src_x < draw_width; src_x++) {
-            uint8_t* src_pixel = src_row + src_x * (img->bpp / 8);
-            
-            uint32_t pixel_color;
-            if (img->bpp == 24) {
-                pixel_color = vesa_rgb(src_pixel[0], src_pixel[1], src_pixel[2]);
-            } else if (img->bpp == 32) {
-                pixel_color = vesa_argb(src_pixel[3], src_pixel[0], src_pixel[1], src_pixel[2]);
-            } else {
-                continue;
-            }
-            
-            if (pixel_color != transparent_color) {
-                vesa_put_pixel(x + src_x, y + src_y, pixel_color);
+    uint32_t span[IMAGE_SPAN];
+    uint32_t dst[IMAGE_SPAN];
+    uint32_t draw_width;
+    uint32_t draw_height;
+    if (!image_drawable(img)) return;
+    draw_width = img->width;
+    draw_height = img->height;
+    if (!image_clip(x, y, &draw_width, &draw_height)) return;
+
+    for (uint32_t row = 0; row < draw_height; row++) {
+        for (uint32_t col = 0; col < draw_width; col += IMAGE_SPAN) {
+            uint32_t n = draw_width - col;
+            if (n > IMAGE_SPAN) n = IMAGE_SPAN;
+            image_load_span(img, col, row, span, n);
+            n = vesa_read_row(x + col, y + row, dst, n);
+            for (uint32_t i = 0; i < n; i++) {
+                if (span[i] != transparent_color) dst[i] = span[i];
             }
+            vesa_write_row(x + col, y + row, dst, n);
         }
     }
 }
 
 void image_draw_alpha(image_t* img, uint32_t x, uint32_t y) {
+    uint32_t draw_width;
+    uint32_t draw_height;
     if (!img || !img->data || !vesa_is_initialized() || img->bpp != 32) {
         image_draw(img, x, y);
         return;
     }
-    
-    uint32_t screen_width = vesa_get_width();
-    uint32_t screen_height = vesa_get_height();
-    
-    uint32_t draw_width = img->width;
-    uint32_t draw_height = img->height;
-    
-    if (x + draw_width > screen_width) draw_width = screen_width - x;
-    if (y + draw_height > screen_height) draw_height = screen_height - y;
-    
-    for (uint32_t src_y = 0; src_y < draw_height; src_y++) {
-        uint8_t* src_row = img->data + src_y * img->pitch;
-        
-        for (uint32_t src_x = 0; src_x < draw_width; src_x++) {
-            uint8_t* src_pixel = src_row + src_x * 4;
-            
-            uint8_t alpha = src_pixel[3];
-            
-            if (alpha == 0) {
-                continue;
-            } else if (alpha == 255) {
-                uint32_t color = vesa_rgb(src_pixel[0], src_pixel[1], src_pixel[2]);
-                vesa_put_pixel(x + src_x, y + src_y, color);
-            } else {
-                uint32_t bg_color = vesa_get_pixel(x + src_x, y + src_y);
-                
-                uint8_t bg_r, bg_g, bg_b, bg_a;
-                vesa_extract_color(bg_color, &bg_r, &bg_g, &bg_b, &bg_a);
-                
-                
-                uint8_t r = alpha_blend(src_pixel[0], bg_r, alpha);
-                uint8_t g = alpha_blend(src_pixel[1], bg_g, alpha);
-                uint8_t b = alpha_blend(src_pixel[2], bg_b, alpha);
-                
-                uint32_t blended_color = vesa_rgb(r, g, b);
-                vesa_put_pixel(x + src_x, y + src_y, blended_color);
-            }
+    draw_width = img->width;
+    draw_height = img->height;
+    if (!image_clip(x, y, &draw_width, &draw_height)) return;
+    image_blit(img, 0, 0, draw_width, draw_height, x, y, true);
+}
+
+void image_draw_scaled(image_t* img, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    uint32_t span[IMAGE_SPAN];
+    uint32_t draw_width = width;
+    uint32_t draw_height = height;
+    uint32_t step_x;
+    uint32_t step_y;
+    uint32_t fy = 0;
+    bool blend;
+    if (!image_drawable(img) || img->width == 0 || img->height == 0) return;
+    if (!image_clip(x, y, &draw_width, &draw_height)) return;
+    step_x = (img->width << 16) / width;
+    step_y = (img->height << 16) / height;
+    blend = img->bpp == 32 && img->has_alpha;
+
+    for (uint32_t dy = 0; dy < draw_height; dy++, fy += step_y) {
+        const uint8_t* src_row = img->data + (fy >> 16) * img->pitch;
+        uint32_t fx = 0;
+        for (uint32_t col = 0; col < draw_width; col += IMAGE_SPAN) {
+            uint32_t n = draw_width - col;
+            if (n > IMAGE_SPAN) n = IMAGE_SPAN;
+            for (uint32_t i = 0; i < n; i++, fx += step_x) span[i] = image_fetch(img, src_row, fx >> 16);
+            image_emit_span(x + col, y + dy, span, n, blend);
         }
     }
 }
 
-void image_draw_scaled(image_t* img, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
-    if (!img || !img->data || !vesa_is_initialized() || width == 0 || height == 0) return;
-    
-    uint32_t screen_width = vesa_get_width();
-    uint32_t screen_height = vesa_get_height();
-    
+void image_draw_scaled_bilinear(image_t* img, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+    uint32_t span[IMAGE_SPAN];
     uint32_t draw_width = width;
     uint32_t draw_height = height;
-    
-    if (x + draw_width > screen_width) draw_width = screen_width - x;
-    if (y + draw_height > screen_height) draw_height = screen_height - y;
-    
-    for (uint32_t dy = 0; dy < draw_height; dy++) {
-        uint32_t src_y = (dy * img->height) / height;
-        if (src_y >= img->height) src_y = img->height - 1;
-        
-        uint8_t* src_row = img->data + src_y * img->pitch;
-        
-        for (uint32_t dx = 0; dx < draw_width; dx++) {
-            uint32_t src_x = (dx * img->width) / width;
-            if (src_x >= img->width) src_x = img->width - 1;
-            
-            uint8_t* src_pixel = src_row + src_x * (img->bpp / 8);
-            
-            uint32_t color;
-            if (img->bpp == 24) {
-                color = vesa_rgb(src_pixel[0], src_pixel[1], src_pixel[2]);
-            } else if (img->bpp == 32) {
-                color = vesa_argb(src_pixel[3], src_pixel[0], src_pixel[1], src_pixel[2]);
-            } else {
-                continue;
+    int32_t step_x;
+    int32_t step_y;
+    int32_t fy;
+    bool blend;
+    if (!image_drawable(img) || img->width == 0 || img->height == 0) return;
+    if (!image_clip(x, y, &draw_width, &draw_height)) return;
+    step_x = (int32_t)((img->width << 16) / width);
+    step_y = (int32_t)((img->height << 16) / height);
+    blend = img->bpp == 32 && img->has_alpha;
+    fy = step_y / 2 - 0x8000;
+
+    for (uint32_t dy = 0; dy < draw_height; dy++, fy += step_y) {
+        uint32_t cy = (fy > 0) ? (uint32_t)fy : 0u;
+        uint32_t sy = cy >> 16;
+        uint32_t wy = (cy >> 8) & 0xFFu;
+        const uint8_t* row0;
+        const uint8_t* row1;
+        int32_t fx = step_x / 2 - 0x8000;
+        if (sy >= img->height - 1u) {
+            sy = img->height - 1u;
+            wy = 0;
+        }
+        row0 = img->data + sy * img->pitch;
+        row1 = (wy != 0u) ? row0 + img->pitch : row0;
+
+        for (uint32_t col = 0; col < draw_width; col += IMAGE_SPAN) {
+            uint32_t n = draw_width - col;
+            if (n > IMAGE_SPAN) n = IMAGE_SPAN;
+            for (uint32_t i = 0; i < n; i++, fx += step_x) {
+                uint32_t cx = (fx > 0) ? (uint32_t)fx : 0u;
+                uint32_t sx = cx >> 16;
+                uint32_t wx = (cx >> 8) & 0xFFu;
+                uint32_t sx1 = sx + 1u;
+                uint32_t top;
+                uint32_t bottom;
+                if (sx1 >= img->width) {
+                    sx = img->width - 1u;
+                    sx1 = sx;
+                }
+                top = image_lerp_px(image_fetch(img, row0, sx), image_fetch(img, row0, sx1), wx);
+                bottom = image_lerp_px(image_fetch(img, row1, sx), image_fetch(img, row1, sx1), wx);
+                span[i] = image_lerp_px(top, bottom, wy);
             }
-            
-            vesa_put_pixel(x + dx, y + dy, color);
+            image_emit_span(x + col, y + dy, span, n, blend);
         }
     }
 }
 
 void image_draw_part(image_t* img, uint32_t src_x, uint32_t src_y, uint32_t src_w, uint32_t src_h, uint32_t dst_x, uint32_t dst_y) {
-    if (!img || !img->data || !vesa_is_initialized()) return;
+    if (!image_drawable(img)) return;
     if (src_x >= img->width || src_y >= img->height) return;
-    
+
     if (src_x + src_w > img->width) src_w = img->width - src_x;
     if (src_y + src_h > img->height) src_h = img->height - src_y;
-    
-    uint32_t screen_width = vesa_get_width();
-    uint32_t screen_height = vesa_get_height();
-    
-    uint32_t draw_width = src_w;
-    uint32_t draw_height = src_h;
-    
-    if (dst_x + draw_width > screen_width) draw_width = screen_width - dst_x;
-    if (dst_y + draw_height > screen_height) draw_height = screen_height - dst_y;
-    
-    if (draw_width < src_w) src_w = draw_width;
-    if (draw_height < src_h) src_h = draw_height;
-    
-    for (uint32_t y = 0; y < src_h; y++) {
-        uint8_t* src_row = img->data + (src_y + y) * img->pitch;
-        
-        for (uint32_t x = 0; x < src_w; x++) {
-            uint8_t* src_pixel = src_row + (src_x + x) * (img->bpp / 8);
-            
-            uint32_t color;
-            if (img->bpp == 24) {
-                color = vesa_rgb(src_pixel[0], src_pixel[1], src_pixel[2]);
-            } else if (img->bpp == 32) {
-                color = vesa_argb(src_pixel[3], src_pixel[0], src_pixel[1], src_pixel[2]);
-            } else {
-                continue;
-            }
-            
-            vesa_put_pixel(dst_x + x, dst_y + y, color);
-        }
-    }
-}
\ No newline at end of file
+    if (!image_clip(dst_x, dst_y, &src_w, &src_h)) return;
+    image_blit(img, src_x, src_y, src_w, src_h, dst_x, dst_y, false);
+}
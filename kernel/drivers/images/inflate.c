@@ -0,0 +1,320 @@
+#include <drivers/images/inflate.h>
+#include <asm/mm.h>
+#include <string.h>
+
+#define INFLATE_WINDOW_MASK (INFLATE_WINDOW - 1u)
+#define INFLATE_FAST_MASK ((1u << INFLATE_FAST_BITS) - 1u)
+
+enum {
+    INFLATE_HEADER,
+    INFLATE_STORED,
+    INFLATE_CODES,
+    INFLATE_DONE,
+    INFLATE_ERROR,
+};
+
+static const uint16_t len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t clen_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static inflate_huff_t fixed_lit;
+static inflate_huff_t fixed_dist;
+static bool fixed_ready = false;
+
+static uint32_t bit_reverse(uint32_t code, uint32_t len) {
+    uint32_t r = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        r = (r << 1) | (code & 1u);
+        code >>= 1;
+    }
+    return r;
+}
+
+static int huff_build(inflate_huff_t* h, const uint8_t* lens, uint32_t n) {
+    uint16_t offs[16];
+    int32_t left = 1;
+    uint32_t code = 0;
+    uint32_t idx = 0;
+    memset(h, 0, sizeof(*h));
+    for (uint32_t i = 0; i < n; i++) h->count[lens[i]]++;
+    h->count[0] = 0;
+    for (uint32_t len = 1; len < 16; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0) return -1;
+    }
+    offs[1] = 0;
+    for (uint32_t len = 1; len < 15; len++) offs[len + 1] = (uint16_t)(offs[len] + h->count[len]);
+    for (uint32_t i = 0; i < n; i++) {
+        if (lens[i]) h->symbol[offs[lens[i]]++] = (uint16_t)i;
+    }
+    for (uint32_t len = 1; len <= INFLATE_FAST_BITS; len++) {
+        for (uint32_t k = 0; k < h->count[len]; k++) {
+            uint16_t entry = (uint16_t)((len << 9) | h->symbol[idx++]);
+            for (uint32_t j = bit_reverse(code, len); j <= INFLATE_FAST_MASK; j += 1u << len) h->fast[j] = entry;
+            code++;
+        }
+        code <<= 1;
+    }
+    return 0;
+}
+
+static void inflate_fixed_init(void) {
+    uint8_t lens[288];
+    uint32_t i;
+    if (fixed_ready) return;
+    for (i = 0; i < 144; i++) lens[i] = 8;
+    for (; i < 256; i++) lens[i] = 9;
+    for (; i < 280; i++) lens[i] = 7;
+    for (; i < 288; i++) lens[i] = 8;
+    (void)huff_build(&fixed_lit, lens, 288);
+    for (i = 0; i < 30; i++) lens[i] = 5;
+    (void)huff_build(&fixed_dist, lens, 30);
+    fixed_ready = true;
+}
+
+static uint32_t inflate_byte(inflate_t* z) {
+    while (z->in_len == 0) {
+        if (!z->fill) {
+            z->overrun++;
+            return 0;
+        }
+        z->in_len = z->fill(z->ctx, &z->in);
+        if (z->in_len == 0) z->fill = NULL;
+    }
+    z->in_len--;
+    return *z->in++;
+}
+
+static inline void inflate_need(inflate_t* z, uint32_t n) {
+    while (z->bitcnt < n) {
+        z->bitbuf |= inflate_byte(z) << z->bitcnt;
+        z->bitcnt += 8;
+    }
+}
+
+static inline uint32_t inflate_bits(inflate_t* z, uint32_t n) {
+    uint32_t v;
+    if (n == 0) return 0;
+    inflate_need(z, n);
+    v = z->bitbuf & ((1u << n) - 1u);
+    z->bitbuf >>= n;
+    z->bitcnt -= n;
+    return v;
+}
+
+static int inflate_decode(inflate_t* z, const inflate_huff_t* h) {
+    uint32_t e;
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    inflate_need(z, INFLATE_FAST_BITS);
+    e = h->fast[z->bitbuf & INFLATE_FAST_MASK];
+    if (e) {
+        z->bitbuf >>= e >> 9;
+        z->bitcnt -= e >> 9;
+        return (int)(e & 0x1FFu);
+    }
+    for (uint32_t len = 1; len < 16; len++) {
+        int count;
+        code |= (int)inflate_bits(z, 1);
+        count = h->count[len];
+        if (code - count < first) return h->symbol[index + (code - first)];
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+static int inflate_dynamic(inflate_t* z) {
+    uint8_t lens[286 + 30];
+    uint32_t nlen = inflate_bits(z, 5) + 257u;
+    uint32_t ndist = inflate_bits(z, 5) + 1u;
+    uint32_t ncode = inflate_bits(z, 4) + 4u;
+    uint32_t idx = 0;
+    if (nlen > 286u || ndist > 30u) return -1;
+    memset(lens, 0, 19);
+    for (uint32_t i = 0; i < ncode; i++) lens[clen_order[i]] = (uint8_t)inflate_bits(z, 3);
+    if (huff_build(&z->lit, lens, 19) != 0) return -1;
+
+    while (idx < nlen + ndist) {
+        int sym = inflate_decode(z, &z->lit);
+        uint8_t len = 0;
+        uint32_t rep;
+        if (sym < 0) return -1;
+        if (sym < 16) {
+            lens[idx++] = (uint8_t)sym;
+            continue;
+        }
+        if (sym == 16) {
+            if (idx == 0) return -1;
+            len = lens[idx - 1u];
+            rep = 3u + inflate_bits(z, 2);
+        } else if (sym == 17) {
+            rep = 3u + inflate_bits(z, 3);
+        } else {
+            rep = 11u + inflate_bits(z, 7);
+        }
+        if (idx + rep > nlen + ndist) return -1;
+        while (rep--) lens[idx++] = len;
+    }
+    if (lens[256] == 0) return -1;
+    if (huff_build(&z->lit, lens, nlen) != 0) return -1;
+    if (huff_build(&z->dist, lens + nlen, ndist) != 0) return -1;
+    z->lcode = &z->lit;
+    z->dcode = &z->dist;
+    return 0;
+}
+
+static int inflate_block_header(inflate_t* z) {
+    uint32_t type;
+    if (z->final) {
+        z->state = INFLATE_DONE;
+        return 0;
+    }
+    z->final = (uint8_t)inflate_bits(z, 1);
+    type = inflate_bits(z, 2);
+    if (type == 0) {
+        uint32_t len;
+        uint32_t nlen;
+        z->bitbuf >>= z->bitcnt & 7u;
+        z->bitcnt -= z->bitcnt & 7u;
+        len = inflate_bits(z, 16);
+        nlen = inflate_bits(z, 16);
+        if ((len ^ 0xFFFFu) != nlen) return -1;
+        z->stored = len;
+        z->state = INFLATE_STORED;
+        return 0;
+    }
+    if (type == 1) {
+        inflate_fixed_init();
+        z->lcode = &fixed_lit;
+        z->dcode = &fixed_dist;
+        z->state = INFLATE_CODES;
+        return 0;
+    }
+    if (type == 2 && inflate_dynamic(z) == 0) {
+        z->state = INFLATE_CODES;
+        return 0;
+    }
+    return -1;
+}
+
+static inline void inflate_put(inflate_t* z, uint8_t* out, uint32_t* n, uint8_t b) {
+    out[(*n)++] = b;
+    z->window[z->wpos] = b;
+    z->wpos = (z->wpos + 1u) & INFLATE_WINDOW_MASK;
+    if (z->total < INFLATE_WINDOW) z->total++;
+}
+
+int inflate_init(inflate_t* z, inflate_fill_t fill, void* ctx, bool zlib) {
+    if (!z || !fill) return -1;
+    memset(z, 0, sizeof(*z));
+    z->fill = fill;
+    z->ctx = ctx;
+    z->state = INFLATE_HEADER;
+    z->window = (uint8_t*)valloc(INFLATE_WINDOW);
+    if (!z->window) return -1;
+    if (zlib) {
+        uint32_t cmf = inflate_bits(z, 8);
+        uint32_t flg = inflate_bits(z, 8);
+        if ((cmf & 0x0Fu) != 8u || (cmf >> 4) > 7u || ((cmf << 8) | flg) % 31u != 0 || (flg & 0x20u)) {
+            inflate_free(z);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int32_t inflate_read(inflate_t* z, uint8_t* out, uint32_t size) {
+    uint32_t n = 0;
+    if (!z || !z->window || !out) return -1;
+    while (n < size) {
+        if (z->match_len) {
+            uint32_t run = z->match_len;
+            if (run > size - n) run = size - n;
+            z->match_len -= run;
+            while (run--) inflate_put(z, out, &n, z->window[(z->wpos - z->match_dist) & INFLATE_WINDOW_MASK]);
+            continue;
+        }
+        switch (z->state) {
+            case INFLATE_HEADER:
+                if (inflate_block_header(z) != 0) z->state = INFLATE_ERROR;
+                break;
+            case INFLATE_STORED:
+                if (z->stored == 0) {
+                    z->state = INFLATE_HEADER;
+                    break;
+                }
+                inflate_put(z, out, &n, (uint8_t)inflate_bits(z, 8));
+                z->stored--;
+                break;
+            case INFLATE_CODES: {
+                int sym = inflate_decode(z, z->lcode);
+                uint32_t len;
+                uint32_t dist;
+                if (sym < 0) {
+                    z->state = INFLATE_ERROR;
+                    break;
+                }
+                if (sym < 256) {
+                    inflate_put(z, out, &n, (uint8_t)sym);
+                    break;
+                }
+                if (sym == 256) {
+                    z->state = INFLATE_HEADER;
+                    break;
+                }
+                sym -= 257;
+                if (sym >= 29) {
+                    z->state = INFLATE_ERROR;
+                    break;
+                }
+                len = len_base[sym] + inflate_bits(z, len_extra[sym]);
+                sym = inflate_decode(z, z->dcode);
+                if (sym < 0 || sym >= 30) {
+                    z->state = INFLATE_ERROR;
+                    break;
+                }
+                dist = dist_base[sym] + inflate_bits(z, dist_extra[sym]);
+                if (dist > z->total) {
+                    z->state = INFLATE_ERROR;
+                    break;
+                }
+                z->match_len = len;
+                z->match_dist = dist;
+                break;
+            }
+            case INFLATE_DONE:
+                return (int32_t)n;
+            default:
+                return -1;
+        }
+        if (z->overrun > 4u) z->state = INFLATE_ERROR;
+    }
+    return (int32_t)n;
+}
+
+void inflate_free(inflate_t* z) {
+    if (!z || !z->window) return;
+    vfree(z->window);
+    z->window = NULL;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define INFLATE_WINDOW 32768u
+#define INFLATE_FAST_BITS 9u
+
+typedef struct {
+    uint16_t fast[1u << INFLATE_FAST_BITS];
+    uint16_t count[16];
+    uint16_t symbol[288];
+} inflate_huff_t;
+
+typedef uint32_t (*inflate_fill_t)(void* ctx, const uint8_t** data);
+
+typedef struct {
+    inflate_fill_t fill;
+    void* ctx;
+    const uint8_t* in;
+    uint32_t in_len;
+    uint32_t bitbuf;
+    uint32_t bitcnt;
+    uint32_t overrun;
+    uint8_t* window;
+    uint32_t wpos;
+    uint32_t total;
+    uint32_t stored;
+    uint32_t match_len;
+    uint32_t match_dist;
+    uint8_t state;
+    uint8_t final;
+    const inflate_huff_t* lcode;
+    const inflate_huff_t* dcode;
+    inflate_huff_t lit;
+    inflate_huff_t dist;
+} inflate_t;
+
+int inflate_init(inflate_t* z, inflate_fill_t fill, void* ctx, bool zlib);
+int32_t inflate_read(inflate_t* z, uint8_t* out, uint32_t size);
+void inflate_free(inflate_t* z);
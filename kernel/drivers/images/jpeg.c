@@ -1,15 +1,577 @@
-
 #include <drivers/images/jpeg.h>
+#include <asm/mm.h>
 #include <string.h>
 
+#define JPEG_FAST_BITS 9u
+#define JPEG_MAX_COMPONENTS 3u
+#define JPEG_MAX_DIM 16384u
+
+typedef struct {
+    uint16_t fast[1u << JPEG_FAST_BITS];
+    uint16_t code[256];
+    uint8_t values[256];
+    uint8_t size[257];
+    uint32_t maxcode[18];
+    int32_t delta[17];
+    bool present;
+} jpeg_huff_t;
+
+typedef struct {
+    uint8_t id;
+    uint8_t h;
+    uint8_t v;
+    uint8_t tq;
+    uint8_t td;
+    uint8_t ta;
+    uint8_t hshift;
+    uint8_t vshift;
+    int32_t dc_pred;
+    uint32_t stride;
+    uint8_t* plane;
+} jpeg_component_t;
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    uint32_t bits;
+    uint32_t nbits;
+    uint8_t marker;
+    bool error;
+    uint32_t width;
+    uint32_t height;
+    uint32_t ncomp;
+    uint32_t hmax;
+    uint32_t vmax;
+    uint32_t restart_interval;
+    bool adobe;
+    uint8_t adobe_transform;
+    bool rgb;
+    uint16_t quant[4][64];
+    jpeg_huff_t dc[4];
+    jpeg_huff_t ac[4];
+    jpeg_component_t comp[JPEG_MAX_COMPONENTS];
+} jpeg_t;
+
+static const uint8_t jpeg_zigzag[64 + 16] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+};
+
+static uint16_t jpeg_be16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
 
 bool jpeg_verify(const uint8_t* data, size_t size) {
     if (size < 2) return false;
-    
+
     return (data[0] == 0xFF && data[1] == 0xD8);
 }
 
+static int jpeg_build_huff(jpeg_huff_t* h, const uint8_t* counts, const uint8_t* vals) {
+    uint32_t k = 0;
+    uint32_t code = 0;
+    memset(h, 0, sizeof(*h));
+    for (uint32_t i = 0; i < 16; i++) {
+        for (uint32_t j = 0; j < counts[i]; j++) {
+            if (k >= 256) return -1;
+            h->size[k++] = (uint8_t)(i + 1u);
+        }
+    }
+    memcpy(h->values, vals, k);
+    h->size[k] = 0;
+
+    k = 0;
+    for (uint32_t j = 1; j <= 16; j++) {
+        h->delta[j] = (int32_t)k - (int32_t)code;
+        while (h->size[k] == j) h->code[k++] = (uint16_t)code++;
+        if (code > (1u << j)) return -1;
+        h->maxcode[j] = code << (16u - j);
+        code <<= 1;
+    }
+    h->maxcode[17] = 0xFFFFFFFFu;
+
+    for (uint32_t i = 0; i < k; i++) {
+        uint32_t s = h->size[i];
+        if (s <= JPEG_FAST_BITS) {
+            uint32_t c = (uint32_t)h->code[i] << (JPEG_FAST_BITS - s);
+            uint32_t m = 1u << (JPEG_FAST_BITS - s);
+            for (uint32_t j = 0; j < m; j++) h->fast[c + j] = (uint16_t)((s << 8) | h->values[i]);
+        }
+    }
+    h->present = true;
+    return 0;
+}
+
+static void jpeg_fill(jpeg_t* j) {
+    while (j->nbits <= 24) {
+        uint32_t b = 0;
+        if (!j->marker && j->pos < j->size) {
+            b = j->data[j->pos++];
+            if (b == 0xFF) {
+                uint8_t c = 0;
+                while (j->pos < j->size && (c = j->data[j->pos++]) == 0xFF) {}
+                if (c != 0) {
+                    j->marker = c;
+                    b = 0;
+                }
+            }
+        }
+        j->bits |= b << (24u - j->nbits);
+        j->nbits += 8;
+    }
+}
+
+static int jpeg_decode_huff(jpeg_t* j, const jpeg_huff_t* h) {
+    uint32_t e;
+    uint32_t k;
+    uint32_t c;
+    jpeg_fill(j);
+    e = h->fast[j->bits >> (32u - JPEG_FAST_BITS)];
+    if (e) {
+        k = e >> 8;
+        j->bits <<= k;
+        j->nbits -= k;
+        return (int)(e & 0xFFu);
+    }
+    for (k = JPEG_FAST_BITS + 1u; k <= 16u; k++) {
+        if ((j->bits >> 16) < h->maxcode[k]) break;
+    }
+    if (k > 16u) {
+        j->error = true;
+        return -1;
+    }
+    c = (uint32_t)((int32_t)(j->bits >> (32u - k)) + h->delta[k]);
+    if (c >= 256u) {
+        j->error = true;
+        return -1;
+    }
+    j->bits <<= k;
+    j->nbits -= k;
+    return h->values[c];
+}
+
+static int32_t jpeg_extend(jpeg_t* j, uint32_t s) {
+    uint32_t v;
+    if (s == 0) return 0;
+    if (s > 16u) {
+        j->error = true;
+        return 0;
+    }
+    if (j->nbits < s) jpeg_fill(j);
+    v = j->bits >> (32u - s);
+    j->bits <<= s;
+    j->nbits -= s;
+    if (v < (1u << (s - 1u))) return (int32_t)v - (int32_t)((1u << s) - 1u);
+    return (int32_t)v;
+}
+
+static int jpeg_decode_block(jpeg_t* j, jpeg_component_t* c, int32_t* coef) {
+    const jpeg_huff_t* dc = &j->dc[c->td];
+    const jpeg_huff_t* ac = &j->ac[c->ta];
+    const uint16_t* q = j->quant[c->tq];
+    int t;
+    uint32_t k = 1;
+
+    memset(coef, 0, 64 * sizeof(int32_t));
+    t = jpeg_decode_huff(j, dc);
+    if (t < 0 || t > 11) return -1;
+    c->dc_pred += jpeg_extend(j, (uint32_t)t);
+    coef[0] = c->dc_pred * (int32_t)q[0];
+
+    while (k < 64u) {
+        int rs = jpeg_decode_huff(j, ac);
+        uint32_t r;
+        uint32_t s;
+        if (rs < 0) return -1;
+        r = (uint32_t)rs >> 4;
+        s = (uint32_t)rs & 15u;
+        if (s == 0) {
+            if (r != 15u) break;
+            k += 16u;
+            continue;
+        }
+        k += r;
+        if (k > 63u) return -1;
+        coef[jpeg_zigzag[k]] = jpeg_extend(j, s) * (int32_t)q[k];
+        k++;
+    }
+    return j->error ? -1 : 0;
+}
+
+static inline uint8_t jpeg_clamp(int32_t v) {
+    if ((uint32_t)v > 255u) return v < 0 ? 0 : 255;
+    return (uint8_t)v;
+}
+
+/* Integer IDCT with 12-bit fixed-point rotations (the LLM factorisation used
+   by libjpeg's islow path); columns keep 2 extra bits, rows descale by 17. */
+#define JPEG_IDCT_1D(s0, s1, s2, s3, s4, s5, s6, s7)  \
+    int32_t t0, t1, t2, t3, p1, p2, p3, p4, p5, x0, x1, x2, x3; \
+    p2 = (s2);                                        \
+    p3 = (s6);                                        \
+    p1 = (p2 + p3) * 2217;                            \
+    t2 = p1 + p3 * -7567;                             \
+    t3 = p1 + p2 * 3135;                              \
+    p2 = (s0);                                        \
+    p3 = (s4);                                        \
+    t0 = (p2 + p3) * 4096;                            \
+    t1 = (p2 - p3) * 4096;                            \
+    x0 = t0 + t3;                                     \
+    x3 = t0 - t3;                                     \
+    x1 = t1 + t2;                                     \
+    x2 = t1 - t2;                                     \
+    t0 = (s7);                                        \
+    t1 = (s5);                                        \
+    t2 = (s3);                                        \
+    t3 = (s1);                                        \
+    p3 = t0 + t2;                                     \
+    p4 = t1 + t3;                                     \
+    p1 = t0 + t3;                                     \
+    p2 = t1 + t2;                                     \
+    p5 = (p3 + p4) * 4816;                            \
+    t0 = t0 * 1223;                                   \
+    t1 = t1 * 8410;                                   \
+    t2 = t2 * 12586;                                  \
+    t3 = t3 * 6149;                                   \
+    p1 = p5 + p1 * -3685;                             \
+    p2 = p5 + p2 * -10497;                            \
+    p3 = p3 * -8034;                                  \
+    p4 = p4 * -1597;                                  \
+    t3 += p1 + p4;                                    \
+    t2 += p2 + p3;                                    \
+    t1 += p2 + p4;                                    \
+    t0 += p1 + p3;
+
+static void jpeg_idct(const int32_t* in, uint8_t* out, uint32_t stride) {
+    int32_t tmp[64];
+    for (uint32_t i = 0; i < 8; i++) {
+        const int32_t* d = in + i;
+        int32_t* v = tmp + i;
+        if (d[8] == 0 && d[16] == 0 && d[24] == 0 && d[32] == 0 && d[40] == 0 && d[48] == 0 && d[56] == 0) {
+            int32_t dc = d[0] * 4;
+            v[0] = v[8] = v[16] = v[24] = v[32] = v[40] = v[48] = v[56] = dc;
+            continue;
+        }
+        {
+            JPEG_IDCT_1D(d[0], d[8], d[16], d[24], d[32], d[40], d[48], d[56])
+            x0 += 512;
+            x1 += 512;
+            x2 += 512;
+            x3 += 512;
+            v[0] = (x0 + t3) >> 10;
+            v[56] = (x0 - t3) >> 10;
+            v[8] = (x1 + t2) >> 10;
+            v[48] = (x1 - t2) >> 10;
+            v[16] = (x2 + t1) >> 10;
+            v[40] = (x2 - t1) >> 10;
+            v[24] = (x3 + t0) >> 10;
+            v[32] = (x3 - t0) >> 10;
+        }
+    }
+    for (uint32_t i = 0; i < 8; i++, out += stride) {
+        const int32_t* v = tmp + i * 8u;
+        JPEG_IDCT_1D(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7])
+        x0 += 65536 + (128 << 17);
+        x1 += 65536 + (128 << 17);
+        x2 += 65536 + (128 << 17);
+        x3 += 65536 + (128 << 17);
+        out[0] = jpeg_clamp((x0 + t3) >> 17);
+        out[7] = jpeg_clamp((x0 - t3) >> 17);
+        out[1] = jpeg_clamp((x1 + t2) >> 17);
+        out[6] = jpeg_clamp((x1 - t2) >> 17);
+        out[2] = jpeg_clamp((x2 + t1) >> 17);
+        out[5] = jpeg_clamp((x2 - t1) >> 17);
+        out[3] = jpeg_clamp((x3 + t0) >> 17);
+        out[4] = jpeg_clamp((x3 - t0) >> 17);
+    }
+}
+
+static void jpeg_restart(jpeg_t* j) {
+    if (!j->marker) {
+        while (j->pos + 1u < j->size) {
+            if (j->data[j->pos] == 0xFF && j->data[j->pos + 1u] >= 0xD0 && j->data[j->pos + 1u] <= 0xD7) {
+                j->pos += 2u;
+                break;
+            }
+            j->pos++;
+        }
+    }
+    j->marker = 0;
+    j->bits = 0;
+    j->nbits = 0;
+    for (uint32_t i = 0; i < j->ncomp; i++) j->comp[i].dc_pred = 0;
+}
+
+static void jpeg_color_row(const jpeg_t* j, uint32_t y, uint8_t* dst) {
+    const jpeg_component_t* c0 = &j->comp[0];
+    const uint8_t* yrow = c0->plane + (y >> c0->vshift) * c0->stride;
+    if (j->ncomp == 1) {
+        for (uint32_t x = 0; x < j->width; x++, dst += 3) dst[0] = dst[1] = dst[2] = yrow[x];
+        return;
+    }
+    {
+        const jpeg_component_t* c1 = &j->comp[1];
+        const jpeg_component_t* c2 = &j->comp[2];
+        const uint8_t* cbrow = c1->plane + (y >> c1->vshift) * c1->stride;
+        const uint8_t* crrow = c2->plane + (y >> c2->vshift) * c2->stride;
+        if (j->rgb) {
+            for (uint32_t x = 0; x < j->width; x++, dst += 3) {
+                dst[0] = yrow[x >> c0->hshift];
+                dst[1] = cbrow[x >> c1->hshift];
+                dst[2] = crrow[x >> c2->hshift];
+            }
+            return;
+        }
+        for (uint32_t x = 0; x < j->width; x++, dst += 3) {
+            int32_t yy = (int32_t)yrow[x >> c0->hshift] << 16;
+            int32_t cb = (int32_t)cbrow[x >> c1->hshift] - 128;
+            int32_t cr = (int32_t)crrow[x >> c2->hshift] - 128;
+            dst[0] = jpeg_clamp((yy + 91881 * cr + 32768) >> 16);
+            dst[1] = jpeg_clamp((yy - 22553 * cb - 46802 * cr + 32768) >> 16);
+            dst[2] = jpeg_clamp((yy + 116130 * cb + 32768) >> 16);
+        }
+    }
+}
+
+static int jpeg_decode_scan(jpeg_t* j, image_t* img) {
+    uint32_t mcu_w = 8u * j->hmax;
+    uint32_t mcu_h = 8u * j->vmax;
+    uint32_t mcus_x = (j->width + mcu_w - 1u) / mcu_w;
+    uint32_t mcus_y = (j->height + mcu_h - 1u) / mcu_h;
+    uint32_t todo = j->restart_interval;
+    int32_t coef[64];
+    int rc = 0;
+
+    for (uint32_t i = 0; i < j->ncomp; i++) {
+        jpeg_component_t* c = &j->comp[i];
+        c->stride = mcus_x * c->h * 8u;
+        c->plane = (uint8_t*)valloc(c->stride * c->v * 8u);
+        if (!c->plane) rc = -1;
+    }
+
+    for (uint32_t my = 0; my < mcus_y && rc == 0; my++) {
+        for (uint32_t mx = 0; mx < mcus_x && rc == 0; mx++) {
+            if (j->restart_interval) {
+                if (todo == 0) {
+                    jpeg_restart(j);
+                    todo = j->restart_interval;
+                }
+                todo--;
+            }
+            for (uint32_t i = 0; i < j->ncomp && rc == 0; i++) {
+                jpeg_component_t* c = &j->comp[i];
+                for (uint32_t by = 0; by < c->v && rc == 0; by++) {
+                    for (uint32_t bx = 0; bx < c->h; bx++) {
+                        uint8_t* out = c->plane + by * 8u * c->stride + (mx * c->h + bx) * 8u;
+                        if (jpeg_decode_block(j, c, coef) != 0) {
+                            rc = -1;
+                            break;
+                        }
+                        jpeg_idct(coef, out, c->stride);
+                    }
+                }
+            }
+        }
+        for (uint32_t y = 0; y < mcu_h && rc == 0; y++) {
+            uint32_t oy = my * mcu_h + y;
+            if (oy >= j->height) break;
+            jpeg_color_row(j, y, img->data + oy * img->pitch);
+        }
+    }
+
+    for (uint32_t i = 0; i < j->ncomp; i++) {
+        if (j->comp[i].plane) vfree(j->comp[i].plane);
+        j->comp[i].plane = NULL;
+    }
+    return rc;
+}
+
+static int jpeg_parse_sof(jpeg_t* j, const uint8_t* p, uint32_t len) {
+    if (len < 6 || p[0] != 8) return -1;
+    j->height = jpeg_be16(p + 1);
+    j->width = jpeg_be16(p + 3);
+    j->ncomp = p[5];
+    if (j->width == 0 || j->height == 0 || j->width > JPEG_MAX_DIM || j->height > JPEG_MAX_DIM) return -1;
+    if ((j->ncomp != 1 && j->ncomp != 3) || len < 6u + j->ncomp * 3u) return -1;
+    j->hmax = 1;
+    j->vmax = 1;
+    for (uint32_t i = 0; i < j->ncomp; i++) {
+        jpeg_component_t* c = &j->comp[i];
+        const uint8_t* e = p + 6 + i * 3u;
+        c->id = e[0];
+        c->h = (uint8_t)(e[1] >> 4);
+        c->v = (uint8_t)(e[1] & 15u);
+        c->tq = e[2];
+        if (c->h < 1 || c->h > 4 || c->v < 1 || c->v > 4 || c->tq > 3) return -1;
+        if (c->h > j->hmax) j->hmax = c->h;
+        if (c->v > j->vmax) j->vmax = c->v;
+    }
+    if (j->ncomp == 1) {
+        j->comp[0].h = 1;
+        j->comp[0].v = 1;
+        j->hmax = 1;
+        j->vmax = 1;
+    }
+    for (uint32_t i = 0; i < j->ncomp; i++) {
+        jpeg_component_t* c = &j->comp[i];
+        uint32_t hs = j->hmax / c->h;
+        uint32_t vs = j->vmax / c->v;
+        if (j->hmax % c->h || j->vmax % c->v || (hs & (hs - 1u)) || (vs & (vs - 1u))) return -1;
+        c->hshift = (uint8_t)(hs == 4 ? 2 : hs == 2 ? 1 : 0);
+        c->vshift = (uint8_t)(vs == 4 ? 2 : vs == 2 ? 1 : 0);
+    }
+    return 0;
+}
+
+static int jpeg_parse_dht(jpeg_t* j, const uint8_t* p, uint32_t len) {
+    while (len >= 17) {
+        uint32_t tc = p[0] >> 4;
+        uint32_t th = p[0] & 15u;
+        uint32_t total = 0;
+        for (uint32_t i = 0; i < 16; i++) total += p[1 + i];
+        if (tc > 1 || th > 3 || total > 256 || len < 17u + total) return -1;
+        if (jpeg_build_huff(tc ? &j->ac[th] : &j->dc[th], p + 1, p + 17) != 0) return -1;
+        p += 17u + total;
+        len -= 17u + total;
+    }
+    return len == 0 ? 0 : -1;
+}
+
+static int jpeg_parse_dqt(jpeg_t* j, const uint8_t* p, uint32_t len) {
+    while (len > 0) {
+        uint32_t pq = p[0] >> 4;
+        uint32_t tq = p[0] & 15u;
+        uint32_t need = 1u + (pq ? 128u : 64u);
+        if (pq > 1 || tq > 3 || len < need) return -1;
+        for (uint32_t i = 0; i < 64; i++) {
+            j->quant[tq][i] = pq ? jpeg_be16(p + 1 + i * 2u) : p[1 + i];
+        }
+        p += need;
+        len -= need;
+    }
+    return 0;
+}
+
+static int jpeg_parse_sos(jpeg_t* j, const uint8_t* p, uint32_t len) {
+    uint32_t ns;
+    if (len < 1) return -1;
+    ns = p[0];
+    if (ns != j->ncomp || len < 4u + ns * 2u) return -1;
+    for (uint32_t i = 0; i < ns; i++) {
+        uint8_t id = p[1 + i * 2u];
+        uint8_t tables = p[2 + i * 2u];
+        uint32_t k = 0;
+        while (k < j->ncomp && j->comp[k].id != id) k++;
+        if (k == j->ncomp) return -1;
+        j->comp[k].td = (uint8_t)(tables >> 4);
+        j->comp[k].ta = (uint8_t)(tables & 15u);
+        if (j->comp[k].td > 3 || j->comp[k].ta > 3) return -1;
+        if (!j->dc[j->comp[k].td].present || !j->ac[j->comp[k].ta].present) return -1;
+        j->comp[k].dc_pred = 0;
+    }
+    return 0;
+}
+
+static int jpeg_decode(jpeg_t* j, image_t* img) {
+    bool have_frame = false;
+    while (j->pos + 4u <= j->size) {
+        uint8_t m;
+        uint32_t len;
+        const uint8_t* body;
+        if (j->data[j->pos] != 0xFF) {
+            j->pos++;
+            continue;
+        }
+        m = j->data[j->pos + 1u];
+        if (m == 0xFF) {
+            j->pos++;
+            continue;
+        }
+        if (m == 0xD8 || (m >= 0xD0 && m <= 0xD7) || m == 0x01) {
+            j->pos += 2u;
+            continue;
+        }
+        if (m == 0xD9) break;
+        len = jpeg_be16(j->data + j->pos + 2u);
+        if (len < 2u || j->pos + 2u + len > j->size) return -1;
+        body = j->data + j->pos + 4u;
+        j->pos += 2u + len;
+        len -= 2u;
+
+        switch (m) {
+            case 0xC0:
+            case 0xC1:
+                if (have_frame || jpeg_parse_sof(j, body, len) != 0) return -1;
+                have_frame = true;
+                img->width = j->width;
+                img->height = j->height;
+                img->pitch = image_calculate_pitch(img->width, img->bpp);
+                img->data_size = img->pitch * img->height;
+                img->data = (uint8_t*)valloc(img->data_size);
+                if (!img->data) return -1;
+                break;
+            case 0xC4:
+                if (jpeg_parse_dht(j, body, len) != 0) return -1;
+                break;
+            case 0xDB:
+                if (jpeg_parse_dqt(j, body, len) != 0) return -1;
+                break;
+            case 0xDD:
+                if (len < 2) return -1;
+                j->restart_interval = jpeg_be16(body);
+                break;
+            case 0xEE:
+                if (len >= 12u && memcmp(body, "Adobe", 5) == 0) {
+                    j->adobe = true;
+                    j->adobe_transform = body[11];
+                }
+                break;
+            case 0xDA:
+                if (!have_frame || jpeg_parse_sos(j, body, len) != 0) return -1;
+                /* Adobe transform 0, or component IDs 'R','G','B' without an Adobe marker, mean the samples are already RGB. */
+                if (j->adobe) j->rgb = j->ncomp == 3 && j->adobe_transform == 0;
+                else j->rgb = j->ncomp == 3 && j->comp[0].id == 'R' && j->comp[1].id == 'G' && j->comp[2].id == 'B';
+                j->bits = 0;
+                j->nbits = 0;
+                j->marker = 0;
+                return jpeg_decode_scan(j, img);
+            default:
+                if (m >= 0xC2 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC) return -1;
+                break;
+        }
+    }
+    return -1;
+}
+
 image_t* jpeg_load(const uint8_t* data, size_t size) {
-    
-    return NULL;
+    jpeg_t* j;
+    image_t* img;
+    if (!data || !jpeg_verify(data, size)) return NULL;
+
+    j = (jpeg_t*)valloc(sizeof(jpeg_t));
+    img = (image_t*)valloc(sizeof(image_t));
+    if (!j || !img) {
+        if (j) vfree(j);
+        if (img) vfree(img);
+        return NULL;
+    }
+    memset(j, 0, sizeof(*j));
+    memset(img, 0, sizeof(image_t));
+    j->data = data;
+    j->size = size;
+    j->pos = 0;
+    img->bpp = 24;
+    img->type = IMAGE_TYPE_JPEG;
+    img->has_alpha = false;
+
+    if (jpeg_decode(j, img) != 0) {
+        image_free(img);
+        img = NULL;
+    }
+    vfree(j);
+    return img;
 }
@@ -1,15 +1,290 @@
-
 #include <drivers/images/png.h>
+#include <drivers/images/inflate.h>
+#include <asm/mm.h>
 #include <string.h>
 
+#define PNG_MAX_DIM 16384u
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint8_t depth;
+    uint8_t color;
+    uint8_t channels;
+    bool has_trns;
+    uint16_t trns_key[3];
+    uint32_t palette_len;
+    uint8_t palette[256][4];
+} png_info_t;
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+} png_idat_src_t;
+
+static uint32_t png_be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
 bool png_verify(const uint8_t* data, size_t size) {
     if (size < 8) return false;
-    
+
     const uint8_t png_signature[8] = {0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A};
     return memcmp(data, png_signature, 8) == 0;
 }
 
+static uint32_t png_next_idat(void* ctx, const uint8_t** out) {
+    png_idat_src_t* s = (png_idat_src_t*)ctx;
+    while (s->pos + 12u <= s->size) {
+        uint32_t len = png_be32(s->data + s->pos);
+        const uint8_t* type = s->data + s->pos + 4;
+        size_t body = s->pos + 8u;
+        if (len > s->size - body - 4u) return 0;
+        if (memcmp(type, "IDAT", 4) != 0) return 0;
+        s->pos = body + len + 4u;
+        if (len == 0) continue;
+        *out = s->data + body;
+        return len;
+    }
+    return 0;
+}
+
+static bool png_valid_format(const png_info_t* p) {
+    switch (p->color) {
+        case 0: return p->depth == 1 || p->depth == 2 || p->depth == 4 || p->depth == 8 || p->depth == 16;
+        case 3: return p->depth == 1 || p->depth == 2 || p->depth == 4 || p->depth == 8;
+        case 2:
+        case 4:
+        case 6: return p->depth == 8 || p->depth == 16;
+        default: return false;
+    }
+}
+
+static int png_parse_chunks(const uint8_t* data, size_t size, png_info_t* p, size_t* idat_pos) {
+    size_t pos = 8;
+    bool have_ihdr = false;
+    while (pos + 12u <= size) {
+        uint32_t len = png_be32(data + pos);
+        const uint8_t* type = data + pos + 4;
+        const uint8_t* body = data + pos + 8;
+        if (len > size - pos - 12u) return -1;
+
+        if (memcmp(type, "IHDR", 4) == 0) {
+            if (len != 13) return -1;
+            p->width = png_be32(body);
+            p->height = png_be32(body + 4);
+            p->depth = body[8];
+            p->color = body[9];
+            if (body[10] != 0 || body[11] != 0 || body[12] != 0) return -1;
+            have_ihdr = true;
+        } else if (!have_ihdr) {
+            return -1;
+        } else if (memcmp(type, "PLTE", 4) == 0) {
+            if (len % 3u != 0 || len > 768u) return -1;
+            p->palette_len = len / 3u;
+            for (uint32_t i = 0; i < p->palette_len; i++) {
+                p->palette[i][0] = body[i * 3u];
+                p->palette[i][1] = body[i * 3u + 1u];
+                p->palette[i][2] = body[i * 3u + 2u];
+                p->palette[i][3] = 255;
+            }
+        } else if (memcmp(type, "tRNS", 4) == 0) {
+            if (p->color == 3) {
+                for (uint32_t i = 0; i < len && i < 256u; i++) p->palette[i][3] = body[i];
+            } else if (p->color == 0 && len >= 2) {
+                p->trns_key[0] = (uint16_t)((body[0] << 8) | body[1]);
+            } else if (p->color == 2 && len >= 6) {
+                for (uint32_t i = 0; i < 3; i++) p->trns_key[i] = (uint16_t)((body[i * 2u] << 8) | body[i * 2u + 1u]);
+            } else {
+                return -1;
+            }
+            p->has_trns = true;
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            *idat_pos = pos;
+            return 0;
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            return -1;
+        }
+        pos += 12u + len;
+    }
+    return -1;
+}
+
+static inline uint8_t png_paeth(uint8_t a, uint8_t b, uint8_t c) {
+    int32_t p = (int32_t)a + b - c;
+    int32_t pa = p > a ? p - a : a - p;
+    int32_t pb = p > b ? p - b : b - p;
+    int32_t pc = p > c ? p - c : c - p;
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+static int png_unfilter(uint8_t filter, uint8_t* cur, const uint8_t* prev, uint32_t n, uint32_t bpp) {
+    uint32_t i;
+    switch (filter) {
+        case 0:
+            break;
+        case 1:
+            for (i = bpp; i < n; i++) cur[i] = (uint8_t)(cur[i] + cur[i - bpp]);
+            break;
+        case 2:
+            for (i = 0; i < n; i++) cur[i] = (uint8_t)(cur[i] + prev[i]);
+            break;
+        case 3:
+            for (i = 0; i < bpp; i++) cur[i] = (uint8_t)(cur[i] + (prev[i] >> 1));
+            for (; i < n; i++) cur[i] = (uint8_t)(cur[i] + ((cur[i - bpp] + prev[i]) >> 1));
+            break;
+        case 4:
+            for (i = 0; i < bpp; i++) cur[i] = (uint8_t)(cur[i] + prev[i]);
+            for (; i < n; i++) cur[i] = (uint8_t)(cur[i] + png_paeth(cur[i - bpp], prev[i], prev[i - bpp]));
+            break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+static inline uint32_t png_sample(const uint8_t* row, uint32_t idx, uint32_t depth) {
+    uint32_t bit;
+    if (depth == 8) return row[idx];
+    if (depth == 16) return ((uint32_t)row[idx * 2u] << 8) | row[idx * 2u + 1u];
+    bit = idx * depth;
+    return (row[bit >> 3] >> (8u - depth - (bit & 7u))) & ((1u << depth) - 1u);
+}
+
+static inline uint8_t png_to8(uint32_t v, uint32_t depth) {
+    switch (depth) {
+        case 1: return (uint8_t)(v * 255u);
+        case 2: return (uint8_t)(v * 85u);
+        case 4: return (uint8_t)(v * 17u);
+        case 16: return (uint8_t)(v >> 8);
+        default: return (uint8_t)v;
+    }
+}
+
+static void png_convert_row(const png_info_t* p, const uint8_t* src, uint8_t* dst, bool alpha) {
+    uint32_t out_bpp = alpha ? 4u : 3u;
+    if (p->depth == 8 && !p->has_trns && ((p->color == 2 && !alpha) || (p->color == 6 && alpha))) {
+        memcpy(dst, src, p->width * out_bpp);
+        return;
+    }
+    for (uint32_t x = 0; x < p->width; x++, dst += out_bpp) {
+        uint32_t c = x * p->channels;
+        uint32_t r;
+        uint32_t g;
+        uint32_t b;
+        uint8_t a = 255;
+        switch (p->color) {
+            case 0:
+                r = png_sample(src, x, p->depth);
+                if (p->has_trns && r == p->trns_key[0]) a = 0;
+                dst[0] = dst[1] = dst[2] = png_to8(r, p->depth);
+                break;
+            case 3: {
+                const uint8_t* e = p->palette[png_sample(src, x, p->depth)];
+                dst[0] = e[0];
+                dst[1] = e[1];
+                dst[2] = e[2];
+                a = e[3];
+                break;
+            }
+            case 4:
+                dst[0] = dst[1] = dst[2] = png_to8(png_sample(src, c, p->depth), p->depth);
+                a = png_to8(png_sample(src, c + 1u, p->depth), p->depth);
+                break;
+            default:
+                r = png_sample(src, c, p->depth);
+                g = png_sample(src, c + 1u, p->depth);
+                b = png_sample(src, c + 2u, p->depth);
+                if (p->color == 6) {
+                    a = png_to8(png_sample(src, c + 3u, p->depth), p->depth);
+                } else if (p->has_trns && r == p->trns_key[0] && g == p->trns_key[1] && b == p->trns_key[2]) {
+                    a = 0;
+                }
+                dst[0] = png_to8(r, p->depth);
+                dst[1] = png_to8(g, p->depth);
+                dst[2] = png_to8(b, p->depth);
+                break;
+        }
+        if (alpha) dst[3] = a;
+    }
+}
+
+static int png_read_full(inflate_t* z, uint8_t* out, uint32_t size) {
+    return inflate_read(z, out, size) == (int32_t)size ? 0 : -1;
+}
+
+static int png_decode_rows(const png_info_t* p, png_idat_src_t* src, image_t* img) {
+    uint32_t rowbytes = (p->width * p->channels * p->depth + 7u) / 8u;
+    uint32_t filter_bpp = (p->channels * p->depth + 7u) / 8u;
+    uint8_t* rows = (uint8_t*)valloc(rowbytes * 2u);
+    inflate_t* z = (inflate_t*)valloc(sizeof(inflate_t));
+    int rc = -1;
+
+    if (rows && z && inflate_init(z, png_next_idat, src, true) == 0) {
+        memset(rows, 0, rowbytes);
+        rc = 0;
+        for (uint32_t y = 0; y < p->height && rc == 0; y++) {
+            uint8_t* prev = rows + (y & 1u) * rowbytes;
+            uint8_t* cur = rows + ((y + 1u) & 1u) * rowbytes;
+            uint8_t filter = 0;
+            if (png_read_full(z, &filter, 1) != 0 || png_read_full(z, cur, rowbytes) != 0 ||
+                png_unfilter(filter, cur, prev, rowbytes, filter_bpp) != 0) {
+                rc = -1;
+                break;
+            }
+            png_convert_row(p, cur, img->data + y * img->pitch, img->has_alpha);
+        }
+        inflate_free(z);
+    }
+    if (z) vfree(z);
+    if (rows) vfree(rows);
+    return rc;
+}
+
 image_t* png_load(const uint8_t* data, size_t size) {
-    
-    return NULL;
-}
\ No newline at end of file
+    static const uint8_t channel_count[7] = {1, 0, 3, 1, 2, 0, 4};
+    png_info_t* p;
+    png_idat_src_t src;
+    image_t* img;
+    size_t idat_pos = 0;
+
+    if (!data || !png_verify(data, size)) return NULL;
+    p = (png_info_t*)valloc(sizeof(png_info_t));
+    if (!p) return NULL;
+    memset(p, 0, sizeof(*p));
+    if (png_parse_chunks(data, size, p, &idat_pos) != 0 || !png_valid_format(p) ||
+        p->width == 0 || p->height == 0 || p->width > PNG_MAX_DIM || p->height > PNG_MAX_DIM ||
+        (p->color == 3 && p->palette_len == 0)) {
+        vfree(p);
+        return NULL;
+    }
+    p->channels = channel_count[p->color];
+
+    img = (image_t*)valloc(sizeof(image_t));
+    if (!img) {
+        vfree(p);
+        return NULL;
+    }
+    memset(img, 0, sizeof(image_t));
+    img->width = p->width;
+    img->height = p->height;
+    img->has_alpha = p->color == 4 || p->color == 6 || p->has_trns;
+    img->bpp = img->has_alpha ? 32 : 24;
+    img->type = IMAGE_TYPE_PNG;
+    img->pitch = image_calculate_pitch(img->width, img->bpp);
+    img->data_size = img->pitch * img->height;
+    img->data = (uint8_t*)valloc(img->data_size);
+
+    src.data = data;
+    src.size = size;
+    src.pos = idat_pos;
+    if (!img->data || png_decode_rows(p, &src, img) != 0) {
+        image_free(img);
+        img = NULL;
+    }
+    vfree(p);
+    return img;
+}
@@ -2,18 +2,13 @@
 #include <drivers/keyboard.h>
 #include <drivers/mouse.h>
 #include <drivers/power.h>
-#include <asm/processor.h>
 #include <devctl.h>
 
 static ssize_t keyboard_dev_read(void *ctx, void *buf, size_t size) {
     struct key_event ev;
     (void)ctx;
     if (!buf || size < sizeof(struct key_event)) return -1;
-    while (!keyboard_try_get_event(&ev)) {
-        sti();
-        hlt();
-        cli();
-    }
+    ev = keyboard_get_event();
     *(struct key_event*)buf = ev;
     return (ssize_t)sizeof(struct key_event);
 }
@@ -57,11 +52,7 @@ static ssize_t mouse_dev_read(void *ctx, void *buf, size_t size) {
     mouse_packet_t p;
     (void)ctx;
     if (!buf || size < sizeof(mouse_packet_t)) return -1;
-    while (!mouse_try_get_packet(&p)) {
-        sti();
-        hlt();
-        cli();
-    }
+    p = mouse_get_packet();
     *(mouse_packet_t*)buf = p;
     return (ssize_t)sizeof(mouse_packet_t);
 }
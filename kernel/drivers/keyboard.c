@@ -5,6 +5,7 @@
 #endif
 #include <asm/port.h>
 #include <asm/processor.h>
+#include <asm/task.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
@@ -55,11 +56,14 @@ static size_t scancode_head = 0;
 static size_t scancode_tail = 0;
 static size_t scancode_count = 0;
 
+static wait_queue_t input_wq;
+
 static void buffer_put(char c) {
     if (buffer_count < KEYBOARD_BUFFER_SIZE) {
         keyboard_buffer[buffer_tail] = c;
         buffer_tail = (buffer_tail + 1) % KEYBOARD_BUFFER_SIZE;
         buffer_count++;
+        wait_queue_wake_all(&input_wq);
     }
 }
 
@@ -96,6 +100,7 @@ static void event_buffer_put(struct key_event event) {
         event_buffer[event_tail] = event;
         event_tail = (event_tail + 1) % EVENT_BUFFER_SIZE;
         event_count++;
+        wait_queue_wake_all(&input_wq);
     }
 }
 
@@ -344,6 +349,13 @@ static void keyboard_process_scancode(uint8_t scancode) {
     uint8_t keycode = scancode & 0x7F;
     
     handle_ctrl_alt_combo(keycode, pressed);
+
+    if (pressed && shift_pressed && !ctrl_pressed && !alt_pressed &&
+        (keycode == KEY_PGUP || keycode == KEY_PGDOWN) && hotkey_handler) {
+        hotkey_handler(keycode, true, shift_pressed, ctrl_pressed, alt_pressed);
+        ext_scancode = false;
+        return;
+    }
     
     if (ext_scancode) {
         handle_extended_scancode(keycode, pressed);
@@ -453,14 +465,26 @@ void keyboard_handler(void) {
     keyboard_process_scancode(scancode);
 }
 
-char keyboard_getchar(void) {
+static void keyboard_wait_for(const size_t *a, const size_t *b) {
     uint32_t flags;
     __asm__ __volatile__("pushf; pop %0" : "=r"(flags) :: "memory");
-    while (buffer_count == 0) {
-        sti();
-        hlt();
+    cli();
+    while (*a == 0 && *b == 0) {
+        if (task_wait(&input_wq, 0) != 0) {
+            sti();
+            hlt();
+            cli();
+        }
     }
-    if ((flags & (1u << 9)) == 0u) cli();
+    if (flags & (1u << 9)) sti();
+}
+
+void keyboard_wait(void) {
+    keyboard_wait_for(&buffer_count, &event_count);
+}
+
+char keyboard_getchar(void) {
+    keyboard_wait_for(&buffer_count, &buffer_count);
     return buffer_get();
 }
 
@@ -469,13 +493,7 @@ bool keyboard_available(void) {
 }
 
 struct key_event keyboard_get_event(void) {
-    uint32_t flags;
-    __asm__ __volatile__("pushf; pop %0" : "=r"(flags) :: "memory");
-    while (event_count == 0) {
-        sti();
-        hlt();
-    }
-    if ((flags & (1u << 9)) == 0u) cli();
+    keyboard_wait_for(&event_count, &event_count);
     return event_buffer_get();
 }
 
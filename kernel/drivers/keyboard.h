@@ -123,6 +123,7 @@ static const uint8_t ext_scancodes[] = {
 void keyboard_init(void);
 void keyboard_handler(void);
 char keyboard_getchar(void);
+void keyboard_wait(void);
 bool keyboard_available(void);
 uint8_t keyboard_get_scancode(void);
 bool keyboard_scancode_available(void);
@@ -1,6 +1,8 @@
 #include <drivers/mouse.h>
 #include <drivers/vesa.h>
 #include <asm/port.h>
+#include <asm/processor.h>
+#include <asm/task.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -23,6 +25,7 @@ static volatile uint8_t g_cycle = 0;
 static volatile int16_t g_x = 0;
 static volatile int16_t g_y = 0;
 static volatile uint8_t g_buttons = 0;
+static wait_queue_t g_wq;
 
 static inline void io_wait_small(void) {
     outb(0x80, 0);
@@ -76,6 +79,7 @@ static void queue_push(mouse_packet_t p) {
     g_queue[g_tail] = p;
     g_tail = (g_tail + 1) % MOUSE_QUEUE_SIZE;
     g_count++;
+    wait_queue_wake_all(&g_wq);
 }
 
 void mouse_inject_packet(uint8_t buttons, int16_t x_movement, int16_t y_movement) {
@@ -100,6 +104,7 @@ void mouse_inject_packet(uint8_t buttons, int16_t x_movement, int16_t y_movement
 
     p.x = g_x;
     p.y = g_y;
+    vesa_cursor_move(g_x, g_y);
     queue_push(p);
 }
 
@@ -119,9 +124,17 @@ bool mouse_try_get_packet(mouse_packet_t* out) {
 
 mouse_packet_t mouse_get_packet(void) {
     mouse_packet_t p;
+    uint32_t flags;
+    __asm__ __volatile__("pushf; pop %0" : "=r"(flags) :: "memory");
+    cli();
     while (!mouse_try_get_packet(&p)) {
-        __asm__ __volatile__("hlt");
+        if (task_wait(&g_wq, 0) != 0) {
+            sti();
+            hlt();
+            cli();
+        }
     }
+    if (flags & (1u << 9)) sti();
     return p;
 }
 
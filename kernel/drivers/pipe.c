@@ -0,0 +1,140 @@
+#include <drivers/pipe.h>
+#include <asm/mm.h>
+#include <kerrno.h>
+#include <string.h>
+
+static void ring_copy_in(pipe_t *p, const uint8_t *src, uint32_t n) {
+    uint32_t tail = (p->head + p->count) % p->capacity;
+    uint32_t first = p->capacity - tail;
+    if (first > n) first = n;
+    memcpy(p->data + tail, src, first);
+    if (n > first) memcpy(p->data, src + first, n - first);
+    p->count += n;
+}
+
+static void ring_copy_out(pipe_t *p, uint8_t *dst, uint32_t n) {
+    uint32_t first = p->capacity - p->head;
+    if (first > n) first = n;
+    memcpy(dst, p->data + p->head, first);
+    if (n > first) memcpy(dst + first, p->data, n - first);
+    p->head = (p->head + n) % p->capacity;
+    p->count -= n;
+    if (p->count == 0) p->head = 0;
+}
+
+static int pipe_grow(pipe_t *p, uint32_t need) {
+    uint32_t cap = p->capacity;
+    uint32_t count = p->count;
+    uint8_t *data;
+    if (cap >= PIPE_MAX_CAPACITY) return -1;
+    while (cap < need && cap < PIPE_MAX_CAPACITY) cap <<= 1;
+    data = (uint8_t*)kmalloc(cap);
+    if (!data) return -1;
+    ring_copy_out(p, data, count);
+    kfree(p->data);
+    p->data = data;
+    p->capacity = cap;
+    p->head = 0;
+    p->count = count;
+    return 0;
+}
+
+static void pipe_wake(pipe_t *p) {
+    wait_queue_wake_all(&p->read_wq);
+    wait_queue_wake_all(&p->write_wq);
+    task_poll_notify();
+}
+
+pipe_t *pipe_create(uint32_t flags) {
+    pipe_t *p = (pipe_t*)kcalloc(1, sizeof(pipe_t));
+    if (!p) return NULL;
+    p->data = (uint8_t*)kmalloc(PIPE_MIN_CAPACITY);
+    if (!p->data) {
+        kfree(p);
+        return NULL;
+    }
+    p->capacity = PIPE_MIN_CAPACITY;
+    p->flags = flags;
+    wait_queue_init(&p->read_wq);
+    wait_queue_init(&p->write_wq);
+    return p;
+}
+
+void pipe_destroy(pipe_t *p) {
+    if (!p) return;
+    pipe_wake(p);
+    kfree(p->data);
+    kfree(p);
+}
+
+void pipe_open_end(pipe_t *p, int write_end) {
+    if (!p) return;
+    if (write_end) p->writers++;
+    else p->readers++;
+}
+
+void pipe_close_end(pipe_t *p, int write_end) {
+    if (!p) return;
+    if (write_end && p->writers > 0) p->writers--;
+    else if (!write_end && p->readers > 0) p->readers--;
+    if (!(p->flags & PIPE_NAMED) && p->readers == 0 && p->writers == 0) {
+        pipe_destroy(p);
+        return;
+    }
+    pipe_wake(p);
+}
+
+ssize_t pipe_read(pipe_t *p, void *buf, size_t size, int nonblock) {
+    uint32_t n;
+    if (!p || !buf) return -1;
+    if (size == 0) return 0;
+    while (p->count == 0) {
+        if (!(p->flags & PIPE_NAMED) && p->writers == 0) return 0;
+        if (nonblock || (p->flags & PIPE_NAMED)) return -K_EAGAIN;
+        if (task_wait(&p->read_wq, 0) != 0) return -K_EAGAIN;
+    }
+    n = (size < p->count) ? (uint32_t)size : p->count;
+    ring_copy_out(p, (uint8_t*)buf, n);
+    wait_queue_wake_all(&p->write_wq);
+    task_poll_notify();
+    return (ssize_t)n;
+}
+
+ssize_t pipe_write(pipe_t *p, const void *buf, size_t size, int nonblock) {
+    const uint8_t *src = (const uint8_t*)buf;
+    uint32_t done = 0;
+    if (!p || !buf) return -1;
+    while (done < size) {
+        uint32_t left = (uint32_t)size - done;
+        uint32_t room;
+        if (!(p->flags & PIPE_NAMED) && p->readers == 0) break;
+        room = p->capacity - p->count;
+        if (room < left) {
+            (void)pipe_grow(p, p->count + left);
+            room = p->capacity - p->count;
+        }
+        if (room > 0) {
+            uint32_t n = (left < room) ? left : room;
+            ring_copy_in(p, src + done, n);
+            done += n;
+            wait_queue_wake_all(&p->read_wq);
+            task_poll_notify();
+            continue;
+        }
+        if (nonblock) break;
+        if (task_wait(&p->write_wq, 0) != 0) break;
+    }
+    if (done > 0 || size == 0) return (ssize_t)done;
+    if (!(p->flags & PIPE_NAMED) && p->readers == 0) return -K_EPIPE;
+    return -K_EAGAIN;
+}
+
+uint32_t pipe_available(const pipe_t *p) {
+    return p ? p->count : 0;
+}
+
+uint32_t pipe_space(const pipe_t *p) {
+    if (!p) return 0;
+    if (p->capacity < PIPE_MAX_CAPACITY) return PIPE_MAX_CAPACITY - p->count;
+    return p->capacity - p->count;
+}
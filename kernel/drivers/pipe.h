@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <asm/task.h>
+
+#define PIPE_MIN_CAPACITY 4096u
+#define PIPE_MAX_CAPACITY 65536u
+
+enum {
+    PIPE_NAMED = 1 << 0,
+};
+
+typedef struct pipe {
+    uint8_t *data;
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+    uint32_t flags;
+    uint32_t readers;
+    uint32_t writers;
+    wait_queue_t read_wq;
+    wait_queue_t write_wq;
+} pipe_t;
+
+pipe_t *pipe_create(uint32_t flags);
+void pipe_destroy(pipe_t *p);
+void pipe_open_end(pipe_t *p, int write_end);
+void pipe_close_end(pipe_t *p, int write_end);
+ssize_t pipe_read(pipe_t *p, void *buf, size_t size, int nonblock);
+ssize_t pipe_write(pipe_t *p, const void *buf, size_t size, int nonblock);
+uint32_t pipe_available(const pipe_t *p);
+uint32_t pipe_space(const pipe_t *p);
@@ -1,6 +1,7 @@
 #include <drivers/power.h>
 #include <asm/port.h>
 #include <asm/processor.h>
+#include <drivers/disk.h>
 
 static uint32_t g_cad_mode = POWER_CAD_REBOOT;
 
@@ -13,12 +14,14 @@ uint32_t power_get_ctrl_alt_del_mode(void) {
 }
 
 void power_reboot(void) {
+    (void)disk_flush();
     cli();
     outb(0x64, 0xFE);
     while (1) hlt();
 }
 
 void power_poweroff(void) {
+    (void)disk_flush();
     cli();
 
     
@@ -1,5 +1,6 @@
 #include <drivers/pty.h>
 #include <asm/processor.h>
+#include <asm/task.h>
 #include <devctl.h>
 #include <string.h>
 
@@ -11,6 +12,7 @@ typedef struct {
     uint32_t head;
     uint32_t tail;
     uint32_t count;
+    wait_queue_t readers;
 } pty_ring_t;
 
 typedef struct {
@@ -40,6 +42,8 @@ static void pair_reset(pty_pair_t *p) {
     if (!p) return;
     ring_reset(&p->master_to_slave);
     ring_reset(&p->slave_to_master);
+    wait_queue_wake_all(&p->master_to_slave.readers);
+    wait_queue_wake_all(&p->slave_to_master.readers);
 }
 
 static uint32_t ring_push(pty_ring_t *r, const uint8_t *buf, uint32_t size) {
@@ -80,9 +84,11 @@ static ssize_t pty_read(void *ctx, void *buf, size_t size) {
         got = ring_pop(src, (uint8_t*)buf, (uint32_t)size);
         if (got > 0u) return (ssize_t)got;
         if (!d->pair->allocated) return 0;
-        sti();
-        hlt();
-        cli();
+        if (task_wait(&src->readers, 0) != 0) {
+            sti();
+            hlt();
+            cli();
+        }
     }
 }
 
@@ -93,7 +99,10 @@ static ssize_t pty_write(void *ctx, const void *buf, size_t size) {
     if (!d->pair->allocated) return -1;
     if (size == 0u) return 0;
     dst = d->is_master ? &d->pair->master_to_slave : &d->pair->slave_to_master;
-    return (ssize_t)ring_push(dst, (const uint8_t*)buf, (uint32_t)size);
+    size = ring_push(dst, (const uint8_t*)buf, (uint32_t)size);
+    wait_queue_wake_all(&dst->readers);
+    task_poll_notify();
+    return (ssize_t)size;
 }
 
 static void build_pair_paths(uint32_t idx, char *master, uint32_t mcap, char *slave, uint32_t scap) {
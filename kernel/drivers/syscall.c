@@ -8,8 +8,11 @@
 #include <drivers/filesystem/vfs.h>
 #include <drivers/filesystem/fat32.h>
 #include <drivers/elf_loader.h>
+#include <drivers/disk.h>
 #include <drivers/tty.h>
+#include <drivers/pipe.h>
 #include <drivers/serial.h>
+#include <devctl.h>
 #include <kerrno.h>
 #include <string.h>
 
@@ -59,6 +62,12 @@ enum {
     SYS_FORK = 42,
     SYS_POLL = 43,
     SYS_SELECT = 44,
+    SYS_SET_NICE = 45,
+    SYS_GET_NICE = 46,
+    SYS_FSYNC = 47,
+    SYS_BRK = 48,
+    SYS_MADVISE = 49,
+    SYS_COPY_FILE_RANGE = 50,
 };
 
 vfs_t *g_root_fs_for_syscalls = NULL;
@@ -69,18 +78,21 @@ volatile uint32_t g_in_syscall = 0;
 enum {
     FD_KIND_VFS = 0,
     FD_KIND_UDP = 1,
+    FD_KIND_PIPE = 2,
 };
 
 typedef struct {
     uint8_t used;
     uint8_t kind;
-    uint8_t pipe_auto_unlink;
+    uint8_t pipe_end;
     uint8_t reserved0;
     int16_t sock_id;
     uint16_t reserved1;
     uint32_t fd_flags;
     uint32_t open_flags;
     uint32_t offset;
+    vfs_handle_t handle;
+    pipe_t *pipe;
     char path[256];
 } fd_entry_t;
 
@@ -104,8 +116,6 @@ typedef struct {
     uint32_t user_esp;
     uint32_t user_eflags;
     uint32_t user_cr3;
-    uint32_t user_slot;
-    uint32_t user_phys;
     uint32_t ebx;
     uint32_t ecx;
     uint32_t edx;
@@ -178,7 +188,7 @@ typedef struct {
 #define INADDR_LOOPBACK 0x7F000001u
 #define UDP_MAX_SOCKETS 8u
 #define UDP_QUEUE_MAX 8u
-#define UDP_PAYLOAD_MAX 512u
+#define UDP_PAYLOAD_MAX 4096u
 #define UDP_EPHEMERAL_START 49152u
 #define UDP_EPHEMERAL_END 65535u
 
@@ -187,7 +197,7 @@ typedef struct {
     uint32_t src_addr;
     uint16_t src_port;
     uint16_t len;
-    uint8_t payload[UDP_PAYLOAD_MAX];
+    uint8_t *payload;
 } udp_datagram_t;
 
 typedef struct {
@@ -200,13 +210,11 @@ typedef struct {
     uint8_t q_head;
     uint8_t q_tail;
     uint8_t q_len;
+    wait_queue_t rx_wq;
 } udp_socket_t;
 
 static udp_socket_t g_udp_sockets[UDP_MAX_SOCKETS];
 static uint16_t g_udp_next_ephemeral = UDP_EPHEMERAL_START;
-static uint32_t g_pipe_seq = 1;
-
-static int fd_has_path_ref(const char *path, int exclude_fd);
 
 #define USER_ARG_MAX 32
 #define USER_ARG_TOKEN 128
@@ -218,6 +226,11 @@ static int fd_has_path_ref(const char *path, int exclude_fd);
 #define SEEK_CUR 1
 #define SEEK_END 2
 
+#define MADV_DONTNEED 4u
+#define COPY_RANGE_CHUNK 16384u
+#define USER_STACK_RESERVE 0x40000u
+#define USER_HEAP_TOP (USER_VADDR_BASE + USER_VADDR_SIZE - USER_STACK_RESERVE)
+
 #define F_DUPFD 0
 #define F_GETFD 1
 #define F_SETFD 2
@@ -300,6 +313,16 @@ static int udp_autobind(int sid) {
     return -1;
 }
 
+static uint32_t ms_to_ticks(uint32_t ms) {
+    uint32_t t = (ms + 9u) / 10u;
+    return t ? t : 1u;
+}
+
+static void poll_wait_until(int32_t timeout_ms, uint32_t deadline) {
+    if (timeout_ms > 0) task_poll_wait(deadline - timer_get_ticks());
+    else task_poll_wait(0);
+}
+
 static int udp_socket_alloc(void) {
     for (uint32_t i = 0; i < UDP_MAX_SOCKETS; i++) {
         if (!g_udp_sockets[i].used) {
@@ -313,6 +336,10 @@ static int udp_socket_alloc(void) {
 
 static void udp_socket_free(int sid) {
     if (sid < 0 || sid >= (int)UDP_MAX_SOCKETS) return;
+    wait_queue_wake_all(&g_udp_sockets[sid].rx_wq);
+    for (uint32_t i = 0; i < UDP_QUEUE_MAX; i++) {
+        if (g_udp_sockets[sid].q[i].payload) kfree(g_udp_sockets[sid].q[i].payload);
+    }
     memset(&g_udp_sockets[sid], 0, sizeof(g_udp_sockets[sid]));
 }
 
@@ -360,15 +387,21 @@ static int udp_sendto_socket(int sid, const syscall_udp_send_req_t *req) {
     if (dst->q_len >= UDP_QUEUE_MAX) return -K_EAGAIN;
 
     pkt = &dst->q[dst->q_tail];
-    memset(pkt, 0, sizeof(*pkt));
+    pkt->payload = NULL;
+    if (req->len) {
+        pkt->payload = (uint8_t*)kmalloc(req->len);
+        if (!pkt->payload) return -K_ENOMEM;
+        memcpy(pkt->payload, req->buf, req->len);
+    }
     pkt->used = 1;
     pkt->src_addr = (src->bind_addr == INADDR_ANY) ? INADDR_LOOPBACK : src->bind_addr;
     pkt->src_port = src->bind_port;
     pkt->len = (uint16_t)req->len;
-    if (pkt->len) memcpy(pkt->payload, req->buf, pkt->len);
 
     dst->q_tail = (uint8_t)((dst->q_tail + 1u) % UDP_QUEUE_MAX);
     dst->q_len++;
+    wait_queue_wake_all(&dst->rx_wq);
+    task_poll_notify();
     return (int)req->len;
 }
 
@@ -376,15 +409,21 @@ static int udp_recvfrom_socket(int sid, syscall_udp_recv_req_t *req) {
     udp_socket_t *s;
     udp_datagram_t *pkt;
     uint32_t to_copy;
-    uint32_t waited = 0;
+    uint32_t deadline;
 
     if (sid < 0 || sid >= (int)UDP_MAX_SOCKETS || !req || !req->buf) return -K_EINVAL;
     s = &g_udp_sockets[sid];
+    deadline = timer_get_ticks() + ms_to_ticks(s->rcv_timeout_ms);
     while (s->q_len == 0) {
         if (req->flags & MSG_DONTWAIT) return -K_EAGAIN;
-        if (s->rcv_timeout_ms > 0 && waited >= s->rcv_timeout_ms) return -K_ETIMEDOUT;
-        sleep(10);
-        waited += 10;
+        if (!s->used) return -K_EBADF;
+        if (s->rcv_timeout_ms > 0) {
+            int32_t left = (int32_t)(deadline - timer_get_ticks());
+            if (left <= 0) return -K_ETIMEDOUT;
+            if (task_wait(&s->rx_wq, (uint32_t)left) != 0) return -K_EAGAIN;
+        } else if (task_wait(&s->rx_wq, 0) != 0) {
+            return -K_EAGAIN;
+        }
     }
 
     pkt = &s->q[s->q_head];
@@ -401,6 +440,7 @@ static int udp_recvfrom_socket(int sid, syscall_udp_recv_req_t *req) {
         *req->addrlen = sizeof(syscall_sockaddr_in_t);
     }
 
+    if (pkt->payload) kfree(pkt->payload);
     memset(pkt, 0, sizeof(*pkt));
     s->q_head = (uint8_t)((s->q_head + 1u) % UDP_QUEUE_MAX);
     s->q_len--;
@@ -493,7 +533,7 @@ static int build_user_stack_from_cmdline(const char *cmdline, uint32_t *user_esp
 
 static fd_entry_t g_fds[FD_MAX];
 static uint8_t g_fd_init_done = 0;
-static fd_entry_t g_task_fds[MAX_TASKS][FD_MAX];
+static fd_entry_t *g_task_fds[MAX_TASKS];
 static uint8_t g_task_fd_init[MAX_TASKS];
 static fat32_fs_t g_mount_fat_ctx[VFS_MAX_MOUNTS];
 static uint8_t g_mount_fat_used[VFS_MAX_MOUNTS];
@@ -542,29 +582,26 @@ int syscall_task_fd_path(uint32_t pid, uint32_t fd, char *out, uint32_t cap) {
         out[cap - 1] = '\0';
         return 0;
     }
+    if (fds[fd].kind == FD_KIND_PIPE) {
+        strncpy(out, fds[fd].pipe_end ? "pipe:w" : "pipe:r", cap - 1);
+        out[cap - 1] = '\0';
+        return 0;
+    }
     return -1;
 }
 
 static int ensure_current_task_user_space(void) {
-    uint32_t slot_idx = 0;
-    uint32_t slot_phys = 0;
     uint32_t user_cr3 = 0;
 
     if (!current_task) return -1;
-    if (current_task->user_slot != (uint32_t)-1 && current_task->cr3) {
+    if (current_task->cr3 && current_task->cr3 != mm_kernel_cr3()) {
         mm_switch_cr3(current_task->cr3);
         return 0;
     }
 
-    if (mm_user_slot_alloc(&slot_idx, &slot_phys) != 0) return -1;
-    user_cr3 = mm_user_cr3_create(slot_phys);
-    if (!user_cr3) {
-        mm_user_slot_free(slot_idx);
-        return -1;
-    }
+    user_cr3 = mm_user_space_create();
+    if (!user_cr3) return -1;
 
-    current_task->user_slot = slot_idx;
-    current_task->user_phys_base = slot_phys;
     current_task->cr3 = user_cr3;
     mm_switch_cr3(current_task->cr3);
     return 0;
@@ -655,6 +692,24 @@ static int build_interp_cmdline(const char *interp_path, const char *target_path
     return 0;
 }
 
+static void task_heap_reset(uint32_t image_end, uint32_t limit) {
+    uint32_t base = (image_end + PAGE_SIZE - 1u) & ~(PAGE_SIZE - 1u);
+    if (!current_task) return;
+    if (limit > USER_HEAP_TOP) limit = USER_HEAP_TOP;
+    if (base < USER_VADDR_BASE || base > limit) base = limit;
+    /* Drop whatever the previous image left between its heap and the stack. */
+    (void)mm_user_release(current_task->cr3, base, limit - base);
+    current_task->brk_start = base;
+    current_task->brk = base;
+    current_task->brk_limit = limit;
+}
+
+void syscall_task_heap_init(void) {
+    uint32_t image_end = 0;
+    elf_get_last_image(NULL, &image_end);
+    task_heap_reset(image_end, USER_HEAP_TOP);
+}
+
 static int resolve_exec_entry(
     const char *prog_path,
     const char *orig_cmdline,
@@ -664,13 +719,19 @@ static int resolve_exec_entry(
 ) {
     char interp[256];
     uint32_t entry = 0;
+    uint32_t image_end = 0;
+    uint32_t heap_limit = USER_HEAP_TOP;
     if (!prog_path || !entry_out || !stack_cmdline || stack_cmdline_cap < 2u) return -1;
     stack_cmdline[0] = '\0';
 
     if (elf_load_from_vfs_ex(g_root_fs_for_syscalls, prog_path, &entry, interp, sizeof(interp)) != 0) return -1;
+    elf_get_last_image(NULL, &image_end);
     if (interp[0] != '\0') {
         uint32_t interp_entry = 0;
         if (elf_load_from_vfs(g_root_fs_for_syscalls, interp, &interp_entry) != 0) return -1;
+        elf_get_last_image(&heap_limit, NULL);
+        if (heap_limit <= image_end) heap_limit = USER_HEAP_TOP;
+        task_heap_reset(image_end, heap_limit);
         if (build_interp_cmdline(interp, prog_path, orig_cmdline, stack_cmdline, stack_cmdline_cap) != 0) return -1;
         *entry_out = interp_entry;
         return 0;
@@ -682,6 +743,7 @@ static int resolve_exec_entry(
     } else {
         stack_cmdline[0] = '\0';
     }
+    task_heap_reset(image_end, USER_HEAP_TOP);
     *entry_out = entry;
     return 0;
 }
@@ -698,42 +760,66 @@ static int normalize_mount_path_local(const char *in, char *out, uint32_t cap) {
     return 0;
 }
 
+static void fd_set_vfs(fd_entry_t *e, const char *path, uint32_t open_flags) {
+    e->used = 1;
+    e->kind = FD_KIND_VFS;
+    e->pipe_end = 0;
+    e->pipe = NULL;
+    e->sock_id = -1;
+    e->open_flags = open_flags;
+    e->fd_flags = 0;
+    e->offset = 0;
+    strncpy(e->path, path, sizeof(e->path) - 1);
+    e->path[sizeof(e->path) - 1] = '\0';
+    if (!g_root_fs_for_syscalls || vfs_handle_open(g_root_fs_for_syscalls, path, &e->handle) != 0) {
+        memset(&e->handle, 0, sizeof(e->handle));
+    }
+}
+
+static void fd_release(fd_entry_t *fds, int fd) {
+    fd_entry_t *e = &fds[fd];
+    if (!e->used) return;
+    if (e->kind == FD_KIND_UDP && e->sock_id >= 0) {
+        udp_socket_free((int)e->sock_id);
+    }
+    if (e->kind == FD_KIND_PIPE) {
+        pipe_close_end(e->pipe, e->pipe_end);
+    }
+    vfs_handle_release(&e->handle);
+    e->used = 0;
+    e->kind = FD_KIND_VFS;
+    e->pipe_end = 0;
+    e->pipe = NULL;
+    e->sock_id = -1;
+    e->fd_flags = 0;
+    e->open_flags = 0;
+    e->offset = 0;
+    e->path[0] = '\0';
+}
+
+static fd_entry_t *fd_task_table(int slot) {
+    if (!g_task_fds[slot]) g_task_fds[slot] = (fd_entry_t*)kcalloc(FD_MAX, sizeof(fd_entry_t));
+    return g_task_fds[slot];
+}
+
 static void fd_table_init(fd_entry_t *fds, uint8_t *done, const char *tty_path) {
     if (*done) return;
     memset(fds, 0, sizeof(fd_entry_t) * FD_MAX);
-    strncpy(fds[0].path, tty_path, sizeof(fds[0].path) - 1);
-    strncpy(fds[1].path, tty_path, sizeof(fds[1].path) - 1);
-    strncpy(fds[2].path, tty_path, sizeof(fds[2].path) - 1);
-    fds[0].path[sizeof(fds[0].path) - 1] = '\0';
-    fds[1].path[sizeof(fds[1].path) - 1] = '\0';
-    fds[2].path[sizeof(fds[2].path) - 1] = '\0';
-    fds[0].used = 1;
-    fds[1].used = 1;
-    fds[2].used = 1;
-    fds[0].kind = FD_KIND_VFS;
-    fds[1].kind = FD_KIND_VFS;
-    fds[2].kind = FD_KIND_VFS;
-    fds[0].pipe_auto_unlink = 0;
-    fds[1].pipe_auto_unlink = 0;
-    fds[2].pipe_auto_unlink = 0;
-    fds[0].sock_id = -1;
-    fds[1].sock_id = -1;
-    fds[2].sock_id = -1;
-    fds[0].open_flags = 0;
-    fds[1].open_flags = 0;
-    fds[2].open_flags = 0;
-    fds[0].fd_flags = 0;
-    fds[1].fd_flags = 0;
-    fds[2].fd_flags = 0;
-    fds[0].offset = 0;
-    fds[1].offset = 0;
-    fds[2].offset = 0;
+    fd_set_vfs(&fds[0], tty_path, 0);
+    fd_set_vfs(&fds[1], tty_path, 0);
+    fd_set_vfs(&fds[2], tty_path, 0);
     *done = 1;
 }
 
+static void fd_table_release(int slot) {
+    if (slot < 0 || slot >= MAX_TASKS || !g_task_fd_init[slot]) return;
+    for (int i = 0; i < FD_MAX; i++) fd_release(g_task_fds[slot], i);
+    g_task_fd_init[slot] = 0;
+}
+
 static fd_entry_t *fd_current(void) {
     int slot = current_task_slot();
-    if (slot < 0) {
+    if (slot < 0 || !fd_task_table(slot)) {
         fd_table_init(g_fds, &g_fd_init_done, "/dev/tty/1");
         return g_fds;
     }
@@ -745,52 +831,28 @@ void syscall_bind_stdio(const char *path) {
     fd_entry_t *fds;
     if (!path || path[0] == '\0') return;
     fds = fd_current();
-    strncpy(fds[0].path, path, sizeof(fds[0].path) - 1);
-    strncpy(fds[1].path, path, sizeof(fds[1].path) - 1);
-    strncpy(fds[2].path, path, sizeof(fds[2].path) - 1);
-    fds[0].path[sizeof(fds[0].path) - 1] = '\0';
-    fds[1].path[sizeof(fds[1].path) - 1] = '\0';
-    fds[2].path[sizeof(fds[2].path) - 1] = '\0';
-    fds[0].used = 1;
-    fds[1].used = 1;
-    fds[2].used = 1;
-    fds[0].kind = FD_KIND_VFS;
-    fds[1].kind = FD_KIND_VFS;
-    fds[2].kind = FD_KIND_VFS;
-    fds[0].pipe_auto_unlink = 0;
-    fds[1].pipe_auto_unlink = 0;
-    fds[2].pipe_auto_unlink = 0;
-    fds[0].sock_id = -1;
-    fds[1].sock_id = -1;
-    fds[2].sock_id = -1;
-    fds[0].open_flags = 0;
-    fds[1].open_flags = 0;
-    fds[2].open_flags = 0;
-    fds[0].fd_flags = 0;
-    fds[1].fd_flags = 0;
-    fds[2].fd_flags = 0;
-    fds[0].offset = 0;
-    fds[1].offset = 0;
-    fds[2].offset = 0;
+    for (int i = 0; i < 3; i++) {
+        fd_release(fds, i);
+        fd_set_vfs(&fds[i], path, 0);
+    }
 }
 
 void syscall_set_devfs_ctx(void *ctx) {
     g_devfs_ctx = ctx;
 }
 
+void syscall_task_exit(task_t *task) {
+    int slot;
+    if (!task) return;
+    slot = (int)(task - tasks);
+    fd_table_release(slot);
+}
+
 static int fd_alloc(const char *path, uint32_t open_flags) {
     fd_entry_t *fds = fd_current();
     for (int i = 3; i < FD_MAX; i++) {
         if (!fds[i].used) {
-            fds[i].used = 1;
-            fds[i].kind = FD_KIND_VFS;
-            fds[i].pipe_auto_unlink = 0;
-            fds[i].sock_id = -1;
-            fds[i].open_flags = open_flags;
-            fds[i].fd_flags = 0;
-            fds[i].offset = 0;
-            strncpy(fds[i].path, path, sizeof(fds[i].path) - 1);
-            fds[i].path[sizeof(fds[i].path) - 1] = '\0';
+            fd_set_vfs(&fds[i], path, open_flags);
             return i;
         }
     }
@@ -803,11 +865,13 @@ static int fd_alloc_udp(int sid) {
         if (!fds[i].used) {
             fds[i].used = 1;
             fds[i].kind = FD_KIND_UDP;
-            fds[i].pipe_auto_unlink = 0;
+            fds[i].pipe_end = 0;
+            fds[i].pipe = NULL;
             fds[i].sock_id = (int16_t)sid;
             fds[i].open_flags = 0;
             fds[i].fd_flags = 0;
             fds[i].offset = 0;
+            memset(&fds[i].handle, 0, sizeof(fds[i].handle));
             fds[i].path[0] = '\0';
             return i;
         }
@@ -815,6 +879,32 @@ static int fd_alloc_udp(int sid) {
     return -1;
 }
 
+static int fd_alloc_pipe(pipe_t *p, int write_end) {
+    fd_entry_t *fds = fd_current();
+    for (int i = 3; i < FD_MAX; i++) {
+        if (!fds[i].used) {
+            fds[i].used = 1;
+            fds[i].kind = FD_KIND_PIPE;
+            fds[i].pipe_end = write_end ? 1u : 0u;
+            fds[i].pipe = p;
+            fds[i].sock_id = -1;
+            fds[i].open_flags = write_end ? 1u : 0u;
+            fds[i].fd_flags = 0;
+            fds[i].offset = 0;
+            memset(&fds[i].handle, 0, sizeof(fds[i].handle));
+            fds[i].path[0] = '\0';
+            pipe_open_end(p, write_end);
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void fd_entry_ref(fd_entry_t *e) {
+    if (e->kind == FD_KIND_PIPE) pipe_open_end(e->pipe, e->pipe_end);
+    vfs_handle_ref(&e->handle);
+}
+
 static int fd_dup_from_to(uint32_t oldfd, uint32_t newfd, int fixed_target) {
     fd_entry_t *fds = fd_current();
     uint32_t dst = newfd;
@@ -830,30 +920,12 @@ static int fd_dup_from_to(uint32_t oldfd, uint32_t newfd, int fixed_target) {
     } else {
         if (dst >= FD_MAX) return -K_EBADF;
         if (dst == oldfd) return (int)dst;
-        if (fds[dst].used) {
-            if (fds[dst].kind == FD_KIND_UDP && fds[dst].sock_id >= 0) {
-                udp_socket_free((int)fds[dst].sock_id);
-            }
-            fds[dst].used = 0;
-            fds[dst].kind = FD_KIND_VFS;
-            fds[dst].pipe_auto_unlink = 0;
-            fds[dst].sock_id = -1;
-            fds[dst].fd_flags = 0;
-            fds[dst].open_flags = 0;
-            fds[dst].offset = 0;
-            fds[dst].path[0] = '\0';
-        }
+        fd_release(fds, (int)dst);
     }
 
-    fds[dst].used = 1;
-    fds[dst].kind = fds[oldfd].kind;
-    fds[dst].pipe_auto_unlink = fds[oldfd].pipe_auto_unlink;
-    fds[dst].sock_id = fds[oldfd].sock_id;
+    fds[dst] = fds[oldfd];
     fds[dst].fd_flags = 0;
-    fds[dst].open_flags = fds[oldfd].open_flags;
-    fds[dst].offset = fds[oldfd].offset;
-    strncpy(fds[dst].path, fds[oldfd].path, sizeof(fds[dst].path) - 1);
-    fds[dst].path[sizeof(fds[dst].path) - 1] = '\0';
+    fd_entry_ref(&fds[dst]);
     return (int)dst;
 }
 
@@ -862,22 +934,7 @@ static void close_cloexec_fds(void) {
     for (int i = 3; i < FD_MAX; i++) {
         if (!fds[i].used) continue;
         if ((fds[i].fd_flags & FD_CLOEXEC) == 0) continue;
-        if (fds[i].kind == FD_KIND_UDP && fds[i].sock_id >= 0) {
-            udp_socket_free((int)fds[i].sock_id);
-        }
-        if (fds[i].kind == FD_KIND_VFS &&
-            fds[i].pipe_auto_unlink &&
-            !fd_has_path_ref(fds[i].path, i)) {
-            (void)vfs_unlink(g_root_fs_for_syscalls, fds[i].path);
-        }
-        fds[i].used = 0;
-        fds[i].kind = FD_KIND_VFS;
-        fds[i].pipe_auto_unlink = 0;
-        fds[i].sock_id = -1;
-        fds[i].fd_flags = 0;
-        fds[i].open_flags = 0;
-        fds[i].offset = 0;
-        fds[i].path[0] = '\0';
+        fd_release(fds, i);
     }
 }
 
@@ -887,6 +944,13 @@ static const char *fd_path(uint32_t fd) {
     return fds[fd].path;
 }
 
+static pipe_t *fd_pipe(uint32_t fd, int *write_end) {
+    fd_entry_t *fds = fd_current();
+    if (fd >= FD_MAX || !fds[fd].used || fds[fd].kind != FD_KIND_PIPE) return NULL;
+    if (write_end) *write_end = fds[fd].pipe_end;
+    return fds[fd].pipe;
+}
+
 static int fd_udp_sid(uint32_t fd) {
     fd_entry_t *fds = fd_current();
     if (fd >= FD_MAX || !fds[fd].used || fds[fd].kind != FD_KIND_UDP) return -1;
@@ -894,15 +958,97 @@ static int fd_udp_sid(uint32_t fd) {
     return (int)fds[fd].sock_id;
 }
 
-static int fd_has_path_ref(const char *path, int exclude_fd) {
+static int fd_get_info(uint32_t fd, vfs_info_t *out) {
+    fd_entry_t *fds = fd_current();
+    if (fd >= FD_MAX || !fds[fd].used || fds[fd].kind != FD_KIND_VFS) return -1;
+    if (fds[fd].handle.node) return vfs_handle_get_info(&fds[fd].handle, out);
+    return vfs_get_info(g_root_fs_for_syscalls, fds[fd].path, out);
+}
+
+static ssize_t fd_pread(uint32_t fd, void *buf, size_t size, uint32_t offset) {
     fd_entry_t *fds = fd_current();
-    if (!path || path[0] == '\0') return 0;
-    for (int i = 0; i < FD_MAX; i++) {
-        if (i == exclude_fd) continue;
-        if (!fds[i].used || fds[i].kind != FD_KIND_VFS) continue;
-        if (strcmp(fds[i].path, path) == 0) return 1;
+    if (fd >= FD_MAX || !fds[fd].used || fds[fd].kind != FD_KIND_VFS) return -1;
+    if (fds[fd].handle.node) return vfs_handle_pread(&fds[fd].handle, buf, size, offset);
+    return vfs_pread(g_root_fs_for_syscalls, fds[fd].path, buf, size, offset);
+}
+
+static ssize_t fd_pwrite(uint32_t fd, const void *buf, size_t size, uint32_t offset) {
+    fd_entry_t *fds = fd_current();
+    if (fd >= FD_MAX || !fds[fd].used || fds[fd].kind != FD_KIND_VFS) return -1;
+    if (fds[fd].handle.node) return vfs_handle_pwrite(&fds[fd].handle, buf, size, offset);
+    return vfs_pwrite(g_root_fs_for_syscalls, fds[fd].path, buf, size, offset);
+}
+
+/*
+ * Moves up to `count` bytes from a regular file to another descriptor inside
+ * the kernel, starting at each side's current offset and advancing both.
+ * Returns the byte count, 0 at end of input, or a negative K_E* code.
+ */
+static int32_t fd_copy_range(uint32_t in_fd, uint32_t out_fd, uint32_t count) {
+    fd_entry_t *fds = fd_current();
+    vfs_info_t in_info;
+    vfs_info_t out_info;
+    pipe_t *out_pipe;
+    int write_end = 0;
+    int out_is_file;
+    uint8_t *buf;
+    uint32_t done = 0;
+    int32_t err = 0;
+
+    if (in_fd == out_fd) return -K_EINVAL;
+    if (!fd_path(in_fd)) return fd_pipe(in_fd, NULL) ? -K_ESPIPE : -K_EBADF;
+    if (fd_get_info(in_fd, &in_info) != 0 || in_info.type != VFS_NODE_FILE) return -K_EINVAL;
+    out_pipe = fd_pipe(out_fd, &write_end);
+    if (out_pipe && !write_end) return -K_EBADF;
+    if (!out_pipe && !fd_path(out_fd)) return -K_EBADF;
+    out_is_file = !out_pipe && fd_get_info(out_fd, &out_info) == 0 && out_info.type == VFS_NODE_FILE;
+    if (count == 0 || fds[in_fd].offset >= in_info.size) return 0;
+    if (count > in_info.size - fds[in_fd].offset) count = in_info.size - fds[in_fd].offset;
+
+    buf = (uint8_t*)kmalloc(count < COPY_RANGE_CHUNK ? count : COPY_RANGE_CHUNK);
+    if (!buf) return -K_ENOMEM;
+    while (done < count) {
+        uint32_t want = count - done < COPY_RANGE_CHUNK ? count - done : COPY_RANGE_CHUNK;
+        uint32_t got;
+        uint32_t put = 0;
+        ssize_t n = fd_pread(in_fd, buf, want, fds[in_fd].offset);
+        if (n < 0) {
+            err = -K_EIO;
+            break;
+        }
+        if (n == 0) break;
+        got = (uint32_t)n;
+        while (put < got) {
+            if (out_pipe) {
+                n = pipe_write(out_pipe, buf + put, got - put, (fds[out_fd].open_flags & O_NONBLOCK) != 0);
+            } else if (out_is_file) {
+                uint32_t off = fds[out_fd].offset;
+                if ((fds[out_fd].open_flags & O_APPEND) && fd_get_info(out_fd, &out_info) == 0) off = out_info.size;
+                n = fd_pwrite(out_fd, buf + put, got - put, off);
+                if (n > 0) fds[out_fd].offset = off + (uint32_t)n;
+            } else {
+                n = fd_pwrite(out_fd, buf + put, got - put, 0);
+            }
+            if (n <= 0) {
+                err = n < 0 && out_pipe ? (int32_t)n : -K_EIO;
+                break;
+            }
+            put += (uint32_t)n;
+        }
+        fds[in_fd].offset += put;
+        done += put;
+        if (err != 0 || put < want) break;
     }
-    return 0;
+    kfree(buf);
+    if (done == 0 && err != 0) return err;
+    return (int32_t)done;
+}
+
+static int fd_ioctl(uint32_t fd, uint32_t request, void *arg) {
+    fd_entry_t *fds = fd_current();
+    if (fd >= FD_MAX || !fds[fd].used || fds[fd].kind != FD_KIND_VFS) return -1;
+    if (fds[fd].handle.node) return vfs_handle_ioctl(&fds[fd].handle, request, arg);
+    return vfs_ioctl(g_root_fs_for_syscalls, fds[fd].path, request, arg);
 }
 
 static uint32_t vfs_mode_from_info(const vfs_info_t *info) {
@@ -926,17 +1072,31 @@ static int16_t fd_poll_revents(int32_t fd, int16_t events) {
     if (fd < 0 || (uint32_t)fd >= FD_MAX) return POLLNVAL;
     path = fd_path((uint32_t)fd);
     if (!path) {
-        int sid = fd_udp_sid((uint32_t)fd);
+        int write_end = 0;
+        pipe_t *p = fd_pipe((uint32_t)fd, &write_end);
+        int sid;
+        if (p) {
+            if (!write_end && (events & POLLIN) && pipe_available(p) > 0) revents |= POLLIN;
+            if (!write_end && p->writers == 0) revents |= POLLHUP;
+            if (write_end && (events & POLLOUT) && pipe_space(p) > 0) revents |= POLLOUT;
+            if (write_end && p->readers == 0) revents |= POLLERR;
+            return revents;
+        }
+        sid = fd_udp_sid((uint32_t)fd);
         if (sid < 0) return POLLNVAL;
         if ((events & POLLIN) && g_udp_sockets[sid].q_len > 0) revents |= POLLIN;
         if (events & POLLOUT) revents |= POLLOUT;
         return revents;
     }
-    if (vfs_get_info(g_root_fs_for_syscalls, path, &info) != 0) return POLLNVAL;
+    if (fd_get_info((uint32_t)fd, &info) != 0) return POLLNVAL;
     if (events & POLLOUT) revents |= POLLOUT;
     if (events & POLLIN) {
+        uint32_t avail = 0;
         if (info.type == VFS_NODE_FIFO || info.type == VFS_NODE_SOCKET) {
             if (info.size > 0) revents |= POLLIN;
+        } else if ((info.type == VFS_NODE_DEVICE || info.type == VFS_NODE_CHARDEV) &&
+                   fd_ioctl((uint32_t)fd, DEV_IOCTL_PTY_GET_READABLE, &avail) == 0) {
+            if (avail > 0) revents |= POLLIN;
         } else {
             revents |= POLLIN;
         }
@@ -950,6 +1110,7 @@ static void spawned_user_task(void *arg) {
     uint32_t user_esp = USER_STACK_TOP;
     char stack_cmdline[512];
     if (!req) task_exit();
+    fd_table_release(current_task_slot());
     syscall_bind_stdio(req->tty);
     if (current_task) {
         strncpy(current_task->tty_path, req->tty, sizeof(current_task->tty_path) - 1);
@@ -989,8 +1150,6 @@ static void spawned_fork_child(void *arg) {
     kfree(ctx);
 
     current_task->cr3 = local.user_cr3;
-    current_task->user_slot = local.user_slot;
-    current_task->user_phys_base = local.user_phys;
     strncpy(current_task->tty_path, local.tty_path, sizeof(current_task->tty_path) - 1);
     current_task->tty_path[sizeof(current_task->tty_path) - 1] = '\0';
     strncpy(current_task->prog_path, local.prog_path, sizeof(current_task->prog_path) - 1);
@@ -1039,6 +1198,7 @@ uint32_t do_syscall_impl(
     struct interrupt_frame *f, syscall_saved_regs_t *regs
 ) {
     fd_current();
+    if (current_task) current_task->nr_syscalls++;
 
     switch (eax) {
         case SYS_YIELD:
@@ -1054,86 +1214,66 @@ uint32_t do_syscall_impl(
                 current_task->exit_status = (int32_t)ebx;
                 current_task->term_signal = 0;
             }
+            fd_table_release(current_task_slot());
             task_exit();
             return 0;
         case SYS_READ: {
             fd_entry_t *fds = fd_current();
-            const char *path;
             vfs_info_t info;
+            int have_info;
+            ssize_t n;
+            pipe_t *p;
+            int write_end = 0;
             if (!g_root_fs_for_syscalls) return (uint32_t)(-K_ENODEV);
             if (!ecx || edx == 0) return 0;
-            path = fd_path(ebx);
-            if (!path) return (uint32_t)(-K_EBADF);
-            if (vfs_get_info(g_root_fs_for_syscalls, path, &info) == 0 && info.type == VFS_NODE_FILE) {
+            p = fd_pipe(ebx, &write_end);
+            if (p) {
+                if (write_end) return (uint32_t)(-K_EBADF);
+                return (uint32_t)pipe_read(p, (void*)ecx, edx, (fds[ebx].open_flags & O_NONBLOCK) != 0);
+            }
+            if (!fd_path(ebx)) return (uint32_t)(-K_EBADF);
+            have_info = (fd_get_info(ebx, &info) == 0);
+            if (have_info && info.type == VFS_NODE_FILE) {
                 uint32_t off = fds[ebx].offset;
-                uint32_t to_copy;
-                uint8_t *tmp;
                 if (off >= info.size) return 0;
-                to_copy = ((uint32_t)edx < (info.size - off)) ? (uint32_t)edx : (info.size - off);
-                tmp = (uint8_t*)kmalloc(info.size ? info.size : 1);
-                if (!tmp) return (uint32_t)(-K_ENOMEM);
-                {
-                    ssize_t n = vfs_read(g_root_fs_for_syscalls, path, tmp, info.size);
-                    if (n < 0) {
-                        kfree(tmp);
-                        return (uint32_t)(-K_EIO);
-                    }
-                }
-                memcpy((void*)ecx, tmp + off, to_copy);
-                kfree(tmp);
-                fds[ebx].offset = off + to_copy;
-                return to_copy;
-            }
-            {
-                ssize_t n = vfs_read(g_root_fs_for_syscalls, path, (void*)ecx, edx);
-                if (n == 0 && (fds[ebx].open_flags & O_NONBLOCK) &&
-                    (vfs_get_info(g_root_fs_for_syscalls, path, &info) == 0) &&
-                    (info.type == VFS_NODE_FIFO || info.type == VFS_NODE_SOCKET)) {
-                    return (uint32_t)(-K_EAGAIN);
-                }
+                n = fd_pread(ebx, (void*)ecx, edx, off);
                 if (n < 0) return (uint32_t)(-K_EIO);
+                fds[ebx].offset = off + (uint32_t)n;
                 return (uint32_t)n;
             }
+            n = fd_pread(ebx, (void*)ecx, edx, 0);
+            if (n == 0 && (fds[ebx].open_flags & O_NONBLOCK) && have_info &&
+                (info.type == VFS_NODE_FIFO || info.type == VFS_NODE_SOCKET)) {
+                return (uint32_t)(-K_EAGAIN);
+            }
+            if (n < 0) return (uint32_t)(-K_EIO);
+            return (uint32_t)n;
         }
         case SYS_WRITE: {
             fd_entry_t *fds = fd_current();
-            const char *path;
             vfs_info_t info;
+            ssize_t n;
+            pipe_t *p;
+            int write_end = 0;
             if (!g_root_fs_for_syscalls) return (uint32_t)(-K_ENODEV);
             if (!ecx || edx == 0) return 0;
-            path = fd_path(ebx);
-            if (!path) return (uint32_t)(-K_EBADF);
-            if (vfs_get_info(g_root_fs_for_syscalls, path, &info) == 0 && info.type == VFS_NODE_FILE) {
+            p = fd_pipe(ebx, &write_end);
+            if (p) {
+                if (!write_end) return (uint32_t)(-K_EBADF);
+                return (uint32_t)pipe_write(p, (const void*)ecx, edx, (fds[ebx].open_flags & O_NONBLOCK) != 0);
+            }
+            if (!fd_path(ebx)) return (uint32_t)(-K_EBADF);
+            if (fd_get_info(ebx, &info) == 0 && info.type == VFS_NODE_FILE) {
                 uint32_t off = fds[ebx].offset;
-                uint32_t in_size = (uint32_t)edx;
-                uint32_t dst_size;
-                uint8_t *buf;
                 if (fds[ebx].open_flags & O_APPEND) off = info.size;
-                dst_size = (off + in_size > info.size) ? (off + in_size) : info.size;
-                buf = (uint8_t*)kmalloc(dst_size ? dst_size : 1);
-                if (!buf) return (uint32_t)(-K_ENOMEM);
-                memset(buf, 0, dst_size);
-                if (info.size > 0) {
-                    ssize_t rn = vfs_read(g_root_fs_for_syscalls, path, buf, info.size);
-                    if (rn < 0) {
-                        kfree(buf);
-                        return (uint32_t)(-K_EIO);
-                    }
-                }
-                memcpy(buf + off, (const void*)ecx, in_size);
-                if (vfs_write(g_root_fs_for_syscalls, path, buf, dst_size) < 0) {
-                    kfree(buf);
-                    return (uint32_t)(-K_EIO);
-                }
-                kfree(buf);
-                fds[ebx].offset = off + in_size;
-                return in_size;
-            }
-            {
-                ssize_t n = vfs_write(g_root_fs_for_syscalls, path, (const void*)ecx, edx);
+                n = fd_pwrite(ebx, (const void*)ecx, edx, off);
                 if (n < 0) return (uint32_t)(-K_EIO);
+                fds[ebx].offset = off + (uint32_t)n;
                 return (uint32_t)n;
             }
+            n = fd_pwrite(ebx, (const void*)ecx, edx, 0);
+            if (n < 0) return (uint32_t)(-K_EIO);
+            return (uint32_t)n;
         }
         case SYS_EXEC: {
             char path[256];
@@ -1196,13 +1336,10 @@ uint32_t do_syscall_impl(
             f->sp = user_esp;
             return 0;
         }
-        case SYS_IOCTL: {
-            const char *path;
+        case SYS_IOCTL:
             if (!g_root_fs_for_syscalls) return (uint32_t)(-K_ENODEV);
-            path = fd_path(ebx);
-            if (!path) return (uint32_t)(-K_EBADF);
-            return (uint32_t)vfs_ioctl(g_root_fs_for_syscalls, path, ecx, (void*)edx);
-        }
+            if (!fd_path(ebx)) return (uint32_t)(-K_EBADF);
+            return (uint32_t)fd_ioctl(ebx, ecx, (void*)edx);
         case SYS_OPEN: {
             char path[256];
             int inode_fd = -1;
@@ -1225,22 +1362,7 @@ uint32_t do_syscall_impl(
         case SYS_CLOSE: {
             fd_entry_t *fds = fd_current();
             if (ebx >= FD_MAX || !fds[ebx].used) return (uint32_t)(-K_EBADF);
-            if (fds[ebx].kind == FD_KIND_UDP && fds[ebx].sock_id >= 0) {
-                udp_socket_free((int)fds[ebx].sock_id);
-            }
-            if (fds[ebx].kind == FD_KIND_VFS &&
-                fds[ebx].pipe_auto_unlink &&
-                !fd_has_path_ref(fds[ebx].path, (int)ebx)) {
-                (void)vfs_unlink(g_root_fs_for_syscalls, fds[ebx].path);
-            }
-            fds[ebx].used = 0;
-            fds[ebx].kind = FD_KIND_VFS;
-            fds[ebx].pipe_auto_unlink = 0;
-            fds[ebx].sock_id = -1;
-            fds[ebx].fd_flags = 0;
-            fds[ebx].open_flags = 0;
-            fds[ebx].offset = 0;
-            fds[ebx].path[0] = '\0';
+            fd_release(fds, (int)ebx);
             return 0;
         }
         case SYS_MKDIR: {
@@ -1286,18 +1408,33 @@ uint32_t do_syscall_impl(
         case SYS_APPEND: {
             fd_entry_t *fds = fd_current();
             const char *path;
+            pipe_t *p;
+            int write_end = 0;
             if (!g_root_fs_for_syscalls) return (uint32_t)(-K_ENODEV);
             if (!ecx || edx == 0) return 0;
+            p = fd_pipe(ebx, &write_end);
+            if (p) {
+                if (!write_end) return (uint32_t)(-K_EBADF);
+                return (uint32_t)pipe_write(p, (const void*)ecx, edx, (fds[ebx].open_flags & O_NONBLOCK) != 0);
+            }
             path = fd_path(ebx);
             if (!path) return (uint32_t)(-K_EBADF);
             {
-                ssize_t n = vfs_append(g_root_fs_for_syscalls, path, (const void*)ecx, edx);
-                if (n < 0) return (uint32_t)(-K_EIO);
-                if (n > 0) {
-                    vfs_info_t info;
-                    if (vfs_get_info(g_root_fs_for_syscalls, path, &info) == 0) {
-                        fds[ebx].offset = info.size;
+                vfs_info_t info;
+                ssize_t n;
+                if (fds[ebx].handle.node) {
+                    if (vfs_handle_get_info(&fds[ebx].handle, &info) != 0) return (uint32_t)(-K_EIO);
+                    if (info.type != VFS_NODE_FILE && info.type != VFS_NODE_FIFO && info.type != VFS_NODE_SOCKET) {
+                        return (uint32_t)(-K_EIO);
                     }
+                    n = vfs_handle_pwrite(&fds[ebx].handle, (const void*)ecx, edx,
+                                          (info.type == VFS_NODE_FILE) ? info.size : 0);
+                } else {
+                    n = vfs_append(g_root_fs_for_syscalls, path, (const void*)ecx, edx);
+                }
+                if (n < 0) return (uint32_t)(-K_EIO);
+                if (n > 0 && fd_get_info(ebx, &info) == 0) {
+                    fds[ebx].offset = info.size;
                 }
                 return (uint32_t)n;
             }
@@ -1344,6 +1481,47 @@ uint32_t do_syscall_impl(
             return (uint32_t)(current_task ? current_task->pid : 0);
         case SYS_GETPPID:
             return (uint32_t)(current_task ? current_task->ppid : 0);
+        case SYS_SET_NICE: {
+            uint32_t pid = ebx ? ebx : (current_task ? current_task->pid : 0);
+            if (task_set_nice(pid, (int32_t)ecx) != 0) return (uint32_t)(-K_ESRCH);
+            return 0;
+        }
+        case SYS_GET_NICE: {
+            uint32_t pid = ebx ? ebx : (current_task ? current_task->pid : 0);
+            int32_t nice = 0;
+            if (!ecx) return (uint32_t)(-K_EINVAL);
+            if (task_get_nice(pid, &nice) != 0) return (uint32_t)(-K_ESRCH);
+            *(int32_t*)ecx = nice;
+            return 0;
+        }
+        case SYS_FSYNC: {
+            fd_entry_t *fds = fd_current();
+            if (ebx >= FD_MAX || !fds[ebx].used) return (uint32_t)(-K_EBADF);
+            if (fds[ebx].kind != FD_KIND_VFS) return (uint32_t)(-K_EINVAL);
+            if (disk_flush() != 0) return (uint32_t)(-K_EIO);
+            return 0;
+        }
+        case SYS_BRK: {
+            uint32_t old_brk;
+            if (!current_task || !current_task->brk_start) return (uint32_t)(-K_ENOMEM);
+            old_brk = current_task->brk;
+            if (ebx == 0) return old_brk;
+            if (ebx < current_task->brk_start || ebx > current_task->brk_limit) return old_brk;
+            if (ebx < old_brk) (void)mm_user_release(current_task->cr3, ebx, old_brk - ebx);
+            current_task->brk = ebx;
+            return ebx;
+        }
+        case SYS_MADVISE: {
+            if (!current_task || !current_task->brk_start) return (uint32_t)(-K_EINVAL);
+            if (edx != MADV_DONTNEED) return (uint32_t)(-K_EINVAL);
+            if ((ebx & (PAGE_SIZE - 1u)) != 0) return (uint32_t)(-K_EINVAL);
+            if (ebx < current_task->brk_start || ebx > current_task->brk || ecx > current_task->brk - ebx) return (uint32_t)(-K_EINVAL);
+            (void)mm_user_release(current_task->cr3, ebx, ecx);
+            return 0;
+        }
+        case SYS_COPY_FILE_RANGE:
+            if (!g_root_fs_for_syscalls) return (uint32_t)(-K_ENODEV);
+            return (uint32_t)fd_copy_range(ebx, ecx, edx);
         case SYS_STAT: {
             char path[256];
             vfs_info_t info;
@@ -1358,14 +1536,18 @@ uint32_t do_syscall_impl(
             return 0;
         }
         case SYS_FSTAT: {
-            const char *path;
             vfs_info_t info;
             syscall_stat_t st;
             if (!g_root_fs_for_syscalls) return (uint32_t)(-K_ENODEV);
             if (!ecx) return (uint32_t)(-K_EINVAL);
-            path = fd_path(ebx);
-            if (!path) return (uint32_t)(-K_EBADF);
-            if (vfs_get_info(g_root_fs_for_syscalls, path, &info) != 0) return (uint32_t)(-K_EIO);
+            if (fd_pipe(ebx, NULL)) {
+                memset(&info, 0, sizeof(info));
+                info.type = VFS_NODE_FIFO;
+                info.size = pipe_available(fd_pipe(ebx, NULL));
+            } else {
+                if (!fd_path(ebx)) return (uint32_t)(-K_EBADF);
+                if (fd_get_info(ebx, &info) != 0) return (uint32_t)(-K_EIO);
+            }
             st.st_mode = vfs_mode_from_info(&info);
             st.st_size = (int32_t)info.size;
             memcpy((void*)ecx, &st, sizeof(st));
@@ -1373,14 +1555,13 @@ uint32_t do_syscall_impl(
         }
         case SYS_LSEEK: {
             fd_entry_t *fds = fd_current();
-            const char *path;
             vfs_info_t info;
             int32_t cur;
             int32_t off = (int32_t)ecx;
             int32_t np = 0;
-            path = fd_path(ebx);
-            if (!path) return (uint32_t)(-K_EBADF);
-            if (vfs_get_info(g_root_fs_for_syscalls, path, &info) != 0) return (uint32_t)(-K_EIO);
+            if (fd_pipe(ebx, NULL)) return (uint32_t)(-K_ESPIPE);
+            if (!fd_path(ebx)) return (uint32_t)(-K_EBADF);
+            if (fd_get_info(ebx, &info) != 0) return (uint32_t)(-K_EIO);
             if (info.type != VFS_NODE_FILE) return (uint32_t)(-K_ENOTSUP);
             cur = (int32_t)fds[ebx].offset;
             if ((int32_t)edx == SEEK_SET) np = off;
@@ -1392,55 +1573,27 @@ uint32_t do_syscall_impl(
             return (uint32_t)np;
         }
         case SYS_PIPE: {
-            char path[256];
             int fdr = -1;
             int fdw = -1;
             int32_t *fds_out = (int32_t*)ebx;
             fd_entry_t *fds = fd_current();
-            if (!g_root_fs_for_syscalls) return (uint32_t)(-K_ENODEV);
+            pipe_t *p;
             if (!fds_out) return (uint32_t)(-K_EINVAL);
-            for (uint32_t tries = 0; tries < 32; tries++) {
-                uint32_t pid = current_task ? current_task->pid : 0;
-                uint32_t seq = g_pipe_seq++;
-                if (seq == 0) seq = g_pipe_seq++;
-                path[0] = '\0';
-                strcpy(path, "/tmp/.pipe_");
-                {
-                    char nbuf[16];
-                    utoa(pid, nbuf, 10);
-                    strcat(path, nbuf);
-                    strcat(path, "_");
-                    utoa(seq, nbuf, 10);
-                    strcat(path, nbuf);
-                }
-                if (vfs_mkfifo(g_root_fs_for_syscalls, path) == 0) {
-                    fdr = fd_alloc(path, 0);
-                    if (fdr < 0) {
-                        (void)vfs_unlink(g_root_fs_for_syscalls, path);
-                        return (uint32_t)(-K_ENFILE);
-                    }
-                    fdw = fd_alloc(path, 0);
-                    if (fdw < 0) {
-                        fd_entry_t *t = fd_current();
-                        t[fdr].used = 0;
-                        t[fdr].kind = FD_KIND_VFS;
-                        t[fdr].pipe_auto_unlink = 0;
-                        t[fdr].sock_id = -1;
-                        t[fdr].fd_flags = 0;
-                        t[fdr].open_flags = 0;
-                        t[fdr].offset = 0;
-                        t[fdr].path[0] = '\0';
-                        (void)vfs_unlink(g_root_fs_for_syscalls, path);
-                        return (uint32_t)(-K_ENFILE);
-                    }
-                    fds[fdr].pipe_auto_unlink = 1;
-                    fds[fdw].pipe_auto_unlink = 1;
-                    fds_out[0] = fdr;
-                    fds_out[1] = fdw;
-                    return 0;
-                }
+            p = pipe_create(0);
+            if (!p) return (uint32_t)(-K_ENOMEM);
+            fdr = fd_alloc_pipe(p, 0);
+            if (fdr < 0) {
+                pipe_destroy(p);
+                return (uint32_t)(-K_ENFILE);
             }
-            return (uint32_t)(-K_EBUSY);
+            fdw = fd_alloc_pipe(p, 1);
+            if (fdw < 0) {
+                fd_release(fds, fdr);
+                return (uint32_t)(-K_ENFILE);
+            }
+            fds_out[0] = fdr;
+            fds_out[1] = fdw;
+            return 0;
         }
         case SYS_FCNTL: {
             fd_entry_t *fds = fd_current();
@@ -1471,8 +1624,6 @@ uint32_t do_syscall_impl(
         }
         case SYS_FORK: {
             fork_child_ctx_t *ctx;
-            uint32_t child_slot = 0;
-            uint32_t child_phys = 0;
             uint32_t child_cr3 = 0;
             uint32_t ret_esp = 0;
             int pid;
@@ -1481,22 +1632,16 @@ uint32_t do_syscall_impl(
             int cslot;
 
             if (!current_task || !f || !regs) return (uint32_t)(-K_EINVAL);
-            if (current_task->user_slot == (uint32_t)-1 || current_task->user_phys_base == 0) {
+            if (!current_task->cr3 || current_task->cr3 == mm_kernel_cr3()) {
                 return (uint32_t)(-K_ENOSYS);
             }
 
-            if (mm_user_slot_alloc(&child_slot, &child_phys) != 0) return (uint32_t)(-K_ENOMEM);
-            memcpy((void*)(uintptr_t)child_phys, (const void*)(uintptr_t)current_task->user_phys_base, USER_SLOT_SIZE_PHYS);
-            child_cr3 = mm_user_cr3_create(child_phys);
-            if (!child_cr3) {
-                mm_user_slot_free(child_slot);
-                return (uint32_t)(-K_ENOMEM);
-            }
+            child_cr3 = mm_user_space_clone(current_task->cr3);
+            if (!child_cr3) return (uint32_t)(-K_ENOMEM);
 
             ctx = (fork_child_ctx_t*)kmalloc(sizeof(*ctx));
             if (!ctx) {
-                mm_user_cr3_destroy(child_cr3);
-                mm_user_slot_free(child_slot);
+                mm_user_space_destroy(child_cr3);
                 return (uint32_t)(-K_ENOMEM);
             }
             memset(ctx, 0, sizeof(*ctx));
@@ -1505,8 +1650,6 @@ uint32_t do_syscall_impl(
             ctx->user_esp = ret_esp;
             ctx->user_eflags = f->flags;
             ctx->user_cr3 = child_cr3;
-            ctx->user_slot = child_slot;
-            ctx->user_phys = child_phys;
             ctx->ebx = regs->ebx;
             ctx->ecx = regs->ecx;
             ctx->edx = regs->edx;
@@ -1520,16 +1663,16 @@ uint32_t do_syscall_impl(
             pid = task_create(spawned_fork_child, ctx);
             if (pid < 0) {
                 kfree(ctx);
-                mm_user_cr3_destroy(child_cr3);
-                mm_user_slot_free(child_slot);
+                mm_user_space_destroy(child_cr3);
                 return (uint32_t)(-K_ENFILE);
             }
 
             child_task = task_find_by_pid((uint32_t)pid);
             if (!child_task) return (uint32_t)(-K_EIO);
             child_task->cr3 = child_cr3;
-            child_task->user_slot = child_slot;
-            child_task->user_phys_base = child_phys;
+            child_task->brk_start = current_task->brk_start;
+            child_task->brk = current_task->brk;
+            child_task->brk_limit = current_task->brk_limit;
             strncpy(child_task->tty_path, current_task->tty_path, sizeof(child_task->tty_path) - 1);
             child_task->tty_path[sizeof(child_task->tty_path) - 1] = '\0';
             strncpy(child_task->prog_path, current_task->prog_path, sizeof(child_task->prog_path) - 1);
@@ -1539,16 +1682,22 @@ uint32_t do_syscall_impl(
 
             pslot = current_task_slot();
             cslot = (int)(child_task - tasks);
-            if (cslot >= 0 && cslot < MAX_TASKS) {
+            if (cslot >= 0 && cslot < MAX_TASKS && fd_task_table(cslot)) {
+                fd_table_release(cslot);
                 if (pslot >= 0 && pslot < MAX_TASKS && g_task_fd_init[pslot]) {
-                    memcpy(g_task_fds[cslot], g_task_fds[pslot], sizeof(g_task_fds[cslot]));
+                    memcpy(g_task_fds[cslot], g_task_fds[pslot], sizeof(fd_entry_t) * FD_MAX);
                     g_task_fd_init[cslot] = 1;
                 } else if (g_fd_init_done) {
-                    memcpy(g_task_fds[cslot], g_fds, sizeof(g_task_fds[cslot]));
+                    memcpy(g_task_fds[cslot], g_fds, sizeof(fd_entry_t) * FD_MAX);
                     g_task_fd_init[cslot] = 1;
                 } else {
                     g_task_fd_init[cslot] = 0;
                 }
+                if (g_task_fd_init[cslot]) {
+                    for (int i = 0; i < FD_MAX; i++) {
+                        if (g_task_fds[cslot][i].used) fd_entry_ref(&g_task_fds[cslot][i]);
+                    }
+                }
             }
 
             return (uint32_t)pid;
@@ -1557,7 +1706,7 @@ uint32_t do_syscall_impl(
             syscall_pollfd_t *pfds = (syscall_pollfd_t*)ebx;
             uint32_t nfds = ecx;
             int32_t timeout_ms = (int32_t)edx;
-            uint32_t waited = 0;
+            uint32_t deadline = timer_get_ticks() + ms_to_ticks((uint32_t)timeout_ms);
             if (!pfds && nfds > 0) return (uint32_t)(-K_EINVAL);
             while (1) {
                 int32_t ready = 0;
@@ -1568,9 +1717,8 @@ uint32_t do_syscall_impl(
                 }
                 if (ready > 0) return (uint32_t)ready;
                 if (timeout_ms == 0) return 0;
-                if (timeout_ms > 0 && (int32_t)waited >= timeout_ms) return 0;
-                sleep(10);
-                waited += 10;
+                if (timeout_ms > 0 && (int32_t)(deadline - timer_get_ticks()) <= 0) return 0;
+                poll_wait_until(timeout_ms, deadline);
             }
         }
         case SYS_SELECT: {
@@ -1578,7 +1726,7 @@ uint32_t do_syscall_impl(
             uint32_t *rfds;
             uint32_t *wfds;
             uint32_t *efds;
-            uint32_t waited = 0;
+            uint32_t deadline;
             int32_t timeout_ms;
             if (!ebx) return (uint32_t)(-K_EINVAL);
             memcpy(&req, (const void*)ebx, sizeof(req));
@@ -1587,6 +1735,7 @@ uint32_t do_syscall_impl(
             wfds = req.writefds;
             efds = req.exceptfds;
             timeout_ms = req.timeout_ms;
+            deadline = timer_get_ticks() + ms_to_ticks((uint32_t)timeout_ms);
             while (1) {
                 uint32_t rmask = 0;
                 uint32_t wmask = 0;
@@ -1612,9 +1761,8 @@ uint32_t do_syscall_impl(
                 if (efds) *efds = emask;
                 if (ready > 0) return (uint32_t)ready;
                 if (timeout_ms == 0) return 0;
-                if (timeout_ms > 0 && (int32_t)waited >= timeout_ms) return 0;
-                sleep(10);
-                waited += 10;
+                if (timeout_ms > 0 && (int32_t)(deadline - timer_get_ticks()) <= 0) return 0;
+                poll_wait_until(timeout_ms, deadline);
             }
         }
         case SYS_WAITPID: {
@@ -1662,6 +1810,7 @@ uint32_t do_syscall_impl(
             if (vfs_mount(g_root_fs_for_syscalls, mount_path, fs_drv, ctx) != 0) {
                 for (uint32_t i = 0; i < VFS_MAX_MOUNTS; i++) {
                     if (&g_mount_fat_ctx[i] == (fat32_fs_t*)ctx) {
+                        fat32_release(&g_mount_fat_ctx[i]);
                         g_mount_fat_used[i] = 0;
                         g_mount_fat_path[i][0] = '\0';
                         break;
@@ -1680,12 +1829,18 @@ uint32_t do_syscall_impl(
             if (!g_root_fs_for_syscalls) return (uint32_t)(-K_ENODEV);
             if (copy_user_path((const char*)ebx, mount_path, sizeof(mount_path)) != 0) return (uint32_t)(-K_EINVAL);
             if (normalize_mount_path_local(mount_path, norm, sizeof(norm)) != 0) return (uint32_t)(-K_EINVAL);
+            for (uint32_t i = 0; i < VFS_MAX_MOUNTS; i++) {
+                if (g_mount_fat_used[i] && strcmp(g_mount_fat_path[i], norm) == 0 && g_mount_fat_ctx[i].open_nodes) {
+                    return (uint32_t)(-K_EBUSY);
+                }
+            }
             if (vfs_umount(g_root_fs_for_syscalls, mount_path) != 0) return (uint32_t)(-K_EBUSY);
             for (uint32_t i = 0; i < VFS_MAX_MOUNTS; i++) {
                 if (!g_mount_fat_used[i]) continue;
                 if (strcmp(g_mount_fat_path[i], norm) == 0) {
                     g_mount_fat_used[i] = 0;
                     g_mount_fat_path[i][0] = '\0';
+                    fat32_release(&g_mount_fat_ctx[i]);
                     memset(&g_mount_fat_ctx[i], 0, sizeof(g_mount_fat_ctx[i]));
                     break;
                 }
@@ -2,8 +2,12 @@
 
 #include <stdint.h>
 
+struct task;
+
 void syscall_bind_stdio(const char *path);
 void syscall_set_devfs_ctx(void *ctx);
+void syscall_task_exit(struct task *task);
+void syscall_task_heap_init(void);
 int syscall_task_fd_path(uint32_t pid, uint32_t fd, char *out, uint32_t cap);
 uint32_t syscall_task_fd_max(void);
 void syscall_handler(void);
@@ -4,6 +4,7 @@ global syscall_handler
 extern do_syscall_impl
 
 syscall_handler:
+    cld
     push ebp
     push edi
     push esi
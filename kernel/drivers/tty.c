@@ -10,6 +10,7 @@
 #include <asm/mm.h>
 #include <asm/processor.h>
 #include <asm/task.h>
+#include <asm/timer.h>
 #include <drivers/serial.h>
 #include <string.h>
 
@@ -17,6 +18,13 @@
 #define SERIAL_TTY_COUNT 1
 #define TTY_HISTORY_MAX 32
 #define TTY_HISTORY_LINE_MAX 1024
+#define TTY_ANSI_MAX_PARAMS 8
+#define TTY_ATTR_DEFAULT 0x07u
+#define TTY_ATTR_BOLD 0x08u
+
+#ifndef CONFIG_TTY_SCROLLBACK_LINES
+#define CONFIG_TTY_SCROLLBACK_LINES 200
+#endif
 
 typedef enum {
     TTY_VESA = 0,
@@ -32,13 +40,31 @@ typedef struct {
     uint32_t cols;
     uint32_t rows;
     char *cells;
+    uint8_t *attrs;
+    uint32_t ring_rows;
+    uint32_t head;
+    uint32_t history_lines;
+    uint32_t view;
+    uint8_t attr;
     char *history;
     uint32_t history_count;
     uint32_t history_next;
     uint8_t ansi_state;
     uint32_t ansi_param;
     uint8_t ansi_have_param;
+    uint32_t ansi_params[TTY_ANSI_MAX_PARAMS];
+    uint32_t ansi_nparams;
     int32_t fg_pid;
+    uint8_t deferred;
+    uint32_t pending_scroll;
+    uint32_t dirty_lo;
+    uint32_t dirty_hi;
+    uint32_t stat_bytes;
+    uint32_t stat_writes;
+    uint32_t stat_frames;
+    uint32_t stat_scrolled;
+    uint32_t stat_blits;
+    uint32_t stat_start;
 } tty_device_t;
 
 static tty_device_t g_tty_v[VESA_TTY_COUNT];
@@ -51,6 +77,47 @@ static uint32_t g_char_h = 16;
 static uint32_t g_fg = 0x00D0D0D0;
 static uint32_t g_bg = 0x00000000;
 static uint8_t g_tty_ready = 0;
+static wait_queue_t g_active_wq;
+
+static const uint32_t g_tty_palette[16] = {
+    0x00000000, 0x00AA0000, 0x0000AA00, 0x00AA5500, 0x000000AA, 0x00AA00AA, 0x0000AAAA, 0x00D0D0D0,
+    0x00555555, 0x00FF5555, 0x0055FF55, 0x00FFFF55, 0x005555FF, 0x00FF55FF, 0x0055FFFF, 0x00FFFFFF,
+};
+static const uint8_t g_tty_vga_color[8] = {
+    VGA_COLOR_BLACK, VGA_COLOR_RED, VGA_COLOR_GREEN, VGA_COLOR_BROWN,
+    VGA_COLOR_BLUE, VGA_COLOR_MAGENTA, VGA_COLOR_CYAN, VGA_COLOR_LIGHT_GREY,
+};
+
+static uint32_t tty_attr_fg(uint8_t attr) {
+    if (attr == TTY_ATTR_DEFAULT) return g_fg;
+    return g_tty_palette[attr & 0x0Fu];
+}
+
+static uint32_t tty_attr_bg(uint8_t attr) {
+    uint32_t bg = (attr >> 4) & 0x07u;
+    return bg ? g_tty_palette[bg] : g_bg;
+}
+
+static uint8_t tty_attr_vga(uint8_t attr) {
+    uint8_t fg;
+    uint8_t bg;
+    if (attr == TTY_ATTR_DEFAULT) return vga_color_get();
+    fg = (uint8_t)(g_tty_vga_color[attr & 0x07u] | (attr & TTY_ATTR_BOLD));
+    bg = g_tty_vga_color[(attr >> 4) & 0x07u];
+    return (uint8_t)((bg << 4) | fg);
+}
+
+static uint32_t tty_slot(const tty_device_t *tty, uint32_t row, uint32_t view) {
+    return (tty->head + tty->ring_rows - view + row) % tty->ring_rows;
+}
+
+static char *tty_row(tty_device_t *tty, uint32_t row) {
+    return tty->cells + tty_slot(tty, row, 0) * tty->cols;
+}
+
+static uint8_t *tty_row_attrs(tty_device_t *tty, uint32_t row) {
+    return tty->attrs + tty_slot(tty, row, 0) * tty->cols;
+}
 
 static inline void tty_spin_wait(void) {
     uint32_t flags;
@@ -60,10 +127,20 @@ static inline void tty_spin_wait(void) {
     if ((flags & (1u << 9)) == 0u) cli();
 }
 
+static void tty_wait_active(tty_device_t *tty) {
+    uint32_t flags;
+    __asm__ __volatile__("pushf; pop %0" : "=r"(flags) :: "memory");
+    cli();
+    while (tty->index != g_active_tty) {
+        if (task_wait(&g_active_wq, 0) != 0) tty_spin_wait();
+    }
+    if (flags & (1u << 9)) sti();
+}
+
 static void tty_render_full(tty_device_t *tty);
-static void tty_draw_cell(uint32_t col, uint32_t row, char c);
+static void tty_draw_cell(uint32_t col, uint32_t row, char c, uint8_t attr);
 static const uint8_t *tty_fallback_glyph(char c);
-static void tty_draw_fallback_char(uint32_t px, uint32_t py, char c);
+static void tty_draw_fallback_char(uint32_t px, uint32_t py, char c, uint32_t fg);
 static void tty_redraw_row(tty_device_t *tty, uint32_t row);
 static void tty_putc_vesa(tty_device_t *tty, char c);
 static void tty_putc_vga(tty_device_t *tty, char c);
@@ -123,6 +200,7 @@ static void tty_input_cursor(tty_device_t *tty, int visible) {
     uint32_t y;
     uint32_t x;
     if (!tty || tty->type != TTY_VESA || tty->index != g_active_tty) return;
+    if (tty->view != 0) return;
     if (tty->cursor_x >= tty->cols || tty->cursor_y >= tty->rows) return;
 
     x = tty->cursor_x;
@@ -133,7 +211,7 @@ static void tty_input_cursor(tty_device_t *tty, int visible) {
     if (visible) {
         vesa_fill_rect(px, py, g_char_w, 1, g_fg);
     } else {
-        tty_draw_cell(x, y, tty->cells[y * tty->cols + x]);
+        tty_draw_cell(x, y, tty_row(tty, y)[x], tty_row_attrs(tty, y)[x]);
     }
 }
 
@@ -164,11 +242,26 @@ static void tty_erase_to_eol(tty_device_t *tty) {
     if (tty->cursor_y >= tty->rows || tty->cursor_x >= tty->cols) return;
     y = tty->cursor_y;
     for (x = tty->cursor_x; x < tty->cols; x++) {
-        tty->cells[y * tty->cols + x] = ' ';
-        if (tty->index == g_active_tty) {
-            if (tty->type == TTY_VGA) tty_redraw_row(tty, y);
-            else tty_draw_cell(x, y, ' ');
-        }
+        tty_row(tty, y)[x] = ' ';
+        tty_row_attrs(tty, y)[x] = tty->attr;
+    }
+    if (tty->index == g_active_tty) tty_redraw_row(tty, y);
+}
+
+static void tty_apply_sgr(tty_device_t *tty) {
+    for (uint32_t i = 0; i < tty->ansi_nparams; i++) {
+        uint32_t p = tty->ansi_params[i];
+        uint8_t a = tty->attr;
+        if (p == 0u) a = TTY_ATTR_DEFAULT;
+        else if (p == 1u) a |= TTY_ATTR_BOLD;
+        else if (p == 22u) a &= (uint8_t)~TTY_ATTR_BOLD;
+        else if (p >= 30u && p <= 37u) a = (uint8_t)((a & ~0x07u) | (p - 30u));
+        else if (p == 39u) a = (uint8_t)((a & ~0x07u) | (TTY_ATTR_DEFAULT & 0x07u));
+        else if (p >= 40u && p <= 47u) a = (uint8_t)((a & ~0x70u) | ((p - 40u) << 4));
+        else if (p == 49u) a &= (uint8_t)~0x70u;
+        else if (p >= 90u && p <= 97u) a = (uint8_t)((a & ~0x07u) | (p - 90u) | TTY_ATTR_BOLD);
+        else if (p >= 100u && p <= 107u) a = (uint8_t)((a & ~0x70u) | ((p - 100u) << 4));
+        tty->attr = a;
     }
 }
 
@@ -179,6 +272,7 @@ static int tty_consume_ansi(tty_device_t *tty, char c) {
             tty->ansi_state = 1u;
             tty->ansi_param = 0u;
             tty->ansi_have_param = 0u;
+            tty->ansi_nparams = 0u;
             return 1;
         }
         return 0;
@@ -199,11 +293,19 @@ static int tty_consume_ansi(tty_device_t *tty, char c) {
             tty->ansi_param = tty->ansi_param * 10u + (uint32_t)(c - '0');
             return 1;
         }
-        if (c == ';') return 1;
+        if (c == ';') {
+            if (tty->ansi_nparams < TTY_ANSI_MAX_PARAMS) tty->ansi_params[tty->ansi_nparams++] = tty->ansi_param;
+            tty->ansi_param = 0u;
+            tty->ansi_have_param = 0u;
+            return 1;
+        }
         if (c >= 0x40 && c <= 0x7E) {
             uint32_t n = tty->ansi_have_param ? tty->ansi_param : 1u;
             if (n == 0u) n = 1u;
-            if (c == 'D') {
+            if (c == 'm') {
+                if (tty->ansi_nparams < TTY_ANSI_MAX_PARAMS) tty->ansi_params[tty->ansi_nparams++] = tty->ansi_param;
+                tty_apply_sgr(tty);
+            } else if (c == 'D') {
                 while (n--) tty_cursor_left_raw(tty);
             } else if (c == 'C') {
                 while (n--) tty_cursor_right_raw(tty);
@@ -306,11 +408,46 @@ static void tty_set_active(uint32_t idx) {
     if (idx >= VESA_TTY_COUNT) return;
     keyboard_clear_buffers();
     g_active_tty = idx;
+    wait_queue_wake_all(&g_active_wq);
     if (g_tty_v[g_active_tty].type == TTY_VESA && vesa_is_initialized()) vesa_clear(g_bg);
     if (g_tty_v[g_active_tty].type == TTY_VGA) vga_clear();
     tty_render_full(&g_tty_v[g_active_tty]);
 }
 
+static void tty_view_scroll(tty_device_t *tty, int32_t delta) {
+    int32_t view;
+    int32_t d;
+    if (!tty || !tty->cells || tty->rows == 0) return;
+    view = (int32_t)tty->view + delta;
+    if (view < 0) view = 0;
+    if (view > (int32_t)tty->history_lines) view = (int32_t)tty->history_lines;
+    d = view - (int32_t)tty->view;
+    if (d == 0) return;
+    tty->view = (uint32_t)view;
+    if (tty->index != g_active_tty) return;
+
+    if (tty->type == TTY_VESA && (uint32_t)(d < 0 ? -d : d) < tty->rows) {
+        vesa_scroll(0, d * (int32_t)g_char_h, g_bg);
+        if (d > 0) {
+            for (uint32_t y = 0; y < (uint32_t)d; y++) tty_redraw_row(tty, y);
+        } else {
+            for (uint32_t y = tty->rows - (uint32_t)(-d); y < tty->rows; y++) tty_redraw_row(tty, y);
+        }
+        return;
+    }
+    tty_render_full(tty);
+}
+
+static void tty_view_reset(tty_device_t *tty) {
+    if (tty->view == 0) return;
+    tty->view = 0;
+    if (tty->deferred) {
+        tty->pending_scroll = tty->rows;
+        return;
+    }
+    if (tty->index == g_active_tty) tty_render_full(tty);
+}
+
 static void tty_hotkey_handler(uint8_t keycode, bool pressed, bool shift, bool ctrl, bool alt) {
     if (!pressed) return;
 
@@ -329,18 +466,72 @@ static void tty_hotkey_handler(uint8_t keycode, bool pressed, bool shift, bool c
         tty_set_active(idx);
         return;
     }
+
+    if (shift && !ctrl && !alt && (keycode == KEY_PGUP || keycode == KEY_PGDOWN)) {
+        tty_device_t *tty = &g_tty_v[g_active_tty];
+        int32_t page = (tty->rows > 1) ? (int32_t)(tty->rows - 1) : 1;
+        tty_view_scroll(tty, (keycode == KEY_PGUP) ? page : -page);
+        return;
+    }
 }
 
-static void tty_draw_cell(uint32_t col, uint32_t row, char c) {
+static void tty_mark_row(tty_device_t *tty, uint32_t row) {
+    if (row >= tty->rows) return;
+    if (tty->dirty_lo > tty->dirty_hi) {
+        tty->dirty_lo = row;
+        tty->dirty_hi = row;
+        return;
+    }
+    if (row < tty->dirty_lo) tty->dirty_lo = row;
+    if (row > tty->dirty_hi) tty->dirty_hi = row;
+}
+
+static void tty_update_cell(tty_device_t *tty, uint32_t col, uint32_t row, char c, uint8_t attr) {
+    if (tty->deferred) {
+        tty_mark_row(tty, row);
+        return;
+    }
+    if (tty->index == g_active_tty) tty_draw_cell(col, row, c, attr);
+}
+
+static void tty_begin_deferred(tty_device_t *tty) {
+    tty->deferred = 1;
+    tty->pending_scroll = 0;
+    tty->dirty_lo = 1;
+    tty->dirty_hi = 0;
+}
+
+static void tty_end_deferred(tty_device_t *tty) {
+    uint32_t n = tty->pending_scroll;
+    tty->deferred = 0;
+    tty->pending_scroll = 0;
+    if (tty->index != g_active_tty || tty->rows == 0) return;
+    if (n == 0 && tty->dirty_lo > tty->dirty_hi) return;
+
+    tty->stat_frames++;
+    if (n >= tty->rows) {
+        tty_render_full(tty);
+        return;
+    }
+    if (n > 0) {
+        vesa_scroll(0, -(int32_t)(n * g_char_h), g_bg);
+        tty->stat_blits++;
+    }
+    if (tty->dirty_lo <= tty->dirty_hi) {
+        for (uint32_t y = tty->dirty_lo; y <= tty->dirty_hi; y++) tty_redraw_row(tty, y);
+    }
+}
+
+static void tty_draw_cell(uint32_t col, uint32_t row, char c, uint8_t attr) {
     uint32_t px = col * g_char_w;
     uint32_t py = row * g_char_h;
-    vesa_fill_rect(px, py, g_char_w, g_char_h, g_bg);
-    if (c == ' ') return;
     if (g_font) {
-        font_draw_char(g_font, px, py, c, g_fg);
+        font_draw_run(g_font, px, py, &c, 1, tty_attr_fg(attr), tty_attr_bg(attr));
         return;
     }
-    tty_draw_fallback_char(px, py, c);
+    vesa_fill_rect(px, py, g_char_w, g_char_h, tty_attr_bg(attr));
+    if (c == ' ') return;
+    tty_draw_fallback_char(px, py, c, tty_attr_fg(attr));
 }
 
 static const uint8_t *tty_fallback_glyph(char c) {
@@ -402,7 +593,7 @@ static const uint8_t *tty_fallback_glyph(char c) {
     }
 }
 
-static void tty_draw_fallback_char(uint32_t px, uint32_t py, char c) {
+static void tty_draw_fallback_char(uint32_t px, uint32_t py, char c, uint32_t fg) {
     const uint8_t *g = tty_fallback_glyph(c);
     uint32_t sx = (g_char_w >= 5) ? (g_char_w / 5) : 1;
     uint32_t sy = (g_char_h >= 7) ? (g_char_h / 7) : 1;
@@ -419,7 +610,7 @@ static void tty_draw_fallback_char(uint32_t px, uint32_t py, char c) {
     for (uint32_t row = 0; row < 7; row++) {
         for (uint32_t col = 0; col < 5; col++) {
             if ((g[row] & (1u << (4 - col))) == 0) continue;
-            vesa_fill_rect(px + ox + col * s, py + oy + row * s, s, s, g_fg);
+            vesa_fill_rect(px + ox + col * s, py + oy + row * s, s, s, fg);
         }
     }
 }
@@ -430,11 +621,7 @@ static void tty_render_full(tty_device_t *tty) {
     uint8_t color;
     if (!tty || !tty->cells) return;
     if (tty->type == TTY_VESA) {
-        for (uint32_t y = 0; y < tty->rows; y++) {
-            for (uint32_t x = 0; x < tty->cols; x++) {
-                tty_draw_cell(x, y, tty->cells[y * tty->cols + x]);
-            }
-        }
+        for (uint32_t y = 0; y < tty->rows; y++) tty_redraw_row(tty, y);
         return;
     }
     if (tty->type != TTY_VGA) return;
@@ -443,44 +630,72 @@ static void tty_render_full(tty_device_t *tty) {
     blank = (uint16_t)((color << 8) | ' ');
     vga_mem = (volatile uint16_t*)(uintptr_t)VGA_MEMORY_ADDRESS;
     for (uint32_t i = 0; i < VGA_WIDTH * VGA_HEIGHT; i++) vga_mem[i] = blank;
-    for (uint32_t y = 0; y < tty->rows; y++) {
-        for (uint32_t x = 0; x < tty->cols; x++) {
-            char c = tty->cells[y * tty->cols + x];
-            vga_mem[y * VGA_WIDTH + x] = (uint16_t)((color << 8) | (uint8_t)c);
-        }
-    }
+    for (uint32_t y = 0; y < tty->rows; y++) tty_redraw_row(tty, y);
     vga_cursor_set(tty->cursor_x, tty->cursor_y);
 }
 
 static void tty_redraw_row(tty_device_t *tty, uint32_t row) {
     volatile uint16_t *vga_mem;
-    uint8_t color;
+    const char *cells;
+    const uint8_t *attrs;
+    uint32_t slot;
     if (!tty || !tty->cells || row >= tty->rows) return;
+    slot = tty_slot(tty, row, tty->view);
+    cells = tty->cells + slot * tty->cols;
+    attrs = tty->attrs + slot * tty->cols;
     if (tty->type == TTY_VESA) {
-        for (uint32_t x = 0; x < tty->cols; x++) {
-            tty_draw_cell(x, row, tty->cells[row * tty->cols + x]);
+        if (tty->deferred) {
+            tty_mark_row(tty, row);
+            return;
+        }
+        if (g_font) {
+            uint32_t x = 0;
+            while (x < tty->cols) {
+                uint32_t end = x + 1;
+                while (end < tty->cols && attrs[end] == attrs[x]) end++;
+                font_draw_run(g_font, x * g_char_w, row * g_char_h, cells + x, end - x,
+                    tty_attr_fg(attrs[x]), tty_attr_bg(attrs[x]));
+                x = end;
+            }
+            return;
         }
+        for (uint32_t x = 0; x < tty->cols; x++) tty_draw_cell(x, row, cells[x], attrs[x]);
         return;
     }
     if (tty->type != TTY_VGA) return;
-    color = vga_color_get();
     vga_mem = (volatile uint16_t*)(uintptr_t)VGA_MEMORY_ADDRESS;
     for (uint32_t x = 0; x < tty->cols; x++) {
-        char c = tty->cells[row * tty->cols + x];
-        vga_mem[row * VGA_WIDTH + x] = (uint16_t)((color << 8) | (uint8_t)c);
+        vga_mem[row * VGA_WIDTH + x] = (uint16_t)((tty_attr_vga(attrs[x]) << 8) | (uint8_t)cells[x]);
     }
 }
 
 static void tty_scroll(tty_device_t *tty) {
     if (!tty || !tty->cells || tty->rows == 0) return;
     if (tty->type != TTY_VESA && tty->type != TTY_VGA) return;
-    size_t line_sz = tty->cols;
-    size_t total = tty->rows * tty->cols;
-    memmove(tty->cells, tty->cells + line_sz, total - line_sz);
-    memset(tty->cells + total - line_sz, ' ', line_sz);
+    tty->head = (tty->head + 1) % tty->ring_rows;
+    if (tty->history_lines < tty->ring_rows - tty->rows) tty->history_lines++;
+    memset(tty_row(tty, tty->rows - 1), ' ', tty->cols);
+    memset(tty_row_attrs(tty, tty->rows - 1), TTY_ATTR_DEFAULT, tty->cols);
+    tty->stat_scrolled++;
+
+    if (tty->deferred) {
+        if (tty->pending_scroll < tty->rows) tty->pending_scroll++;
+        if (tty->dirty_lo <= tty->dirty_hi) {
+            if (tty->dirty_lo > 0) tty->dirty_lo--;
+            if (tty->dirty_hi == 0) {
+                tty->dirty_lo = 1;
+                tty->dirty_hi = 0;
+            } else {
+                tty->dirty_hi--;
+            }
+        }
+        tty_mark_row(tty, tty->rows - 1);
+        return;
+    }
     if (tty->index != g_active_tty) return;
 
     if (tty->type == TTY_VESA) {
+        tty->stat_blits++;
         vesa_scroll(0, -(int32_t)g_char_h, g_bg);
         tty_redraw_row(tty, tty->rows - 1);
         return;
@@ -496,6 +711,7 @@ static void tty_scroll(tty_device_t *tty) {
 
 static void tty_putc_vesa(tty_device_t *tty, char c) {
     if (!tty || tty->type != TTY_VESA || !tty->cells) return;
+    tty_view_reset(tty);
     if (tty_consume_ansi(tty, c)) return;
 
     if (c == '\r') {
@@ -513,13 +729,15 @@ static void tty_putc_vesa(tty_device_t *tty, char c) {
     }
     if (c == '\b') {
         tty_cursor_left_raw(tty);
-        tty->cells[tty->cursor_y * tty->cols + tty->cursor_x] = ' ';
-        if (tty->index == g_active_tty) tty_draw_cell(tty->cursor_x, tty->cursor_y, ' ');
+        tty_row(tty, tty->cursor_y)[tty->cursor_x] = ' ';
+        tty_row_attrs(tty, tty->cursor_y)[tty->cursor_x] = tty->attr;
+        tty_update_cell(tty, tty->cursor_x, tty->cursor_y, ' ', tty->attr);
         return;
     }
 
-    tty->cells[tty->cursor_y * tty->cols + tty->cursor_x] = c;
-    if (tty->index == g_active_tty) tty_draw_cell(tty->cursor_x, tty->cursor_y, c);
+    tty_row(tty, tty->cursor_y)[tty->cursor_x] = c;
+    tty_row_attrs(tty, tty->cursor_y)[tty->cursor_x] = tty->attr;
+    tty_update_cell(tty, tty->cursor_x, tty->cursor_y, c, tty->attr);
 
     tty->cursor_x++;
     if (tty->cursor_x >= tty->cols) {
@@ -537,6 +755,7 @@ static void tty_putc_vga(tty_device_t *tty, char c) {
     uint8_t color;
     if (!tty || tty->type != TTY_VGA || !tty->cells) return;
     if (tty->cols == 0 || tty->rows == 0) return;
+    tty_view_reset(tty);
     if (tty_consume_ansi(tty, c)) return;
 
     if (c == '\r') {
@@ -556,9 +775,10 @@ static void tty_putc_vga(tty_device_t *tty, char c) {
     }
     if (c == '\b') {
         tty_cursor_left_raw(tty);
-        tty->cells[tty->cursor_y * tty->cols + tty->cursor_x] = ' ';
+        tty_row(tty, tty->cursor_y)[tty->cursor_x] = ' ';
+        tty_row_attrs(tty, tty->cursor_y)[tty->cursor_x] = tty->attr;
         if (tty->index == g_active_tty) {
-            color = vga_color_get();
+            color = tty_attr_vga(tty->attr);
             vga_mem = (volatile uint16_t*)(uintptr_t)VGA_MEMORY_ADDRESS;
             vga_mem[tty->cursor_y * VGA_WIDTH + tty->cursor_x] = (uint16_t)((color << 8) | ' ');
             vga_cursor_set(tty->cursor_x, tty->cursor_y);
@@ -566,9 +786,10 @@ static void tty_putc_vga(tty_device_t *tty, char c) {
         return;
     }
 
-    tty->cells[tty->cursor_y * tty->cols + tty->cursor_x] = c;
+    tty_row(tty, tty->cursor_y)[tty->cursor_x] = c;
+    tty_row_attrs(tty, tty->cursor_y)[tty->cursor_x] = tty->attr;
     if (tty->index == g_active_tty) {
-        color = vga_color_get();
+        color = tty_attr_vga(tty->attr);
         vga_mem = (volatile uint16_t*)(uintptr_t)VGA_MEMORY_ADDRESS;
         vga_mem[tty->cursor_y * VGA_WIDTH + tty->cursor_x] = (uint16_t)((color << 8) | (uint8_t)c);
     }
@@ -602,8 +823,8 @@ static ssize_t tty_vesa_read(void *ctx, void *buf, size_t size) {
 
     if (size == 1) {
         while (1) {
-            while (tty->index != g_active_tty) tty_spin_wait();
-            while (!keyboard_event_available() && !keyboard_available()) tty_spin_wait();
+            tty_wait_active(tty);
+            keyboard_wait();
             if (tty->index != g_active_tty) continue;
 
             if (!keyboard_event_available() && keyboard_available()) {
@@ -649,12 +870,8 @@ static ssize_t tty_vesa_read(void *ctx, void *buf, size_t size) {
     tty_input_cursor(tty, 1);
 
     while (n < (size - 1)) {
-        while (tty->index != g_active_tty) {
-            tty_spin_wait();
-        }
-        while (!keyboard_event_available() && !keyboard_available()) {
-            tty_spin_wait();
-        }
+        tty_wait_active(tty);
+        keyboard_wait();
 
         if (tty->index != g_active_tty) continue;
         if (!keyboard_event_available() && keyboard_available()) {
@@ -860,7 +1077,15 @@ static ssize_t tty_vesa_write(void *ctx, const void *buf, size_t size) {
     tty_device_t *tty = (tty_device_t*)ctx;
     const char *s = (const char*)buf;
     if (!tty || !buf) return -1;
+    tty->stat_bytes += (uint32_t)size;
+    tty->stat_writes++;
+    if (size == 1) {
+        tty_putc_vesa(tty, s[0]);
+        return 1;
+    }
+    tty_begin_deferred(tty);
     for (size_t i = 0; i < size; i++) tty_putc_vesa(tty, s[i]);
+    tty_end_deferred(tty);
     return (ssize_t)size;
 }
 
@@ -876,8 +1101,8 @@ static ssize_t tty_vga_read(void *ctx, void *buf, size_t size) {
 
     if (size == 1) {
         while (1) {
-            while (tty->index != g_active_tty) tty_spin_wait();
-            while (!keyboard_event_available() && !keyboard_available()) tty_spin_wait();
+            tty_wait_active(tty);
+            keyboard_wait();
             if (tty->index != g_active_tty) continue;
 
             if (!keyboard_event_available() && keyboard_available()) {
@@ -919,12 +1144,8 @@ static ssize_t tty_vga_read(void *ctx, void *buf, size_t size) {
     }
 
     while (n < (size - 1)) {
-        while (tty->index != g_active_tty) {
-            tty_spin_wait();
-        }
-        while (!keyboard_event_available() && !keyboard_available()) {
-            tty_spin_wait();
-        }
+        tty_wait_active(tty);
+        keyboard_wait();
         if (tty->index != g_active_tty) continue;
 
         if (!keyboard_event_available() && keyboard_available()) {
@@ -1005,6 +1226,8 @@ static ssize_t tty_vga_write(void *ctx, const void *buf, size_t size) {
     const char *s = (const char*)buf;
     if (!tty || !buf) return -1;
     if (tty->type != TTY_VGA) return -1;
+    tty->stat_bytes += (uint32_t)size;
+    tty->stat_writes++;
     for (size_t i = 0; i < size; i++) tty_putc_vga(tty, s[i]);
     return (ssize_t)size;
 }
@@ -1024,6 +1247,18 @@ static int tty_vesa_ioctl(void *ctx, uint32_t request, void *arg) {
         out->cursor_y = tty->cursor_y;
         return 0;
     }
+    if (request == DEV_IOCTL_TTY_GET_STATS) {
+        dev_tty_stats_t *out = (dev_tty_stats_t*)arg;
+        if (!out) return -1;
+        out->bytes = tty->stat_bytes;
+        out->writes = tty->stat_writes;
+        out->frames = tty->stat_frames;
+        out->scrolled_lines = tty->stat_scrolled;
+        out->scroll_blits = tty->stat_blits;
+        out->ticks = timer_get_ticks() - tty->stat_start;
+        out->hz = 100;
+        return 0;
+    }
 
     if (request == DEV_IOCTL_TTY_SET_ACTIVE) {
         if (!arg) return -1;
@@ -1341,6 +1576,24 @@ void tty_klog(const char *text) {
     }
 }
 
+static void tty_alloc_grid(tty_device_t *tty) {
+    uint32_t ring = tty->rows + CONFIG_TTY_SCROLLBACK_LINES;
+    tty->cells = (char*)valloc(tty->cols * ring * 2u);
+    if (!tty->cells) {
+        ring = tty->rows;
+        tty->cells = (char*)valloc(tty->cols * ring * 2u);
+        if (!tty->cells) return;
+    }
+    tty->attrs = (uint8_t*)(tty->cells + tty->cols * ring);
+    tty->ring_rows = ring;
+    tty->head = 0;
+    tty->history_lines = 0;
+    tty->view = 0;
+    tty->attr = TTY_ATTR_DEFAULT;
+    memset(tty->cells, ' ', tty->cols * ring);
+    memset(tty->attrs, TTY_ATTR_DEFAULT, tty->cols * ring);
+}
+
 void tty_init(memfs *root_fs, devfs_t *devfs) {
     if (!root_fs || !devfs) return;
     serial_write(SERIAL_COM1, "tty_init: enter\n");
@@ -1388,13 +1641,13 @@ void tty_init(memfs *root_fs, devfs_t *devfs) {
             g_tty_v[i].cursor_y = 0;
             g_tty_v[i].cols = cols;
             g_tty_v[i].rows = rows;
-            g_tty_v[i].cells = (char*)valloc(cols * rows);
-            if (g_tty_v[i].cells) memset(g_tty_v[i].cells, ' ', cols * rows);
+            tty_alloc_grid(&g_tty_v[i]);
             g_tty_v[i].history = (char*)kmalloc(TTY_HISTORY_MAX * TTY_HISTORY_LINE_MAX);
             if (g_tty_v[i].history) memset(g_tty_v[i].history, 0, TTY_HISTORY_MAX * TTY_HISTORY_LINE_MAX);
             g_tty_v[i].history_count = 0;
             g_tty_v[i].history_next = 0;
             g_tty_v[i].fg_pid = -1;
+            g_tty_v[i].stat_start = timer_get_ticks();
 
             strcpy(path, "/tty/");
             path[5] = (char)('1' + i);
@@ -1421,12 +1674,12 @@ void tty_init(memfs *root_fs, devfs_t *devfs) {
             g_tty_v[i].cursor_y = 0;
             g_tty_v[i].cols = cols;
             g_tty_v[i].rows = rows;
-            g_tty_v[i].cells = (char*)valloc(cols * rows);
-            if (g_tty_v[i].cells) memset(g_tty_v[i].cells, ' ', cols * rows);
+            tty_alloc_grid(&g_tty_v[i]);
             g_tty_v[i].history = NULL;
             g_tty_v[i].history_count = 0;
             g_tty_v[i].history_next = 0;
             g_tty_v[i].fg_pid = -1;
+            g_tty_v[i].stat_start = timer_get_ticks();
 
             strcpy(path, "/tty/");
             path[5] = (char)('1' + i);
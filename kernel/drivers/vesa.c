@@ -1,17 +1,53 @@
 #include <drivers/vesa.h>
+#include <asm/mm.h>
 #include <string.h>
 #include <stddef.h>
 
 static vesa_info_t* vesa_info = (vesa_info_t*)VESA_INFO_ADDR;
 static vesa_mode_info_t* mode_info = (vesa_mode_info_t*)MODE_INFO_ADDR;
 static uint8_t* framebuffer = NULL;
+static uint8_t* backbuf = NULL;
 static bool initialized = false;
 static uint32_t bytes_per_pixel = 0;
+static uint32_t native_mask = 0;
 #ifndef CONFIG_VESA_ROTATION
 #define CONFIG_VESA_ROTATION 0
 #endif
+#ifndef CONFIG_VESA_SHADOW_FB
+#define CONFIG_VESA_SHADOW_FB 0
+#endif
 static uint32_t rotation_deg = 0;
 
+#if CONFIG_VESA_SHADOW_FB
+static uint8_t* shadow = NULL;
+static uint16_t* dirty_x0 = NULL;
+static uint16_t* dirty_x1 = NULL;
+static uint32_t dirty_y0 = 0;
+static uint32_t dirty_y1 = 0;
+#endif
+
+static uint32_t cursor_image[VESA_CURSOR_MAX * VESA_CURSOR_MAX];
+static uint32_t cursor_under[VESA_CURSOR_MAX * VESA_CURSOR_MAX];
+static uint32_t cursor_w = 0;
+static uint32_t cursor_h = 0;
+static uint32_t cursor_hot_x = 0;
+static uint32_t cursor_hot_y = 0;
+static int32_t cursor_x = 0;
+static int32_t cursor_y = 0;
+static bool cursor_enabled = false;
+static bool cursor_drawn = false;
+static uint32_t cursor_px0 = 0;
+static uint32_t cursor_py0 = 0;
+static uint32_t cursor_px1 = 0;
+static uint32_t cursor_py1 = 0;
+
+static void vesa_cursor_draw(void);
+static void vesa_cursor_erase(void);
+static bool vesa_cursor_overlaps(uint32_t px, uint32_t py, uint32_t w, uint32_t h);
+static void vesa_cursor_damage(uint32_t px, uint32_t py, uint32_t w, uint32_t h);
+static bool vesa_cursor_lift(uint32_t px, uint32_t py, uint32_t w, uint32_t h, uint32_t* flags);
+static void vesa_cursor_replace(uint32_t flags);
+
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define ABS(x) ((x) < 0 ? -(x) : (x))
@@ -76,11 +112,128 @@ bool vesa_init(void) {
     min_pitch = (uint32_t)mode_info->width * bytes_per_pixel;
     if (mode_info->pitch < min_pitch) return false;
 
+    native_mask = 0;
+    if (bytes_per_pixel == 4 &&
+        mode_info->red_mask == 8u && mode_info->red_position == 16u &&
+        mode_info->green_mask == 8u && mode_info->green_position == 8u &&
+        mode_info->blue_mask == 8u && mode_info->blue_position == 0u) {
+        if (mode_info->reserved_mask == 0u) native_mask = 0x00FFFFFFu;
+        else if (mode_info->reserved_mask == 8u && mode_info->reserved_position == 24u) native_mask = 0xFFFFFFFFu;
+    }
+
     framebuffer = (uint8_t*)(uintptr_t)mode_info->framebuffer;
+    backbuf = framebuffer;
     initialized = true;
     return true;
 }
 
+static inline uint32_t vesa_irq_save(void) {
+    uint32_t flags;
+    __asm__ __volatile__("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void vesa_irq_restore(uint32_t flags) {
+    if (flags & (1u << 9)) __asm__ __volatile__("sti" ::: "memory");
+}
+
+bool vesa_enable_shadow(void) {
+#if CONFIG_VESA_SHADOW_FB
+    uint32_t size;
+    uint32_t flags;
+    if (!initialized) return false;
+    if (shadow) return true;
+    size = (uint32_t)mode_info->pitch * mode_info->height;
+    if (size > get_free_heap() / 2u) return false;
+    shadow = (uint8_t*)kmalloc(size);
+    dirty_x0 = (uint16_t*)kcalloc(mode_info->height, sizeof(uint16_t));
+    dirty_x1 = (uint16_t*)kcalloc(mode_info->height, sizeof(uint16_t));
+    if (!shadow || !dirty_x0 || !dirty_x1) {
+        if (shadow) kfree(shadow);
+        if (dirty_x0) kfree(dirty_x0);
+        if (dirty_x1) kfree(dirty_x1);
+        shadow = NULL;
+        dirty_x0 = NULL;
+        dirty_x1 = NULL;
+        return false;
+    }
+    flags = vesa_irq_save();
+    vesa_cursor_erase();
+    memcpy(shadow, framebuffer, size);
+    dirty_y0 = 0;
+    dirty_y1 = 0;
+    backbuf = shadow;
+    vesa_cursor_draw();
+    vesa_irq_restore(flags);
+    return true;
+#else
+    return false;
+#endif
+}
+
+static void vesa_mark_phys(uint32_t px, uint32_t py, uint32_t w, uint32_t h) {
+#if CONFIG_VESA_SHADOW_FB
+    uint32_t flags;
+    uint32_t x_end;
+    uint32_t y_end;
+    if (w == 0 || h == 0) return;
+    if (!shadow) {
+        vesa_cursor_damage(px, py, w, h);
+        return;
+    }
+    if (px >= mode_info->width || py >= mode_info->height) return;
+    x_end = MIN(px + w, (uint32_t)mode_info->width);
+    y_end = MIN(py + h, (uint32_t)mode_info->height);
+    flags = vesa_irq_save();
+    if (dirty_y1 <= dirty_y0) {
+        dirty_y0 = py;
+        dirty_y1 = y_end;
+    } else {
+        if (py < dirty_y0) dirty_y0 = py;
+        if (y_end > dirty_y1) dirty_y1 = y_end;
+    }
+    for (uint32_t y = py; y < y_end; y++) {
+        if (dirty_x1[y] <= dirty_x0[y]) {
+            dirty_x0[y] = (uint16_t)px;
+            dirty_x1[y] = (uint16_t)x_end;
+        } else {
+            if (px < dirty_x0[y]) dirty_x0[y] = (uint16_t)px;
+            if (x_end > dirty_x1[y]) dirty_x1[y] = (uint16_t)x_end;
+        }
+    }
+    vesa_irq_restore(flags);
+#else
+    vesa_cursor_damage(px, py, w, h);
+#endif
+}
+
+void vesa_flush(void) {
+#if CONFIG_VESA_SHADOW_FB
+    uint32_t flags;
+    bool cursor_hit = false;
+    if (!shadow) return;
+    flags = vesa_irq_save();
+    if (cursor_drawn && dirty_y1 > dirty_y0) {
+        for (uint32_t y = MAX(dirty_y0, cursor_py0); y < MIN(dirty_y1, cursor_py1) && !cursor_hit; y++) {
+            if (dirty_x1[y] > dirty_x0[y]) cursor_hit = vesa_cursor_overlaps(dirty_x0[y], y, dirty_x1[y] - dirty_x0[y], 1);
+        }
+    }
+    if (cursor_hit) vesa_cursor_erase();
+    for (uint32_t y = dirty_y0; y < dirty_y1; y++) {
+        if (dirty_x1[y] > dirty_x0[y]) {
+            uint32_t off = y * mode_info->pitch + (uint32_t)dirty_x0[y] * bytes_per_pixel;
+            memcpy(framebuffer + off, shadow + off, (uint32_t)(dirty_x1[y] - dirty_x0[y]) * bytes_per_pixel);
+            dirty_x0[y] = 0;
+            dirty_x1[y] = 0;
+        }
+    }
+    dirty_y0 = 0;
+    dirty_y1 = 0;
+    if (cursor_hit) vesa_cursor_draw();
+    vesa_irq_restore(flags);
+#endif
+}
+
 bool vesa_is_initialized(void) {
     return initialized && framebuffer != NULL;
 }
@@ -128,10 +281,167 @@ static void vesa_map_xy(uint32_t x, uint32_t y, uint32_t *px, uint32_t *py) {
     }
 }
 
+static void vesa_phys_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h,
+                           uint32_t *px, uint32_t *py, uint32_t *pw, uint32_t *ph) {
+    uint32_t ax;
+    uint32_t ay;
+    uint32_t bx;
+    uint32_t by;
+    vesa_map_xy(x, y, &ax, &ay);
+    vesa_map_xy(x + w - 1u, y + h - 1u, &bx, &by);
+    *px = MIN(ax, bx);
+    *py = MIN(ay, by);
+    *pw = ABS((int32_t)bx - (int32_t)ax) + 1u;
+    *ph = ABS((int32_t)by - (int32_t)ay) + 1u;
+}
+
+static void vesa_mark_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+    uint32_t px;
+    uint32_t py;
+    uint32_t pw;
+    uint32_t ph;
+    if (w == 0 || h == 0) return;
+    vesa_phys_rect(x, y, w, h, &px, &py, &pw, &ph);
+    vesa_mark_phys(px, py, pw, ph);
+}
+
+static void vesa_steps(int32_t *step_x, int32_t *step_y) {
+    int32_t bpp = (int32_t)bytes_per_pixel;
+    int32_t pitch = (int32_t)mode_info->pitch;
+    switch (rotation_deg) {
+        case 90u:
+            *step_x = -pitch;
+            *step_y = bpp;
+            break;
+        case 180u:
+            *step_x = -bpp;
+            *step_y = -pitch;
+            break;
+        case 270u:
+            *step_x = pitch;
+            *step_y = -bpp;
+            break;
+        default:
+            *step_x = bpp;
+            *step_y = pitch;
+            break;
+    }
+}
+
+static inline void vesa_store_packed(uint8_t* pixel, uint32_t packed) {
+    switch (bytes_per_pixel) {
+        case 1:
+            pixel[0] = (uint8_t)packed;
+            break;
+        case 2:
+            *(uint16_t*)pixel = (uint16_t)packed;
+            break;
+        case 3:
+            pixel[0] = (uint8_t)(packed & 0xFFu);
+            pixel[1] = (uint8_t)((packed >> 8) & 0xFFu);
+            pixel[2] = (uint8_t)((packed >> 16) & 0xFFu);
+            break;
+        case 4:
+            *(uint32_t*)pixel = packed;
+            break;
+    }
+}
+
+static inline uint32_t vesa_load_packed(const uint8_t* pixel) {
+    switch (bytes_per_pixel) {
+        case 1: return pixel[0];
+        case 2: return *(const uint16_t*)pixel;
+        case 3: return (uint32_t)pixel[0] | ((uint32_t)pixel[1] << 8) | ((uint32_t)pixel[2] << 16);
+        case 4: return *(const uint32_t*)pixel;
+        default: return 0;
+    }
+}
+
+static inline void vesa_copy_pixel(uint8_t* dst, const uint8_t* src) {
+    switch (bytes_per_pixel) {
+        case 1:
+            dst[0] = src[0];
+            break;
+        case 2:
+            *(uint16_t*)dst = *(const uint16_t*)src;
+            break;
+        case 3:
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            break;
+        case 4:
+            *(uint32_t*)dst = *(const uint32_t*)src;
+            break;
+    }
+}
+
+static void vesa_fill_span(uint8_t* dst, uint32_t packed, uint32_t n) {
+    switch (bytes_per_pixel) {
+        case 1:
+            memset(dst, (int)(packed & 0xFFu), n);
+            break;
+        case 2: {
+            uint32_t pair = (packed & 0xFFFFu) | (packed << 16);
+            uint32_t* q;
+            if (n > 0 && ((uintptr_t)dst & 2u)) {
+                *(uint16_t*)dst = (uint16_t)packed;
+                dst += 2;
+                n--;
+            }
+            q = (uint32_t*)dst;
+            for (; n >= 2; n -= 2) *q++ = pair;
+            if (n) *(uint16_t*)q = (uint16_t)packed;
+            break;
+        }
+        case 3: {
+            uint32_t w0 = (packed & 0xFFFFFFu) | (packed << 24);
+            uint32_t w1 = ((packed >> 8) & 0xFFFFu) | (packed << 16);
+            uint32_t w2 = ((packed >> 16) & 0xFFu) | (packed << 8);
+            for (; n >= 4; n -= 4) {
+                ((uint32_t*)dst)[0] = w0;
+                ((uint32_t*)dst)[1] = w1;
+                ((uint32_t*)dst)[2] = w2;
+                dst += 12;
+            }
+            for (; n > 0; n--) {
+                dst[0] = (uint8_t)(packed & 0xFFu);
+                dst[1] = (uint8_t)((packed >> 8) & 0xFFu);
+                dst[2] = (uint8_t)((packed >> 16) & 0xFFu);
+                dst += 3;
+            }
+            break;
+        }
+        case 4: {
+            uint32_t* q = (uint32_t*)dst;
+            for (uint32_t i = 0; i < n; i++) q[i] = packed;
+            break;
+        }
+    }
+}
+
+static inline uint32_t vesa_color_to_packed(uint32_t color) {
+    return vesa_pack_color((uint8_t)((color >> 16) & 0xFFu), (uint8_t)((color >> 8) & 0xFFu),
+                           (uint8_t)(color & 0xFFu), (uint8_t)((color >> 24) & 0xFFu));
+}
+
+static inline uint32_t vesa_packed_to_color(uint32_t packed) {
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+    uint8_t a = 0;
+    vesa_unpack_color(packed, &r, &g, &b, &a);
+    return ((uint32_t)a << 24) | ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
+}
+
 bool vesa_set_rotation(uint32_t degrees) {
 #if CONFIG_VESA_ROTATION
     if (degrees == 0u || degrees == 90u || degrees == 180u || degrees == 270u) {
+        uint32_t flags = vesa_irq_save();
+        vesa_cursor_erase();
         rotation_deg = degrees;
+        vesa_cursor_draw();
+        vesa_irq_restore(flags);
         return true;
     }
     return false;
@@ -155,138 +465,159 @@ uint32_t vesa_calculate_pixel_offset(uint32_t x, uint32_t y) {
 void vesa_put_pixel(uint32_t x, uint32_t y, uint32_t color) {
     uint32_t px;
     uint32_t py;
-    uint32_t packed;
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-    uint8_t a;
     if (!vesa_is_initialized() || x >= vesa_logical_width() || y >= vesa_logical_height()) return;
     vesa_map_xy(x, y, &px, &py);
-    
-    uint32_t offset = py * mode_info->pitch + px * bytes_per_pixel;
-    uint8_t* pixel = framebuffer + offset;
-    r = (uint8_t)((color >> 16) & 0xFFu);
-    g = (uint8_t)((color >> 8) & 0xFFu);
-    b = (uint8_t)(color & 0xFFu);
-    a = (uint8_t)((color >> 24) & 0xFFu);
-    packed = vesa_pack_color(r, g, b, a);
-    
-    switch (bytes_per_pixel) {
-        case 1:
-            pixel[0] = (uint8_t)packed;
-            break;
-        case 2:
-            *(uint16_t*)pixel = (uint16_t)packed;
-            break;
-        case 3:
-            pixel[0] = (uint8_t)(packed & 0xFFu);
-            pixel[1] = (uint8_t)((packed >> 8) & 0xFFu);
-            pixel[2] = (uint8_t)((packed >> 16) & 0xFFu);
-            break;
-        case 4:
-            *(uint32_t*)pixel = packed;
-            break;
-    }
+    vesa_store_packed(backbuf + py * mode_info->pitch + px * bytes_per_pixel, vesa_color_to_packed(color));
+    vesa_mark_phys(px, py, 1, 1);
 }
 
 uint32_t vesa_get_pixel(uint32_t x, uint32_t y) {
     uint32_t px;
     uint32_t py;
-    uint32_t packed = 0;
-    uint8_t r = 0;
-    uint8_t g = 0;
-    uint8_t b = 0;
-    uint8_t a = 0;
+    uint32_t flags;
+    uint32_t color;
+    bool lifted;
     if (!vesa_is_initialized() || x >= vesa_logical_width() || y >= vesa_logical_height()) return 0;
     vesa_map_xy(x, y, &px, &py);
-    
-    uint32_t offset = py * mode_info->pitch + px * bytes_per_pixel;
-    uint8_t* pixel = framebuffer + offset;
-    
-    switch (bytes_per_pixel) {
-        case 1:
-            packed = pixel[0];
-            break;
-        case 2:
-            packed = *(uint16_t*)pixel;
-            break;
-        case 3:
-            packed = (uint32_t)pixel[0] | ((uint32_t)pixel[1] << 8) | ((uint32_t)pixel[2] << 16);
-            break;
-        case 4:
-            packed = *(uint32_t*)pixel;
-            break;
-        default: return 0;
+    lifted = vesa_cursor_lift(px, py, 1, 1, &flags);
+    color = vesa_packed_to_color(vesa_load_packed(backbuf + py * mode_info->pitch + px * bytes_per_pixel));
+    if (lifted) vesa_cursor_replace(flags);
+    return color;
+}
+
+uint32_t vesa_read_row(uint32_t x, uint32_t y, uint32_t* colors, uint32_t count) {
+    uint32_t lw;
+    uint32_t px;
+    uint32_t py;
+    uint32_t pw;
+    uint32_t ph;
+    uint32_t flags;
+    bool lifted;
+    const uint8_t* src;
+    if (!vesa_is_initialized() || !colors || count == 0) return 0;
+    lw = vesa_logical_width();
+    if (x >= lw || y >= vesa_logical_height()) return 0;
+    count = MIN(count, lw - x);
+    vesa_phys_rect(x, y, count, 1, &px, &py, &pw, &ph);
+    lifted = vesa_cursor_lift(px, py, pw, ph, &flags);
+    src = backbuf + vesa_calculate_pixel_offset(x, y);
+    if (rotation_deg == 0u && native_mask) {
+        const uint32_t* q = (const uint32_t*)src;
+        for (uint32_t i = 0; i < count; i++) colors[i] = q[i] & native_mask;
+    } else {
+        int32_t step_x;
+        int32_t step_y;
+        vesa_steps(&step_x, &step_y);
+        for (uint32_t i = 0; i < count; i++) {
+            colors[i] = vesa_packed_to_color(vesa_load_packed(src));
+            src += step_x;
+        }
     }
-    vesa_unpack_color(packed, &r, &g, &b, &a);
-    return ((uint32_t)a << 24) | ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
+    if (lifted) vesa_cursor_replace(flags);
+    return count;
 }
 
-void vesa_clear(uint32_t color) {
-    uint32_t packed;
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-    uint8_t a;
-    if (!vesa_is_initialized()) return;
-    r = (uint8_t)((color >> 16) & 0xFFu);
-    g = (uint8_t)((color >> 8) & 0xFFu);
-    b = (uint8_t)(color & 0xFFu);
-    a = (uint8_t)((color >> 24) & 0xFFu);
-    packed = vesa_pack_color(r, g, b, a);
-    
-    uint32_t screen_size = mode_info->pitch * mode_info->height;
-    if (rotation_deg == 0u && bytes_per_pixel == 4) {
-        uint32_t* fb = (uint32_t*)framebuffer;
-        uint32_t count = screen_size / 4;
-        
-        for (uint32_t i = 0; i < count; i++) fb[i] = packed;
+uint32_t vesa_write_row(uint32_t x, uint32_t y, const uint32_t* colors, uint32_t count) {
+    uint32_t lw;
+    uint8_t* dst;
+    if (!vesa_is_initialized() || !colors || count == 0) return 0;
+    lw = vesa_logical_width();
+    if (x >= lw || y >= vesa_logical_height()) return 0;
+    count = MIN(count, lw - x);
+    dst = backbuf + vesa_calculate_pixel_offset(x, y);
+    if (rotation_deg == 0u && native_mask) {
+        uint32_t* q = (uint32_t*)dst;
+        for (uint32_t i = 0; i < count; i++) q[i] = colors[i] & native_mask;
     } else {
-        for (uint32_t y = 0; y < vesa_logical_height(); y++) {
-            for (uint32_t x = 0; x < vesa_logical_width(); x++) {
-                vesa_put_pixel(x, y, color);
-            }
+        int32_t step_x;
+        int32_t step_y;
+        vesa_steps(&step_x, &step_y);
+        for (uint32_t i = 0; i < count; i++) {
+            vesa_store_packed(dst, vesa_color_to_packed(colors[i]));
+            dst += step_x;
         }
     }
+    vesa_mark_rect(x, y, count, 1);
+    return count;
+}
+
+void vesa_clear(uint32_t color) {
+    if (!vesa_is_initialized()) return;
+    vesa_fill_rect(0, 0, vesa_logical_width(), vesa_logical_height(), color);
 }
 
 void vesa_fill_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t color) {
     uint32_t lw;
     uint32_t lh;
-    uint32_t x_end;
-    uint32_t y_end;
+    uint32_t px;
+    uint32_t py;
+    uint32_t pw;
+    uint32_t ph;
     uint32_t packed;
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-    uint8_t a;
-    if (!vesa_is_initialized()) return;
-    r = (uint8_t)((color >> 16) & 0xFFu);
-    g = (uint8_t)((color >> 8) & 0xFFu);
-    b = (uint8_t)(color & 0xFFu);
-    a = (uint8_t)((color >> 24) & 0xFFu);
-    packed = vesa_pack_color(r, g, b, a);
+    uint8_t* line;
+    if (!vesa_is_initialized() || w == 0 || h == 0) return;
     lw = vesa_logical_width();
     lh = vesa_logical_height();
-    x_end = MIN(x + w, lw);
-    y_end = MIN(y + h, lh);
     if (x >= lw || y >= lh) return;
-    if (rotation_deg == 0u && bytes_per_pixel == 4) {
-        for (uint32_t cy = y; cy < y_end; cy++) {
-            uint32_t* line = (uint32_t*)(framebuffer + vesa_calculate_pixel_offset(x, cy));
-            uint32_t width = x_end - x;
-            
-            for (uint32_t cx = 0; cx < width; cx++) {
-                line[cx] = packed;
+    w = MIN(w, lw - x);
+    h = MIN(h, lh - y);
+    packed = vesa_color_to_packed(color);
+    vesa_phys_rect(x, y, w, h, &px, &py, &pw, &ph);
+    line = backbuf + py * mode_info->pitch + px * bytes_per_pixel;
+    for (uint32_t row = 0; row < ph; row++) {
+        vesa_fill_span(line, packed, pw);
+        line += mode_info->pitch;
+    }
+    vesa_mark_phys(px, py, pw, ph);
+}
+
+uint32_t vesa_get_bytes_per_pixel(void) {
+    return initialized ? bytes_per_pixel : 0;
+}
+
+void vesa_blit_glyphs(uint32_t x, uint32_t y, uint32_t w, uint32_t h, const uint8_t* const* masks, uint32_t count, uint32_t fg, uint32_t bg) {
+    uint32_t lw;
+    uint32_t lh;
+    uint32_t pbg;
+    uint32_t diff;
+    if (!vesa_is_initialized() || !masks || w == 0 || h == 0) return;
+    lw = vesa_logical_width();
+    lh = vesa_logical_height();
+    if (x >= lw || y >= lh) return;
+    if (count > (lw - x) / w) count = (lw - x) / w;
+    if (h > lh - y) h = lh - y;
+    if (count == 0) return;
+    pbg = vesa_color_to_packed(bg);
+    diff = vesa_color_to_packed(fg) ^ pbg;
+    /* Coverage bytes are 0x00 or 0xFF, so sign-extending one selects fg or bg without a branch. */
+    if (rotation_deg == 0u && bytes_per_pixel == 4u) {
+        for (uint32_t r = 0; r < h; r++) {
+            uint32_t* dst = (uint32_t*)(backbuf + vesa_calculate_pixel_offset(x, y + r));
+            uint32_t src_off = r * w;
+            for (uint32_t i = 0; i < count; i++) {
+                const uint8_t* m = masks[i] + src_off;
+                for (uint32_t c = 0; c < w; c++) dst[c] = pbg ^ (diff & (uint32_t)(int32_t)(int8_t)m[c]);
+                dst += w;
             }
         }
     } else {
-        for (uint32_t cy = y; cy < y_end; cy++) {
-            for (uint32_t cx = x; cx < x_end; cx++) {
-                vesa_put_pixel(cx, cy, color);
+        int32_t step_x;
+        int32_t step_y;
+        vesa_steps(&step_x, &step_y);
+        for (uint32_t i = 0; i < count; i++) {
+            const uint8_t* m = masks[i];
+            uint8_t* base = backbuf + vesa_calculate_pixel_offset(x + i * w, y);
+            for (uint32_t r = 0; r < h; r++) {
+                uint8_t* dst = base;
+                for (uint32_t c = 0; c < w; c++) {
+                    vesa_store_packed(dst, pbg ^ (diff & (uint32_t)(int32_t)(int8_t)*m++));
+                    dst += step_x;
+                }
+                base += step_y;
             }
         }
     }
+    vesa_mark_rect(x, y, count * w, h);
 }
 
 void vesa_draw_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t color, uint32_t thickness) {
@@ -393,6 +724,16 @@ void vesa_copy_rect(uint32_t src_x, uint32_t src_y, uint32_t dst_x, uint32_t dst
     uint32_t lh;
     uint32_t copy_w;
     uint32_t copy_h;
+    uint32_t sx;
+    uint32_t sy;
+    uint32_t dx;
+    uint32_t dy;
+    uint32_t pw;
+    uint32_t ph;
+    uint32_t pitch;
+    uint32_t row_bytes;
+    uint32_t flags;
+    bool lifted;
     if (!vesa_is_initialized()) return;
     lw = vesa_logical_width();
     lh = vesa_logical_height();
@@ -400,70 +741,195 @@ void vesa_copy_rect(uint32_t src_x, uint32_t src_y, uint32_t dst_x, uint32_t dst
     copy_w = MIN(w, lw - MAX(src_x, dst_x));
     copy_h = MIN(h, lh - MAX(src_y, dst_y));
     if (copy_w == 0 || copy_h == 0) return;
-    if (rotation_deg == 0u) {
-        for (uint32_t y = 0; y < copy_h; y++) {
-            uint32_t src_offset = vesa_calculate_pixel_offset(src_x, src_y + y);
-            uint32_t dst_offset = vesa_calculate_pixel_offset(dst_x, dst_y + y);
-            memcpy(framebuffer + dst_offset, framebuffer + src_offset, copy_w * bytes_per_pixel);
+
+    vesa_phys_rect(src_x, src_y, copy_w, copy_h, &sx, &sy, &pw, &ph);
+    vesa_phys_rect(dst_x, dst_y, copy_w, copy_h, &dx, &dy, &pw, &ph);
+    pitch = mode_info->pitch;
+    row_bytes = pw * bytes_per_pixel;
+    lifted = vesa_cursor_lift(MIN(sx, dx), MIN(sy, dy), pw + MAX(sx, dx) - MIN(sx, dx), ph + MAX(sy, dy) - MIN(sy, dy), &flags);
+    if (dy > sy) {
+        for (uint32_t row = ph; row-- > 0;) {
+            memmove(backbuf + (dy + row) * pitch + dx * bytes_per_pixel,
+                    backbuf + (sy + row) * pitch + sx * bytes_per_pixel, row_bytes);
         }
     } else {
-        for (uint32_t y = 0; y < copy_h; y++) {
-            for (uint32_t x = 0; x < copy_w; x++) {
-                uint32_t c = vesa_get_pixel(src_x + x, src_y + y);
-                vesa_put_pixel(dst_x + x, dst_y + y, c);
-            }
+        for (uint32_t row = 0; row < ph; row++) {
+            memmove(backbuf + (dy + row) * pitch + dx * bytes_per_pixel,
+                    backbuf + (sy + row) * pitch + sx * bytes_per_pixel, row_bytes);
         }
     }
+    vesa_mark_phys(dx, dy, pw, ph);
+    if (lifted) vesa_cursor_replace(flags);
 }
 
 void vesa_scroll(int32_t dx, int32_t dy, uint32_t fill_color) {
     uint32_t lw;
     uint32_t lh;
+    uint32_t abs_dy;
     if (!vesa_is_initialized() || (dx == 0 && dy == 0)) return;
     lw = vesa_logical_width();
     lh = vesa_logical_height();
     
     if (dx == 0) {
-        uint32_t abs_dy = ABS(dy);
-        if ((uint32_t)abs_dy >= lh) {
+        abs_dy = ABS(dy);
+        if (abs_dy >= lh) {
             vesa_clear(fill_color);
             return;
         }
-        if (rotation_deg == 0u) {
-            if (dy > 0) {
-                for (uint32_t y = lh - 1; y >= (uint32_t)dy; y--) {
-                    memcpy(framebuffer + vesa_calculate_pixel_offset(0, y),
-                           framebuffer + vesa_calculate_pixel_offset(0, y - dy),
-                           lw * bytes_per_pixel);
-                }
-            } else {
-                for (uint32_t y = 0; y < lh - abs_dy; y++) {
-                    memcpy(framebuffer + vesa_calculate_pixel_offset(0, y),
-                           framebuffer + vesa_calculate_pixel_offset(0, y + abs_dy),
-                           lw * bytes_per_pixel);
-                }
-            }
-        } else {
-            if (dy > 0) {
-                for (uint32_t y = lh - 1; y >= (uint32_t)dy; y--) {
-                    for (uint32_t x = 0; x < lw; x++) {
-                        vesa_put_pixel(x, y, vesa_get_pixel(x, y - dy));
-                    }
-                }
-            } else {
-                for (uint32_t y = 0; y < lh - abs_dy; y++) {
-                    for (uint32_t x = 0; x < lw; x++) {
-                        vesa_put_pixel(x, y, vesa_get_pixel(x, y + abs_dy));
-                    }
-                }
-            }
-        }
+        if (dy > 0) vesa_copy_rect(0, 0, 0, abs_dy, lw, lh - abs_dy);
+        else vesa_copy_rect(0, abs_dy, 0, 0, lw, lh - abs_dy);
         
-        if (dy > 0) vesa_fill_rect(0, 0, lw, dy, fill_color);
+        if (dy > 0) vesa_fill_rect(0, 0, lw, abs_dy, fill_color);
         else vesa_fill_rect(0, lh - abs_dy, lw, abs_dy, fill_color);
     }
 }
 
+static uint8_t* vesa_cursor_pixel(uint32_t i, uint32_t j, uint32_t* px, uint32_t* py) {
+    int32_t lx = cursor_x - (int32_t)cursor_hot_x + (int32_t)i;
+    int32_t ly = cursor_y - (int32_t)cursor_hot_y + (int32_t)j;
+    if (lx < 0 || ly < 0 || (uint32_t)lx >= vesa_logical_width() || (uint32_t)ly >= vesa_logical_height()) return NULL;
+    vesa_map_xy((uint32_t)lx, (uint32_t)ly, px, py);
+    return framebuffer + *py * mode_info->pitch + *px * bytes_per_pixel;
+}
+
+static void vesa_cursor_plot(uint8_t* pixel, uint32_t idx) {
+    uint32_t src = cursor_image[idx];
+    uint32_t a = src >> 24;
+    uint32_t under = vesa_load_packed(pixel);
+    cursor_under[idx] = under;
+    if (a != 255u) {
+        uint32_t dst = vesa_packed_to_color(under);
+        uint32_t ia = 255u - a;
+        uint32_t r = (((src >> 16) & 0xFFu) * a + ((dst >> 16) & 0xFFu) * ia + 127u) / 255u;
+        uint32_t g = (((src >> 8) & 0xFFu) * a + ((dst >> 8) & 0xFFu) * ia + 127u) / 255u;
+        uint32_t b = ((src & 0xFFu) * a + (dst & 0xFFu) * ia + 127u) / 255u;
+        src = (r << 16) | (g << 8) | b;
+    }
+    vesa_store_packed(pixel, vesa_color_to_packed(src));
+}
+
+static void vesa_cursor_draw(void) {
+    uint32_t px;
+    uint32_t py;
+    if (!cursor_enabled || cursor_drawn || cursor_w == 0 || !vesa_is_initialized()) return;
+    cursor_px0 = cursor_py0 = 0xFFFFFFFFu;
+    cursor_px1 = cursor_py1 = 0;
+    for (uint32_t j = 0; j < cursor_h; j++) {
+        for (uint32_t i = 0; i < cursor_w; i++) {
+            uint32_t idx = j * cursor_w + i;
+            uint8_t* pixel;
+            if ((cursor_image[idx] >> 24) == 0u) continue;
+            pixel = vesa_cursor_pixel(i, j, &px, &py);
+            if (!pixel) continue;
+            vesa_cursor_plot(pixel, idx);
+            cursor_px0 = MIN(cursor_px0, px);
+            cursor_py0 = MIN(cursor_py0, py);
+            cursor_px1 = MAX(cursor_px1, px + 1u);
+            cursor_py1 = MAX(cursor_py1, py + 1u);
+        }
+    }
+    cursor_drawn = true;
+}
+
+static void vesa_cursor_erase(void) {
+    uint32_t px;
+    uint32_t py;
+    if (!cursor_drawn) return;
+    for (uint32_t j = 0; j < cursor_h; j++) {
+        for (uint32_t i = 0; i < cursor_w; i++) {
+            uint32_t idx = j * cursor_w + i;
+            uint8_t* pixel;
+            if ((cursor_image[idx] >> 24) == 0u) continue;
+            pixel = vesa_cursor_pixel(i, j, &px, &py);
+            if (pixel) vesa_store_packed(pixel, cursor_under[idx]);
+        }
+    }
+    cursor_drawn = false;
+}
+
+static bool vesa_cursor_overlaps(uint32_t px, uint32_t py, uint32_t w, uint32_t h) {
+    return cursor_drawn && px < cursor_px1 && px + w > cursor_px0 && py < cursor_py1 && py + h > cursor_py0;
+}
+
+/* Without a shadow buffer drawing lands straight in the visible framebuffer,
+   so pixels painted over the sprite become the new save-under and the
+   sprite is put back on top of them. */
+static void vesa_cursor_damage(uint32_t px, uint32_t py, uint32_t w, uint32_t h) {
+    uint32_t flags;
+    uint32_t cx;
+    uint32_t cy;
+    if (!vesa_cursor_overlaps(px, py, w, h)) return;
+    flags = vesa_irq_save();
+    for (uint32_t j = 0; j < cursor_h; j++) {
+        for (uint32_t i = 0; i < cursor_w; i++) {
+            uint32_t idx = j * cursor_w + i;
+            uint8_t* pixel;
+            if ((cursor_image[idx] >> 24) == 0u) continue;
+            pixel = vesa_cursor_pixel(i, j, &cx, &cy);
+            if (pixel && cx >= px && cx < px + w && cy >= py && cy < py + h) vesa_cursor_plot(pixel, idx);
+        }
+    }
+    vesa_irq_restore(flags);
+}
+
+/* Without a shadow buffer the sprite is composited into the pixels that
+   reads and copies see, so it is lifted off for the duration, the same
+   way vesa_flush does before copying the shadow out. */
+static bool vesa_cursor_lift(uint32_t px, uint32_t py, uint32_t w, uint32_t h, uint32_t* flags) {
+    if (backbuf != framebuffer) return false;
+    *flags = vesa_irq_save();
+    if (!vesa_cursor_overlaps(px, py, w, h)) {
+        vesa_irq_restore(*flags);
+        return false;
+    }
+    vesa_cursor_erase();
+    return true;
+}
+
+static void vesa_cursor_replace(uint32_t flags) {
+    vesa_cursor_draw();
+    vesa_irq_restore(flags);
+}
+
+bool vesa_cursor_set_image(const uint32_t* argb, uint32_t w, uint32_t h, uint32_t hot_x, uint32_t hot_y) {
+    uint32_t flags;
+    if (!argb || w == 0 || h == 0 || w > VESA_CURSOR_MAX || h > VESA_CURSOR_MAX) return false;
+    if (hot_x >= w || hot_y >= h) return false;
+    flags = vesa_irq_save();
+    vesa_cursor_erase();
+    memcpy(cursor_image, argb, w * h * sizeof(uint32_t));
+    cursor_w = w;
+    cursor_h = h;
+    cursor_hot_x = hot_x;
+    cursor_hot_y = hot_y;
+    vesa_cursor_draw();
+    vesa_irq_restore(flags);
+    return true;
+}
+
+void vesa_cursor_move(int32_t x, int32_t y) {
+    uint32_t flags = vesa_irq_save();
+    if (x != cursor_x || y != cursor_y) {
+        vesa_cursor_erase();
+        cursor_x = x;
+        cursor_y = y;
+        vesa_cursor_draw();
+    }
+    vesa_irq_restore(flags);
+}
+
+void vesa_cursor_show(bool show) {
+    uint32_t flags = vesa_irq_save();
+    vesa_cursor_erase();
+    cursor_enabled = show;
+    vesa_cursor_draw();
+    vesa_irq_restore(flags);
+}
+
+bool vesa_cursor_visible(void) {
+    return cursor_enabled && cursor_w != 0;
+}
+
 uint32_t vesa_get_width(void) {
     return vesa_logical_width();
 }
@@ -484,6 +950,39 @@ uint32_t vesa_get_framebuffer(void) {
     return (uint32_t)(uintptr_t)framebuffer;
 }
 
+uint32_t vesa_read_raw(uint32_t offset, void* buf, uint32_t size) {
+    uint32_t fb_size;
+    uint32_t y0;
+    uint32_t y1;
+    uint32_t flags;
+    bool lifted;
+    if (!vesa_is_initialized() || !buf) return 0;
+    fb_size = (uint32_t)mode_info->pitch * mode_info->height;
+    if (offset >= fb_size) return 0;
+    if (size > fb_size - offset) size = fb_size - offset;
+    y0 = offset / mode_info->pitch;
+    y1 = (offset + size - 1u) / mode_info->pitch;
+    lifted = vesa_cursor_lift(0, y0, mode_info->width, y1 - y0 + 1u, &flags);
+    memcpy(buf, backbuf + offset, size);
+    if (lifted) vesa_cursor_replace(flags);
+    return size;
+}
+
+uint32_t vesa_write_raw(uint32_t offset, const void* buf, uint32_t size) {
+    uint32_t fb_size;
+    uint32_t y0;
+    uint32_t y1;
+    if (!vesa_is_initialized() || !buf) return 0;
+    fb_size = (uint32_t)mode_info->pitch * mode_info->height;
+    if (offset >= fb_size || size == 0) return 0;
+    if (size > fb_size - offset) size = fb_size - offset;
+    memcpy(backbuf + offset, buf, size);
+    y0 = offset / mode_info->pitch;
+    y1 = (offset + size - 1u) / mode_info->pitch;
+    vesa_mark_phys(0, y0, mode_info->width, y1 - y0 + 1u);
+    return size;
+}
+
 uint32_t vesa_rgb(uint8_t r, uint8_t g, uint8_t b) {
     return (r << 16) | (g << 8) | b;
 }
@@ -5,6 +5,7 @@
 
 #define VESA_INFO_ADDR 0x9000
 #define MODE_INFO_ADDR 0x9100
+#define VESA_CURSOR_MAX 32u
 
 typedef struct {
     char signature[4];
@@ -61,6 +62,8 @@ typedef struct {
 
 bool vesa_init(void);
 bool vesa_is_initialized(void);
+bool vesa_enable_shadow(void);
+void vesa_flush(void);
 
 void vesa_put_pixel(uint32_t x, uint32_t y, uint32_t color);
 uint32_t vesa_get_pixel(uint32_t x, uint32_t y);
@@ -73,16 +76,28 @@ void vesa_draw_circle(uint32_t cx, uint32_t cy, uint32_t radius, uint32_t color,
 void vesa_draw_triangle(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint32_t x3, uint32_t y3, uint32_t color, bool filled);
 void vesa_copy_rect(uint32_t src_x, uint32_t src_y, uint32_t dst_x, uint32_t dst_y, uint32_t w, uint32_t h);
 void vesa_scroll(int32_t dx, int32_t dy, uint32_t fill_color);
+void vesa_blit_glyphs(uint32_t x, uint32_t y, uint32_t w, uint32_t h, const uint8_t* const* masks, uint32_t count, uint32_t fg, uint32_t bg);
 
 uint32_t vesa_get_width(void);
 uint32_t vesa_get_height(void);
 uint32_t vesa_get_pitch(void);
 uint32_t vesa_get_bpp(void);
 uint32_t vesa_get_framebuffer(void);
+uint32_t vesa_read_raw(uint32_t offset, void* buf, uint32_t size);
+uint32_t vesa_write_raw(uint32_t offset, const void* buf, uint32_t size);
 uint32_t vesa_calculate_pixel_offset(uint32_t x, uint32_t y);
 bool vesa_set_rotation(uint32_t degrees);
 uint32_t vesa_get_rotation(void);
 
+uint32_t vesa_get_bytes_per_pixel(void);
+uint32_t vesa_read_row(uint32_t x, uint32_t y, uint32_t* colors, uint32_t count);
+uint32_t vesa_write_row(uint32_t x, uint32_t y, const uint32_t* colors, uint32_t count);
+
+bool vesa_cursor_set_image(const uint32_t* argb, uint32_t w, uint32_t h, uint32_t hot_x, uint32_t hot_y);
+void vesa_cursor_move(int32_t x, int32_t y);
+void vesa_cursor_show(bool show);
+bool vesa_cursor_visible(void);
+
 uint32_t vesa_rgb(uint8_t r, uint8_t g, uint8_t b);
 uint32_t vesa_argb(uint8_t a, uint8_t r, uint8_t g, uint8_t b);
 void vesa_extract_color(uint32_t color, uint8_t* r, uint8_t* g, uint8_t* b, uint8_t* a);
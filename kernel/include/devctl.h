@@ -7,11 +7,15 @@ enum {
     DEV_IOCTL_VGA_GET_INFO = 0x1001,
     DEV_IOCTL_VESA_GET_ROTATION = 0x1002,
     DEV_IOCTL_VESA_SET_ROTATION = 0x1003,
+    DEV_IOCTL_VESA_FLUSH = 0x1004,
+    DEV_IOCTL_VESA_SET_CURSOR = 0x1005,
+    DEV_IOCTL_VESA_SHOW_CURSOR = 0x1006,
     DEV_IOCTL_TTY_GET_INFO = 0x1100,
     DEV_IOCTL_TTY_SET_ACTIVE = 0x1101,
     DEV_IOCTL_TTY_GET_ACTIVE = 0x1102,
     DEV_IOCTL_TTY_SET_FG_PID = 0x1103,
     DEV_IOCTL_TTY_GET_FG_PID = 0x1104,
+    DEV_IOCTL_TTY_GET_STATS = 0x1105,
     DEV_IOCTL_KBD_GET_INFO = 0x1200,
     DEV_IOCTL_KBD_GET_EVENT = 0x1201,
     DEV_IOCTL_KBD_SET_LAYOUT = 0x1202,
@@ -23,6 +27,7 @@ enum {
     DEV_IOCTL_DISK_GET_INFO = 0x1500,
     DEV_IOCTL_DISK_READ = 0x1501,
     DEV_IOCTL_DISK_WRITE = 0x1502,
+    DEV_IOCTL_DISK_FLUSH = 0x1503,
     DEV_IOCTL_BOOTLOADER_SET = 0x1600,
     DEV_IOCTL_BOOTLOADER_GET = 0x1601,
     DEV_IOCTL_BOOTLOADER_GET_MODES = 0x1602,
@@ -52,6 +57,14 @@ typedef struct {
     uint32_t size;
 } dev_fb_info_t;
 
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t hot_x;
+    uint32_t hot_y;
+    uint32_t pixels[32 * 32];
+} dev_fb_cursor_t;
+
 typedef struct {
     uint32_t cols;
     uint32_t rows;
@@ -69,6 +82,16 @@ typedef struct {
     uint32_t cursor_y;
 } dev_tty_info_t;
 
+typedef struct {
+    uint32_t bytes;
+    uint32_t writes;
+    uint32_t frames;
+    uint32_t scrolled_lines;
+    uint32_t scroll_blits;
+    uint32_t ticks;
+    uint32_t hz;
+} dev_tty_stats_t;
+
 typedef struct {
     uint32_t layout;
     uint32_t caps_lock;
@@ -2,6 +2,7 @@
 
 #define K_EPERM 1
 #define K_ENOENT 2
+#define K_ESRCH 3
 #define K_EIO 5
 #define K_EBADF 9
 #define K_EAGAIN 11
@@ -15,6 +16,8 @@
 #define K_EISDIR 21
 #define K_EINVAL 22
 #define K_ENFILE 23
+#define K_ESPIPE 29
+#define K_EPIPE 32
 #define K_ENOSYS 38
 #define K_ENOTSUP 95
 #define K_ETIMEDOUT 110
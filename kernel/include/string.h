@@ -5,6 +5,8 @@
 
 typedef uint32_t size_t;
 
+void string_init(void);
+
 size_t strlen(const char* str);
 char* strcpy(char* dest, const char* src);
 char* strncpy(char* dest, const char* src, size_t n);
@@ -91,6 +91,7 @@ static int prepare_empty_user_stack(uint32_t *user_esp_out) {
 }
 
 static void panic_halt(void) {
+    vesa_flush();
     cli();
     while (1) hlt();
 }
@@ -113,6 +114,18 @@ static ssize_t fb_write(void *ctx, const void *buf, size_t size) {
     return (ssize_t)to_copy;
 }
 
+static ssize_t vesa_fb_read(void *ctx, void *buf, size_t size) {
+    fb_ctx_t *fb = (fb_ctx_t*)ctx;
+    if (!fb || !buf) return -1;
+    return (ssize_t)vesa_read_raw(0, buf, (size < fb->size) ? (uint32_t)size : fb->size);
+}
+
+static ssize_t vesa_fb_write(void *ctx, const void *buf, size_t size) {
+    fb_ctx_t *fb = (fb_ctx_t*)ctx;
+    if (!fb || !buf) return -1;
+    return (ssize_t)vesa_write_raw(0, buf, (size < fb->size) ? (uint32_t)size : fb->size);
+}
+
 static int fb_ioctl(void *ctx, uint32_t request, void *arg) {
     fb_ctx_t *fb = (fb_ctx_t*)ctx;
     if (!fb) return -1;
@@ -138,6 +151,21 @@ static int fb_ioctl(void *ctx, uint32_t request, void *arg) {
         if (!in) return -1;
         return vesa_set_rotation(*in) ? 0 : -1;
     }
+    if (request == DEV_IOCTL_VESA_FLUSH) {
+        vesa_flush();
+        return 0;
+    }
+    if (request == DEV_IOCTL_VESA_SET_CURSOR) {
+        dev_fb_cursor_t *in = (dev_fb_cursor_t*)arg;
+        if (!in) return -1;
+        return vesa_cursor_set_image(in->pixels, in->width, in->height, in->hot_x, in->hot_y) ? 0 : -1;
+    }
+    if (request == DEV_IOCTL_VESA_SHOW_CURSOR) {
+        uint32_t *in = (uint32_t*)arg;
+        if (!in) return -1;
+        vesa_cursor_show(*in != 0u);
+        return 0;
+    }
     return -1;
 }
 
@@ -165,8 +193,6 @@ static void user_boot_task(void *arg) {
     const char *tty_path;
     const char *prog_path;
     uint32_t entry = 0;
-    uint32_t slot_idx = 0;
-    uint32_t slot_phys = 0;
     uint32_t user_cr3 = 0;
     uint32_t user_esp = USER_STACK_TOP;
 
@@ -186,19 +212,12 @@ static void user_boot_task(void *arg) {
         tty_klog("boot_task: no current_task\n");
         task_exit();
     }
-    if (current_task->user_slot == (uint32_t)-1) {
-        if (mm_user_slot_alloc(&slot_idx, &slot_phys) != 0) {
-            tty_klog("boot_task: no user slot\n");
-            task_exit();
-        }
-        user_cr3 = mm_user_cr3_create(slot_phys);
+    if (!current_task->cr3 || current_task->cr3 == mm_kernel_cr3()) {
+        user_cr3 = mm_user_space_create();
         if (!user_cr3) {
-            mm_user_slot_free(slot_idx);
             tty_klog("boot_task: no user cr3\n");
             task_exit();
         }
-        current_task->user_slot = slot_idx;
-        current_task->user_phys_base = slot_phys;
         current_task->cr3 = user_cr3;
     }
     mm_switch_cr3(current_task->cr3);
@@ -219,6 +238,7 @@ static void user_boot_task(void *arg) {
         else tty_klog("boot_task: elf_load failed\n");
         task_exit();
     }
+    syscall_task_heap_init();
     if (prepare_empty_user_stack(&user_esp) != 0) {
         tty_klog("boot_task: bad user stack\n");
         task_exit();
@@ -234,6 +254,7 @@ void kmain(void) {
     int root_fat_ready = 0;
     uint32_t root_sel = 0;
     const char *root_disk = NULL;
+    string_init();
     serial_init(SERIAL_COM1);
     KSERIAL("kmain: enter\n");
 
@@ -263,6 +284,8 @@ void kmain(void) {
     paging_init();
     KSERIAL("kmain: kmalloc_init\n");
     kmalloc_init();
+    KSERIAL("kmain: pmm_init\n");
+    pmm_init();
     KSERIAL("kmain: timer_init\n");
     timer_init();
 
@@ -301,6 +324,7 @@ void kmain(void) {
         tty_klog("kmain: devfs_init failed\n");
     }
 #endif
+    if (vesa_ok && !vesa_enable_shadow()) KSERIAL("kmain: vesa shadow framebuffer disabled\n");
     if (vesa_ok && g_devfs.fs) {
         uint32_t fb_size = vesa_get_pitch() * vesa_get_height();
         g_fb_ctx.base = (uint8_t*)(uintptr_t)vesa_get_framebuffer();
@@ -308,7 +332,7 @@ void kmain(void) {
         devfs_create_device_ops(
             &g_devfs, "/vesa",
             MEMFS_DEV_READ | MEMFS_DEV_WRITE,
-            fb_read, fb_write, fb_ioctl, &g_fb_ctx
+            vesa_fb_read, vesa_fb_write, fb_ioctl, &g_fb_ctx
         );
     } else if (g_devfs.fs) {
         g_vga_ctx.base = (uint8_t*)(uintptr_t)VGA_MEMORY_ADDRESS;
@@ -374,6 +398,7 @@ void kmain(void) {
         use_fat_root = 1;
     } else if (root_fat_ready) {
         tty_klog("kmain: vfs_set_root fat32 failed\n");
+        fat32_release(&g_rootfat);
     }
 
 #endif
@@ -411,6 +436,7 @@ void kmain(void) {
         if (fat32_init_named(&g_datafat, data_disk, 3) == 0) {
             if (vfs_mount(&g_vfs, "/data", "fat32", &g_datafat) != 0) {
                 tty_klog("kmain: mount /data fat32 failed\n");
+                fat32_release(&g_datafat);
             } else {
                 char data_src[32];
                 data_src[0] = '/'; data_src[1] = 'd'; data_src[2] = 'e'; data_src[3] = 'v';
@@ -427,6 +453,7 @@ void kmain(void) {
     g_root_fs_for_syscalls = &g_vfs;
     syscall_set_devfs_ctx(&g_devfs);
     task_init(NULL);
+    task_set_exit_hook(syscall_task_exit);
     {
         int pid = task_create(user_boot_task, &g_init_boot);
         if (pid < 0) tty_klog("kmain: task_create init failed\n");
@@ -2,10 +2,36 @@
 #include <stdint.h>
 
 
+#define STRING_ERMSB_MIN 256u
+#define STRING_HAS_ZERO(v) (((v) - 0x01010101u) & ~(v) & 0x80808080u)
+
+typedef uint32_t __attribute__((__may_alias__, __aligned__(1))) string_word_t;
+
+static int string_ermsb = 0;
+
+void string_init(void) {
+    uint32_t eax = 0, ebx, ecx = 0, edx;
+    __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+    if (eax < 7u) return;
+    eax = 7u;
+    ecx = 0;
+    __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+    string_ermsb = (ebx >> 9) & 1u;
+}
+
+
 size_t strlen(const char* str) {
-    size_t len = 0;
-    while (str[len]) len++;
-    return len;
+    const char* p = str;
+    const string_word_t* w;
+    while ((uintptr_t)p & 3u) {
+        if (!*p) return (size_t)(p - str);
+        p++;
+    }
+    w = (const string_word_t*)p;
+    while (!STRING_HAS_ZERO(*w)) w++;
+    p = (const char*)w;
+    while (*p) p++;
+    return (size_t)(p - str);
 }
 
 
@@ -51,6 +77,23 @@ char* strncat(char* dest, const char* src, size_t n) {
 
 
 int strcmp(const char* str1, const char* str2) {
+    if ((((uintptr_t)str1 ^ (uintptr_t)str2) & 3u) == 0) {
+        const string_word_t* w1;
+        const string_word_t* w2;
+        while ((uintptr_t)str1 & 3u) {
+            if (!*str1 || *str1 != *str2) return *(unsigned char*)str1 - *(unsigned char*)str2;
+            str1++;
+            str2++;
+        }
+        w1 = (const string_word_t*)str1;
+        w2 = (const string_word_t*)str2;
+        while (*w1 == *w2 && !STRING_HAS_ZERO(*w1)) {
+            w1++;
+            w2++;
+        }
+        str1 = (const char*)w1;
+        str2 = (const char*)w2;
+    }
     while (*str1 && (*str1 == *str2)) {
         str1++;
         str2++;
@@ -111,18 +154,37 @@ char* strstr(const char* haystack, const char* needle) {
 
 void* memset(void* ptr, int value, size_t num) {
     uint8_t* p = (uint8_t*)ptr;
-    while (num--) *p++ = (uint8_t)value;
+    uint32_t v = (uint8_t)value * 0x01010101u;
+    if (num >= 16u && !(string_ermsb && num >= STRING_ERMSB_MIN)) {
+        size_t head = (size_t)(-(uintptr_t)p & 3u);
+        size_t words;
+        num -= head;
+        __asm__ __volatile__("rep stosb" : "+D"(p), "+c"(head) : "a"(v) : "memory");
+        words = num >> 2;
+        __asm__ __volatile__("rep stosl" : "+D"(p), "+c"(words) : "a"(v) : "memory");
+        num &= 3u;
+    }
+    __asm__ __volatile__("rep stosb" : "+D"(p), "+c"(num) : "a"(v) : "memory");
     return ptr;
 }
 
 
+static inline void copy_forward(uint8_t* d, const uint8_t* s, size_t num) {
+    if (num >= 16u && !(string_ermsb && num >= STRING_ERMSB_MIN)) {
+        size_t head = (size_t)(-(uintptr_t)d & 3u);
+        size_t words;
+        num -= head;
+        __asm__ __volatile__("rep movsb" : "+D"(d), "+S"(s), "+c"(head) : : "memory");
+        words = num >> 2;
+        __asm__ __volatile__("rep movsl" : "+D"(d), "+S"(s), "+c"(words) : : "memory");
+        num &= 3u;
+    }
+    __asm__ __volatile__("rep movsb" : "+D"(d), "+S"(s), "+c"(num) : : "memory");
+}
+
+
 void* memcpy(void* dest, const void* src, size_t num) {
-    uint8_t* d = (uint8_t*)dest;
-    const uint8_t* s = (const uint8_t*)src;
-    
-    
-    while (num--) *d++ = *s++;
-    
+    copy_forward((uint8_t*)dest, (const uint8_t*)src, num);
     return dest;
 }
 
@@ -130,17 +192,25 @@ void* memcpy(void* dest, const void* src, size_t num) {
 void* memmove(void* dest, const void* src, size_t num) {
     uint8_t* d = (uint8_t*)dest;
     const uint8_t* s = (const uint8_t*)src;
-    
-    if (d < s) {
-        
-        while (num--) *d++ = *s++;
-    } else {
-        
-        d += num;
-        s += num;
-        while (num--) *--d = *--s;
+
+    if (d <= s || d >= s + num) {
+        copy_forward(d, s, num);
+        return dest;
+    }
+
+    /* Overlapping with dest above src: copy down from the end. */
+    d += num;
+    s += num;
+    while (num & 3u) {
+        *--d = *--s;
+        num--;
+    }
+    while (num) {
+        d -= 4;
+        s -= 4;
+        *(string_word_t*)d = *(const string_word_t*)s;
+        num -= 4;
     }
-    
     return dest;
 }
 
@@ -148,7 +218,12 @@ void* memmove(void* dest, const void* src, size_t num) {
 int memcmp(const void* ptr1, const void* ptr2, size_t num) {
     const uint8_t* p1 = (const uint8_t*)ptr1;
     const uint8_t* p2 = (const uint8_t*)ptr2;
-    
+
+    while (num >= 4u && *(const string_word_t*)p1 == *(const string_word_t*)p2) {
+        p1 += 4;
+        p2 += 4;
+        num -= 4;
+    }
     while (num--) {
         if (*p1 != *p2) return *p1 - *p2;
         p1++;
@@ -11,6 +11,9 @@
 #include <asm/port.h>
 #include <asm/mm.h>
 #include <drivers/filesystem/memfs.h>
+#include <drivers/images/image.h>
+#include <asm/timer.h>
+#include <drivers/serial.h>
 
 #ifndef ENABLE_VGA
 #define vga_print(...) ((void)0)
@@ -750,6 +753,77 @@ static uint32_t cmd_hexdump(struct shell_args *a) {
     
     return 0;
 }
+static void bench_print(const char *s) {
+    vga_print(s);
+    serial_write(SERIAL_COM1, s);
+}
+
+static uint32_t cmd_imgbench(struct shell_args *a) {
+    char buf[16];
+    char abs_path[MAX_PATH_LENGTH];
+    memfs_inode info;
+    uint32_t iterations = 10;
+    uint32_t out_bytes = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t start;
+    uint32_t ms;
+    uint32_t kb;
+    uint32_t kbps;
+
+    if (!fs) {
+        bench_print("imgbench: filesystem not initialized\n");
+        return 1;
+    }
+    if (a->argc < 2) {
+        bench_print("Usage: imgbench <image> [iterations]\n");
+        return 1;
+    }
+    if (a->argc >= 3 && atoi(a->argv[2]) > 0) iterations = (uint32_t)atoi(a->argv[2]);
+
+    normalize_path(a->argv[1], abs_path);
+    if (memfs_get_info(fs, abs_path, &info) != 0 || info.type != MEMFS_TYPE_FILE || !info.file.data) {
+        bench_print("imgbench: cannot open '");
+        bench_print(abs_path);
+        bench_print("'\n");
+        return 1;
+    }
+
+    start = timer_get_ticks();
+    for (uint32_t i = 0; i < iterations; i++) {
+        image_t *img = image_load_from_buffer(info.file.data, info.file.size);
+        if (!img) {
+            bench_print("imgbench: decode failed\n");
+            return 1;
+        }
+        width = img->width;
+        height = img->height;
+        out_bytes = img->data_size;
+        image_free(img);
+    }
+    ms = (timer_get_ticks() - start) * 10u;
+    if (ms == 0) ms = 10u;
+
+    kb = (out_bytes / 1024u) * iterations;
+    kbps = (kb / ms) * 1000u + ((kb % ms) * 1000u) / ms;
+
+    bench_print(utoa(width, buf, 10));
+    bench_print("x");
+    bench_print(utoa(height, buf, 10));
+    bench_print(", ");
+    bench_print(utoa(iterations, buf, 10));
+    bench_print(" decodes in ");
+    bench_print(utoa(ms, buf, 10));
+    bench_print(" ms, ");
+    bench_print(utoa(kbps / 1024u, buf, 10));
+    bench_print(".");
+    bench_print(utoa(((kbps % 1024u) * 10u) / 1024u, buf, 10));
+    bench_print(" MB/s decoded (");
+    bench_print(utoa((uint32_t)info.file.size, buf, 10));
+    bench_print(" bytes in)\n");
+    return 0;
+}
+
 static void cmd_init(void) {
     register_command("command_not_found", cmd_command_not_found);
     register_command("help", cmd_help);
@@ -776,4 +850,5 @@ static void cmd_init(void) {
     register_command("stat", cmd_stat);
 
     register_command("hexdump", cmd_hexdump);
+    register_command("imgbench", cmd_imgbench);
 }
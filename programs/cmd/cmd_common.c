@@ -3,6 +3,9 @@
 #include <syscall.h>
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/errno.h>
+#include <sys/stat.h>
 
 const mode_desc_t g_vga_mode_desc[] = {
     {0x00, 80, 25, 4}, {0x02, 80, 25, 4}, {0x03, 80, 25, 4},
@@ -242,11 +245,65 @@ static int str_contains(const char *hay, const char *needle) {
     return 0;
 }
 
+/* A short read only means end of input on a terminal; pipes deliver partial chunks. */
+static int fd_is_tty(int fd) {
+    dev_tty_info_t ti;
+    return ioctl(fd, DEV_IOCTL_TTY_GET_INFO, &ti) == 0;
+}
+
+#define COPY_RANGE_MAX 0x100000u
+
+static int write_all(int fd, const char *buf, uint32_t len) {
+    while (len > 0) {
+        int32_t n = write(fd, buf, len);
+        if (n <= 0) return -1;
+        buf += n;
+        len -= (uint32_t)n;
+    }
+    return 0;
+}
+
+/*
+ * Copies in_fd to out_fd until end of input. Regular files go through
+ * copy_file_range so the data never leaves the kernel; anything it refuses
+ * (pipes, terminals) falls back to a read/write loop.
+ */
+int copy_fd(int in_fd, int out_fd, uint32_t *copied) {
+    static char buf[CMD_STREAM_BUF_SZ];
+    uint32_t total = 0;
+    int32_t n;
+    int tty;
+
+    while ((n = copy_file_range(in_fd, out_fd, COPY_RANGE_MAX)) > 0) total += (uint32_t)n;
+    if (copied) *copied = total;
+    if (n == 0) return 0;
+    if (total > 0 || (errno != EINVAL && errno != ESPIPE)) return -1;
+
+    tty = fd_is_tty(in_fd);
+    for (;;) {
+        n = read(in_fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        if (write_all(out_fd, buf, (uint32_t)n) != 0) return -1;
+        total += (uint32_t)n;
+        if (copied) *copied = total;
+        if (tty && n < (int32_t)sizeof(buf)) break;
+    }
+    return n < 0 ? -1 : 0;
+}
+
+/* Opens path for writing from offset 0, dropping an old regular file so no stale tail survives. */
+int replace_file_fd(const char *path) {
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) (void)unlink(path);
+    return open(path, O_WRONLY | O_CREAT);
+}
+
 int grep_stream(int fd, const char *needle) {
-    char in[CMD_BUF_SZ];
+    static char in[CMD_STREAM_BUF_SZ];
     char line[CMD_BUF_SZ * 2];
     uint32_t line_len = 0;
     uint32_t needle_len = (uint32_t)strlen(needle);
+    int tty = fd_is_tty(fd);
     for (;;) {
         int32_t n = read(fd, in, sizeof(in));
         if (n <= 0) break;
@@ -255,15 +312,15 @@ int grep_stream(int fd, const char *needle) {
             if (line_len + 1 < sizeof(line)) line[line_len++] = c;
             if (c == '\n') {
                 line[line_len] = '\0';
-                if (needle_len == 0 || str_contains(line, needle)) write(fileno(stdout), line, line_len);
+                if (needle_len == 0 || str_contains(line, needle)) fwrite(line, 1, line_len, stdout);
                 line_len = 0;
             }
         }
-        if (n < (int32_t)sizeof(in)) break;
+        if (tty && n < (int32_t)sizeof(in)) break;
     }
     if (line_len > 0) {
         line[line_len] = '\0';
-        if (needle_len == 0 || str_contains(line, needle)) write(fileno(stdout), line, line_len);
+        if (needle_len == 0 || str_contains(line, needle)) fwrite(line, 1, line_len, stdout);
     }
     return 0;
 }
@@ -274,6 +331,8 @@ int less_stream(int fd) {
     uint32_t lines_left;
     dev_tty_info_t ti;
     int interactive = (ioctl(fileno(stdout), DEV_IOCTL_TTY_GET_INFO, &ti) == 0 && ti.rows > 1);
+    int tty = fd_is_tty(fd);
+    int key_fd = fd_is_tty(fileno(stdin)) ? fileno(stdin) : fileno(stdout);
     if (interactive) rows = ti.rows;
     lines_left = rows - 1;
 
@@ -282,7 +341,7 @@ int less_stream(int fd) {
         if (n <= 0) break;
         for (int32_t i = 0; i < n; i++) {
             char c = in[i];
-            write(fileno(stdout), &c, 1);
+            fwrite(&c, 1, 1, stdout);
             if (c != '\n') continue;
             if (!interactive) continue;
             if (lines_left > 0) lines_left--;
@@ -291,13 +350,14 @@ int less_stream(int fd) {
                 char ans[8];
                 int32_t rn;
                 const char *prompt = "--More-- (Enter/q)\n";
-                write(fileno(stdout), prompt, (uint32_t)strlen(prompt));
-                rn = read(fileno(stdin), ans, sizeof(ans));
+                fwrite(prompt, 1, (uint32_t)strlen(prompt), stdout);
+                fflush(stdout);
+                rn = read(key_fd, ans, sizeof(ans));
                 if (rn > 0 && (ans[0] == 'q' || ans[0] == 'Q')) return 0;
                 lines_left = rows - 1;
             }
         }
-        if (n < (int32_t)sizeof(in)) break;
+        if (tty && n < (int32_t)sizeof(in)) break;
     }
     return 0;
 }
@@ -307,7 +367,7 @@ static void print_u32_base(uint32_t v, uint32_t base, int upper) {
     uint32_t n = 0;
     if (v == 0) {
         char z = '0';
-        write(fileno(stdout), &z, 1);
+        fwrite(&z, 1, 1, stdout);
         return;
     }
     while (v > 0 && n < sizeof(tmp)) {
@@ -318,7 +378,7 @@ static void print_u32_base(uint32_t v, uint32_t base, int upper) {
     }
     while (n > 0) {
         n--;
-        write(fileno(stdout), &tmp[n], 1);
+        fwrite(&tmp[n], 1, 1, stdout);
     }
 }
 
@@ -340,30 +400,30 @@ int cmd_printf_impl(int argc, char **argv, int arg0) {
             else if (e == 'r') c = '\r';
             else if (e == '\\') c = '\\';
             else c = e;
-            write(fileno(stdout), &c, 1);
+            fwrite(&c, 1, 1, stdout);
             continue;
         }
         if (c != '%') {
-            write(fileno(stdout), &c, 1);
+            fwrite(&c, 1, 1, stdout);
             continue;
         }
         c = fmt[++i];
         if (c == '\0') break;
         if (c == '%') {
-            write(fileno(stdout), "%", 1);
+            fwrite("%", 1, 1, stdout);
             continue;
         }
         if (argi >= argc) return 1;
         if (c == 's') {
-            write(fileno(stdout), argv[argi], (uint32_t)strlen(argv[argi]));
+            fwrite(argv[argi], 1, (uint32_t)strlen(argv[argi]), stdout);
         } else if (c == 'c') {
-            write(fileno(stdout), argv[argi], 1);
+            fwrite(argv[argi], 1, 1, stdout);
         } else if (c == 'd') {
             int32_t v;
             if (parse_i32(argv[argi], &v) != 0) return 1;
             if (v < 0) {
                 uint32_t uv = 0u - (uint32_t)v;
-                write(fileno(stdout), "-", 1);
+                fwrite("-", 1, 1, stdout);
                 print_u32_base(uv, 10, 0);
             } else {
                 print_u32_base((uint32_t)v, 10, 0);
@@ -377,8 +437,8 @@ int cmd_printf_impl(int argc, char **argv, int arg0) {
             if (parse_u32(argv[argi], &v) != 0) return 1;
             print_u32_base(v, 16, 0);
         } else {
-            write(fileno(stdout), "%", 1);
-            write(fileno(stdout), &c, 1);
+            fwrite("%", 1, 1, stdout);
+            fwrite(&c, 1, 1, stdout);
             i--;
         }
         argi++;
@@ -397,20 +457,21 @@ static void write_hex_u32(uint32_t v) {
         uint8_t n = (uint8_t)((v >> (28 - i * 4)) & 0x0F);
         s[i] = hex_nibble(n);
     }
-    write(fileno(stdout), s, 8);
+    fwrite(s, 1, 8, stdout);
 }
 
 static void write_hex_byte(uint8_t b) {
     char s[2];
     s[0] = hex_nibble((uint8_t)(b >> 4));
     s[1] = hex_nibble(b);
-    write(fileno(stdout), s, 2);
+    fwrite(s, 1, 2, stdout);
 }
 
 int cmd_hexdump_impl(int argc, char **argv, int arg0, const char *cwd) {
     uint8_t buf[16];
     uint32_t off = 0;
     int fd = fileno(stdin);
+    int tty;
     if (arg0 + 1 < argc) {
         char path[256];
         if (normalize_path(cwd, argv[arg0 + 1], path, sizeof(path)) != 0) return 1;
@@ -420,26 +481,32 @@ int cmd_hexdump_impl(int argc, char **argv, int arg0, const char *cwd) {
             return 1;
         }
     }
+    tty = fd_is_tty(fd);
     for (;;) {
         int32_t n = read(fd, buf, sizeof(buf));
         if (n <= 0) break;
+        while (!tty && n < (int32_t)sizeof(buf)) {
+            int32_t more = read(fd, buf + n, sizeof(buf) - (uint32_t)n);
+            if (more <= 0) break;
+            n += more;
+        }
 
         write_hex_u32(off);
-        write(fileno(stdout), "  ", 2);
+        fwrite("  ", 1, 2, stdout);
         for (int32_t i = 0; i < 16; i++) {
             if (i < n) write_hex_byte(buf[i]);
-            else write(fileno(stdout), "  ", 2);
-            if (i != 15) write(fileno(stdout), " ", 1);
+            else fwrite("  ", 1, 2, stdout);
+            if (i != 15) fwrite(" ", 1, 1, stdout);
         }
-        write(fileno(stdout), "  |", 3);
+        fwrite("  |", 1, 3, stdout);
         for (int32_t i = 0; i < n; i++) {
             char c = (buf[i] >= 32 && buf[i] < 127) ? (char)buf[i] : '.';
-            write(fileno(stdout), &c, 1);
+            fwrite(&c, 1, 1, stdout);
         }
-        write(fileno(stdout), "|\n", 2);
+        fwrite("|\n", 1, 2, stdout);
 
         off += (uint32_t)n;
-        if (n < (int32_t)sizeof(buf)) break;
+        if (tty && n < (int32_t)sizeof(buf)) break;
     }
     if (fd != fileno(stdin)) close(fd);
     return 0;
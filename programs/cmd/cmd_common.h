@@ -4,6 +4,7 @@
 #include <devctl.h>
 
 #define CMD_BUF_SZ 512
+#define CMD_STREAM_BUF_SZ 16384
 
 typedef struct {
     uint16_t id;
@@ -36,6 +37,8 @@ int normalize_path(const char *cwd, const char *in, char *out, uint32_t cap);
 int parse_modes_filters(int argc, char **argv, int start, mode_filter_t *f);
 int mode_matches(const mode_filter_t *f, uint16_t w, uint16_t h, uint8_t bpp);
 void print_mode_line(uint16_t id, uint16_t w, uint16_t h, uint8_t bpp);
+int copy_fd(int in_fd, int out_fd, uint32_t *copied);
+int replace_file_fd(const char *path);
 int grep_stream(int fd, const char *needle);
 int less_stream(int fd);
 int cmd_printf_impl(int argc, char **argv, int arg0);
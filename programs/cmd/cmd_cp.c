@@ -5,17 +5,30 @@
 #include <syscall.h>
 #include <string.h>
 
+static void cp_report(uint32_t bytes, uint32_t ms) {
+    if (ms == 0) {
+        printf("%u bytes in <10 ms\n", bytes);
+        return;
+    }
+    printf("%u bytes in %u ms (%u KB/s)\n", bytes, ms, (bytes >> 10) * 100u / (ms / 10u));
+}
+
 int cmd_cp(int argc, char **argv, int arg0, const char *cwd) {
     char src[256];
     char dst[256];
-    char buf[CMD_BUF_SZ];
+    int verbose = 0;
     int in_fd;
     int out_fd;
-    int32_t n;
-    int first = 1;
+    int rc;
+    uint32_t copied = 0;
+    uint32_t start;
 
+    if (arg0 + 1 < argc && strcmp(argv[arg0 + 1], "-v") == 0) {
+        verbose = 1;
+        arg0++;
+    }
     if (arg0 + 2 >= argc) {
-        fprintf(stderr, "usage: cp SRC DST\n");
+        fprintf(stderr, "usage: cp [-v] SRC DST\n");
         return 1;
     }
     if (normalize_path(cwd, argv[arg0 + 1], src, sizeof(src)) != 0 ||
@@ -30,30 +43,21 @@ int cmd_cp(int argc, char **argv, int arg0, const char *cwd) {
         fprintf(stderr, "cp failed\n");
         return 1;
     }
-    out_fd = open(dst, 1);
+    out_fd = replace_file_fd(dst);
     if (out_fd < 0) {
         close(in_fd);
         fprintf(stderr, "cp failed\n");
         return 1;
     }
 
-    n = read(in_fd, buf, sizeof(buf));
-    if (n > 0) {
-        int32_t wr = first ? write(out_fd, buf, (uint32_t)n) : append(out_fd, buf, (uint32_t)n);
-        if (wr != n) {
-            close(out_fd);
-            close(in_fd);
-            fprintf(stderr, "cp failed\n");
-            return 1;
-        }
-        first = 0;
-    }
-
+    start = get_ticks();
+    rc = copy_fd(in_fd, out_fd, &copied);
     close(out_fd);
     close(in_fd);
-    if (n < 0) {
+    if (rc != 0) {
         fprintf(stderr, "cp failed\n");
         return 1;
     }
+    if (verbose) cp_report(copied, (get_ticks() - start) * 10u);
     return 0;
 }
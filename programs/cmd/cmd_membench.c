@@ -0,0 +1,86 @@
+#include "commands.h"
+#include "cmd_common.h"
+#include <syscall.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEMBENCH_MAX_SIZE 262144u
+#define MEMBENCH_SLACK 64u
+
+static const uint32_t g_sizes[] = { 16, 64, 256, 1024, 4096, 65536, MEMBENCH_MAX_SIZE };
+
+static volatile uint32_t g_sink;
+
+enum {
+    BENCH_MEMCPY,
+    BENCH_MEMSET,
+    BENCH_MEMMOVE,
+    BENCH_STRLEN,
+    BENCH_COUNT
+};
+
+static const char *g_bench_names[BENCH_COUNT] = { "memcpy", "memset", "memmove", "strlen" };
+
+static uint32_t bench_run(int op, uint8_t *a, uint8_t *b, uint32_t size, uint32_t iters) {
+    uint32_t start = get_ticks();
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < iters; i++) {
+        switch (op) {
+            case BENCH_MEMCPY: memcpy(b, a, size); break;
+            case BENCH_MEMSET: memset(b, (int)i, size); break;
+            case BENCH_MEMMOVE: memmove(a + MEMBENCH_SLACK, a, size); break;
+            default: acc += (uint32_t)strlen((const char*)b); break;
+        }
+    }
+    g_sink = acc;
+    return (get_ticks() - start) * 10u;
+}
+
+static void bench_report(int op, uint32_t size, uint32_t kib, uint32_t ms) {
+    if (ms == 0) {
+        printf("%s %u: >%u MB/s\n", g_bench_names[op], size, kib * 100u / 1024u);
+        return;
+    }
+    printf("%s %u: %u MB/s\n", g_bench_names[op], size, kib * 1000u / ms / 1024u);
+}
+
+int cmd_membench(int argc, char **argv, int arg0, const char *cwd) {
+    uint32_t total_mib = 16;
+    uint8_t *a;
+    uint8_t *b;
+    (void)cwd;
+
+    if (arg0 + 2 < argc) {
+        fprintf(stderr, "usage: membench [MiB-per-size]\n");
+        return 1;
+    }
+    if (arg0 + 1 < argc && (parse_u32(argv[arg0 + 1], &total_mib) != 0 || total_mib == 0 || total_mib > 1024u)) {
+        fprintf(stderr, "membench: bad size: %s\n", argv[arg0 + 1]);
+        return 1;
+    }
+    a = (uint8_t*)malloc(MEMBENCH_MAX_SIZE + MEMBENCH_SLACK);
+    b = (uint8_t*)malloc(MEMBENCH_MAX_SIZE + MEMBENCH_SLACK);
+    if (!a || !b) {
+        fprintf(stderr, "membench: out of memory\n");
+        free(a);
+        free(b);
+        return 1;
+    }
+    memset(a, 'a', MEMBENCH_MAX_SIZE + MEMBENCH_SLACK);
+
+    for (int op = 0; op < BENCH_COUNT; op++) {
+        for (uint32_t i = 0; i < sizeof(g_sizes) / sizeof(g_sizes[0]); i++) {
+            uint32_t size = g_sizes[i];
+            uint32_t iters = (total_mib << 20) / size;
+            if (op == BENCH_STRLEN) {
+                memset(b, 's', size - 1u);
+                b[size - 1u] = '\0';
+            }
+            bench_report(op, size, total_mib << 10, bench_run(op, a, b, size, iters));
+        }
+    }
+    free(a);
+    free(b);
+    return 0;
+}
@@ -8,11 +8,9 @@
 int cmd_mv(int argc, char **argv, int arg0, const char *cwd) {
     char src[256];
     char dst[256];
-    char buf[CMD_BUF_SZ];
     int in_fd;
     int out_fd;
-    int32_t n;
-    int first = 1;
+    int rc;
 
     if (arg0 + 2 >= argc) {
         fprintf(stderr, "usage: mv SRC DST\n");
@@ -35,28 +33,17 @@ int cmd_mv(int argc, char **argv, int arg0, const char *cwd) {
         fprintf(stderr, "mv failed\n");
         return 1;
     }
-    out_fd = open(dst, 1);
+    out_fd = replace_file_fd(dst);
     if (out_fd < 0) {
         close(in_fd);
         fprintf(stderr, "mv failed\n");
         return 1;
     }
 
-    n = read(in_fd, buf, sizeof(buf));
-    if (n > 0) {
-        int32_t wr = first ? write(out_fd, buf, (uint32_t)n) : append(out_fd, buf, (uint32_t)n);
-        if (wr != n) {
-            close(out_fd);
-            close(in_fd);
-            fprintf(stderr, "mv failed\n");
-            return 1;
-        }
-        first = 0;
-    }
-
+    rc = copy_fd(in_fd, out_fd, NULL);
     close(out_fd);
     close(in_fd);
-    if (n < 0 || unlink(src) != 0) {
+    if (rc != 0 || unlink(src) != 0) {
         fprintf(stderr, "mv failed\n");
         return 1;
     }
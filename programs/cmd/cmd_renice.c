@@ -0,0 +1,42 @@
+#include "commands.h"
+#include <stdio.h>
+#include "cmd_common.h"
+#include <syscall.h>
+
+static int parse_i32_dec(const char *s, int32_t *out) {
+    uint32_t v = 0;
+    int neg = 0;
+    if (!s || !out) return -1;
+    if (*s == '-' || *s == '+') {
+        neg = (*s == '-');
+        s++;
+    }
+    if (parse_u32_dec(s, &v) != 0 || v > 0x7FFFFFFFu) return -1;
+    *out = neg ? -(int32_t)v : (int32_t)v;
+    return 0;
+}
+
+int cmd_renice(int argc, char **argv, int arg0, const char *cwd) {
+    uint32_t pid = 0;
+    int32_t nice = 0;
+    (void)cwd;
+    if (arg0 + 2 == argc && parse_u32_dec(argv[arg0 + 1], &pid) == 0) {
+        if (task_get_nice((int32_t)pid, &nice) != 0) {
+            fprintf(stderr, "renice: no such process: %u\n", pid);
+            return 1;
+        }
+        fprintf(stdout, "%u: %d\n", pid, (int)nice);
+        return 0;
+    }
+    if (arg0 + 3 != argc ||
+        parse_i32_dec(argv[arg0 + 1], &nice) != 0 ||
+        parse_u32_dec(argv[arg0 + 2], &pid) != 0) {
+        fprintf(stderr, "usage: renice [<nice>] <pid>\n");
+        return 1;
+    }
+    if (task_set_nice((int32_t)pid, nice) != 0) {
+        fprintf(stderr, "renice: no such process: %u\n", pid);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "commands.h"
+#include "cmd_common.h"
+#include <syscall.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t syscalls;
+    uint32_t ms;
+} bench_sample_t;
+
+static uint32_t self_syscalls(void) {
+    char text[768];
+    const char *key = "Syscalls:\t";
+    uint32_t key_len = (uint32_t)strlen(key);
+    uint32_t v = 0;
+    int32_t n;
+    int fd = open("/proc/self/status", 0);
+    if (fd < 0) return 0;
+    n = read(fd, text, sizeof(text) - 1);
+    close(fd);
+    if (n <= 0) return 0;
+    text[n] = '\0';
+    for (int32_t i = 0; i + (int32_t)key_len <= n; i++) {
+        if (strncmp(text + i, key, key_len) != 0) continue;
+        for (const char *p = text + i + key_len; *p >= '0' && *p <= '9'; p++) v = v * 10u + (uint32_t)(*p - '0');
+        break;
+    }
+    return v;
+}
+
+static void bench_begin(bench_sample_t *s) {
+    s->syscalls = self_syscalls();
+    s->ms = get_ticks() * 10u;
+}
+
+static void bench_end(bench_sample_t *s) {
+    s->syscalls = self_syscalls() - s->syscalls;
+    s->ms = get_ticks() * 10u - s->ms;
+}
+
+static FILE *bench_open(const char *path, const char *mode, int buf_mode) {
+    FILE *f = fopen(path, mode);
+    if (f) (void)setvbuf(f, NULL, buf_mode, 0);
+    return f;
+}
+
+static char *bench_append(char *dst, const char *src) {
+    while (*src) *dst++ = *src++;
+    return dst;
+}
+
+static void bench_format_line(char *out, uint32_t i, uint32_t lines) {
+    char num[16];
+    char *p = bench_append(out, "line ");
+    utoa(i, num, 10);
+    p = bench_append(p, num);
+    p = bench_append(p, " of ");
+    utoa(lines, num, 10);
+    p = bench_append(p, num);
+    p = bench_append(p, ": ");
+    utoa(i * 2654435761u, num, 16);
+    p = bench_append(p, num);
+    p = bench_append(p, "\n");
+    *p = '\0';
+}
+
+/* per_char reproduces the old libc, which issued one write per formatted byte. */
+static int bench_printf(const char *path, uint32_t lines, int buf_mode, int per_char, bench_sample_t *s) {
+    char line[64];
+    FILE *out;
+    bench_begin(s);
+    out = bench_open(path, "w", buf_mode);
+    if (!out) return -1;
+    for (uint32_t i = 0; i < lines; i++) {
+        if (!per_char) {
+            fprintf(out, "line %u of %u: %x\n", i, lines, i * 2654435761u);
+            continue;
+        }
+        bench_format_line(line, i, lines);
+        for (const char *p = line; *p; p++) fputc(*p, out);
+    }
+    fclose(out);
+    bench_end(s);
+    return 0;
+}
+
+static int bench_cat(const char *src, const char *dst, int buf_mode, bench_sample_t *s) {
+    FILE *in;
+    FILE *out;
+    int c;
+    bench_begin(s);
+    in = bench_open(src, "r", buf_mode);
+    out = bench_open(dst, "w", buf_mode);
+    if (!in || !out) {
+        if (in) fclose(in);
+        if (out) fclose(out);
+        return -1;
+    }
+    while ((c = fgetc(in)) != EOF) fputc(c, out);
+    fclose(in);
+    fclose(out);
+    bench_end(s);
+    return 0;
+}
+
+static int bench_grep(const char *src, const char *dst, int buf_mode, bench_sample_t *s) {
+    char line[128];
+    FILE *in;
+    FILE *out;
+    bench_begin(s);
+    in = bench_open(src, "r", buf_mode);
+    out = bench_open(dst, "w", buf_mode);
+    if (!in || !out) {
+        if (in) fclose(in);
+        if (out) fclose(out);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), in)) {
+        if (strchr(line, '7')) fputs(line, out);
+    }
+    fclose(in);
+    fclose(out);
+    bench_end(s);
+    return 0;
+}
+
+static void bench_report(const char *name, const bench_sample_t *per_char, const bench_sample_t *unbuf, const bench_sample_t *buf) {
+    printf("%s: ", name);
+    if (per_char) printf("per-char %u syscalls %u ms, ", per_char->syscalls, per_char->ms);
+    printf("unbuffered %u syscalls %u ms, buffered %u syscalls %u ms\n",
+           unbuf->syscalls, unbuf->ms, buf->syscalls, buf->ms);
+}
+
+int cmd_stdiobench(int argc, char **argv, int arg0, const char *cwd) {
+    char path[256];
+    char out_path[260];
+    uint32_t lines = 200;
+    bench_sample_t per_char;
+    bench_sample_t unbuf;
+    bench_sample_t buf;
+    int rc = 0;
+
+    if (arg0 + 1 >= argc || arg0 + 3 < argc) {
+        fprintf(stderr, "usage: stdiobench <scratch-file> [lines]\n");
+        return 1;
+    }
+    if (normalize_path(cwd, argv[arg0 + 1], path, sizeof(path)) != 0) {
+        fprintf(stderr, "stdiobench: bad path: %s\n", argv[arg0 + 1]);
+        return 1;
+    }
+    if (arg0 + 2 < argc && (parse_u32(argv[arg0 + 2], &lines) != 0 || lines == 0)) {
+        fprintf(stderr, "stdiobench: bad line count: %s\n", argv[arg0 + 2]);
+        return 1;
+    }
+    strcpy(out_path, path);
+    strcpy(out_path + strlen(out_path), ".out");
+
+    if (bench_printf(path, lines, _IONBF, 1, &per_char) != 0 ||
+        bench_printf(path, lines, _IONBF, 0, &unbuf) != 0 ||
+        bench_printf(path, lines, _IOFBF, 0, &buf) != 0) {
+        fprintf(stderr, "stdiobench: cannot write %s\n", path);
+        return 1;
+    }
+    bench_report("printf", &per_char, &unbuf, &buf);
+
+    if (bench_cat(path, out_path, _IONBF, &unbuf) == 0 && bench_cat(path, out_path, _IOFBF, &buf) == 0) {
+        bench_report("cat", NULL, &unbuf, &buf);
+    } else {
+        fprintf(stderr, "stdiobench: cat pass failed\n");
+        rc = 1;
+    }
+
+    if (bench_grep(path, out_path, _IONBF, &unbuf) == 0 && bench_grep(path, out_path, _IOFBF, &buf) == 0) {
+        bench_report("grep", NULL, &unbuf, &buf);
+    } else {
+        fprintf(stderr, "stdiobench: grep pass failed\n");
+        rc = 1;
+    }
+
+    (void)unlink(out_path);
+    (void)unlink(path);
+    return rc;
+}
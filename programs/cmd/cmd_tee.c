@@ -5,7 +5,7 @@
 
 int cmd_tee(int argc, char **argv, int arg0, const char *cwd) {
     char path[256];
-    char buf[CMD_BUF_SZ];
+    static char buf[CMD_STREAM_BUF_SZ];
     int fd;
     int32_t n;
     if (arg0 + 1 >= argc || arg0 + 2 < argc) {
@@ -22,7 +22,11 @@ int cmd_tee(int argc, char **argv, int arg0, const char *cwd) {
         return 1;
     }
     while ((n = read(fileno(stdin), buf, sizeof(buf))) > 0) {
-        write(fileno(stdout), buf, (uint32_t)n);
+        for (int32_t off = 0; off < n;) {
+            int32_t w = write(fileno(stdout), buf + off, (uint32_t)(n - off));
+            if (w <= 0) break;
+            off += w;
+        }
         if (append(fd, buf, (uint32_t)n) < 0) {
             close(fd);
             fprintf(stderr, "tee: write failed: %s\n", path);
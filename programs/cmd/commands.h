@@ -33,3 +33,6 @@ int cmd_vesa(int argc, char **argv, int arg0, const char *cwd);
 int cmd_vga(int argc, char **argv, int arg0, const char *cwd);
 int cmd_clear(int argc, char **argv, int arg0, const char *cwd);
 int cmd_img_view(int argc, char **argv, int arg0, const char *cwd);
+int cmd_renice(int argc, char **argv, int arg0, const char *cwd);
+int cmd_stdiobench(int argc, char **argv, int arg0, const char *cwd);
+int cmd_membench(int argc, char **argv, int arg0, const char *cwd);
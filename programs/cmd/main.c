@@ -46,6 +46,9 @@ static const cmd_entry_t g_cmds[] = {
     { "vga", cmd_vga },
     { "clear", cmd_clear },
     { "img_view", cmd_img_view },
+    { "renice", cmd_renice },
+    { "stdiobench", cmd_stdiobench },
+    { "membench", cmd_membench },
 };
 
 static const char *cmd_basename(const char *path) {
@@ -5,6 +5,8 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <devctl.h>
+#include <gfx_proto.h>
+#include <poll.h>
 #include <hgui/app.h>
 
 #define PORT_GFXD 7711
@@ -22,6 +24,23 @@
 #define TERM_COLS_MAX 120
 #define TERM_ROWS_MAX 48
 
+#define TOP_H 44u
+#define PANEL_W 200u
+#define TOAST_MS 2200u
+#define BLINK_MS 500u
+#define IDLE_POLL_MS 250
+
+enum {
+    WID_ROOT = 1,
+    WID_TOP = 2,
+    WID_PANEL = 3,
+    WID_DESK = 4,
+    WID_TERM = 5,
+    WID_TOAST = 6,
+    WID_BTN0 = 16,
+    WID_ROW0 = 32,
+};
+
 typedef struct {
     char mode[16];
     char ip[32];
@@ -61,7 +80,6 @@ typedef struct {
 } ui_event_t;
 
 static wm_state_t g_state;
-static wm_state_t g_prev;
 static ui_button_t g_btn[BTN_COUNT];
 
 static int g_sock_in = -1;
@@ -75,7 +93,7 @@ static uint32_t g_target_tty = 2;
 static uint32_t g_prev_btn_down = 0;
 
 static char g_toast[96] = "";
-static uint32_t g_toast_ttl_ms = 0;
+static uint32_t g_toast_until = 0;
 
 static ui_event_t g_evt_q[EVT_QUEUE_CAP];
 static uint32_t g_evt_head = 0;
@@ -95,10 +113,33 @@ static uint32_t g_term_rows = 0;
 static uint32_t g_term_cur_x = 0;
 static uint32_t g_term_cur_y = 0;
 static char g_term_buf[TERM_ROWS_MAX][TERM_COLS_MAX + 1];
+static uint8_t g_term_touched[TERM_ROWS_MAX];
+static uint32_t g_term_blink = 1;
+static uint32_t g_blink_due = 0;
 
-static uint32_t g_tick_ms = 0;
+static int g_active = 0;
+static int g_fd_vesa = -1;
+static int g_cursor_shown = -1;
 static hq_application_t g_ui_app;
 static hq_widget_t g_ui_root;
+static hq_widget_t g_w_top;
+static hq_widget_t g_w_panel;
+static hq_widget_t g_w_btn[BTN_COUNT];
+static hq_widget_t g_w_desk;
+static hq_widget_t g_w_term;
+static hq_widget_t g_w_row[TERM_ROWS_MAX];
+static hq_widget_t g_w_toast;
+static uint8_t g_btn_hover[BTN_COUNT];
+
+static uint8_t g_batch[GFX_BATCH_MAX];
+static uint32_t g_batch_len = 0;
+static uint32_t g_batch_ops = 0;
+static uint32_t g_batch_seq = 0;
+static uint32_t g_dmg_x0 = 0;
+static uint32_t g_dmg_y0 = 0;
+static uint32_t g_dmg_x1 = 0;
+static uint32_t g_dmg_y1 = 0;
+static ui_rect_t g_clip;
 
 static int is_space(char c) {
     return (c == ' ' || c == '\t' || c == '\r' || c == '\n');
@@ -184,12 +225,6 @@ static int buf_append(char *dst, uint32_t cap, const char *s) {
     return 0;
 }
 
-static int buf_append_u32(char *dst, uint32_t cap, uint32_t v) {
-    char n[16];
-    u32_to_dec(v, n, sizeof(n));
-    return buf_append(dst, cap, n);
-}
-
 static int point_in(uint32_t x, uint32_t y, const ui_button_t *b) {
     if (!b) return 0;
     if (x < b->x || y < b->y) return 0;
@@ -197,74 +232,132 @@ static int point_in(uint32_t x, uint32_t y, const ui_button_t *b) {
     return 1;
 }
 
-static void send_cmd(const char *cmd) {
-    (void)sendto(g_sock_out, cmd, (uint32_t)strlen(cmd), 0, (const void*)&g_dst, sizeof(g_dst));
-}
-
-static void send_clear(const char *hex) {
-    char cmd[24];
-    strcpy(cmd, "CLR ");
-    (void)buf_append(cmd, sizeof(cmd), hex);
-    send_cmd(cmd);
-}
-
-static void send_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, const char *hex) {
-    char cmd[96];
-    cmd[0] = '\0';
-    (void)buf_append(cmd, sizeof(cmd), "RECT ");
-    (void)buf_append_u32(cmd, sizeof(cmd), x);
-    (void)buf_append(cmd, sizeof(cmd), " ");
-    (void)buf_append_u32(cmd, sizeof(cmd), y);
-    (void)buf_append(cmd, sizeof(cmd), " ");
-    (void)buf_append_u32(cmd, sizeof(cmd), w);
-    (void)buf_append(cmd, sizeof(cmd), " ");
-    (void)buf_append_u32(cmd, sizeof(cmd), h);
-    (void)buf_append(cmd, sizeof(cmd), " ");
-    (void)buf_append(cmd, sizeof(cmd), hex);
-    send_cmd(cmd);
-}
-
-static void send_frame(uint32_t x, uint32_t y, uint32_t w, uint32_t h, const char *hex) {
-    char cmd[96];
-    cmd[0] = '\0';
-    (void)buf_append(cmd, sizeof(cmd), "FRAME ");
-    (void)buf_append_u32(cmd, sizeof(cmd), x);
-    (void)buf_append(cmd, sizeof(cmd), " ");
-    (void)buf_append_u32(cmd, sizeof(cmd), y);
-    (void)buf_append(cmd, sizeof(cmd), " ");
-    (void)buf_append_u32(cmd, sizeof(cmd), w);
-    (void)buf_append(cmd, sizeof(cmd), " ");
-    (void)buf_append_u32(cmd, sizeof(cmd), h);
-    (void)buf_append(cmd, sizeof(cmd), " ");
-    (void)buf_append(cmd, sizeof(cmd), hex);
-    send_cmd(cmd);
-}
-
-static void send_text(uint32_t x, uint32_t y, uint32_t scale, const char *hex, const char *text) {
-    char cmd[240];
-    cmd[0] = '\0';
-    (void)buf_append(cmd, sizeof(cmd), "TEXT ");
-    (void)buf_append_u32(cmd, sizeof(cmd), x);
-    (void)buf_append(cmd, sizeof(cmd), " ");
-    (void)buf_append_u32(cmd, sizeof(cmd), y);
-    (void)buf_append(cmd, sizeof(cmd), " ");
-    (void)buf_append_u32(cmd, sizeof(cmd), scale);
-    (void)buf_append(cmd, sizeof(cmd), " ");
-    (void)buf_append(cmd, sizeof(cmd), hex);
-    (void)buf_append(cmd, sizeof(cmd), " ");
-    (void)buf_append(cmd, sizeof(cmd), text ? text : "");
-    send_cmd(cmd);
-}
-
-static void draw_cursor(uint32_t x, uint32_t y) {
-    uint32_t cx = x;
-    uint32_t cy = y;
-    if (cx + 9u >= g_width) cx = (g_width > 10u) ? (g_width - 10u) : 0u;
-    if (cy + 13u >= g_height) cy = (g_height > 14u) ? (g_height - 14u) : 0u;
-    send_rect(cx + 1u, cy + 1u, 2u, 13u, "000000");
-    send_rect(cx + 1u, cy + 1u, 9u, 2u, "000000");
-    send_rect(cx, cy, 2u, 13u, "F5F8FB");
-    send_rect(cx, cy, 9u, 2u, "F5F8FB");
+static void batch_reset(void) {
+    g_batch_len = (uint32_t)sizeof(gfx_batch_hdr_t);
+    g_batch_ops = 0u;
+}
+
+static void batch_flush(void) {
+    gfx_batch_hdr_t *h = (gfx_batch_hdr_t*)g_batch;
+    if (g_batch_ops == 0u) return;
+    h->magic = GFX_PROTO_MAGIC;
+    h->version = (uint16_t)GFX_PROTO_VERSION;
+    h->op_count = (uint16_t)g_batch_ops;
+    h->seq = g_batch_seq++;
+    h->bytes = g_batch_len;
+    (void)sendto(g_sock_out, g_batch, g_batch_len, 0, (const void*)&g_dst, sizeof(g_dst));
+    batch_reset();
+}
+
+static void *batch_op(uint16_t type, uint32_t size) {
+    gfx_op_hdr_t *op;
+    size = (size + 3u) & ~3u;
+    if (g_batch_len < sizeof(gfx_batch_hdr_t)) batch_reset();
+    if (g_batch_len + size > GFX_BATCH_MAX) batch_flush();
+    op = (gfx_op_hdr_t*)(g_batch + g_batch_len);
+    memset(op, 0, size);
+    op->type = type;
+    op->size = (uint16_t)size;
+    g_batch_len += size;
+    g_batch_ops++;
+    return op;
+}
+
+static void damage_add(uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+    uint32_t x1 = x + w;
+    uint32_t y1 = y + h;
+    if (w == 0u || h == 0u) return;
+    if (x1 > g_width) x1 = g_width;
+    if (y1 > g_height) y1 = g_height;
+    if (g_clip.w > 0 && g_clip.h > 0) {
+        if (x < (uint32_t)g_clip.x) x = (uint32_t)g_clip.x;
+        if (y < (uint32_t)g_clip.y) y = (uint32_t)g_clip.y;
+        if (x1 > (uint32_t)(g_clip.x + g_clip.w)) x1 = (uint32_t)(g_clip.x + g_clip.w);
+        if (y1 > (uint32_t)(g_clip.y + g_clip.h)) y1 = (uint32_t)(g_clip.y + g_clip.h);
+    }
+    if (x >= x1 || y >= y1) return;
+    if (g_dmg_x1 <= g_dmg_x0 || g_dmg_y1 <= g_dmg_y0) {
+        g_dmg_x0 = x;
+        g_dmg_y0 = y;
+        g_dmg_x1 = x1;
+        g_dmg_y1 = y1;
+        return;
+    }
+    if (x < g_dmg_x0) g_dmg_x0 = x;
+    if (y < g_dmg_y0) g_dmg_y0 = y;
+    if (x1 > g_dmg_x1) g_dmg_x1 = x1;
+    if (y1 > g_dmg_y1) g_dmg_y1 = y1;
+}
+
+static void send_box(uint16_t type, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t color) {
+    gfx_op_rect_t *op = (gfx_op_rect_t*)batch_op(type, sizeof(*op));
+    op->x = (uint16_t)x;
+    op->y = (uint16_t)y;
+    op->w = (uint16_t)w;
+    op->h = (uint16_t)h;
+    op->color = color;
+    damage_add(x, y, w, h);
+}
+
+static void send_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t color) {
+    send_box(GFX_OP_RECT, x, y, w, h, color);
+}
+
+static void send_frame(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t color) {
+    send_box(GFX_OP_FRAME, x, y, w, h, color);
+}
+
+static void send_clip(ui_rect_t r) {
+    gfx_op_clip_t *op = (gfx_op_clip_t*)batch_op(GFX_OP_CLIP, sizeof(*op));
+    op->x = (uint16_t)r.x;
+    op->y = (uint16_t)r.y;
+    op->w = (uint16_t)r.w;
+    op->h = (uint16_t)r.h;
+    g_clip = r;
+}
+
+static void send_text(uint32_t x, uint32_t y, uint32_t scale, uint32_t color, const char *text) {
+    gfx_op_text_t *op;
+    uint32_t len = text ? (uint32_t)strlen(text) : 0u;
+    if (len > GFX_TEXT_MAX) len = GFX_TEXT_MAX;
+    op = (gfx_op_text_t*)batch_op(GFX_OP_TEXT, (uint32_t)sizeof(*op) + len);
+    op->x = (uint16_t)x;
+    op->y = (uint16_t)y;
+    op->scale = (uint16_t)scale;
+    op->len = (uint16_t)len;
+    op->color = color;
+    if (len) memcpy(op + 1, text, len);
+    damage_add(x, y, len * 6u * scale, 8u * scale);
+}
+
+static void send_present(void) {
+    if (g_dmg_x1 > g_dmg_x0 && g_dmg_y1 > g_dmg_y0) {
+        gfx_op_damage_t *d = (gfx_op_damage_t*)batch_op(GFX_OP_DAMAGE, sizeof(*d));
+        d->x = (uint16_t)g_dmg_x0;
+        d->y = (uint16_t)g_dmg_y0;
+        d->w = (uint16_t)(g_dmg_x1 - g_dmg_x0);
+        d->h = (uint16_t)(g_dmg_y1 - g_dmg_y0);
+    }
+    (void)batch_op(GFX_OP_PRESENT, sizeof(gfx_op_present_t));
+    batch_flush();
+    g_dmg_x0 = g_dmg_y0 = g_dmg_x1 = g_dmg_y1 = 0u;
+}
+
+static void term_geometry(uint32_t *tx, uint32_t *ty, uint32_t *tw, uint32_t *th) {
+    *tx = PANEL_W + 20u;
+    *ty = TOP_H + 20u;
+    *tw = g_width - *tx - 20u;
+    *th = g_height - *ty - 20u;
+}
+
+static void ui_repaint_region(ui_rect_t r) {
+    hq_event_t ev;
+    if (!g_active || r.w <= 0 || r.h <= 0) return;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = HQ_EVENT_PAINT;
+    send_clip(r);
+    (void)hq_widget_paint_region(&g_ui_root, r, &ev);
+    send_clip((ui_rect_t){0, 0, 0, 0});
 }
 
 static void evt_push(const ui_event_t *ev) {
@@ -289,7 +382,16 @@ static int evt_pop(ui_event_t *ev) {
 static void set_toast(const char *msg) {
     strncpy(g_toast, msg ? msg : "", sizeof(g_toast) - 1u);
     g_toast[sizeof(g_toast) - 1u] = '\0';
-    g_toast_ttl_ms = 2200u;
+    g_toast_until = get_ticks() * 10u + TOAST_MS;
+    hq_widget_set_visible(&g_w_toast, 1);
+    hq_widget_invalidate(&g_w_toast);
+}
+
+static void hide_toast(void) {
+    if (!g_w_toast.visible) return;
+    hq_widget_set_visible(&g_w_toast, 0);
+    g_w_toast.dirty = 0u;
+    ui_repaint_region(g_w_toast.rect);
 }
 
 static int make_target_tty_path(char *out, uint32_t cap) {
@@ -323,13 +425,16 @@ static int launch_app(const char *path, const char *label) {
     return 0;
 }
 
-static int state_changed(void) {
-    if (strcmp(g_state.mode, g_prev.mode) != 0) return 1;
-    if (strcmp(g_state.ip, g_prev.ip) != 0) return 1;
-    if (g_state.mx != g_prev.mx) return 1;
-    if (g_state.my != g_prev.my) return 1;
-    if (g_state.btn != g_prev.btn) return 1;
-    return 0;
+static void term_touch_row(uint32_t y) {
+    if (y < TERM_ROWS_MAX) g_term_touched[y] = 1u;
+}
+
+static void term_commit_rows(void) {
+    for (uint32_t y = 0; y < g_term_rows; y++) {
+        if (!g_term_touched[y]) continue;
+        g_term_touched[y] = 0u;
+        hq_widget_invalidate(&g_w_row[y]);
+    }
 }
 
 static void term_clear(void) {
@@ -339,6 +444,7 @@ static void term_clear(void) {
     }
     g_term_cur_x = 0u;
     g_term_cur_y = 0u;
+    for (uint32_t y = 0; y < TERM_ROWS_MAX; y++) term_touch_row(y);
 }
 
 static void term_scroll(void) {
@@ -348,6 +454,7 @@ static void term_scroll(void) {
     }
     memset(g_term_buf[g_term_rows - 1u], ' ', g_term_cols);
     if (g_term_cur_y > 0u) g_term_cur_y--;
+    for (uint32_t y = 0; y < g_term_rows; y++) term_touch_row(y);
 }
 
 static void term_newline(void) {
@@ -370,26 +477,31 @@ static void term_putc(char ch) {
         if (g_term_cur_x > 0u) {
             g_term_cur_x--;
             g_term_buf[g_term_cur_y][g_term_cur_x] = ' ';
+            term_touch_row(g_term_cur_y);
         }
         return;
     }
     if ((uint8_t)ch < 32u || (uint8_t)ch > 126u) return;
 
     g_term_buf[g_term_cur_y][g_term_cur_x] = ch;
+    term_touch_row(g_term_cur_y);
     g_term_cur_x++;
     if (g_term_cur_x >= g_term_cols) term_newline();
 }
 
 static void term_feed(const char *buf, uint32_t n) {
+    term_touch_row(g_term_cur_y);
     for (uint32_t i = 0; i < n; i++) term_putc(buf[i]);
+    term_touch_row(g_term_cur_y);
+    g_term_blink = 1u;
+    g_blink_due = get_ticks() * 10u + BLINK_MS;
+    term_commit_rows();
 }
 
 static void layout_buttons(void) {
-    uint32_t top_h = 44u;
-    uint32_t panel_w = 200u;
     uint32_t left = 14u;
-    uint32_t y = top_h + 18u;
-    uint32_t bw = panel_w - 28u;
+    uint32_t y = TOP_H + 18u;
+    uint32_t bw = PANEL_W - 28u;
     uint32_t bh = 42u;
     uint32_t gap = 10u;
 
@@ -555,6 +667,14 @@ static int ensure_terminal_backend(void) {
     return 0;
 }
 
+static void set_term_focus(int focus) {
+    if (g_term_focus == focus) return;
+    g_term_focus = focus;
+    g_term_blink = 1u;
+    g_blink_due = get_ticks() * 10u + BLINK_MS;
+    if (g_term_cur_y < g_term_rows) hq_widget_invalidate(&g_w_row[g_term_cur_y]);
+}
+
 static void show_terminal(void) {
     if (ensure_terminal_backend() != 0) {
         set_toast("Failed to initialize PTY terminal");
@@ -565,12 +685,20 @@ static void show_terminal(void) {
         if (st == 3 || st < 0) g_term_pid = spawn("/bin/sh", g_pty.slave_path);
     }
     g_term_visible = 1;
-    g_term_focus = 1;
+    set_term_focus(1);
+    if (!g_w_term.visible) {
+        hq_widget_set_visible(&g_w_term, 1);
+        hq_widget_invalidate(&g_w_term);
+    }
 }
 
 static void hide_terminal(void) {
     g_term_visible = 0;
-    g_term_focus = 0;
+    set_term_focus(0);
+    if (g_w_term.visible) {
+        hq_widget_set_visible(&g_w_term, 0);
+        hq_widget_invalidate(&g_w_desk);
+    }
 }
 
 static void send_key_to_terminal(const key_event_t *k) {
@@ -690,12 +818,11 @@ static int handle_click(void) {
     }
 
     if (g_term_visible) {
-        uint32_t top_h = 44u;
-        uint32_t panel_w = 200u;
-        uint32_t tx = panel_w + 20u;
-        uint32_t ty = top_h + 20u;
-        uint32_t tw = g_width - tx - 20u;
-        uint32_t th = g_height - ty - 20u;
+        uint32_t tx;
+        uint32_t ty;
+        uint32_t tw;
+        uint32_t th;
+        term_geometry(&tx, &ty, &tw, &th);
 
         if (g_state.mx >= tx + tw - 24u && g_state.mx < tx + tw - 4u &&
             g_state.my >= ty + 4u && g_state.my < ty + 22u) {
@@ -705,24 +832,26 @@ static int handle_click(void) {
 
         if (g_state.mx >= tx && g_state.mx < tx + tw &&
             g_state.my >= ty && g_state.my < ty + th) {
-            g_term_focus = 1;
+            set_term_focus(1);
             return 1;
         }
     }
 
-    g_term_focus = 0;
+    set_term_focus(0);
     return 1;
 }
 
 static void update_terminal_geometry(void) {
-    uint32_t top_h = 44u;
-    uint32_t panel_w = 200u;
-    uint32_t tx = panel_w + 20u;
-    uint32_t ty = top_h + 20u;
-    uint32_t tw = g_width - tx - 20u;
-    uint32_t th = g_height - ty - 20u;
-    uint32_t cols = (tw > 20u) ? ((tw - 20u) / 12u) : 0u;
-    uint32_t rows = (th > 36u) ? ((th - 36u) / 16u) : 0u;
+    uint32_t tx;
+    uint32_t ty;
+    uint32_t tw;
+    uint32_t th;
+    uint32_t cols;
+    uint32_t rows;
+
+    term_geometry(&tx, &ty, &tw, &th);
+    cols = (tw > 20u) ? ((tw - 20u) / 12u) : 0u;
+    rows = (th > 36u) ? ((th - 36u) / 16u) : 0u;
 
     if (cols > TERM_COLS_MAX) cols = TERM_COLS_MAX;
     if (rows > TERM_ROWS_MAX) rows = TERM_ROWS_MAX;
@@ -734,6 +863,12 @@ static void update_terminal_geometry(void) {
         g_term_rows = rows;
         term_clear();
     }
+
+    hq_widget_set_geometry(&g_w_term, (ui_rect_t){(int)tx, (int)ty, (int)tw, (int)th});
+    for (uint32_t y = 0; y < TERM_ROWS_MAX; y++) {
+        hq_widget_set_geometry(&g_w_row[y], (ui_rect_t){(int)tx + 2, (int)(ty + 30u + y * 16u), (int)tw - 4, 16});
+        hq_widget_set_visible(&g_w_row[y], y < g_term_rows);
+    }
 }
 
 static int pump_pty_output(void) {
@@ -753,111 +888,215 @@ static int pump_pty_output(void) {
     return dirty;
 }
 
-static void process_events(int active, int *need_redraw) {
+static void update_hover(void) {
+    for (uint32_t i = 0; i < BTN_COUNT; i++) {
+        uint8_t hover = (uint8_t)point_in(g_state.mx, g_state.my, &g_btn[i]);
+        if (hover == g_btn_hover[i]) continue;
+        g_btn_hover[i] = hover;
+        hq_widget_invalidate(&g_w_btn[i]);
+    }
+}
+
+static void process_events(void) {
     ui_event_t ev;
     while (evt_pop(&ev)) {
         if (ev.type == EVT_STATE) {
             g_state = ev.st;
             if (g_state.mx >= g_width) g_state.mx = (g_width > 0u) ? (g_width - 1u) : 0u;
             if (g_state.my >= g_height) g_state.my = (g_height > 0u) ? (g_height - 1u) : 0u;
-            if (active && handle_click()) *need_redraw = 1;
+            update_hover();
+            if (g_active) (void)handle_click();
             continue;
         }
         if (ev.type == EVT_KEY) {
-            if (apply_key_shortcuts(&ev.key)) *need_redraw = 1;
-            if (active && g_term_visible && g_term_focus) {
-                send_key_to_terminal(&ev.key);
-                *need_redraw = 1;
-            }
+            (void)apply_key_shortcuts(&ev.key);
+            if (g_active && g_term_visible && g_term_focus) send_key_to_terminal(&ev.key);
         }
     }
 }
 
-static void draw_terminal(void) {
-    uint32_t top_h = 44u;
-    uint32_t panel_w = 200u;
-    uint32_t tx = panel_w + 20u;
-    uint32_t ty = top_h + 20u;
-    uint32_t tw = g_width - tx - 20u;
-    uint32_t th = g_height - ty - 20u;
-    uint32_t cy;
+static void paint_top(hq_widget_t *self, const hq_event_t *ev) {
+    (void)self;
+    (void)ev;
+    send_rect(0u, 0u, g_width, TOP_H, 0x1A2732u);
+    send_rect(0u, TOP_H - 2u, g_width, 2u, 0x4E8DBBu);
+    send_text(14u, 12u, 2u, 0xE8F4FDu, "[]");
+    send_text(44u, 12u, 2u, 0xE8F4FDu, "HouseOS");
+}
 
-    update_terminal_geometry();
+static void paint_panel(hq_widget_t *self, const hq_event_t *ev) {
+    (void)self;
+    (void)ev;
+    send_rect(0u, TOP_H, PANEL_W, g_height - TOP_H, 0x14202Au);
+    send_rect(PANEL_W - 2u, TOP_H, 2u, g_height - TOP_H, 0x365367u);
+}
 
-    send_rect(tx, ty, tw, th, "0F151B");
-    send_frame(tx, ty, tw, th, "5FA6D8");
-    send_rect(tx, ty, tw, 26u, "17232E");
-    send_text(tx + 8u, ty + 8u, 2u, "E8F3FB", "Terminal");
-    send_text(tx + tw - 18u, ty + 8u, 2u, "F28A8A", "x");
+static void paint_button(hq_widget_t *self, const hq_event_t *ev) {
+    uint32_t i = self->obj.id - WID_BTN0;
+    const ui_button_t *b;
+    (void)ev;
+    if (i >= BTN_COUNT) return;
+    b = &g_btn[i];
+    send_rect(b->x, b->y, b->w, b->h, g_btn_hover[i] ? 0x355167u : 0x243847u);
+    send_rect(b->x, b->y, b->w, 2u, 0x7EB5DEu);
+    send_text(b->x + 10u, b->y + 13u, 2u, 0xF2FAFFu, b->label);
+}
 
-    for (uint32_t y = 0; y < g_term_rows; y++) {
-        uint32_t len = g_term_cols;
-        while (len > 0u && g_term_buf[y][len - 1u] == ' ') len--;
-        g_term_buf[y][len] = '\0';
-        cy = ty + 30u + y * 16u;
-        if (len > 0u) send_text(tx + 10u, cy, 2u, "CFE3F4", g_term_buf[y]);
-        g_term_buf[y][len] = ' ';
-    }
+static void paint_desk(hq_widget_t *self, const hq_event_t *ev) {
+    uint32_t cx = PANEL_W + 36u;
+    uint32_t cy = TOP_H + 34u;
+    (void)self;
+    (void)ev;
+    send_rect(PANEL_W, TOP_H, g_width - PANEL_W, g_height - TOP_H, 0x0B141Du);
+    if (g_term_visible) return;
+    send_text(cx, cy, 2u, 0xCFE4F4u, "Desktop compositor is running");
+    send_text(cx, cy + 32u, 2u, 0xAFCADBu, "Open Terminal from the left panel");
+    send_text(cx, cy + 64u, 2u, 0xAFCADBu, "Shortcut: Ctrl+Alt+T");
+}
 
-    if (g_term_focus && ((g_tick_ms / 500u) % 2u) == 0u) {
+static void paint_term(hq_widget_t *self, const hq_event_t *ev) {
+    uint32_t tx = (uint32_t)self->rect.x;
+    uint32_t ty = (uint32_t)self->rect.y;
+    uint32_t tw = (uint32_t)self->rect.w;
+    uint32_t th = (uint32_t)self->rect.h;
+    (void)ev;
+    send_rect(tx, ty, tw, th, 0x0F151Bu);
+    send_frame(tx, ty, tw, th, 0x5FA6D8u);
+    send_rect(tx, ty, tw, 26u, 0x17232Eu);
+    send_text(tx + 8u, ty + 8u, 2u, 0xE8F3FBu, "Terminal");
+    send_text(tx + tw - 18u, ty + 8u, 2u, 0xF28A8Au, "x");
+}
+
+static void paint_row(hq_widget_t *self, const hq_event_t *ev) {
+    uint32_t y = self->obj.id - WID_ROW0;
+    uint32_t tx = (uint32_t)g_w_term.rect.x;
+    uint32_t tw = (uint32_t)g_w_term.rect.w;
+    uint32_t cy = (uint32_t)self->rect.y;
+    uint32_t len = g_term_cols;
+    (void)ev;
+    if (y >= g_term_rows) return;
+
+    send_rect((uint32_t)self->rect.x, cy, (uint32_t)self->rect.w, (uint32_t)self->rect.h, 0x0F151Bu);
+    while (len > 0u && g_term_buf[y][len - 1u] == ' ') len--;
+    g_term_buf[y][len] = '\0';
+    if (len > 0u) send_text(tx + 10u, cy, 2u, 0xCFE3F4u, g_term_buf[y]);
+    g_term_buf[y][len] = ' ';
+
+    if (g_term_focus && g_term_blink && y == g_term_cur_y) {
         uint32_t cx = tx + 10u + g_term_cur_x * 12u;
-        uint32_t yy = ty + 30u + g_term_cur_y * 16u + 13u;
-        if (cx + 10u < tx + tw && yy + 2u < ty + th) send_rect(cx, yy, 10u, 2u, "E6F0F8");
+        if (cx + 10u < tx + tw) send_rect(cx, cy + 13u, 10u, 2u, 0xE6F0F8u);
     }
 }
 
-static void render_desktop(void) {
-    uint32_t top_h = 44u;
-    uint32_t panel_w = 200u;
+static void paint_toast(hq_widget_t *self, const hq_event_t *ev) {
+    uint32_t tx = (uint32_t)self->rect.x;
+    uint32_t ty = (uint32_t)self->rect.y;
+    uint32_t tw = (uint32_t)self->rect.w;
+    (void)ev;
+    if (!g_toast[0]) return;
+    send_rect(tx, ty, tw, 40u, 0x24384Au);
+    send_rect(tx, ty, tw, 2u, 0x87C0EAu);
+    send_text(tx + 12u, ty + 14u, 2u, 0xECF7FFu, g_toast);
+}
+
+static void cursor_fill(dev_fb_cursor_t *cur, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t argb) {
+    for (uint32_t row = y; row < y + h; row++) {
+        for (uint32_t col = x; col < x + w; col++) cur->pixels[row * cur->width + col] = argb;
+    }
+}
 
-    send_clear("0B141D");
-    send_rect(0u, 0u, g_width, top_h, "1A2732");
-    send_rect(0u, top_h - 2u, g_width, 2u, "4E8DBB");
-    send_text(14u, 12u, 2u, "E8F4FD", "[]");
-    send_text(44u, 12u, 2u, "E8F4FD", "HouseOS");
+static void setup_cursor(void) {
+    static dev_fb_cursor_t cur;
+    memset(&cur, 0, sizeof(cur));
+    cur.width = 10u;
+    cur.height = 14u;
+    cursor_fill(&cur, 1u, 1u, 2u, 13u, 0xFF000000u);
+    cursor_fill(&cur, 1u, 1u, 9u, 2u, 0xFF000000u);
+    cursor_fill(&cur, 0u, 0u, 2u, 13u, 0xFFF5F8FBu);
+    cursor_fill(&cur, 0u, 0u, 9u, 2u, 0xFFF5F8FBu);
+    g_fd_vesa = open("/dev/vesa", 0);
+    if (g_fd_vesa >= 0 && ioctl(g_fd_vesa, DEV_IOCTL_VESA_SET_CURSOR, &cur) != 0) {
+        close(g_fd_vesa);
+        g_fd_vesa = -1;
+    }
+}
+
+static void show_cursor(int show) {
+    uint32_t on = show ? 1u : 0u;
+    if (g_fd_vesa < 0 || show == g_cursor_shown) return;
+    if (ioctl(g_fd_vesa, DEV_IOCTL_VESA_SHOW_CURSOR, &on) == 0) g_cursor_shown = show;
+}
+
+static void add_widget(hq_widget_t *parent, hq_widget_t *w, uint32_t id, ui_rect_t r, hq_widget_paint_fn paint) {
+    hq_widget_init(w, id);
+    hq_widget_set_geometry(w, r);
+    w->on_paint = paint;
+    hq_widget_add_child(parent, w);
+}
 
-    send_rect(0u, top_h, panel_w, g_height - top_h, "14202A");
-    send_rect(panel_w - 2u, top_h, 2u, g_height - top_h, "365367");
+static void build_ui(void) {
+    uint32_t tw = g_width / 2u;
 
+    hq_widget_init(&g_ui_root, WID_ROOT);
+    hq_widget_set_geometry(&g_ui_root, (ui_rect_t){0, 0, (int)g_width, (int)g_height});
+
+    add_widget(&g_ui_root, &g_w_top, WID_TOP, (ui_rect_t){0, 0, (int)g_width, (int)TOP_H}, paint_top);
+    add_widget(&g_ui_root, &g_w_panel, WID_PANEL,
+               (ui_rect_t){0, (int)TOP_H, (int)PANEL_W, (int)(g_height - TOP_H)}, paint_panel);
     for (uint32_t i = 0; i < BTN_COUNT; i++) {
         const ui_button_t *b = &g_btn[i];
-        int hover = point_in(g_state.mx, g_state.my, b);
-        send_rect(b->x, b->y, b->w, b->h, hover ? "355167" : "243847");
-        send_rect(b->x, b->y, b->w, 2u, "7EB5DE");
-        send_text(b->x + 10u, b->y + 13u, 2u, "F2FAFF", b->label);
+        add_widget(&g_w_panel, &g_w_btn[i], WID_BTN0 + i,
+                   (ui_rect_t){(int)b->x, (int)b->y, (int)b->w, (int)b->h}, paint_button);
     }
+    add_widget(&g_ui_root, &g_w_desk, WID_DESK,
+               (ui_rect_t){(int)PANEL_W, (int)TOP_H, (int)(g_width - PANEL_W), (int)(g_height - TOP_H)}, paint_desk);
 
-    if (g_term_visible) {
-        draw_terminal();
-    } else {
-        uint32_t cx = panel_w + 36u;
-        uint32_t cy = top_h + 34u;
-        send_text(cx, cy, 2u, "CFE4F4", "Desktop compositor is running");
-        send_text(cx, cy + 32u, 2u, "AFCADB", "Open Terminal from the left panel");
-        send_text(cx, cy + 64u, 2u, "AFCADB", "Shortcut: Ctrl+Alt+T");
+    add_widget(&g_ui_root, &g_w_term, WID_TERM, (ui_rect_t){0, 0, 0, 0}, paint_term);
+    hq_widget_set_visible(&g_w_term, 0);
+    for (uint32_t y = 0; y < TERM_ROWS_MAX; y++) {
+        add_widget(&g_w_term, &g_w_row[y], WID_ROW0 + y, (ui_rect_t){0, 0, 0, 0}, paint_row);
     }
+    update_terminal_geometry();
+
+    add_widget(&g_ui_root, &g_w_toast, WID_TOAST,
+               (ui_rect_t){(int)((g_width - tw) / 2u), (int)(g_height - 72u), (int)tw, 40}, paint_toast);
+    hq_widget_set_visible(&g_w_toast, 0);
+
+    hq_app_init(&g_ui_app, &g_ui_root);
+}
+
+static int ms_until(uint32_t due, uint32_t now) {
+    return ((int32_t)(due - now) > 0) ? (int)(due - now) : 0;
+}
 
-    if (g_toast_ttl_ms > 0u && g_toast[0]) {
-        uint32_t tw = g_width / 2u;
-        uint32_t tx = (g_width - tw) / 2u;
-        uint32_t ty = g_height - 72u;
-        send_rect(tx, ty, tw, 40u, "24384A");
-        send_rect(tx, ty, tw, 2u, "87C0EA");
-        send_text(tx + 12u, ty + 14u, 2u, "ECF7FF", g_toast);
+static int next_timeout(uint32_t now) {
+    int timeout = IDLE_POLL_MS;
+    if (g_active && g_term_visible && g_term_focus) {
+        int t = ms_until(g_blink_due, now);
+        if (t < timeout) timeout = t;
+    }
+    if (g_w_toast.visible) {
+        int t = ms_until(g_toast_until, now);
+        if (t < timeout) timeout = t;
     }
+    return timeout;
+}
 
-    draw_cursor(g_state.mx, g_state.my);
-    send_cmd("PRESENT");
+static void run_timers(uint32_t now) {
+    if (g_w_toast.visible && (int32_t)(now - g_toast_until) >= 0) hide_toast();
+    if (g_term_visible && g_term_focus && (int32_t)(now - g_blink_due) >= 0) {
+        g_term_blink ^= 1u;
+        g_blink_due = now + BLINK_MS;
+        if (g_term_cur_y < g_term_rows) hq_widget_invalidate(&g_w_row[g_term_cur_y]);
+    }
 }
 
 int main(int argc, char **argv) {
-    int need_redraw = 1;
     (void)argc;
     (void)argv;
 
     strcpy(g_state.mode, "unknown");
     strcpy(g_state.ip, "0.0.0.0");
-    g_prev = g_state;
     term_clear();
 
     detect_screen();
@@ -875,34 +1114,38 @@ int main(int argc, char **argv) {
     g_dst.sin_port = htons(PORT_GFXD);
     g_dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
 
-    hq_widget_init(&g_ui_root, 1u);
-    hq_widget_set_geometry(&g_ui_root, (ui_rect_t){0, 0, (int)g_width, (int)g_height});
-    hq_app_init(&g_ui_app, &g_ui_root);
+    build_ui();
+    setup_cursor();
 
     while (g_ui_app.running) {
-        (void)hq_app_process_once(&g_ui_app);
+        struct pollfd pfd[2];
+        nfds_t nfds = 1;
         int active = is_target_tty_active();
-        poll_packets();
-        process_events(active, &need_redraw);
 
-        if (pump_pty_output()) need_redraw = 1;
-        if (state_changed()) need_redraw = 1;
-        if ((g_tick_ms % 1000u) == 0u) need_redraw = 1;
+        if (active && !g_active) hq_widget_invalidate_all(&g_ui_root);
+        g_active = active;
 
-        if (g_toast_ttl_ms > 0u) {
-            if (g_toast_ttl_ms > 20u) g_toast_ttl_ms -= 20u;
-            else g_toast_ttl_ms = 0u;
-            need_redraw = 1;
-        }
+        poll_packets();
+        process_events();
+        (void)pump_pty_output();
+        run_timers(get_ticks() * 10u);
 
-        if (active && need_redraw) {
-            render_desktop();
-            g_prev = g_state;
-            need_redraw = 0;
+        if (g_active) {
+            (void)hq_app_process_once(&g_ui_app);
+            if (g_batch_ops) send_present();
         }
-
-        sleep(active ? 20u : 40u);
-        g_tick_ms += active ? 20u : 40u;
+        show_cursor(g_active);
+
+        pfd[0].fd = g_sock_in;
+        pfd[0].events = POLLIN;
+        pfd[0].revents = 0;
+        if (g_term_ready && g_fd_ptm >= 0) {
+            pfd[1].fd = g_fd_ptm;
+            pfd[1].events = POLLIN;
+            pfd[1].revents = 0;
+            nfds = 2;
+        }
+        (void)poll(pfd, nfds, next_timeout(get_ticks() * 10u));
     }
     return 0;
 }
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+#define GFX_PROTO_MAGIC 0x42584647u
+#define GFX_PROTO_VERSION 1u
+#define GFX_BATCH_MAX 4096u
+#define GFX_TEXT_MAX 240u
+
+enum {
+    GFX_OP_CLEAR = 1,
+    GFX_OP_RECT = 2,
+    GFX_OP_FRAME = 3,
+    GFX_OP_TEXT = 4,
+    GFX_OP_DAMAGE = 5,
+    GFX_OP_PRESENT = 6,
+    GFX_OP_CLIP = 7,
+};
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t op_count;
+    uint32_t seq;
+    uint32_t bytes;
+} gfx_batch_hdr_t;
+
+typedef struct {
+    uint16_t type;
+    uint16_t size;
+} gfx_op_hdr_t;
+
+typedef struct {
+    gfx_op_hdr_t hdr;
+    uint32_t color;
+} gfx_op_clear_t;
+
+typedef struct {
+    gfx_op_hdr_t hdr;
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint32_t color;
+} gfx_op_rect_t;
+
+typedef struct {
+    gfx_op_hdr_t hdr;
+    uint16_t x;
+    uint16_t y;
+    uint16_t scale;
+    uint16_t len;
+    uint32_t color;
+} gfx_op_text_t;
+
+typedef struct {
+    gfx_op_hdr_t hdr;
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+} gfx_op_damage_t;
+
+typedef gfx_op_damage_t gfx_op_clip_t;
+
+typedef struct {
+    gfx_op_hdr_t hdr;
+} gfx_op_present_t;
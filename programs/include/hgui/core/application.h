@@ -11,6 +11,7 @@ typedef struct {
     uint8_t running;
     uint8_t process_paint_on_tick;
     uint32_t tick_counter;
+    uint32_t painted;
     hq_event_t queue[HQ_EVENT_QUEUE_CAP];
     uint32_t q_head;
     uint32_t q_tail;
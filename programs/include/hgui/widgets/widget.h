@@ -21,6 +21,7 @@ struct hq_widget {
     ui_rect_t rect;
     uint8_t visible;
     uint8_t enabled;
+    uint8_t dirty;
     hq_widget_paint_fn on_paint;
     hq_widget_event_fn on_widget_event;
     hq_vbox_layout_t vbox;
@@ -35,3 +36,8 @@ void hq_widget_set_enabled(hq_widget_t *w, int enabled);
 void hq_widget_enable_vbox(hq_widget_t *w, uint16_t item_height, uint16_t spacing, uint16_t padding);
 void hq_widget_apply_layout(hq_widget_t *w);
 int hq_widget_dispatch(hq_widget_t *w, const hq_event_t *ev);
+void hq_widget_invalidate(hq_widget_t *w);
+void hq_widget_invalidate_rect(hq_widget_t *root, ui_rect_t rect);
+void hq_widget_invalidate_all(hq_widget_t *root);
+int hq_widget_paint_dirty(hq_widget_t *root, const hq_event_t *ev);
+int hq_widget_paint_region(hq_widget_t *root, ui_rect_t rect, const hq_event_t *ev);
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdlib.h>
+
+struct mallinfo {
+    int arena;
+    int ordblks;
+    int smblks;
+    int hblks;
+    int hblkhd;
+    int usmblks;
+    int fsmblks;
+    int uordblks;
+    int fordblks;
+    int keepcost;
+};
+
+struct mallinfo mallinfo(void);
+size_t malloc_usable_size(void *ptr);
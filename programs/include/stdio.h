@@ -4,11 +4,24 @@
 #include <stddef.h>
 #include <stdarg.h>
 
+#define EOF (-1)
+#define BUFSIZ 1024
+
+#define _IOFBF 0
+#define _IOLBF 1
+#define _IONBF 2
+
 typedef struct FILE {
     int fd;
     int eof;
     int error;
     int mode;
+    int buf_mode;
+    char *buf;
+    uint32_t buf_size;
+    uint32_t w_len;
+    uint32_t r_pos;
+    uint32_t r_len;
 } FILE;
 
 extern FILE *stdin;
@@ -18,6 +31,9 @@ extern FILE *stderr;
 int fileno(FILE *stream);
 FILE *fopen(const char *path, const char *mode);
 int fclose(FILE *stream);
+int fflush(FILE *stream);
+int setvbuf(FILE *stream, char *buf, int mode, size_t size);
+void setbuf(FILE *stream, char *buf);
 size_t fread(void *ptr, size_t size, size_t nmemb, FILE *stream);
 size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream);
 int fgetc(FILE *stream);
@@ -1,4 +1,10 @@
 #pragma once
 
+#include <stddef.h>
+
 void utoa(unsigned int value, char *buf, unsigned int base);
 void exit(int code);
+void *malloc(size_t size);
+void free(void *ptr);
+void *calloc(size_t num, size_t size);
+void *realloc(void *ptr, size_t size);
@@ -15,6 +15,8 @@
 #define EISDIR 21
 #define EINVAL 22
 #define ENFILE 23
+#define ESPIPE 29
+#define EPIPE 32
 #define ENOSYS 38
 #define ENOTSUP 95
 #define ETIMEDOUT 110
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stddef.h>
+
+#define MADV_DONTNEED 4
+
+int madvise(void *addr, size_t len, int advice);
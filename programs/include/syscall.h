@@ -53,6 +53,12 @@ enum {
     SYSCALL_FORK = 42,
     SYSCALL_POLL = 43,
     SYSCALL_SELECT = 44,
+    SYSCALL_SET_NICE = 45,
+    SYSCALL_GET_NICE = 46,
+    SYSCALL_FSYNC = 47,
+    SYSCALL_BRK = 48,
+    SYSCALL_MADVISE = 49,
+    SYSCALL_COPY_FILE_RANGE = 50,
 };
 
 uint32_t syscall0(uint32_t n);
@@ -79,10 +85,13 @@ int32_t rmdir(const char *path);
 int32_t link(const char *oldpath, const char *newpath);
 int32_t list(const char *path, char *buf, uint32_t size);
 ssize_t append(int fd, const void *buf, size_t size);
+ssize_t copy_file_range(int in_fd, int out_fd, size_t count);
 int32_t spawn(const char *path, const char *tty);
 int32_t spawnv(const char *path, const char *tty, const char *cmdline);
 int32_t task_state(int32_t pid);
 int32_t task_kill(int32_t pid, int32_t sig);
+int32_t task_set_nice(int32_t pid, int32_t nice);
+int32_t task_get_nice(int32_t pid, int32_t *nice_out);
 int32_t waitpid(int32_t pid, int32_t *status, uint32_t options);
 int32_t mount(const char *fs_name, const char *mount_path);
 int32_t umount(const char *mount_path);
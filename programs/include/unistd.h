@@ -26,6 +26,7 @@ pid_t getppid(void);
 int access(const char *path, int mode);
 int isatty(int fd);
 int usleep(useconds_t usec);
+int nice(int inc);
 pid_t fork(void);
 int pipe(int fd[2]);
 off_t lseek(int fd, off_t offset, int whence);
@@ -39,3 +40,5 @@ int execve(const char *path, char *const argv[], char *const envp[]);
 int execvp(const char *file, char *const argv[]);
 int execl(const char *path, const char *arg0, ...);
 int fsync(int fd);
+int brk(void *addr);
+void *sbrk(intptr_t increment);
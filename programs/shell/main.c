@@ -1,5 +1,7 @@
 #include <syscall.h>
 #include <devctl.h>
+#include <fcntl.h>
+#include <sys/wait.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
@@ -12,6 +14,8 @@
 #define MAX_VAR_VALUE 160
 #define MAX_HISTORY 64
 #define MAX_HISTORY_LINE 256
+#define MAX_PIPE_STAGES 8
+#define PIPE_CHUNK 512
 
 static char g_path[128] = "/bin";
 static char g_pwd[128] = "/";
@@ -297,6 +301,22 @@ static int current_tty_path(char *out, uint32_t cap) {
     return 0;
 }
 
+static int tty_claim(int32_t pid) {
+    char tty[64];
+    int fd;
+    if (current_tty_path(tty, sizeof(tty)) != 0) return -1;
+    fd = open(tty, 0);
+    if (fd >= 0) (void)ioctl(fd, DEV_IOCTL_TTY_SET_FG_PID, &pid);
+    return fd;
+}
+
+static void tty_release(int fd) {
+    int32_t none = -1;
+    if (fd < 0) return;
+    (void)ioctl(fd, DEV_IOCTL_TTY_SET_FG_PID, &none);
+    close(fd);
+}
+
 static int spawn_and_wait(const char *path, const char *cmdline) {
     char tty[64];
     const char *tty_path = "/dev/tty/1";
@@ -306,23 +326,17 @@ static int spawn_and_wait(const char *path, const char *cmdline) {
 
     if (!path || path[0] != '/') return -1;
     if (current_tty_path(tty, sizeof(tty)) == 0) tty_path = tty;
+    fflush(stdout);
 
     pid = spawnv(path, tty_path, cmdline ? cmdline : "");
     if (pid < 0) return -1;
-    tty_fd = open(tty_path, 0);
-    if (tty_fd >= 0) {
-        (void)ioctl(tty_fd, DEV_IOCTL_TTY_SET_FG_PID, &pid);
-    }
+    tty_fd = tty_claim(pid);
     for (;;) {
         st = task_state(pid);
         if (st < 0 || st == 3) break;
         yield();
     }
-    if (tty_fd >= 0) {
-        int32_t none = -1;
-        (void)ioctl(tty_fd, DEV_IOCTL_TTY_SET_FG_PID, &none);
-        close(tty_fd);
-    }
+    tty_release(tty_fd);
     return 0;
 }
 
@@ -337,24 +351,22 @@ static int is_elf_file(const char *path) {
     return (hdr[0] == 0x7F && hdr[1] == 'E' && hdr[2] == 'L' && hdr[3] == 'F');
 }
 
-static int try_exec_from_path(const char *name, const char *cmdline) {
-    char full[192];
-    char abs_name[160];
-
+static int resolve_command(const char *name, char *out, uint32_t cap) {
     if (strchr(name, '/')) {
-        if (normalize_path(name, abs_name, sizeof(abs_name)) != 0) return -1;
-        if (!is_elf_file(abs_name)) return -1;
-        return spawn_and_wait(abs_name, cmdline);
-    }
-
-    {
+        if (normalize_path(name, out, cap) != 0) return -1;
+    } else {
         uint32_t nlen = (uint32_t)strlen(name);
-        if (nlen + 6 >= sizeof(full)) return -1;
-        memcpy(full, "/bin/", 5);
-        memcpy(full + 5, name, nlen);
-        full[5 + nlen] = '\0';
+        if (nlen + 6 >= cap) return -1;
+        memcpy(out, "/bin/", 5);
+        memcpy(out + 5, name, nlen);
+        out[5 + nlen] = '\0';
     }
-    if (!is_elf_file(full)) return -1;
+    return is_elf_file(out) ? 0 : -1;
+}
+
+static int try_exec_from_path(const char *name, const char *cmdline) {
+    char full[192];
+    if (resolve_command(name, full, sizeof(full)) != 0) return -1;
     return spawn_and_wait(full, cmdline);
 }
 
@@ -625,41 +637,6 @@ static void redir_spec_init(redir_spec_t *r) {
     r->err_append = 0;
 }
 
-static int read_file_into(const char *path, char *out, uint32_t cap) {
-    int fd;
-    int32_t n;
-    fd = open(path, 0);
-    if (fd < 0) return -1;
-    n = read(fd, out, cap - 1);
-    if (n < 0) {
-        close(fd);
-        return -1;
-    }
-    out[(uint32_t)n] = '\0';
-    close(fd);
-    return 0;
-}
-
-static int write_text_to_file(const char *path, const char *text, int append_mode) {
-    int fd = open(path, 1);
-    uint32_t n;
-    if (fd < 0) return -1;
-    n = (uint32_t)strlen(text);
-    if (append_mode) {
-        if (append(fd, text, n) < 0) {
-            close(fd);
-            return -1;
-        }
-    } else {
-        if (write(fd, text, n) < 0) {
-            close(fd);
-            return -1;
-        }
-    }
-    close(fd);
-    return 0;
-}
-
 static int parse_redirections(const char *src, redir_spec_t *out) {
     uint32_t i = 0;
     uint32_t w = 0;
@@ -765,198 +742,209 @@ static int parse_redirections(const char *src, redir_spec_t *out) {
     return 0;
 }
 
-static int capture_simple_io(const char *cmd, const char *in_data, char *out, uint32_t out_cap, char *err, uint32_t err_cap) {
-    char argv[MAX_ARGS][MAX_TOKEN];
-    int argc = 0;
-    uint32_t olen = 0;
-    uint32_t elen = 0;
-    char abs[160];
-    char buf[256];
+static int write_full(int fd, const char *buf, uint32_t n) {
+    while (n > 0) {
+        int32_t w = write(fd, buf, n);
+        if (w <= 0) return -1;
+        buf += w;
+        n -= (uint32_t)w;
+    }
+    return 0;
+}
 
-    out[0] = '\0';
-    err[0] = '\0';
-    if (parse_argv(cmd, argv, &argc) != 0 || argc == 0) return -1;
+static int copy_stream(int in_fd, int out_fd, int tee_fd) {
+    char buf[PIPE_CHUNK];
+    for (;;) {
+        int32_t n = read(in_fd, buf, sizeof(buf));
+        if (n == 0) return 0;
+        if (n < 0) return -1;
+        if (tee_fd >= 0 && append(tee_fd, buf, (uint32_t)n) < 0) return -1;
+        if (write_full(out_fd, buf, (uint32_t)n) != 0) return -1;
+    }
+}
+
+/* Built-ins that can run as a pipeline stage; -2 means "not a built-in". */
+static int run_stage_builtin(char argv[MAX_ARGS][MAX_TOKEN], int argc) {
+    char abs[160];
+    char buf[512];
+    int fd;
+    int rc;
 
     if (strcmp(argv[0], "echo") == 0) {
         for (int i = 1; i < argc; i++) {
-            if (i > 1 && append_char(out, out_cap, &olen, ' ') != 0) return -1;
-            if (append_text(out, out_cap, &olen, argv[i]) != 0) return -1;
+            if (i > 1) fputc(' ', stdout);
+            fputs(argv[i], stdout);
         }
-        if (append_char(out, out_cap, &olen, '\n') != 0) return -1;
+        fputc('\n', stdout);
         return 0;
     }
 
     if (strcmp(argv[0], "pwd") == 0) {
-        if (append_text(out, out_cap, &olen, g_pwd) != 0) return -1;
-        if (append_char(out, out_cap, &olen, '\n') != 0) return -1;
+        fprintf(stdout, "%s\n", g_pwd);
         return 0;
     }
 
     if (strcmp(argv[0], "ls") == 0) {
         const char *target = (argc >= 2) ? argv[1] : g_pwd;
-        int32_t n;
-        if (normalize_path(target, abs, sizeof(abs)) != 0) {
-            (void)append_text(err, err_cap, &elen, "ls failed\n");
-            return -1;
-        }
-        n = list(abs, buf, sizeof(buf));
-        if (n < 0) {
-            (void)append_text(err, err_cap, &elen, "ls failed\n");
-            return -1;
+        if (normalize_path(target, abs, sizeof(abs)) != 0 || list(abs, buf, sizeof(buf)) < 0) {
+            fprintf(stderr, "ls failed\n");
+            return 1;
         }
-        if (append_text(out, out_cap, &olen, buf) != 0) return -1;
-        if (append_char(out, out_cap, &olen, '\n') != 0) return -1;
+        fprintf(stdout, "%s\n", buf);
         return 0;
     }
 
     if (strcmp(argv[0], "cat") == 0) {
-        int fd;
-        if (argc == 1) {
-            if (append_text(out, out_cap, &olen, in_data ? in_data : "") != 0) return -1;
-            return 0;
-        }
-        if (normalize_path(argv[1], abs, sizeof(abs)) != 0) {
-            (void)append_text(err, err_cap, &elen, "cat open failed\n");
-            return -1;
-        }
-        fd = open(abs, 0);
-        if (fd < 0) {
-            (void)append_text(err, err_cap, &elen, "cat open failed\n");
-            return -1;
-        }
-        {
-            int32_t n = read(fd, buf, sizeof(buf));
-            if (n > 0) {
-                for (int32_t i = 0; i < n; i++) {
-                    if (append_char(out, out_cap, &olen, buf[i]) != 0) {
-                        close(fd);
-                        return -1;
-                    }
-                }
-            } else if (n < 0) {
-                close(fd);
-                (void)append_text(err, err_cap, &elen, "cat open failed\n");
-                return -1;
+        if (argc == 1) return copy_stream(0, 1, -1) == 0 ? 0 : 1;
+        rc = 0;
+        for (int i = 1; i < argc; i++) {
+            if (normalize_path(argv[i], abs, sizeof(abs)) != 0 || (fd = open(abs, O_RDONLY)) < 0) {
+                fprintf(stderr, "cat open failed\n");
+                rc = 1;
+                continue;
             }
+            if (copy_stream(fd, 1, -1) != 0) rc = 1;
+            close(fd);
         }
-        close(fd);
-        return 0;
+        return rc;
     }
 
     if (strcmp(argv[0], "tee") == 0) {
-        int fd;
-        const char *src = in_data ? in_data : "";
-        uint32_t nsrc = (uint32_t)strlen(src);
         if (argc < 2) {
-            (void)append_text(err, err_cap, &elen, "usage: tee <path>\n");
-            return -1;
-        }
-        if (normalize_path(argv[1], abs, sizeof(abs)) != 0) {
-            (void)append_text(err, err_cap, &elen, "tee open failed\n");
-            return -1;
+            fprintf(stderr, "usage: tee <path>\n");
+            return 1;
         }
-        fd = open(abs, 1);
-        if (fd < 0) {
-            (void)append_text(err, err_cap, &elen, "tee open failed\n");
-            return -1;
+        if (normalize_path(argv[1], abs, sizeof(abs)) != 0 || (fd = open(abs, O_WRONLY | O_CREAT)) < 0) {
+            fprintf(stderr, "tee open failed\n");
+            return 1;
         }
-        if (nsrc != 0 && append(fd, src, nsrc) < 0) {
+        rc = copy_stream(0, 1, fd) == 0 ? 0 : 1;
+        close(fd);
+        return rc;
+    }
+
+    return -2;
+}
+
+static int redirect_fd(const char *path, int flags, int target) {
+    int fd = open(path, flags);
+    if (fd < 0) return -1;
+    if (fd != target) {
+        if (dup2(fd, target) < 0) {
             close(fd);
-            (void)append_text(err, err_cap, &elen, "tee write failed\n");
             return -1;
         }
         close(fd);
-        if (append_text(out, out_cap, &olen, src) != 0) return -1;
-        return 0;
     }
+    return 0;
+}
 
-    (void)append_text(err, err_cap, &elen, "unknown command\n");
-    return -1;
+/* Runs in the forked child with its pipe ends already on fds 0 and 1. */
+static void stage_exec(const redir_spec_t *spec) {
+    char argv[MAX_ARGS][MAX_TOKEN];
+    char full[192];
+    char cmdline[512];
+    int argc = 0;
+    int rc;
+
+    if ((spec->in_path[0] && redirect_fd(spec->in_path, O_RDONLY, 0) != 0) ||
+        (spec->out_path[0] && redirect_fd(spec->out_path, O_WRONLY | O_CREAT | (spec->out_append ? O_APPEND : 0), 1) != 0) ||
+        (spec->err_path[0] && redirect_fd(spec->err_path, O_WRONLY | O_CREAT | (spec->err_append ? O_APPEND : 0), 2) != 0)) {
+        fprintf(stderr, "redirect failed\n");
+        exit(1);
+    }
+    if (parse_argv(spec->cmd, argv, &argc) != 0) {
+        fprintf(stderr, "parse error\n");
+        exit(1);
+    }
+    if (argc == 0) exit(0);
+
+    rc = run_stage_builtin(argv, argc);
+    if (rc != -2) exit(rc);
+
+    if (build_cmdline_from_argv(argv, argc, cmdline, sizeof(cmdline)) == 0 &&
+        resolve_command(argv[0], full, sizeof(full)) == 0) {
+        (void)execv(full, cmdline);
+    }
+    fprintf(stderr, "command not found: %s\n", argv[0]);
+    exit(127);
 }
 
-static int exec_with_redir_or_pipe(char *seg) {
+static redir_spec_t g_stage_spec[MAX_PIPE_STAGES];
+
+static int run_pipeline(char *seg) {
+    int32_t pids[MAX_PIPE_STAGES];
+    uint32_t nstages = 0;
+    uint32_t started = 0;
     uint32_t pos = 0;
-    char left[MAX_LINE];
-    char right[MAX_LINE];
-    redir_spec_t lspec;
-    redir_spec_t rspec;
-    char in_data[2048];
-    char out_data[2048];
-    char err_data[512];
-
-    if (split_outside_quotes(seg, '|', &pos)) {
-        int rc;
-        if (pos >= sizeof(left)) return -1;
-        memcpy(left, seg, pos);
-        left[pos] = '\0';
-        strncpy(right, seg + pos + 1, sizeof(right) - 1);
-        right[sizeof(right) - 1] = '\0';
-
-        if (parse_redirections(trim_ws(left), &lspec) != 0 || parse_redirections(trim_ws(right), &rspec) != 0) {
-            fprintf(stderr, "parse error\n");
-            return -1;
-        }
+    int prev_read = -1;
+    int tty_fd;
+    int32_t status = 0;
+    int rc = 0;
 
-        in_data[0] = '\0';
-        if (lspec.in_path[0] && read_file_into(lspec.in_path, in_data, sizeof(in_data)) != 0) {
-            fprintf(stderr, "redirect failed\n");
+    for (;;) {
+        int more = split_outside_quotes(seg, '|', &pos);
+        if (nstages >= MAX_PIPE_STAGES) {
+            fprintf(stderr, "pipeline too long\n");
             return -1;
         }
-        rc = capture_simple_io(trim_ws(lspec.cmd), in_data, out_data, sizeof(out_data), err_data, sizeof(err_data));
-        if (lspec.err_path[0]) (void)write_text_to_file(lspec.err_path, err_data, lspec.err_append);
-        else if (err_data[0]) fprintf(stderr, "%s", err_data);
-        if (rc != 0) return -1;
-
-        in_data[0] = '\0';
-        if (rspec.in_path[0]) {
-            if (read_file_into(rspec.in_path, in_data, sizeof(in_data)) != 0) {
-                fprintf(stderr, "redirect failed\n");
-                return -1;
-            }
-        } else {
-            strncpy(in_data, out_data, sizeof(in_data) - 1);
-            in_data[sizeof(in_data) - 1] = '\0';
-        }
-
-        rc = capture_simple_io(trim_ws(rspec.cmd), in_data, out_data, sizeof(out_data), err_data, sizeof(err_data));
-        if (rspec.out_path[0]) {
-            if (write_text_to_file(rspec.out_path, out_data, rspec.out_append) != 0) fprintf(stderr, "redirect failed\n");
-        } else {
-            write(fileno(stdout), out_data, (uint32_t)strlen(out_data));
-        }
-        if (rspec.err_path[0]) (void)write_text_to_file(rspec.err_path, err_data, rspec.err_append);
-        else if (err_data[0]) fprintf(stderr, "%s", err_data);
-        return rc;
-    }
-
-    if (strchr(seg, '>') || strchr(seg, '<')) {
-        int rc;
-        if (parse_redirections(trim_ws(seg), &lspec) != 0) {
+        if (more) seg[pos] = '\0';
+        if (parse_redirections(trim_ws(seg), &g_stage_spec[nstages]) != 0) {
             fprintf(stderr, "parse error\n");
             return -1;
         }
-        in_data[0] = '\0';
-        if (lspec.in_path[0] && read_file_into(lspec.in_path, in_data, sizeof(in_data)) != 0) {
-            fprintf(stderr, "redirect failed\n");
-            return -1;
+        nstages++;
+        if (!more) break;
+        seg += pos + 1;
+    }
+
+    for (uint32_t i = 0; i < nstages; i++) {
+        int fds[2] = { -1, -1 };
+        int32_t pid;
+        if (i + 1 < nstages && pipe(fds) != 0) {
+            fprintf(stderr, "pipe failed\n");
+            rc = -1;
+            break;
         }
-        rc = capture_simple_io(trim_ws(lspec.cmd), in_data, out_data, sizeof(out_data), err_data, sizeof(err_data));
-        if (lspec.out_path[0]) {
-            if (write_text_to_file(lspec.out_path, out_data, lspec.out_append) != 0) {
-                fprintf(stderr, "redirect failed\n");
-                return -1;
+        pid = fork();
+        if (pid == 0) {
+            if (prev_read >= 0) {
+                (void)dup2(prev_read, 0);
+                close(prev_read);
             }
-        } else {
-            write(fileno(stdout), out_data, (uint32_t)strlen(out_data));
-        }
-        if (lspec.err_path[0]) {
-            (void)write_text_to_file(lspec.err_path, err_data, lspec.err_append);
-        } else if (err_data[0]) {
-            fprintf(stderr, "%s", err_data);
+            if (fds[1] >= 0) {
+                (void)dup2(fds[1], 1);
+                close(fds[1]);
+                close(fds[0]);
+            }
+            stage_exec(&g_stage_spec[i]);
+        }
+        if (prev_read >= 0) close(prev_read);
+        if (fds[1] >= 0) close(fds[1]);
+        prev_read = fds[0];
+        if (pid < 0) {
+            fprintf(stderr, "fork failed\n");
+            rc = -1;
+            break;
         }
-        return rc;
+        pids[started++] = pid;
+    }
+    if (prev_read >= 0) close(prev_read);
+
+    tty_fd = started ? tty_claim(pids[started - 1]) : -1;
+    for (uint32_t i = 0; i < started; i++) {
+        if (waitpid(pids[i], &status, 0) < 0) status = -1;
     }
+    tty_release(tty_fd);
+    if (rc == 0 && (status != 0 || started != nstages)) rc = -1;
+    return rc;
+}
 
+static int exec_with_redir_or_pipe(char *seg) {
+    uint32_t pos = 0;
+    if (split_outside_quotes(seg, '|', &pos) || split_outside_quotes(seg, '>', &pos) || split_outside_quotes(seg, '<', &pos)) {
+        return run_pipeline(seg);
+    }
     return exec_single(seg);
 }
 
@@ -1014,6 +1002,7 @@ int main(int argc, char **argv) {
         int line_rc;
         update_tty_name();
         printf("sh:%s$ ", g_pwd);
+        fflush(stdout);
         line_rc = read_line(line, sizeof(line));
         if (line_rc < 0) continue;
         if (line_rc == 0) {
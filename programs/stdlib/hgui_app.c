@@ -74,6 +74,7 @@ void hq_widget_init(hq_widget_t *w, uint32_t id) {
     hq_object_init(&w->obj, id, 1u);
     w->visible = 1u;
     w->enabled = 1u;
+    w->dirty = 1u;
 }
 
 void hq_widget_add_child(hq_widget_t *parent, hq_widget_t *child) {
@@ -83,11 +84,13 @@ void hq_widget_add_child(hq_widget_t *parent, hq_widget_t *child) {
 
 void hq_widget_set_geometry(hq_widget_t *w, ui_rect_t rect) {
     if (!w) return;
+    if (w->rect.x != rect.x || w->rect.y != rect.y || w->rect.w != rect.w || w->rect.h != rect.h) w->dirty = 1u;
     w->rect = rect;
 }
 
 void hq_widget_set_visible(hq_widget_t *w, int visible) {
     if (!w) return;
+    if (w->visible != (visible ? 1u : 0u)) w->dirty = 1u;
     w->visible = visible ? 1u : 0u;
 }
 
@@ -119,11 +122,8 @@ void hq_widget_apply_layout(hq_widget_t *w) {
     }
 }
 
-int hq_widget_dispatch(hq_widget_t *w, const hq_event_t *ev) {
-    hq_object_t *child;
+static int hq_widget_handle(hq_widget_t *w, const hq_event_t *ev) {
     int handled = 0;
-    if (!hq_widget_accepts(w, ev)) return 0;
-
     if (ev->type == HQ_EVENT_PAINT && w->use_vbox) hq_widget_apply_layout(w);
     if (w->on_widget_event) handled |= w->on_widget_event(w, ev);
     if (!handled && w->obj.on_event) handled |= w->obj.on_event(&w->obj, ev);
@@ -131,6 +131,99 @@ int hq_widget_dispatch(hq_widget_t *w, const hq_event_t *ev) {
         w->on_paint(w, ev);
         handled = 1;
     }
+    return handled;
+}
+
+static int hq_rect_overlaps(ui_rect_t a, ui_rect_t b) {
+    if (a.w <= 0 || a.h <= 0 || b.w <= 0 || b.h <= 0) return 0;
+    if (a.x >= b.x + b.w || b.x >= a.x + a.w) return 0;
+    if (a.y >= b.y + b.h || b.y >= a.y + a.h) return 0;
+    return 1;
+}
+
+static void hq_mark_above(hq_widget_t *node, const hq_widget_t *target, ui_rect_t rect, int *seen) {
+    hq_object_t *child;
+    if (!node->visible) return;
+    if (node == target) *seen = 1;
+    else if (*seen && hq_rect_overlaps(node->rect, rect)) node->dirty = 1u;
+    child = hq_object_first_child(&node->obj);
+    while (child) {
+        hq_mark_above((hq_widget_t*)child, target, rect, seen);
+        child = hq_object_next_sibling(child);
+    }
+}
+
+void hq_widget_invalidate(hq_widget_t *w) {
+    hq_object_t *root;
+    int seen = 0;
+    if (!w) return;
+    w->dirty = 1u;
+    root = &w->obj;
+    while (root->parent) root = root->parent;
+    hq_mark_above((hq_widget_t*)root, w, w->rect, &seen);
+}
+
+void hq_widget_invalidate_rect(hq_widget_t *root, ui_rect_t rect) {
+    hq_object_t *child;
+    if (!root || !root->visible) return;
+    if (!root->dirty && hq_rect_overlaps(root->rect, rect)) hq_widget_invalidate(root);
+    child = hq_object_first_child(&root->obj);
+    while (child) {
+        hq_widget_invalidate_rect((hq_widget_t*)child, rect);
+        child = hq_object_next_sibling(child);
+    }
+}
+
+void hq_widget_invalidate_all(hq_widget_t *root) {
+    hq_object_t *child;
+    if (!root) return;
+    root->dirty = 1u;
+    child = hq_object_first_child(&root->obj);
+    while (child) {
+        hq_widget_invalidate_all((hq_widget_t*)child);
+        child = hq_object_next_sibling(child);
+    }
+}
+
+int hq_widget_paint_dirty(hq_widget_t *root, const hq_event_t *ev) {
+    hq_object_t *child;
+    int painted = 0;
+    if (!root || !ev || !root->visible) return 0;
+    if (root->dirty) {
+        root->dirty = 0u;
+        (void)hq_widget_handle(root, ev);
+        painted++;
+    }
+    child = hq_object_first_child(&root->obj);
+    while (child) {
+        painted += hq_widget_paint_dirty((hq_widget_t*)child, ev);
+        child = hq_object_next_sibling(child);
+    }
+    return painted;
+}
+
+int hq_widget_paint_region(hq_widget_t *root, ui_rect_t rect, const hq_event_t *ev) {
+    hq_object_t *child;
+    int painted = 0;
+    if (!root || !ev || !root->visible) return 0;
+    if (hq_rect_overlaps(root->rect, rect)) {
+        (void)hq_widget_handle(root, ev);
+        painted++;
+    }
+    child = hq_object_first_child(&root->obj);
+    while (child) {
+        painted += hq_widget_paint_region((hq_widget_t*)child, rect, ev);
+        child = hq_object_next_sibling(child);
+    }
+    return painted;
+}
+
+int hq_widget_dispatch(hq_widget_t *w, const hq_event_t *ev) {
+    hq_object_t *child;
+    int handled = 0;
+    if (!hq_widget_accepts(w, ev)) return 0;
+
+    handled |= hq_widget_handle(w, ev);
 
     child = hq_object_first_child(&w->obj);
     while (child) {
@@ -187,6 +280,7 @@ void hq_app_quit(hq_application_t *app) {
 int hq_app_process_once(hq_application_t *app) {
     hq_event_t ev;
     if (!app || !app->root) return -1;
+    app->painted = 0u;
     if (!hq_app_queue_pop(app, &ev)) {
         ev.type = HQ_EVENT_TICK;
         ev.target_id = 0u;
@@ -208,7 +302,7 @@ int hq_app_process_once(hq_application_t *app) {
         paint_ev.arg1 = 0u;
         paint_ev.arg2 = 0u;
         paint_ev.arg3 = 0u;
-        (void)hq_widget_dispatch(app->root, &paint_ev);
+        app->painted = (uint32_t)hq_widget_paint_dirty(app->root, &paint_ev);
     }
     return 0;
 }
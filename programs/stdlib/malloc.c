@@ -0,0 +1,347 @@
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * Every block carries an 8-byte header. Requests up to SMALL_MAX come from
+ * per-size-class bins carved out of runs; a free is a single push onto the
+ * bin and never looks at neighbouring blocks. Larger blocks are boundary
+ * tagged chunks that coalesce on free, live in log2 bins, and grow in place
+ * into a free neighbour or the heap top on realloc. Chunks of LARGE_MIN and
+ * up hand their pages back to the kernel while they sit free.
+ */
+
+#define C_INUSE 1u
+#define C_PINUSE 2u
+#define C_SMALL 4u
+#define C_FLAGS 7u
+
+#define CHUNK_HDR 8u
+#define CHUNK_SPLIT 32u
+#define SMALL_MAX 1024u
+#define SMALL_CLASSES 12u
+#define RUN_MIN 4096u
+#define LARGE_MIN 65536u
+#define TREE_BINS 24u
+#define HEAP_GROW 65536u
+#define TRIM_THRESHOLD 262144u
+#define PAGE 4096u
+#define REQUEST_MAX 0x7FFFF000u
+
+typedef struct chunk {
+    uint32_t prev_size;
+    uint32_t head;
+    struct chunk *next;
+    struct chunk *prev;
+} chunk_t;
+
+#define CHUNK_MIN ((uint32_t)sizeof(chunk_t))
+
+static const uint16_t small_size[SMALL_CLASSES] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024
+};
+
+static chunk_t *small_bin[SMALL_CLASSES];
+static chunk_t *tree_bin[TREE_BINS];
+static uint8_t *heap_base;
+static uint8_t *heap_top;
+static uint8_t *heap_brk;
+
+static inline uint32_t csize(const chunk_t *c) { return c->head & ~C_FLAGS; }
+static inline chunk_t *cnext(chunk_t *c) { return (chunk_t*)((uint8_t*)c + csize(c)); }
+static inline void *cmem(chunk_t *c) { return (uint8_t*)c + CHUNK_HDR; }
+static inline chunk_t *mchunk(void *p) { return (chunk_t*)((uint8_t*)p - CHUNK_HDR); }
+
+static uint32_t small_class(size_t n) {
+    uint32_t i = 0;
+    while (small_size[i] < n) i++;
+    return i;
+}
+
+static uint32_t tree_index(uint32_t size) {
+    uint32_t i = 0;
+    while ((size >> 1) >= CHUNK_MIN && i + 1u < TREE_BINS) {
+        size >>= 1;
+        i++;
+    }
+    return i;
+}
+
+static void bin_insert(chunk_t *c) {
+    chunk_t **bin = &tree_bin[tree_index(csize(c))];
+    c->prev = NULL;
+    c->next = *bin;
+    if (*bin) (*bin)->prev = c;
+    *bin = c;
+}
+
+static void bin_unlink(chunk_t *c) {
+    if (c->prev) c->prev->next = c->next;
+    else tree_bin[tree_index(csize(c))] = c->next;
+    if (c->next) c->next->prev = c->prev;
+}
+
+static int heap_init(void) {
+    void *cur;
+    if (heap_base) return 0;
+    cur = sbrk(0);
+    if (cur == (void*)-1) return -1;
+    heap_base = (uint8_t*)(((uintptr_t)cur + 7u) & ~(uintptr_t)7u);
+    heap_top = heap_base;
+    heap_brk = (uint8_t*)cur;
+    return 0;
+}
+
+static int heap_grow(uint32_t need) {
+    uint32_t want;
+    if (heap_top + need <= heap_brk) return 0;
+    want = (uint32_t)(heap_top + need - heap_brk);
+    want = (want + HEAP_GROW - 1u) & ~(HEAP_GROW - 1u);
+    if (sbrk((intptr_t)want) == (void*)-1) {
+        want = (uint32_t)(heap_top + need - heap_brk);
+        want = (want + PAGE - 1u) & ~(PAGE - 1u);
+        if (sbrk((intptr_t)want) == (void*)-1) return -1;
+    }
+    heap_brk += want;
+    return 0;
+}
+
+static void heap_trim(void) {
+    uintptr_t keep;
+    if ((uint32_t)(heap_brk - heap_top) < TRIM_THRESHOLD) return;
+    keep = (((uintptr_t)heap_top + PAGE - 1u) & ~(uintptr_t)(PAGE - 1u)) + HEAP_GROW;
+    if (keep >= (uintptr_t)heap_brk) return;
+    if (brk((void*)keep) == 0) heap_brk = (uint8_t*)keep;
+}
+
+static void release_pages(chunk_t *c) {
+    uintptr_t start = ((uintptr_t)c + sizeof(chunk_t) + PAGE - 1u) & ~(uintptr_t)(PAGE - 1u);
+    uintptr_t end = ((uintptr_t)c + csize(c)) & ~(uintptr_t)(PAGE - 1u);
+    if (end > start) (void)madvise((void*)start, end - start, MADV_DONTNEED);
+}
+
+static void chunk_free(chunk_t *c) {
+    uint32_t size = csize(c);
+    chunk_t *next = cnext(c);
+
+    if (!(c->head & C_PINUSE)) {
+        chunk_t *prev = (chunk_t*)((uint8_t*)c - c->prev_size);
+        bin_unlink(prev);
+        size += csize(prev);
+        c = prev;
+    }
+    if ((uint8_t*)next == heap_top) {
+        heap_top = (uint8_t*)c;
+        heap_trim();
+        return;
+    }
+    if (!(next->head & C_INUSE)) {
+        bin_unlink(next);
+        size += csize(next);
+        next = (chunk_t*)((uint8_t*)c + size);
+    }
+    c->head = size | C_PINUSE;
+    next->prev_size = size;
+    next->head &= ~C_PINUSE;
+    if (size >= LARGE_MIN) release_pages(c);
+    bin_insert(c);
+}
+
+/* Turns the tail of an in-use chunk beyond `need` into a free chunk. */
+static void chunk_split(chunk_t *c, uint32_t need) {
+    uint32_t size = csize(c);
+    chunk_t *rest;
+    if (size - need < CHUNK_SPLIT) return;
+    c->head = need | (c->head & C_FLAGS);
+    rest = cnext(c);
+    rest->head = (size - need) | C_INUSE | C_PINUSE;
+    chunk_free(rest);
+}
+
+static chunk_t *chunk_from_bins(uint32_t need) {
+    for (uint32_t i = tree_index(need); i < TREE_BINS; i++) {
+        for (chunk_t *c = tree_bin[i]; c; c = c->next) {
+            chunk_t *next;
+            if (csize(c) < need) continue;
+            bin_unlink(c);
+            c->head |= C_INUSE;
+            next = cnext(c);
+            if ((uint8_t*)next != heap_top) next->head |= C_PINUSE;
+            chunk_split(c, need);
+            return c;
+        }
+    }
+    return NULL;
+}
+
+static chunk_t *chunk_alloc(uint32_t need) {
+    chunk_t *c;
+    if (heap_init() != 0) return NULL;
+    c = chunk_from_bins(need);
+    if (c) return c;
+    if (heap_grow(need) != 0) return NULL;
+    c = (chunk_t*)heap_top;
+    c->head = need | C_INUSE | C_PINUSE;
+    heap_top += need;
+    return c;
+}
+
+static uint32_t request_size(size_t n) {
+    uint32_t need = ((uint32_t)n + CHUNK_HDR + 7u) & ~7u;
+    return need < CHUNK_MIN ? CHUNK_MIN : need;
+}
+
+static int small_refill(uint32_t idx) {
+    uint32_t obj = small_size[idx] + CHUNK_HDR;
+    uint32_t run = obj * 8u < RUN_MIN ? RUN_MIN : obj * 8u;
+    chunk_t *c = chunk_alloc(request_size(run - CHUNK_HDR));
+    uint8_t *p;
+    uint8_t *end;
+    if (!c) return -1;
+    p = (uint8_t*)cmem(c);
+    end = (uint8_t*)c + csize(c);
+    for (; p + obj <= end; p += obj) {
+        chunk_t *o = (chunk_t*)p;
+        o->prev_size = idx;
+        o->head = obj | C_SMALL;
+        o->next = small_bin[idx];
+        small_bin[idx] = o;
+    }
+    return 0;
+}
+
+void *malloc(size_t size) {
+    chunk_t *c;
+    if (size > REQUEST_MAX) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (size <= SMALL_MAX) {
+        uint32_t idx = small_class(size);
+        if (!small_bin[idx] && small_refill(idx) != 0) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        c = small_bin[idx];
+        small_bin[idx] = c->next;
+        c->head |= C_INUSE;
+        return cmem(c);
+    }
+    c = chunk_alloc(request_size(size));
+    if (!c) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return cmem(c);
+}
+
+void free(void *ptr) {
+    chunk_t *c;
+    if (!ptr) return;
+    c = mchunk(ptr);
+    if (!(c->head & C_INUSE)) return;
+    if (c->head & C_SMALL) {
+        c->head &= ~C_INUSE;
+        c->next = small_bin[c->prev_size];
+        small_bin[c->prev_size] = c;
+        return;
+    }
+    chunk_free(c);
+}
+
+void *calloc(size_t num, size_t size) {
+    void *p;
+    if (size && num > REQUEST_MAX / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    p = malloc(num * size);
+    if (p) memset(p, 0, num * size);
+    return p;
+}
+
+static int chunk_grow(chunk_t *c, uint32_t need) {
+    chunk_t *next = cnext(c);
+    uint32_t size = csize(c);
+    if ((uint8_t*)next == heap_top) {
+        if (heap_grow(need - size) != 0) return -1;
+        c->head = need | (c->head & C_FLAGS);
+        heap_top = (uint8_t*)c + need;
+        return 0;
+    }
+    if (next->head & C_INUSE) return -1;
+    if (size + csize(next) < need) return -1;
+    bin_unlink(next);
+    c->head = (size + csize(next)) | (c->head & C_FLAGS);
+    next = cnext(c);
+    if ((uint8_t*)next != heap_top) next->head |= C_PINUSE;
+    chunk_split(c, need);
+    return 0;
+}
+
+void *realloc(void *ptr, size_t size) {
+    chunk_t *c;
+    uint32_t have;
+    uint32_t need;
+    void *p;
+
+    if (!ptr) return malloc(size);
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    if (size > REQUEST_MAX) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    c = mchunk(ptr);
+    have = csize(c) - CHUNK_HDR;
+    if (c->head & C_SMALL) {
+        if (size <= have) return ptr;
+    } else {
+        need = request_size(size);
+        if (need <= csize(c)) {
+            chunk_split(c, need);
+            return ptr;
+        }
+        if (chunk_grow(c, need) == 0) return ptr;
+    }
+    p = malloc(size);
+    if (!p) return NULL;
+    memcpy(p, ptr, have < size ? have : size);
+    free(ptr);
+    return p;
+}
+
+size_t malloc_usable_size(void *ptr) {
+    if (!ptr) return 0;
+    return csize(mchunk(ptr)) - CHUNK_HDR;
+}
+
+struct mallinfo mallinfo(void) {
+    struct mallinfo mi;
+    memset(&mi, 0, sizeof(mi));
+    if (!heap_base) return mi;
+    mi.arena = (int)(heap_brk - heap_base);
+    mi.keepcost = (int)(heap_brk - heap_top);
+    for (uint32_t i = 0; i < SMALL_CLASSES; i++) {
+        for (chunk_t *c = small_bin[i]; c; c = c->next) {
+            mi.smblks++;
+            mi.fsmblks += (int)csize(c);
+        }
+    }
+    for (chunk_t *c = (chunk_t*)heap_base; (uint8_t*)c < heap_top; c = cnext(c)) {
+        if (!(c->head & C_INUSE)) {
+            mi.ordblks++;
+            mi.fordblks += (int)csize(c);
+        } else if (csize(c) >= LARGE_MIN) {
+            mi.hblks++;
+            mi.hblkhd += (int)csize(c);
+        }
+    }
+    mi.uordblks = mi.arena - mi.keepcost - mi.fordblks - mi.fsmblks;
+    return mi;
+}
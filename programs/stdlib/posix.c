@@ -35,6 +35,14 @@ int isatty(int fd) {
     return 1;
 }
 
+int nice(int inc) {
+    int32_t cur = 0;
+    if (task_get_nice(0, &cur) != 0) return -1;
+    if (task_set_nice(0, cur + inc) != 0) return -1;
+    if (task_get_nice(0, &cur) != 0) return -1;
+    return (int)cur;
+}
+
 int usleep(useconds_t usec) {
     uint32_t ms;
     if (usec == 0) return 0;
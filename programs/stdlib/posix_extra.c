@@ -6,6 +6,7 @@
 #include <string.h>
 #include <dirent.h>
 #include <sys/utsname.h>
+#include <sys/mman.h>
 #include <stdarg.h>
 
 typedef struct DIR {
@@ -130,7 +131,11 @@ int execl(const char *path, const char *arg0, ...) {
 }
 
 int fsync(int fd) {
-    (void)fd;
+    int32_t r = (int32_t)syscall1(SYSCALL_FSYNC, (uint32_t)fd);
+    if (r < 0) {
+        errno = -r;
+        return -1;
+    }
     return 0;
 }
 
@@ -244,3 +249,38 @@ int uname(struct utsname *buf) {
     strncpy(buf->machine, "i386", sizeof(buf->machine) - 1);
     return 0;
 }
+
+int brk(void *addr) {
+    uint32_t r = syscall1(SYSCALL_BRK, (uint32_t)addr);
+    if (r != (uint32_t)addr) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+void *sbrk(intptr_t increment) {
+    uint32_t cur = syscall1(SYSCALL_BRK, 0);
+    uint32_t want;
+    if ((int32_t)cur < 0) {
+        errno = -(int32_t)cur;
+        return (void*)-1;
+    }
+    if (increment == 0) return (void*)cur;
+    want = cur + (uint32_t)increment;
+    if ((increment > 0 && want < cur) || (increment < 0 && want > cur) ||
+        syscall1(SYSCALL_BRK, want) != want) {
+        errno = ENOMEM;
+        return (void*)-1;
+    }
+    return (void*)cur;
+}
+
+int madvise(void *addr, size_t len, int advice) {
+    int32_t r = (int32_t)syscall3(SYSCALL_MADVISE, (uint32_t)addr, (uint32_t)len, (uint32_t)advice);
+    if (r < 0) {
+        errno = -r;
+        return -1;
+    }
+    return 0;
+}
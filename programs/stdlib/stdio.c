@@ -2,42 +2,122 @@
 #include <stdlib.h>
 #include <string.h>
 #include <syscall.h>
+#include <unistd.h>
+#include <devctl.h>
 
 #define FILE_MODE_READ  1
 #define FILE_MODE_WRITE 2
 #define FILE_MODE_APPEND 4
 
-static FILE g_stdin = { .fd = 0, .eof = 0, .error = 0, .mode = FILE_MODE_READ };
-static FILE g_stdout = { .fd = 1, .eof = 0, .error = 0, .mode = FILE_MODE_WRITE };
-static FILE g_stderr = { .fd = 2, .eof = 0, .error = 0, .mode = FILE_MODE_WRITE };
-static FILE g_fpool[16];
-static uint8_t g_fpool_used[16];
+#define FILE_POOL_SIZE 16
+#define FILE_BUF_AUTO (-1)
+
+static char g_stdin_buf[BUFSIZ];
+static char g_stdout_buf[BUFSIZ];
+static char g_fpool_buf[FILE_POOL_SIZE][BUFSIZ];
+
+static FILE g_stdin = { .fd = 0, .mode = FILE_MODE_READ, .buf_mode = FILE_BUF_AUTO, .buf = g_stdin_buf, .buf_size = BUFSIZ };
+static FILE g_stdout = { .fd = 1, .mode = FILE_MODE_WRITE, .buf_mode = FILE_BUF_AUTO, .buf = g_stdout_buf, .buf_size = BUFSIZ };
+static FILE g_stderr = { .fd = 2, .mode = FILE_MODE_WRITE, .buf_mode = _IONBF };
+static FILE g_fpool[FILE_POOL_SIZE];
+static uint8_t g_fpool_used[FILE_POOL_SIZE];
 
 FILE *stdin = &g_stdin;
 FILE *stdout = &g_stdout;
 FILE *stderr = &g_stderr;
 
-static int write_all(int fd, const char *buf, uint32_t len) {
-    int total = 0;
+static void stream_setup(FILE *stream) {
+    dev_tty_info_t ti;
+    if (stream->buf_mode != FILE_BUF_AUTO) return;
+    if (!stream->buf || stream->buf_size == 0) {
+        stream->buf_mode = _IONBF;
+        return;
+    }
+    stream->buf_mode = (ioctl(stream->fd, DEV_IOCTL_TTY_GET_INFO, &ti) == 0) ? _IOLBF : _IOFBF;
+}
+
+static int write_all(FILE *stream, const char *buf, uint32_t len) {
     while (len > 0) {
-        int32_t n = write(fd, buf, len);
-        if (n <= 0) return (total > 0) ? total : -1;
+        int32_t n;
+        if (stream->mode & FILE_MODE_APPEND) n = append(stream->fd, buf, len);
+        else n = write(stream->fd, buf, len);
+        if (n <= 0) {
+            stream->error = 1;
+            return -1;
+        }
         buf += n;
         len -= (uint32_t)n;
-        total += n;
     }
-    return total;
+    return 0;
+}
+
+static int stream_flush(FILE *stream) {
+    uint32_t len = stream->w_len;
+    if (len == 0) return 0;
+    stream->w_len = 0;
+    return write_all(stream, stream->buf, len);
+}
+
+static void stream_drop_input(FILE *stream) {
+    if (stream->r_pos < stream->r_len) {
+        (void)lseek(stream->fd, -(int32_t)(stream->r_len - stream->r_pos), SEEK_CUR);
+    }
+    stream->r_pos = 0;
+    stream->r_len = 0;
+}
+
+static int stream_put(FILE *stream, const char *p, uint32_t n) {
+    int flush = 0;
+    if (!stream || !(stream->mode & FILE_MODE_WRITE)) return -1;
+    stream_setup(stream);
+    if (stream->r_len) stream_drop_input(stream);
+    if (stream->buf_mode == _IONBF) return write_all(stream, p, n);
+    if (n >= stream->buf_size) {
+        if (stream_flush(stream) != 0) return -1;
+        return write_all(stream, p, n);
+    }
+    if (stream->w_len + n > stream->buf_size && stream_flush(stream) != 0) return -1;
+    memcpy(stream->buf + stream->w_len, p, n);
+    stream->w_len += n;
+    if (stream->buf_mode == _IOLBF) {
+        for (uint32_t i = 0; i < n && !flush; i++) flush = (p[i] == '\n');
+    }
+    return flush ? stream_flush(stream) : 0;
+}
+
+static int stream_begin_read(FILE *stream) {
+    if (!stream || !(stream->mode & FILE_MODE_READ)) return -1;
+    stream_setup(stream);
+    if (stream->w_len && stream_flush(stream) != 0) return -1;
+    if (stream->buf_mode != _IOFBF && stream != stdout && stdout->buf_mode == _IOLBF) (void)stream_flush(stdout);
+    return 0;
+}
+
+static int32_t stream_read_raw(FILE *stream, void *buf, uint32_t size) {
+    int32_t n = read(stream->fd, buf, size);
+    if (n == 0) stream->eof = 1;
+    else if (n < 0) stream->error = 1;
+    return n;
+}
+
+static int stream_fill(FILE *stream) {
+    int32_t n = stream_read_raw(stream, stream->buf, stream->buf_size);
+    if (n <= 0) return -1;
+    stream->r_pos = 0;
+    stream->r_len = (uint32_t)n;
+    return 0;
 }
 
 static int put_c(FILE *stream, char c) {
-    if (!stream) return -1;
-    return write_all(stream->fd, &c, 1);
+    return (stream_put(stream, &c, 1) < 0) ? -1 : 1;
 }
 
 static int put_s(FILE *stream, const char *s) {
+    uint32_t len;
     if (!stream) return -1;
     if (!s) s = "(null)";
-    return write_all(stream->fd, s, (uint32_t)strlen(s));
+    len = (uint32_t)strlen(s);
+    return (stream_put(stream, s, len) < 0) ? -1 : (int)len;
 }
 
 int fileno(FILE *stream) {
@@ -68,13 +148,15 @@ FILE *fopen(const char *path, const char *mode) {
     fd = open(path, flags);
     if (fd < 0) return NULL;
 
-    for (int i = 0; i < 16; i++) {
+    for (int i = 0; i < FILE_POOL_SIZE; i++) {
         if (!g_fpool_used[i]) {
             g_fpool_used[i] = 1;
+            memset(&g_fpool[i], 0, sizeof(g_fpool[i]));
             g_fpool[i].fd = fd;
-            g_fpool[i].eof = 0;
-            g_fpool[i].error = 0;
             g_fpool[i].mode = m;
+            g_fpool[i].buf_mode = FILE_BUF_AUTO;
+            g_fpool[i].buf = g_fpool_buf[i];
+            g_fpool[i].buf_size = BUFSIZ;
             return &g_fpool[i];
         }
     }
@@ -86,9 +168,10 @@ FILE *fopen(const char *path, const char *mode) {
 int fclose(FILE *stream) {
     int rc;
     if (!stream) return -1;
-    if (stream == stdin || stream == stdout || stream == stderr) return 0;
-    rc = close(stream->fd);
-    for (int i = 0; i < 16; i++) {
+    rc = fflush(stream);
+    if (stream == stdin || stream == stdout || stream == stderr) return rc;
+    if (close(stream->fd) != 0) rc = -1;
+    for (int i = 0; i < FILE_POOL_SIZE; i++) {
         if (stream == &g_fpool[i]) {
             g_fpool_used[i] = 0;
             break;
@@ -97,59 +180,97 @@ int fclose(FILE *stream) {
     return rc;
 }
 
+int fflush(FILE *stream) {
+    int rc = 0;
+    if (stream) return stream_flush(stream);
+    if (stream_flush(stdout) != 0) rc = -1;
+    if (stream_flush(stderr) != 0) rc = -1;
+    for (int i = 0; i < FILE_POOL_SIZE; i++) {
+        if (g_fpool_used[i] && stream_flush(&g_fpool[i]) != 0) rc = -1;
+    }
+    return rc;
+}
+
+int setvbuf(FILE *stream, char *buf, int mode, size_t size) {
+    if (!stream || (mode != _IOFBF && mode != _IOLBF && mode != _IONBF)) return -1;
+    if (stream_flush(stream) != 0) return -1;
+    stream_drop_input(stream);
+    if (buf && size > 0) {
+        stream->buf = buf;
+        stream->buf_size = (uint32_t)size;
+    }
+    if (mode != _IONBF && (!stream->buf || stream->buf_size == 0)) return -1;
+    stream->buf_mode = mode;
+    return 0;
+}
+
+void setbuf(FILE *stream, char *buf) {
+    (void)setvbuf(stream, buf, buf ? _IOFBF : _IONBF, BUFSIZ);
+}
+
 size_t fread(void *ptr, size_t size, size_t nmemb, FILE *stream) {
+    char *out = (char*)ptr;
     size_t total;
-    int32_t n;
+    size_t got = 0;
     if (!ptr || !stream || size == 0 || nmemb == 0) return 0;
-    if (!(stream->mode & FILE_MODE_READ)) return 0;
+    if (stream_begin_read(stream) != 0) return 0;
 
     total = size * nmemb;
-    n = read(stream->fd, ptr, (uint32_t)total);
-    if (n <= 0) {
-        if (n == 0) stream->eof = 1;
-        else stream->error = 1;
-        return 0;
+    while (got < total) {
+        uint32_t avail = stream->r_len - stream->r_pos;
+        if (avail > 0) {
+            if (avail > total - got) avail = (uint32_t)(total - got);
+            memcpy(out + got, stream->buf + stream->r_pos, avail);
+            stream->r_pos += avail;
+            got += avail;
+            continue;
+        }
+        if (got > 0 && stream->buf_mode != _IOFBF) break;
+        if (stream->buf_mode == _IONBF || total - got >= stream->buf_size) {
+            int32_t n = stream_read_raw(stream, out + got, (uint32_t)(total - got));
+            if (n <= 0) break;
+            got += (size_t)n;
+            continue;
+        }
+        if (stream_fill(stream) != 0) break;
     }
-    return (size_t)n / size;
+    return got / size;
 }
 
 size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream) {
-    size_t total;
-    int32_t n;
     if (!ptr || !stream || size == 0 || nmemb == 0) return 0;
-    if (!(stream->mode & FILE_MODE_WRITE)) return 0;
-
-    total = size * nmemb;
-    if (stream->mode & FILE_MODE_APPEND) {
-        n = append(stream->fd, ptr, (uint32_t)total);
-    } else {
-        n = write(stream->fd, ptr, (uint32_t)total);
-    }
-    if (n <= 0) {
-        stream->error = 1;
-        return 0;
-    }
-    return (size_t)n / size;
+    if (stream_put(stream, (const char*)ptr, (uint32_t)(size * nmemb)) != 0) return 0;
+    return nmemb;
 }
 
 int fgetc(FILE *stream) {
     char c = 0;
-    if (fread(&c, 1, 1, stream) != 1) return -1;
+    if (stream && stream->r_pos < stream->r_len) return (unsigned char)stream->buf[stream->r_pos++];
+    if (fread(&c, 1, 1, stream) != 1) return EOF;
     return (unsigned char)c;
 }
 
 int fputc(int c, FILE *stream) {
     char ch = (char)c;
-    if (fwrite(&ch, 1, 1, stream) != 1) return -1;
+    if (stream_put(stream, &ch, 1) != 0) return EOF;
     return (unsigned char)ch;
 }
 
 char *fgets(char *s, int size, FILE *stream) {
     int i = 0;
     if (!s || !stream || size <= 1) return NULL;
+    if (stream_begin_read(stream) != 0) return NULL;
 
     while (i < size - 1) {
-        int c = fgetc(stream);
+        int c;
+        if (stream->r_pos < stream->r_len) {
+            c = (unsigned char)stream->buf[stream->r_pos++];
+        } else if (stream->buf_mode == _IONBF) {
+            c = fgetc(stream);
+        } else {
+            if (stream_fill(stream) != 0) break;
+            continue;
+        }
         if (c < 0) break;
         s[i++] = (char)c;
         if (c == '\n') break;
@@ -171,7 +292,7 @@ int puts(const char *s) {
     return n + 1;
 }
 
-int vfprintf(FILE *stream, const char *fmt, va_list ap) {
+static int format_out(FILE *stream, const char *fmt, va_list ap) {
     int written = 0;
     char num[32];
 
@@ -243,6 +364,29 @@ int vfprintf(FILE *stream, const char *fmt, va_list ap) {
     return written;
 }
 
+int vfprintf(FILE *stream, const char *fmt, va_list ap) {
+    char tmp[256];
+    char *saved_buf;
+    uint32_t saved_size;
+    int n;
+    if (!stream) return -1;
+    stream_setup(stream);
+    if (stream->buf_mode != _IONBF) return format_out(stream, fmt, ap);
+
+    /* Unbuffered streams still get one write per call, not one per character. */
+    saved_buf = stream->buf;
+    saved_size = stream->buf_size;
+    stream->buf = tmp;
+    stream->buf_size = sizeof(tmp);
+    stream->buf_mode = _IOFBF;
+    n = format_out(stream, fmt, ap);
+    if (stream_flush(stream) != 0) n = -1;
+    stream->buf = saved_buf;
+    stream->buf_size = saved_size;
+    stream->buf_mode = _IONBF;
+    return n;
+}
+
 int fprintf(FILE *stream, const char *fmt, ...) {
     va_list ap;
     int n;
@@ -1,25 +1,107 @@
 #include <string.h>
 
+#define HAS_ZERO(v) (((v) - 0x01010101u) & ~(v) & 0x80808080u)
+
+typedef uint32_t __attribute__((__may_alias__, __aligned__(1))) word_t;
+
+static inline void copy_forward(unsigned char *d, const unsigned char *s, size_t n) {
+    if (n >= 16) {
+        size_t head = (size_t)(-(uintptr_t)d & 3u);
+        size_t words;
+        n -= head;
+        __asm__ __volatile__("rep movsb" : "+D"(d), "+S"(s), "+c"(head) : : "memory");
+        words = n >> 2;
+        __asm__ __volatile__("rep movsl" : "+D"(d), "+S"(s), "+c"(words) : : "memory");
+        n &= 3u;
+    }
+    __asm__ __volatile__("rep movsb" : "+D"(d), "+S"(s), "+c"(n) : : "memory");
+}
+
 void *memcpy(void *dst, const void *src, size_t n) {
+    copy_forward((unsigned char*)dst, (const unsigned char*)src, n);
+    return dst;
+}
+
+void *memmove(void *dst, const void *src, size_t n) {
     unsigned char *d = (unsigned char*)dst;
     const unsigned char *s = (const unsigned char*)src;
-    for (size_t i = 0; i < n; i++) d[i] = s[i];
+    if (d <= s || d >= s + n) {
+        copy_forward(d, s, n);
+        return dst;
+    }
+    d += n;
+    s += n;
+    while (n & 3u) {
+        *--d = *--s;
+        n--;
+    }
+    while (n) {
+        d -= 4;
+        s -= 4;
+        *(word_t*)d = *(const word_t*)s;
+        n -= 4;
+    }
     return dst;
 }
 
 void *memset(void *dst, int c, size_t n) {
     unsigned char *d = (unsigned char*)dst;
-    for (size_t i = 0; i < n; i++) d[i] = (unsigned char)c;
+    uint32_t v = (unsigned char)c * 0x01010101u;
+    if (n >= 16) {
+        size_t head = (size_t)(-(uintptr_t)d & 3u);
+        size_t words;
+        n -= head;
+        __asm__ __volatile__("rep stosb" : "+D"(d), "+c"(head) : "a"(v) : "memory");
+        words = n >> 2;
+        __asm__ __volatile__("rep stosl" : "+D"(d), "+c"(words) : "a"(v) : "memory");
+        n &= 3u;
+    }
+    __asm__ __volatile__("rep stosb" : "+D"(d), "+c"(n) : "a"(v) : "memory");
     return dst;
 }
 
+int memcmp(const void *a, const void *b, size_t n) {
+    const unsigned char *x = (const unsigned char*)a;
+    const unsigned char *y = (const unsigned char*)b;
+    while (n >= 4 && *(const word_t*)x == *(const word_t*)y) {
+        x += 4; y += 4; n -= 4;
+    }
+    for (; n; n--, x++, y++) {
+        if (*x != *y) return *x - *y;
+    }
+    return 0;
+}
+
 size_t strlen(const char *s) {
-    size_t n = 0;
-    while (s[n]) n++;
-    return n;
+    const char *p = s;
+    const word_t *w;
+    while ((uintptr_t)p & 3u) {
+        if (!*p) return (size_t)(p - s);
+        p++;
+    }
+    w = (const word_t*)p;
+    while (!HAS_ZERO(*w)) w++;
+    for (p = (const char*)w; *p; p++) {}
+    return (size_t)(p - s);
 }
 
 int strcmp(const char *a, const char *b) {
+    if ((((uintptr_t)a ^ (uintptr_t)b) & 3u) == 0) {
+        const word_t *wa;
+        const word_t *wb;
+        while (((uintptr_t)a & 3u) && *a && *a == *b) {
+            a++; b++;
+        }
+        if (((uintptr_t)a & 3u) == 0) {
+            wa = (const word_t*)a;
+            wb = (const word_t*)b;
+            while (*wa == *wb && !HAS_ZERO(*wa)) {
+                wa++; wb++;
+            }
+            a = (const char*)wa;
+            b = (const char*)wb;
+        }
+    }
     while (*a && *b && *a == *b) {
         a++; b++;
     }
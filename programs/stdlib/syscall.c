@@ -2,9 +2,17 @@
 #include <stdarg.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <stdio.h>
 
 int errno = 0;
 
+/* Weak so programs that never touch stdio do not pull its buffers in. */
+extern int fflush(FILE *stream) __attribute__((weak));
+
+static void stdio_flush_all(void) {
+    if (fflush) (void)fflush(NULL);
+}
+
 static int32_t syscall_ret(uint32_t raw) {
     int32_t v = (int32_t)raw;
     if (v < 0) {
@@ -44,6 +52,7 @@ void sleep(uint32_t ms) { (void)syscall1(SYSCALL_SLEEP, ms); }
 uint32_t get_ticks(void) { return syscall0(SYSCALL_GET_TICKS); }
 
 void exit(int code) {
+    stdio_flush_all();
     (void)syscall1(SYSCALL_EXIT, (uint32_t)code);
     __asm__ __volatile__("ud2");
     for (;;) __asm__ __volatile__("hlt");
@@ -51,8 +60,14 @@ void exit(int code) {
 
 ssize_t read(int fd, void *buf, size_t size) { return syscall_ret(syscall3(SYSCALL_READ, (uint32_t)fd, (uint32_t)buf, (uint32_t)size)); }
 ssize_t write(int fd, const void *buf, size_t size) { return syscall_ret(syscall3(SYSCALL_WRITE, (uint32_t)fd, (uint32_t)buf, (uint32_t)size)); }
-int32_t exec(const char *path) { return syscall_ret(syscall1(SYSCALL_EXEC, (uint32_t)path)); }
-int32_t execv(const char *path, const char *cmdline) { return syscall_ret(syscall2(SYSCALL_EXECV, (uint32_t)path, (uint32_t)cmdline)); }
+int32_t exec(const char *path) {
+    stdio_flush_all();
+    return syscall_ret(syscall1(SYSCALL_EXEC, (uint32_t)path));
+}
+int32_t execv(const char *path, const char *cmdline) {
+    stdio_flush_all();
+    return syscall_ret(syscall2(SYSCALL_EXECV, (uint32_t)path, (uint32_t)cmdline));
+}
 int32_t ioctl(int fd, uint32_t req, void *arg) { return syscall_ret(syscall3(SYSCALL_IOCTL, (uint32_t)fd, req, (uint32_t)arg)); }
 int32_t open(const char *path, int flags, ...) { return syscall_ret(syscall2(SYSCALL_OPEN, (uint32_t)path, (uint32_t)flags)); }
 int32_t close(int fd) { return syscall_ret(syscall1(SYSCALL_CLOSE, (uint32_t)fd)); }
@@ -64,12 +79,19 @@ int32_t rmdir(const char *path) { return syscall_ret(syscall1(SYSCALL_RMDIR, (ui
 int32_t link(const char *oldpath, const char *newpath) { return syscall_ret(syscall2(SYSCALL_LINK, (uint32_t)oldpath, (uint32_t)newpath)); }
 int32_t list(const char *path, char *buf, uint32_t size) { return syscall_ret(syscall3(SYSCALL_LIST, (uint32_t)path, (uint32_t)buf, size)); }
 ssize_t append(int fd, const void *buf, size_t size) { return syscall_ret(syscall3(SYSCALL_APPEND, (uint32_t)fd, (uint32_t)buf, (uint32_t)size)); }
+ssize_t copy_file_range(int in_fd, int out_fd, size_t count) { return syscall_ret(syscall3(SYSCALL_COPY_FILE_RANGE, (uint32_t)in_fd, (uint32_t)out_fd, (uint32_t)count)); }
 int32_t spawn(const char *path, const char *tty) { return syscall_ret(syscall2(SYSCALL_SPAWN, (uint32_t)path, (uint32_t)tty)); }
 int32_t spawnv(const char *path, const char *tty, const char *cmdline) { return syscall_ret(syscall3(SYSCALL_SPAWNV, (uint32_t)path, (uint32_t)tty, (uint32_t)cmdline)); }
 int32_t task_state(int32_t pid) { return syscall_ret(syscall1(SYSCALL_TASK_STATE, (uint32_t)pid)); }
 int32_t task_kill(int32_t pid, int32_t sig) {
     return syscall_ret(syscall2(SYSCALL_TASK_KILL, (uint32_t)pid, (uint32_t)sig));
 }
+int32_t task_set_nice(int32_t pid, int32_t nice) {
+    return syscall_ret(syscall2(SYSCALL_SET_NICE, (uint32_t)pid, (uint32_t)nice));
+}
+int32_t task_get_nice(int32_t pid, int32_t *nice_out) {
+    return syscall_ret(syscall2(SYSCALL_GET_NICE, (uint32_t)pid, (uint32_t)nice_out));
+}
 int32_t waitpid(int32_t pid, int32_t *status, uint32_t options) {
     return syscall_ret(syscall3(SYSCALL_WAITPID, (uint32_t)pid, (uint32_t)status, options));
 }
@@ -96,7 +118,10 @@ int32_t fcntl(int fd, int cmd, ...) {
     }
     return syscall_ret(syscall3(SYSCALL_FCNTL, (uint32_t)fd, (uint32_t)cmd, arg));
 }
-int32_t fork(void) { return syscall_ret(syscall0(SYSCALL_FORK)); }
+int32_t fork(void) {
+    stdio_flush_all();
+    return syscall_ret(syscall0(SYSCALL_FORK));
+}
 int32_t sys_poll_raw(void *fds, uint32_t nfds, int32_t timeout_ms) {
     return syscall_ret(syscall3(SYSCALL_POLL, (uint32_t)fds, nfds, (uint32_t)timeout_ms));
 }